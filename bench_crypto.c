@@ -0,0 +1,588 @@
+/* clock_gettime, getopt and sched_setaffinity with CMAKE_C_EXTENSIONS off */
+#define _GNU_SOURCE
+
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ed25519.h"
+#include "ge.h"
+#include "sha512.h"
+#include "wallet_aead.h"
+#include "wallet_crypto.h"
+#include "wallet_verify.h"
+
+#define BENCH_MAX_MESSAGE 16384u
+#define BENCH_MAX_BASELINE 128u
+#define BENCH_NAME_LEN 64u
+#define BENCH_MAX_RUNS 64u
+/* Calibration doubles the iteration count until one batch takes this long. */
+#define BENCH_CALIBRATE_S 0.01
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BENCH_HAVE_TSC 1
+#else
+#define BENCH_HAVE_TSC 0
+#endif
+
+static const size_t bench_message_sizes[] = { 32u, 256u, 1232u, BENCH_MAX_MESSAGE };
+
+typedef struct
+{
+    uint8_t seed[WALLET_SEED_LEN];
+    uint8_t scalar[32];
+    uint8_t public_key[WALLET_PUBLIC_KEY_LEN];
+    uint8_t private_key[WALLET_PRIVATE_KEY_LEN];
+    uint8_t signature[64];
+    uint8_t digest[64];
+    uint8_t tag[WALLET_AEAD_TAG_LEN];
+    uint8_t message[BENCH_MAX_MESSAGE];
+    size_t message_len;
+    WalletKdfParams kdf;
+    uint8_t blob[WALLET_BLOB_LEN];
+    uint8_t decrypted[WALLET_PRIVATE_KEY_LEN];
+    int failed;
+} BenchState;
+
+typedef void (*BenchFn)(BenchState *state, size_t iterations);
+
+typedef struct
+{
+    const char *name;
+    BenchFn run;
+    int sized;
+    int kdf;
+    double tolerance;
+} BenchCase;
+
+typedef struct
+{
+    char name[BENCH_NAME_LEN];
+    size_t bytes;
+    double ns_per_op;
+    double tolerance;
+} BenchBaseline;
+
+typedef struct
+{
+    int cpu;
+    double run_seconds;
+    unsigned int runs;
+    int json;
+    const char *filter;
+    const char *baseline_path;
+    double tolerance;
+} BenchOptions;
+
+static void usage(const char *program);
+static int pin_to_cpu(int cpu);
+static double monotonic_seconds(void);
+static uint64_t read_cycles(void);
+static int compare_doubles(const void *a, const void *b);
+static int prepare_state(BenchState *state, const BenchCase *bench, size_t bytes);
+static void measure(const BenchCase *bench, BenchState *state, const BenchOptions *options,
+                    double *out_ns, double *out_cycles);
+static size_t load_baseline(const char *path, BenchBaseline *entries, size_t capacity);
+static const BenchBaseline *find_baseline(const BenchBaseline *entries, size_t count, const char *name, size_t bytes);
+
+static void bench_sha512(BenchState *state, size_t iterations);
+static void bench_create_keypair(BenchState *state, size_t iterations);
+static void bench_scalarmult_base(BenchState *state, size_t iterations);
+static void bench_sign(BenchState *state, size_t iterations);
+static void bench_verify(BenchState *state, size_t iterations);
+static void bench_wallet_verify(BenchState *state, size_t iterations);
+static void bench_aead(BenchState *state, size_t iterations);
+static void bench_encrypt(BenchState *state, size_t iterations);
+static void bench_decrypt(BenchState *state, size_t iterations);
+
+/*
+ * kdf: 0 none, else the WalletKdfId the blob is sealed with. tolerance is the
+ * percent slowdown allowed against the baseline: tight for the compute-bound
+ * primitives, looser for the threaded PBKDF2 lanes and the memory-bound Argon2id.
+ */
+static const BenchCase bench_cases[] = {
+    { "sha512", bench_sha512, 1, 0, 10.0 },
+    { "ed25519_create_keypair", bench_create_keypair, 0, 0, 10.0 },
+    { "ge_scalarmult_base", bench_scalarmult_base, 0, 0, 10.0 },
+    { "ed25519_sign", bench_sign, 1, 0, 10.0 },
+    { "ed25519_verify", bench_verify, 1, 0, 10.0 },
+    { "wallet_verify", bench_wallet_verify, 1, 0, 15.0 },
+    { "wallet_aead_encrypt", bench_aead, 1, 0, 10.0 },
+    { "wallet_encrypt_pbkdf2", bench_encrypt, 0, WALLET_KDF_PBKDF2_SHA512, 20.0 },
+    { "wallet_decrypt_pbkdf2", bench_decrypt, 0, WALLET_KDF_PBKDF2_SHA512, 20.0 },
+    { "wallet_encrypt_argon2id", bench_encrypt, 0, WALLET_KDF_ARGON2ID, 25.0 },
+    { "wallet_decrypt_argon2id", bench_decrypt, 0, WALLET_KDF_ARGON2ID, 25.0 },
+};
+
+int main(int argc, char **argv)
+{
+    BenchOptions options = { 0, 0.2, 5u, 0, NULL, NULL, -1.0 };
+    BenchBaseline baseline[BENCH_MAX_BASELINE];
+    size_t baseline_count = 0u;
+    BenchState *state = NULL;
+    unsigned int regressions = 0u;
+    int first = 1;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "c:m:r:jf:b:t:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'c':
+                options.cpu = atoi(optarg);
+                break;
+            case 'm':
+                options.run_seconds = atof(optarg) / 1000.0;
+                break;
+            case 'r':
+                options.runs = (unsigned int)strtoul(optarg, NULL, 10);
+                break;
+            case 'j':
+                options.json = 1;
+                break;
+            case 'f':
+                options.filter = optarg;
+                break;
+            case 'b':
+                options.baseline_path = optarg;
+                break;
+            case 't':
+                options.tolerance = atof(optarg);
+                break;
+            default:
+                usage(argv[0]);
+                return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    if ((optind != argc) || (options.runs == 0u) || (options.runs > BENCH_MAX_RUNS) || (options.run_seconds <= 0.0))
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (options.baseline_path != NULL)
+    {
+        baseline_count = load_baseline(options.baseline_path, baseline, BENCH_MAX_BASELINE);
+        if (baseline_count == 0u)
+        {
+            fprintf(stderr, "No results in baseline %s.\n", options.baseline_path);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if ((options.cpu >= 0) && (pin_to_cpu(options.cpu) != 0))
+    {
+        fprintf(stderr, "Could not pin to CPU %d; timings may be noisy.\n", options.cpu);
+        options.cpu = -1;
+    }
+
+    state = calloc(1u, sizeof(*state));
+    if (state == NULL)
+    {
+        fprintf(stderr, "Out of memory.\n");
+        return EXIT_FAILURE;
+    }
+
+    if (options.json)
+    {
+        printf("{\n  \"cpu\": %d,\n  \"run_ms\": %.0f,\n  \"runs\": %u,\n  \"timer\": \"%s\",\n  \"results\": [\n",
+               options.cpu, options.run_seconds * 1000.0, options.runs, BENCH_HAVE_TSC ? "tsc" : "none");
+    }
+    else
+    {
+        printf("%-26s %7s %14s %14s %12s\n", "benchmark", "bytes", "ops/s", "ns/op", "cycles/op");
+    }
+
+    for (size_t index = 0u; index < sizeof(bench_cases) / sizeof(bench_cases[0]); index++)
+    {
+        const BenchCase *bench = &bench_cases[index];
+        size_t size_count = bench->sized ? sizeof(bench_message_sizes) / sizeof(bench_message_sizes[0]) : 1u;
+
+        if ((options.filter != NULL) && (strstr(bench->name, options.filter) == NULL))
+        {
+            continue;
+        }
+
+        for (size_t size_index = 0u; size_index < size_count; size_index++)
+        {
+            size_t bytes = bench->sized ? bench_message_sizes[size_index] : 0u;
+            const BenchBaseline *reference = NULL;
+            double ns_per_op = 0.0;
+            double cycles_per_op = 0.0;
+
+            if (prepare_state(state, bench, bytes) != APP_OK)
+            {
+                fprintf(stderr, "%s: setup failed.\n", bench->name);
+                free(state);
+                return EXIT_FAILURE;
+            }
+
+            measure(bench, state, &options, &ns_per_op, &cycles_per_op);
+            if (state->failed)
+            {
+                fprintf(stderr, "%s: operation failed.\n", bench->name);
+                free(state);
+                return EXIT_FAILURE;
+            }
+
+            if (options.json)
+            {
+                printf("%s    {\"name\": \"%s\", \"bytes\": %zu, \"ops_per_sec\": %.1f, \"ns_per_op\": %.1f, ",
+                       first ? "" : ",\n", bench->name, bytes, 1e9 / ns_per_op, ns_per_op);
+                if (BENCH_HAVE_TSC)
+                {
+                    printf("\"cycles_per_op\": %.0f, ", cycles_per_op);
+                }
+                else
+                {
+                    printf("\"cycles_per_op\": null, ");
+                }
+                printf("\"tolerance\": %.0f}", bench->tolerance);
+            }
+            else
+            {
+                printf("%-26s %7zu %14.1f %14.1f %12.0f\n", bench->name, bytes, 1e9 / ns_per_op, ns_per_op, cycles_per_op);
+            }
+            fflush(stdout);
+            first = 0;
+
+            reference = find_baseline(baseline, baseline_count, bench->name, bytes);
+            if (reference != NULL)
+            {
+                double change = (ns_per_op / reference->ns_per_op - 1.0) * 100.0;
+                double tolerance = options.tolerance;
+                int regressed = 0;
+
+                if (tolerance < 0.0)
+                {
+                    tolerance = (reference->tolerance >= 0.0) ? reference->tolerance : bench->tolerance;
+                }
+                regressed = change > tolerance;
+
+                fprintf(stderr, "%-26s %7zu %+7.1f%% vs baseline (limit %.0f%%)%s\n", bench->name, bytes, change,
+                        tolerance, regressed ? "  REGRESSION" : "");
+                if (regressed)
+                {
+                    regressions++;
+                }
+            }
+        }
+    }
+
+    if (options.json)
+    {
+        printf("\n  ]\n}\n");
+    }
+
+    wallet_secure_zero(state, sizeof(*state));
+    free(state);
+
+    if (regressions != 0u)
+    {
+        fprintf(stderr, "%u benchmark(s) slower than the baseline by more than their tolerance.\n", regressions);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static void usage(const char *program)
+{
+    fprintf(stderr,
+            "Usage: %s [-c cpu] [-m run_ms] [-r runs] [-j] [-f filter] [-b baseline.json [-t percent]]\n"
+            "Times the keypair/ primitives, ChaCha20-Poly1305 and the wallet blob KDFs on\n"
+            "one thread pinned to cpu (default 0, -1 to leave unpinned). Each figure is\n"
+            "the median of runs batches of at least run_ms (default 5 x 200 ms). -j\n"
+            "prints JSON; -b compares against an earlier -j output and exits non-zero\n"
+            "when a benchmark is slower than its tolerance allows. Each case has its own\n"
+            "tolerance, which -j records and a baseline line may override; -t percent\n"
+            "applies one tolerance to every case. Cycles are TSC ticks, so they follow\n"
+            "the base clock rather than the boosted one.\n",
+            program);
+}
+
+static int pin_to_cpu(int cpu)
+{
+#ifdef __linux__
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set);
+#else
+    (void)cpu;
+    return -1;
+#endif
+}
+
+static double monotonic_seconds(void)
+{
+    struct timespec now;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + ((double)now.tv_nsec / 1e9);
+}
+
+static uint64_t read_cycles(void)
+{
+#if BENCH_HAVE_TSC
+    return __builtin_ia32_rdtsc();
+#else
+    return 0u;
+#endif
+}
+
+static int compare_doubles(const void *a, const void *b)
+{
+    double left = *(const double *)a;
+    double right = *(const double *)b;
+
+    return (left > right) - (left < right);
+}
+
+/* Fresh key, message and (for decrypt) a sealed blob, so each case starts from the same state. */
+static int prepare_state(BenchState *state, const BenchCase *bench, size_t bytes)
+{
+    int status = APP_OK;
+
+    state->failed = 0;
+    state->message_len = bytes;
+    memset(state->message, 0xa5, sizeof(state->message));
+    status = wallet_random_bytes(state->seed, sizeof(state->seed));
+    if (status == APP_OK)
+    {
+        status = wallet_random_bytes(state->scalar, sizeof(state->scalar));
+    }
+    if (status != APP_OK)
+    {
+        return status;
+    }
+
+    state->scalar[31] &= 127u;
+    ed25519_create_keypair(state->public_key, state->private_key, state->seed);
+    ed25519_sign(state->signature, state->message, state->message_len, state->public_key, state->private_key);
+    wallet_verify_cache_clear();
+
+    if (bench->kdf == WALLET_KDF_ARGON2ID)
+    {
+        /* The floor, not a calibrated cost: the figure should track the code, not the host. */
+        state->kdf.id = WALLET_KDF_ARGON2ID;
+        state->kdf.cost = WALLET_KDF_ARGON2_MIN_MEMORY_KIB;
+        state->kdf.passes = WALLET_KDF_ARGON2_PASSES;
+        state->kdf.lanes = 1u;
+    }
+    else
+    {
+        wallet_kdf_default_params(&state->kdf);
+    }
+
+    if (bench->kdf != 0)
+    {
+        status = wallet_encrypt_private_key_kdf("benchmark", &state->kdf, state->private_key, sizeof(state->private_key),
+                                                state->blob, sizeof(state->blob));
+    }
+
+    return status;
+}
+
+/* Median ns/op over options->runs batches, each sized to last at least run_seconds. */
+static void measure(const BenchCase *bench, BenchState *state, const BenchOptions *options,
+                    double *out_ns, double *out_cycles)
+{
+    double ns_samples[BENCH_MAX_RUNS];
+    double cycle_samples[BENCH_MAX_RUNS];
+    size_t iterations = 1u;
+    double elapsed = 0.0;
+
+    for (;;)
+    {
+        double start = monotonic_seconds();
+
+        bench->run(state, iterations);
+        elapsed = monotonic_seconds() - start;
+        if ((elapsed >= BENCH_CALIBRATE_S) || (elapsed >= options->run_seconds))
+        {
+            break;
+        }
+        iterations *= 2u;
+    }
+
+    if (elapsed < options->run_seconds)
+    {
+        iterations = (size_t)((double)iterations * options->run_seconds / elapsed) + 1u;
+    }
+
+    for (unsigned int run = 0u; run < options->runs; run++)
+    {
+        double start = monotonic_seconds();
+        uint64_t cycles = read_cycles();
+
+        bench->run(state, iterations);
+        cycles = read_cycles() - cycles;
+        ns_samples[run] = (monotonic_seconds() - start) * 1e9 / (double)iterations;
+        cycle_samples[run] = (double)cycles / (double)iterations;
+    }
+
+    qsort(ns_samples, options->runs, sizeof(ns_samples[0]), compare_doubles);
+    qsort(cycle_samples, options->runs, sizeof(cycle_samples[0]), compare_doubles);
+    *out_ns = ns_samples[options->runs / 2u];
+    *out_cycles = cycle_samples[options->runs / 2u];
+}
+
+/*
+ * Reads the result lines of a -j run; anything else in the file is skipped.
+ * A line without a "tolerance" field falls back to the case's own tolerance.
+ */
+static size_t load_baseline(const char *path, BenchBaseline *entries, size_t capacity)
+{
+    FILE *file = fopen(path, "r");
+    char line[512];
+    size_t count = 0u;
+
+    if (file == NULL)
+    {
+        return 0u;
+    }
+
+    while ((count < capacity) && (fgets(line, sizeof(line), file) != NULL))
+    {
+        const char *name = strstr(line, "\"name\": \"");
+        const char *bytes = strstr(line, "\"bytes\": ");
+        const char *ns = strstr(line, "\"ns_per_op\": ");
+        const char *tolerance = strstr(line, "\"tolerance\": ");
+        BenchBaseline *entry = &entries[count];
+
+        if ((name == NULL) || (bytes == NULL) || (ns == NULL))
+        {
+            continue;
+        }
+
+        if ((sscanf(name + 9, "%63[^\"]", entry->name) == 1) &&
+            (sscanf(bytes + 9, "%zu", &entry->bytes) == 1) &&
+            (sscanf(ns + 13, "%lf", &entry->ns_per_op) == 1) &&
+            (entry->ns_per_op > 0.0))
+        {
+            if ((tolerance == NULL) || (sscanf(tolerance + 13, "%lf", &entry->tolerance) != 1) ||
+                (entry->tolerance < 0.0))
+            {
+                entry->tolerance = -1.0;
+            }
+            count++;
+        }
+    }
+
+    fclose(file);
+    return count;
+}
+
+static const BenchBaseline *find_baseline(const BenchBaseline *entries, size_t count, const char *name, size_t bytes)
+{
+    for (size_t index = 0u; index < count; index++)
+    {
+        if ((entries[index].bytes == bytes) && (strcmp(entries[index].name, name) == 0))
+        {
+            return &entries[index];
+        }
+    }
+
+    return NULL;
+}
+
+static void bench_sha512(BenchState *state, size_t iterations)
+{
+    for (size_t i = 0u; i < iterations; i++)
+    {
+        sha512(state->message, state->message_len, state->digest);
+        state->message[0] = state->digest[0];
+    }
+}
+
+static void bench_create_keypair(BenchState *state, size_t iterations)
+{
+    for (size_t i = 0u; i < iterations; i++)
+    {
+        ed25519_create_keypair(state->public_key, state->private_key, state->seed);
+        state->seed[0] = state->public_key[0];
+    }
+}
+
+static void bench_scalarmult_base(BenchState *state, size_t iterations)
+{
+    ge_p3 point;
+
+    for (size_t i = 0u; i < iterations; i++)
+    {
+        ge_scalarmult_base(&point, state->scalar);
+        ge_p3_tobytes(state->digest, &point);
+        state->scalar[0] = state->digest[0];
+    }
+}
+
+static void bench_sign(BenchState *state, size_t iterations)
+{
+    for (size_t i = 0u; i < iterations; i++)
+    {
+        ed25519_sign(state->signature, state->message, state->message_len, state->public_key, state->private_key);
+    }
+}
+
+static void bench_verify(BenchState *state, size_t iterations)
+{
+    for (size_t i = 0u; i < iterations; i++)
+    {
+        if (ed25519_verify(state->signature, state->message, state->message_len, state->public_key) != 1)
+        {
+            state->failed = 1;
+        }
+    }
+}
+
+static void bench_wallet_verify(BenchState *state, size_t iterations)
+{
+    for (size_t i = 0u; i < iterations; i++)
+    {
+        if (wallet_verify(state->signature, state->message, state->message_len, state->public_key) != 1)
+        {
+            state->failed = 1;
+        }
+    }
+}
+
+/* Encrypts the message in place; the seed and scalar stand in for key and nonce. */
+static void bench_aead(BenchState *state, size_t iterations)
+{
+    for (size_t i = 0u; i < iterations; i++)
+    {
+        (void)wallet_aead_encrypt(state->seed, state->scalar, NULL, 0u, state->message, state->message_len,
+                                  state->message, state->tag);
+    }
+}
+
+static void bench_encrypt(BenchState *state, size_t iterations)
+{
+    for (size_t i = 0u; i < iterations; i++)
+    {
+        if (wallet_encrypt_private_key_kdf("benchmark", &state->kdf, state->private_key, sizeof(state->private_key),
+                                           state->blob, sizeof(state->blob)) != APP_OK)
+        {
+            state->failed = 1;
+        }
+    }
+}
+
+static void bench_decrypt(BenchState *state, size_t iterations)
+{
+    for (size_t i = 0u; i < iterations; i++)
+    {
+        if (wallet_decrypt_private_key("benchmark", state->blob, sizeof(state->blob),
+                                       state->decrypted, sizeof(state->decrypted)) != APP_OK)
+        {
+            state->failed = 1;
+        }
+    }
+}
@@ -0,0 +1,470 @@
+/* pipe2, usleep, clock_gettime and SOCK_CLOEXEC with CMAKE_C_EXTENSIONS off */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#ifdef __linux__
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#endif
+
+#include "calc_discovery.h"
+#include "calc_session.h"
+
+#define CALC_DISCOVERY_RESCAN_MS 1000
+#define CALC_DISCOVERY_SETTLE_MS 20
+#define CALC_DISCOVERY_UEVENT_SIZE 4096
+/* uevent PRODUCT= prefix (vendor id in hex, no leading zeros) of Texas Instruments devices */
+#define CALC_DISCOVERY_TI_PRODUCT "PRODUCT=451/"
+
+typedef struct
+{
+    CableDeviceInfo info;
+    CableModel cable_model;
+    CalcModel calc_model;
+} CalcDiscoveryDevice;
+
+typedef struct
+{
+    pthread_mutex_t control; /* held for the whole of start and stop */
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    int running;
+    int thread_started;
+    pthread_t thread;
+    int uevent_fd;
+    int wake_fds[2];
+    int wake_open;
+    unsigned int generation;
+    int device_count;
+    CalcDiscoveryDevice devices[CALC_DISCOVERY_MAX_DEVICES];
+} CalcDiscovery;
+
+static CalcDiscovery discovery = {
+    .control = PTHREAD_MUTEX_INITIALIZER,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .changed = PTHREAD_COND_INITIALIZER,
+    .uevent_fd = -1,
+};
+
+static void *calc_discovery_thread(void *arg);
+static void calc_discovery_rescan(int ti_event);
+static int calc_discovery_open_uevent(void);
+static int calc_discovery_read_uevent(int fd);
+static void calc_discovery_drain(int fd);
+static void calc_discovery_stop_locked(void);
+
+int calc_discovery_start(void)
+{
+    int status = APP_OK;
+
+    pthread_mutex_lock(&discovery.control);
+    pthread_mutex_lock(&discovery.lock);
+    if (discovery.running != 0)
+    {
+        pthread_mutex_unlock(&discovery.lock);
+        pthread_mutex_unlock(&discovery.control);
+        return APP_OK;
+    }
+    discovery.running = 1;
+    discovery.uevent_fd = -1;
+    pthread_mutex_unlock(&discovery.lock);
+
+    calc_discovery_rescan(0);
+
+    /* Non-blocking, so a wakeup on a full pipe is dropped instead of blocking the caller. */
+    pthread_mutex_lock(&discovery.lock);
+    if (pipe2(discovery.wake_fds, O_NONBLOCK | O_CLOEXEC) != 0)
+    {
+        status = APP_ERR_THREAD;
+    }
+    else
+    {
+        discovery.wake_open = 1;
+    }
+    pthread_mutex_unlock(&discovery.lock);
+
+    if (status == APP_OK)
+    {
+        discovery.uevent_fd = calc_discovery_open_uevent();
+        if (discovery.uevent_fd < 0)
+        {
+            printf("Hotplug events unavailable, rescanning USB every %d ms\n", CALC_DISCOVERY_RESCAN_MS);
+        }
+
+        if (pthread_create(&discovery.thread, NULL, calc_discovery_thread, NULL) != 0)
+        {
+            status = APP_ERR_THREAD;
+        }
+        else
+        {
+            discovery.thread_started = 1;
+        }
+    }
+
+    if (status != APP_OK)
+    {
+        calc_discovery_stop_locked();
+    }
+    pthread_mutex_unlock(&discovery.control);
+
+    return status;
+}
+
+void calc_discovery_stop(void)
+{
+    pthread_mutex_lock(&discovery.control);
+    calc_discovery_stop_locked();
+    pthread_mutex_unlock(&discovery.control);
+}
+
+static void calc_discovery_stop_locked(void)
+{
+    pthread_mutex_lock(&discovery.lock);
+    discovery.running = 0;
+    pthread_cond_broadcast(&discovery.changed);
+    pthread_mutex_unlock(&discovery.lock);
+
+    if (discovery.thread_started != 0)
+    {
+        calc_discovery_notify();
+        pthread_join(discovery.thread, NULL);
+        discovery.thread_started = 0;
+    }
+
+    if (discovery.uevent_fd >= 0)
+    {
+        close(discovery.uevent_fd);
+        discovery.uevent_fd = -1;
+    }
+
+    pthread_mutex_lock(&discovery.lock);
+    if (discovery.wake_open != 0)
+    {
+        close(discovery.wake_fds[0]);
+        close(discovery.wake_fds[1]);
+        discovery.wake_open = 0;
+    }
+    discovery.device_count = 0;
+    pthread_mutex_unlock(&discovery.lock);
+}
+
+int calc_discovery_running(void)
+{
+    int running;
+
+    pthread_mutex_lock(&discovery.lock);
+    running = discovery.running;
+    pthread_mutex_unlock(&discovery.lock);
+
+    return running;
+}
+
+int calc_discovery_lookup(int index, CableModel *cable_model, CalcModel *calc_model)
+{
+    int status = APP_ERR_NOT_READY;
+
+    pthread_mutex_lock(&discovery.lock);
+    if (discovery.running != 0)
+    {
+        if ((index < 0) || (index >= discovery.device_count))
+        {
+            status = APP_ERR_NO_CALC;
+        }
+        else if (discovery.devices[index].calc_model != CALC_NONE)
+        {
+            *cable_model = discovery.devices[index].cable_model;
+            *calc_model = discovery.devices[index].calc_model;
+            status = APP_OK;
+        }
+    }
+    pthread_mutex_unlock(&discovery.lock);
+
+    return status;
+}
+
+void calc_discovery_remember(int index, CableModel cable_model, CalcModel calc_model)
+{
+    pthread_mutex_lock(&discovery.lock);
+    if ((index >= 0) && (index < discovery.device_count))
+    {
+        discovery.devices[index].cable_model = cable_model;
+        discovery.devices[index].calc_model = calc_model;
+    }
+    pthread_mutex_unlock(&discovery.lock);
+}
+
+unsigned int calc_discovery_generation(void)
+{
+    unsigned int generation;
+
+    pthread_mutex_lock(&discovery.lock);
+    generation = discovery.generation;
+    pthread_mutex_unlock(&discovery.lock);
+
+    return generation;
+}
+
+unsigned int calc_discovery_wait(unsigned int generation, int timeout_ms)
+{
+    struct timespec deadline;
+    unsigned int current;
+    int running;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&discovery.lock);
+    while ((discovery.running != 0) && (discovery.generation == generation))
+    {
+        if (pthread_cond_timedwait(&discovery.changed, &discovery.lock, &deadline) == ETIMEDOUT)
+        {
+            break;
+        }
+    }
+    current = discovery.generation;
+    running = discovery.running;
+    pthread_mutex_unlock(&discovery.lock);
+
+    /* Without the service there is nothing to wait for but the timeout. */
+    if (running == 0)
+    {
+        usleep((useconds_t)(timeout_ms * 1000));
+    }
+
+    return current;
+}
+
+void calc_discovery_notify(void)
+{
+    char byte = 0;
+
+    /* Under the lock so stop cannot close the pipe between the check and the write. */
+    pthread_mutex_lock(&discovery.lock);
+    if (discovery.wake_open != 0)
+    {
+        if (write(discovery.wake_fds[1], &byte, 1) < 0)
+        {
+            /* Pipe full: a wakeup is already pending. */
+        }
+    }
+    pthread_mutex_unlock(&discovery.lock);
+}
+
+static void *calc_discovery_thread(void *arg)
+{
+    struct pollfd fds[2];
+    nfds_t fd_count = 1;
+
+    (void)arg;
+
+    fds[0].fd = discovery.wake_fds[0];
+    fds[0].events = POLLIN;
+    if (discovery.uevent_fd >= 0)
+    {
+        fds[1].fd = discovery.uevent_fd;
+        fds[1].events = POLLIN;
+        fd_count = 2;
+    }
+
+    while (calc_discovery_running() != 0)
+    {
+        int hotplug = 0;
+        int ti_event = 0;
+        int events;
+        int ready;
+
+        fds[0].revents = 0;
+        fds[1].revents = 0;
+        ready = poll(fds, fd_count, (fd_count > 1) ? -1 : CALC_DISCOVERY_RESCAN_MS);
+        if ((ready < 0) && (errno != EINTR))
+        {
+            break;
+        }
+
+        if ((fds[0].revents & POLLIN) != 0)
+        {
+            calc_discovery_drain(fds[0].fd);
+            hotplug = 1;
+        }
+
+        if ((fd_count > 1) && ((fds[1].revents & POLLIN) != 0))
+        {
+            events = calc_discovery_read_uevent(fds[1].fd);
+            hotplug |= (events != 0);
+            ti_event |= (events > 1);
+        }
+
+        if (calc_discovery_running() == 0)
+        {
+            break;
+        }
+
+        if (hotplug != 0)
+        {
+            /* Unplug/replug comes as a burst of events: let it settle first. */
+            usleep(CALC_DISCOVERY_SETTLE_MS * 1000);
+            calc_discovery_drain(fds[0].fd);
+            if (fd_count > 1)
+            {
+                while (poll(&fds[1], 1, 0) > 0)
+                {
+                    ti_event |= (calc_discovery_read_uevent(fds[1].fd) > 1);
+                }
+            }
+            calc_discovery_rescan(ti_event);
+        }
+        else if (ready == 0)
+        {
+            calc_discovery_rescan(0);
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Enumerate without probing: models already known for an unchanged slot are kept.
+ * The generation moves only when the calculators differ, or when ti_event says a
+ * TI device came or went (a quick replug of the same model looks unchanged here).
+ */
+static void calc_discovery_rescan(int ti_event)
+{
+    CableDeviceInfo *list = NULL;
+    int count = 0;
+    int changed = ti_event;
+    int i;
+
+    ticables_get_usb_device_info(&list, &count);
+    if (count > CALC_DISCOVERY_MAX_DEVICES)
+    {
+        count = CALC_DISCOVERY_MAX_DEVICES;
+    }
+
+    pthread_mutex_lock(&discovery.lock);
+    if (count != discovery.device_count)
+    {
+        changed = 1;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        CalcDiscoveryDevice *device = &discovery.devices[i];
+
+        if ((i < discovery.device_count) &&
+            (device->info.family == list[i].family) && (device->info.variant == list[i].variant))
+        {
+            continue;
+        }
+
+        changed = 1;
+        device->info = list[i];
+        device->cable_model = (list[i].family == CABLE_FAMILY_DBUS) ? CABLE_SLV : CABLE_USB;
+        device->calc_model = ticalcs_remap_model_from_usb(device->cable_model, ticalcs_device_info_to_model(&list[i]));
+    }
+    discovery.device_count = count;
+
+    if (changed != 0)
+    {
+        discovery.generation++;
+        pthread_cond_broadcast(&discovery.changed);
+    }
+    pthread_mutex_unlock(&discovery.lock);
+
+    if (list != NULL)
+    {
+        ticables_free_usb_device_info(list);
+    }
+}
+
+static int calc_discovery_open_uevent(void)
+{
+#ifdef __linux__
+    struct sockaddr_nl address;
+    int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+
+    if (fd >= 0)
+    {
+        memset(&address, 0, sizeof(address));
+        address.nl_family = AF_NETLINK;
+        address.nl_groups = 1u;
+        if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    return fd;
+#else
+    return -1;
+#endif
+}
+
+/* Returns 0 for anything else, 1 for a USB device being added or removed, 2 if it is a TI one. */
+static int calc_discovery_read_uevent(int fd)
+{
+    char buffer[CALC_DISCOVERY_UEVENT_SIZE];
+    ssize_t length = recv(fd, buffer, sizeof(buffer) - 1u, MSG_DONTWAIT);
+    int usb_device = 0;
+    int add_remove = 0;
+    int ti_device = 0;
+    size_t offset = 0u;
+
+    if (length <= 0)
+    {
+        return 0;
+    }
+    buffer[length] = '\0';
+
+    /* "ACTION@devpath\0KEY=VALUE\0KEY=VALUE\0..." */
+    while (offset < (size_t)length)
+    {
+        const char *field = buffer + offset;
+
+        if ((strcmp(field, "ACTION=add") == 0) || (strcmp(field, "ACTION=remove") == 0))
+        {
+            add_remove = 1;
+        }
+        else if (strcmp(field, "DEVTYPE=usb_device") == 0)
+        {
+            usb_device = 1;
+        }
+        else if (strncmp(field, CALC_DISCOVERY_TI_PRODUCT, strlen(CALC_DISCOVERY_TI_PRODUCT)) == 0)
+        {
+            ti_device = 1;
+        }
+        offset += strlen(field) + 1u;
+    }
+
+    if ((usb_device == 0) || (add_remove == 0))
+    {
+        return 0;
+    }
+
+    return (ti_device != 0) ? 2 : 1;
+}
+
+static void calc_discovery_drain(int fd)
+{
+    char buffer[64];
+    struct pollfd pfd;
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    while ((poll(&pfd, 1, 0) > 0) && (read(fd, buffer, sizeof(buffer)) > 0))
+    {
+    }
+}
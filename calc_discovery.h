@@ -0,0 +1,42 @@
+#ifndef CALC_DISCOVERY_H
+#define CALC_DISCOVERY_H
+
+#include "ticables.h"
+#include "ticalcs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CALC_DISCOVERY_MAX_DEVICES 4
+
+/*
+ * Process-wide cache of the USB calculators currently plugged in, kept up to
+ * date from hotplug events (netlink uevents on Linux, a periodic rescan
+ * elsewhere). Index i is the device opened on PORT_1 + i.
+ *
+ * A generation counter moves when the set of TI devices changes (or a TI
+ * device is replugged); other USB hotplug traffic leaves it alone. Sessions
+ * remember the generation they attached at and reattach when it moves (see
+ * calc_session_ensure_link).
+ */
+int calc_discovery_start(void);
+void calc_discovery_stop(void);
+int calc_discovery_running(void);
+
+/* APP_OK with the cached models, APP_ERR_NO_CALC if nothing is plugged at index,
+ * APP_ERR_NOT_READY if the service is stopped or the model still needs a probe. */
+int calc_discovery_lookup(int index, CableModel *cable_model, CalcModel *calc_model);
+void calc_discovery_remember(int index, CableModel cable_model, CalcModel calc_model);
+
+unsigned int calc_discovery_generation(void);
+/* Block until the generation differs from generation or timeout_ms elapsed. */
+unsigned int calc_discovery_wait(unsigned int generation, int timeout_ms);
+/* Force a rescan; the generation only moves if the calculators changed. */
+void calc_discovery_notify(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
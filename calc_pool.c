@@ -0,0 +1,513 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "calc_pool.h"
+#include "calc_string_store.h"
+#include "ed25519.h"
+
+static void *calc_pool_worker_thread(void *arg);
+static int calc_pool_run_job(CalcPoolWorker *worker, CalcJob *job);
+static int calc_pool_run_sign(CalcSession *session, CalcJob *job);
+static int calc_pool_is_link_error(int status);
+static CalcPoolWorker *calc_pool_pick_worker(CalcPool *pool, int avoid_device);
+static void calc_pool_enqueue(CalcPool *pool, CalcPoolWorker *worker, CalcJob *job);
+static CalcJob *calc_pool_take(CalcPool *pool, CalcPoolWorker *worker);
+static CalcJob *calc_pool_steal(CalcPool *pool, CalcPoolWorker *thief);
+static void calc_pool_dispatch(CalcPool *pool, CalcJob *job);
+static void calc_pool_finish(CalcPool *pool, CalcJob *job, int status);
+static void calc_pool_set_offline(CalcPool *pool, CalcPoolWorker *worker);
+
+/*
+ * All queues are protected by pool->lock. Jobs themselves run outside of the
+ * lock, each worker talking to its own calculator, so throughput scales with
+ * the number of units as long as the link is the bottleneck.
+ */
+
+int calc_pool_open(CalcPool *pool, int device_count)
+{
+    int status = APP_ERR_NO_CALC;
+    int online = 0;
+    int i;
+
+    if ((pool == NULL) || (device_count < 1))
+    {
+        return APP_ERR_NO_CALC;
+    }
+
+    if (device_count > CALC_POOL_MAX_DEVICES)
+    {
+        device_count = CALC_POOL_MAX_DEVICES;
+    }
+
+    memset(pool, 0, sizeof(*pool));
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->all_done, NULL);
+    pool->worker_count = device_count;
+
+    for (i = 0; i < device_count; i++)
+    {
+        CalcPoolWorker *worker = &pool->workers[i];
+
+        worker->pool = pool;
+        worker->index = i;
+        worker->session.port_number = (CablePort)(PORT_1 + i);
+
+        if (calc_session_open(&worker->session) != APP_OK)
+        {
+            fprintf(stderr, "Pool device %d unavailable\n", i);
+            continue;
+        }
+
+        worker->online = 1;
+        if (pthread_create(&worker->thread, NULL, calc_pool_worker_thread, worker) != 0)
+        {
+            worker->online = 0;
+            calc_session_cleanup(&worker->session);
+            status = APP_ERR_THREAD;
+            continue;
+        }
+
+        worker->thread_started = 1;
+        online++;
+    }
+
+    if (online > 0)
+    {
+        printf("Calculator pool: %d of %d device(s) online\n", online, device_count);
+        status = APP_OK;
+    }
+    else
+    {
+        calc_pool_close(pool);
+    }
+
+    return status;
+}
+
+int calc_pool_submit(CalcPool *pool, CalcJob *job)
+{
+    int status = APP_OK;
+
+    if ((pool == NULL) || (job == NULL))
+    {
+        return APP_ERR_IO;
+    }
+
+    if ((job->device != CALC_POOL_ANY_DEVICE) && ((job->device < 0) || (job->device >= pool->worker_count)))
+    {
+        return APP_ERR_NO_CALC;
+    }
+
+    job->status = APP_ERR_NOT_READY;
+    job->executed_on = CALC_POOL_ANY_DEVICE;
+    job->attempts = 0;
+    job->avoid_device = CALC_POOL_ANY_DEVICE;
+    job->out_len = 0u;
+    job->next = NULL;
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->stopping != 0)
+    {
+        status = APP_ERR_NOT_READY;
+    }
+    else if ((job->device != CALC_POOL_ANY_DEVICE) && (pool->workers[job->device].online == 0))
+    {
+        status = APP_ERR_NO_CALC;
+    }
+    else
+    {
+        pool->pending++;
+        calc_pool_dispatch(pool, job);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return status;
+}
+
+void calc_pool_wait(CalcPool *pool)
+{
+    if (pool != NULL)
+    {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->pending != 0u)
+        {
+            pthread_cond_wait(&pool->all_done, &pool->lock);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+void calc_pool_close(CalcPool *pool)
+{
+    int i;
+
+    if (pool == NULL)
+    {
+        return;
+    }
+
+    calc_pool_wait(pool);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 0; i < pool->worker_count; i++)
+    {
+        CalcPoolWorker *worker = &pool->workers[i];
+
+        if (worker->thread_started != 0)
+        {
+            pthread_join(worker->thread, NULL);
+            worker->thread_started = 0;
+        }
+
+        if ((worker->completed != 0u) || (worker->failed != 0u))
+        {
+            printf("Pool device %d: %lu job(s) done, %lu stolen, %lu failed\n",
+                   i, worker->completed, worker->stolen, worker->failed);
+        }
+
+        calc_session_cleanup(&worker->session);
+        worker->online = 0;
+    }
+
+    pthread_cond_destroy(&pool->all_done);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_mutex_destroy(&pool->lock);
+}
+
+static void *calc_pool_worker_thread(void *arg)
+{
+    CalcPoolWorker *worker = (CalcPoolWorker *)arg;
+    CalcPool *pool = worker->pool;
+
+    pthread_mutex_lock(&pool->lock);
+    while ((pool->stopping == 0) && (worker->online != 0))
+    {
+        CalcJob *job = calc_pool_take(pool, worker);
+        int status;
+        int ready;
+
+        if (job == NULL)
+        {
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+            continue;
+        }
+
+        worker->busy = 1;
+        pthread_mutex_unlock(&pool->lock);
+
+        status = calc_pool_run_job(worker, job);
+
+        pthread_mutex_lock(&pool->lock);
+        worker->busy = 0;
+        job->attempts++;
+        job->executed_on = worker->index;
+
+        if ((status != APP_OK) && (calc_pool_is_link_error(status) != 0))
+        {
+            worker->failed++;
+
+            /* Only give up on the unit when it stops answering altogether. */
+            pthread_mutex_unlock(&pool->lock);
+            ready = calc_session_isready(&worker->session);
+            pthread_mutex_lock(&pool->lock);
+            if (ready != 0)
+            {
+                fprintf(stderr, "Pool device %d stopped responding\n", worker->index);
+                calc_pool_set_offline(pool, worker);
+            }
+
+            if (job->attempts < CALC_POOL_MAX_ATTEMPTS)
+            {
+                if (job->device == CALC_POOL_ANY_DEVICE)
+                {
+                    job->avoid_device = worker->index;
+                    calc_pool_dispatch(pool, job);
+                    continue;
+                }
+                if (worker->online != 0)
+                {
+                    calc_pool_enqueue(pool, worker, job);
+                    continue;
+                }
+            }
+        }
+        else if (status != APP_OK)
+        {
+            /* The unit answered but the job itself failed (bad password, bad slot): no retry. */
+            worker->failed++;
+        }
+        else
+        {
+            worker->completed++;
+        }
+
+        calc_pool_finish(pool, job, status);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+static int calc_pool_run_job(CalcPoolWorker *worker, CalcJob *job)
+{
+    CalcSession *session = &worker->session;
+    int status = APP_ERR_IO;
+
+    switch (job->type)
+    {
+        case CALC_JOB_STORE:
+            status = calc_store_binary_string(session, job->var_name, job->payload, job->payload_len);
+            break;
+        case CALC_JOB_FETCH:
+            status = calc_fetch_binary_string(session, job->var_name, job->out_data, job->out_size, &job->out_len);
+            break;
+        case CALC_JOB_SIGN:
+            status = calc_pool_run_sign(session, job);
+            break;
+        default:
+            break;
+    }
+
+    return status;
+}
+
+static int calc_pool_run_sign(CalcSession *session, CalcJob *job)
+{
+    uint8_t payload[WALLET_PUBLIC_KEY_LEN + WALLET_BLOB_LEN];
+    uint8_t private_key[WALLET_PRIVATE_KEY_LEN];
+    size_t payload_len = 0u;
+    int status = APP_ERR_IO;
+
+    if ((job->password == NULL) || ((job->message == NULL) && (job->message_len != 0u)))
+    {
+        return APP_ERR_CRYPTO;
+    }
+
+    status = calc_fetch_binary_string(session, job->var_name, payload, sizeof(payload), &payload_len);
+    if ((status == APP_OK) &&
+        ((payload_len <= WALLET_PUBLIC_KEY_LEN) ||
+         (wallet_blob_length(payload + WALLET_PUBLIC_KEY_LEN, payload_len - WALLET_PUBLIC_KEY_LEN) !=
+          payload_len - WALLET_PUBLIC_KEY_LEN)))
+    {
+        fprintf(stderr, "%s does not contain an encrypted key.\n", job->var_name);
+        status = APP_ERR_IO;
+    }
+
+    if (status == APP_OK)
+    {
+        status = wallet_decrypt_private_key(job->password, payload + WALLET_PUBLIC_KEY_LEN,
+                                            payload_len - WALLET_PUBLIC_KEY_LEN,
+                                            private_key, sizeof(private_key));
+    }
+
+    if (status == APP_OK)
+    {
+        memcpy(job->public_key, payload, WALLET_PUBLIC_KEY_LEN);
+        ed25519_sign(job->signature, job->message, job->message_len, job->public_key, private_key);
+    }
+
+    wallet_secure_zero(private_key, sizeof(private_key));
+    wallet_secure_zero(payload, sizeof(payload));
+
+    return status;
+}
+
+static int calc_pool_is_link_error(int status)
+{
+    return (status == APP_ERR_IO) || (status == APP_ERR_NO_CALC) ||
+           (status == APP_ERR_NO_CABLE) || (status == APP_ERR_NOT_READY);
+}
+
+/* Online worker with the least work, other than avoid_device when possible. */
+static CalcPoolWorker *calc_pool_pick_worker(CalcPool *pool, int avoid_device)
+{
+    CalcPoolWorker *best = NULL;
+    CalcPoolWorker *fallback = NULL;
+    int i;
+
+    for (i = 0; i < pool->worker_count; i++)
+    {
+        CalcPoolWorker *worker = &pool->workers[i];
+        unsigned int load = worker->queued + (unsigned int)worker->busy;
+
+        if (worker->online == 0)
+        {
+            continue;
+        }
+
+        if (i == avoid_device)
+        {
+            fallback = worker;
+        }
+        else if ((best == NULL) || (load < best->queued + (unsigned int)best->busy))
+        {
+            best = worker;
+        }
+    }
+
+    return (best != NULL) ? best : fallback;
+}
+
+static void calc_pool_enqueue(CalcPool *pool, CalcPoolWorker *worker, CalcJob *job)
+{
+    job->next = NULL;
+    if (worker->tail != NULL)
+    {
+        worker->tail->next = job;
+    }
+    else
+    {
+        worker->head = job;
+    }
+    worker->tail = job;
+    worker->queued++;
+
+    pthread_cond_broadcast(&pool->work_ready);
+}
+
+static CalcJob *calc_pool_take(CalcPool *pool, CalcPoolWorker *worker)
+{
+    CalcJob *job = worker->head;
+
+    if (job != NULL)
+    {
+        worker->head = job->next;
+        if (worker->head == NULL)
+        {
+            worker->tail = NULL;
+        }
+        worker->queued--;
+        job->next = NULL;
+    }
+    else
+    {
+        job = calc_pool_steal(pool, worker);
+    }
+
+    return job;
+}
+
+/* Take the newest unpinned job from the most loaded queue. */
+static CalcJob *calc_pool_steal(CalcPool *pool, CalcPoolWorker *thief)
+{
+    CalcPoolWorker *victim = NULL;
+    CalcJob *job = NULL;
+    CalcJob *prev = NULL;
+    CalcJob *found = NULL;
+    CalcJob *found_prev = NULL;
+    int i;
+
+    for (i = 0; i < pool->worker_count; i++)
+    {
+        CalcPoolWorker *worker = &pool->workers[i];
+        if ((worker != thief) && (worker->queued > 0u) && ((victim == NULL) || (worker->queued > victim->queued)))
+        {
+            victim = worker;
+        }
+    }
+
+    if (victim == NULL)
+    {
+        return NULL;
+    }
+
+    for (job = victim->head; job != NULL; prev = job, job = job->next)
+    {
+        if ((job->device == CALC_POOL_ANY_DEVICE) && (job->avoid_device != thief->index))
+        {
+            found = job;
+            found_prev = prev;
+        }
+    }
+
+    if (found != NULL)
+    {
+        if (found_prev != NULL)
+        {
+            found_prev->next = found->next;
+        }
+        else
+        {
+            victim->head = found->next;
+        }
+        if (victim->tail == found)
+        {
+            victim->tail = found_prev;
+        }
+        victim->queued--;
+        found->next = NULL;
+        thief->stolen++;
+    }
+
+    return found;
+}
+
+/* Called with the lock held. */
+static void calc_pool_dispatch(CalcPool *pool, CalcJob *job)
+{
+    CalcPoolWorker *worker = NULL;
+
+    if (job->device == CALC_POOL_ANY_DEVICE)
+    {
+        worker = calc_pool_pick_worker(pool, job->avoid_device);
+    }
+    else if (pool->workers[job->device].online != 0)
+    {
+        worker = &pool->workers[job->device];
+    }
+
+    if (worker != NULL)
+    {
+        calc_pool_enqueue(pool, worker, job);
+    }
+    else
+    {
+        calc_pool_finish(pool, job, APP_ERR_NO_CALC);
+    }
+}
+
+/* Called with the lock held; the callback runs unlocked and may free the job. */
+static void calc_pool_finish(CalcPool *pool, CalcJob *job, int status)
+{
+    calc_job_callback done = job->done;
+    void *user_data = job->user_data;
+
+    job->status = status;
+
+    if (done != NULL)
+    {
+        pthread_mutex_unlock(&pool->lock);
+        done(job, user_data);
+        pthread_mutex_lock(&pool->lock);
+    }
+
+    pool->pending--;
+    if (pool->pending == 0u)
+    {
+        pthread_cond_broadcast(&pool->all_done);
+    }
+}
+
+/* Called with the lock held: hand the unit's queue over to the others. */
+static void calc_pool_set_offline(CalcPool *pool, CalcPoolWorker *worker)
+{
+    CalcJob *job = worker->head;
+
+    worker->online = 0;
+    worker->head = NULL;
+    worker->tail = NULL;
+    worker->queued = 0u;
+
+    while (job != NULL)
+    {
+        CalcJob *next = job->next;
+        job->next = NULL;
+        calc_pool_dispatch(pool, job);
+        job = next;
+    }
+}
@@ -0,0 +1,115 @@
+#ifndef CALC_POOL_H
+#define CALC_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "calc_session.h"
+#include "wallet_crypto.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CALC_POOL_MAX_DEVICES 4
+#define CALC_POOL_ANY_DEVICE (-1)
+#define CALC_POOL_MAX_ATTEMPTS 3
+#define CALC_POOL_VAR_NAME_LEN 8u
+#define CALC_POOL_SIGNATURE_LEN 64u
+
+typedef enum
+{
+    CALC_JOB_STORE = 0,
+    CALC_JOB_FETCH,
+    CALC_JOB_SIGN
+} CalcJobType;
+
+typedef struct CalcJob CalcJob;
+typedef void (*calc_job_callback)(CalcJob *job, void *user_data);
+
+/*
+ * A unit of work for the pool. The caller owns the job and every buffer it
+ * points to until the done callback has run (or calc_pool_wait returned).
+ *
+ * - CALC_JOB_STORE: writes payload/payload_len into var_name.
+ * - CALC_JOB_FETCH: reads var_name into out_data (out_size bytes), sets out_len.
+ * - CALC_JOB_SIGN:  reads the encrypted keypair stored in var_name, decrypts it
+ *                   with password and signs message; fills public_key and signature.
+ *
+ * Slots live on a given calculator, so fetch and sign jobs are normally pinned
+ * with device; CALC_POOL_ANY_DEVICE lets the pool pick any unit (stores, or
+ * slots replicated on every unit).
+ */
+struct CalcJob
+{
+    CalcJobType type;
+    int device;
+    char var_name[CALC_POOL_VAR_NAME_LEN];
+
+    const uint8_t *payload;
+    size_t payload_len;
+
+    uint8_t *out_data;
+    size_t out_size;
+    size_t out_len;
+
+    const char *password;
+    const uint8_t *message;
+    size_t message_len;
+    uint8_t public_key[WALLET_PUBLIC_KEY_LEN];
+    uint8_t signature[CALC_POOL_SIGNATURE_LEN];
+
+    calc_job_callback done;
+    void *user_data;
+
+    /* results, written by the pool */
+    int status;
+    int executed_on;
+    int attempts;
+
+    /* private */
+    int avoid_device;
+    CalcJob *next;
+};
+
+typedef struct CalcPool CalcPool;
+
+typedef struct
+{
+    CalcPool *pool;
+    int index;
+    int online;
+    CalcSession session;
+    pthread_t thread;
+    int thread_started;
+    CalcJob *head;
+    CalcJob *tail;
+    unsigned int queued;
+    int busy;
+    unsigned long completed;
+    unsigned long stolen;
+    unsigned long failed;
+} CalcPoolWorker;
+
+struct CalcPool
+{
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t all_done;
+    CalcPoolWorker workers[CALC_POOL_MAX_DEVICES];
+    int worker_count;
+    unsigned int pending;
+    int stopping;
+};
+
+int calc_pool_open(CalcPool *pool, int device_count);
+int calc_pool_submit(CalcPool *pool, CalcJob *job);
+void calc_pool_wait(CalcPool *pool);
+void calc_pool_close(CalcPool *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,97 +1,125 @@
+/* pipe2, O_CLOEXEC and clock_gettime with CMAKE_C_EXTENSIONS off */
+#define _GNU_SOURCE
+
+#include <fcntl.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include "calc_session.h"
+#include "calc_discovery.h"
+#include "calc_string_store.h"
 
 #define CALC_SESSION_MAX_POLL_CYCLES 3600000u
+#define CALC_SESSION_REATTACH_ATTEMPTS 8
+#define CALC_SESSION_REATTACH_MIN_MS 5
+#define CALC_SESSION_REATTACH_MAX_MS 500
+#define CALC_SESSION_MONITOR_MIN_MS 50
+#define CALC_SESSION_MONITOR_BACKOFF 8
+#define CALC_SESSION_SIM_ENV "CWALLET_SIM_LINK"
+#define CALC_SESSION_METRICS_ENV "CWALLET_LINK_METRICS"
+
+/*
+ * Commands queued for the I/O thread. The thread is the only one touching
+ * the handles while it runs; keepalive probes go in the gaps between
+ * commands, so they never contend with a transfer.
+ */
+struct CalcSessionLink
+{
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    CalcSessionFuture *head;
+    CalcSessionFuture *tail;
+    struct timespec last_activity;
+    pthread_t thread;
+    int stopping;
+    CalcSessionStatus status;
+    int status_fds[2];
+    int status_fds_open;
+};
 
-static void *calc_session_polling_thread(void *arg);
+static int calc_session_detect(CalcSession *session);
+static int calc_session_device_index(const CalcSession *session);
+static void *calc_session_io_thread(void *arg);
+static void calc_session_keepalive(CalcSession *session);
+static void calc_session_publish(CalcSession *session, const CalcSessionStatus *status);
+static int calc_session_on_io_thread(const CalcSession *session);
+static void calc_session_deadline(struct timespec *deadline, const struct timespec *from, int timeout_ms);
+static int calc_session_reattach_command(CalcSession *session, void *arg);
+static int calc_session_isready_command(CalcSession *session, void *arg);
+static void calc_session_dump_metrics(CalcSession *session);
 
 int calc_session_open(CalcSession *session)
 {
-    CableDeviceInfo *devices = NULL;
-    int device_count = 0;
+    const char *sim_link = getenv(CALC_SESSION_SIM_ENV);
     int status = APP_ERR_NO_CALC;
 
     if (session != NULL)
     {
-        ticables_get_usb_device_info(&devices, &device_count);
-        if (device_count < 1)
+        if (sim_link != NULL)
         {
-            fprintf(stderr, "No USB calculator detected\n");
-            status = APP_ERR_NO_CALC;
-        }
-        else if (devices[0].family == CABLE_FAMILY_UNKNOWN)
-        {
-            fprintf(stderr, "Unsupported cable family\n");
-            status = APP_ERR_NO_CABLE;
+            session->cable_model = CABLE_SIM;
+            session->calc_model = CALC_TI83P;
+            printf("Using simulated TI-83 Plus link\n");
+            status = APP_OK;
         }
         else
         {
-            status = APP_OK;
-            session->cable_model = (devices[0].family == CABLE_FAMILY_DBUS) ? CABLE_SLV : CABLE_USB;
-            session->calc_model = ticalcs_device_info_to_model(&devices[0]);
-            session->calc_model = ticalcs_remap_model_from_usb(session->cable_model, session->calc_model);
+            status = calc_session_detect(session);
+        }
 
-            printf("Detected calculator model: %s\n", ticalcs_model_to_string(session->calc_model));
-            if (session->calc_model == CALC_NONE)
-            {
-                int probe_status = ticalcs_probe(session->cable_model, session->port_number, &session->calc_model, 1);
-                if (probe_status != 0)
-                {
-                    fprintf(stderr, "No calculator found during probe\n");
-                    status = APP_ERR_NO_CALC;
-                }
-                else
-                {
-                    printf("Probed calculator model: %s\n", ticalcs_model_to_string(session->calc_model));
-                }
-            }
-            else if (session->calc_model != CALC_TI83P)
+        if (status == APP_OK)
+        {
+            session->cable = ticables_handle_new(session->cable_model, session->port_number);
+            if (session->cable == NULL)
             {
-                fprintf(stderr, "Warning: detected model is not TI-83 Plus\n");
+                fprintf(stderr, "ticables_handle_new failed\n");
+                status = APP_ERR_NO_CABLE;
             }
+        }
 
-            if (status == APP_OK)
+        if ((status == APP_OK) && (sim_link != NULL))
+        {
+            if (ticables_cable_set_device(session->cable, sim_link) != 0)
             {
-                session->cable = ticables_handle_new(session->cable_model, session->port_number);
-                if (session->cable == NULL)
-                {
-                    fprintf(stderr, "ticables_handle_new failed\n");
-                    status = APP_ERR_NO_CABLE;
-                }
+                fprintf(stderr, "Invalid %s settings\n", CALC_SESSION_SIM_ENV);
+                status = APP_ERR_NO_CABLE;
             }
+        }
 
-            if (status == APP_OK)
+        if (status == APP_OK)
+        {
+            session->calc = ticalcs_handle_new(session->calc_model);
+            if (session->calc == NULL)
             {
-                session->calc = ticalcs_handle_new(session->calc_model);
-                if (session->calc == NULL)
-                {
-                    fprintf(stderr, "ticalcs_handle_new failed\n");
-                    status = APP_ERR_ALLOC;
-                }
+                fprintf(stderr, "ticalcs_handle_new failed\n");
+                status = APP_ERR_ALLOC;
             }
+        }
 
-            if (status == APP_OK)
+        if (status == APP_OK)
+        {
+            if (ticalcs_cable_attach(session->calc, session->cable) != 0)
             {
-                if (ticalcs_cable_attach(session->calc, session->cable) != 0)
-                {
-                    fprintf(stderr, "ticalcs_cable_attach failed\n");
-                    status = APP_ERR_NO_CABLE;
-                }
+                fprintf(stderr, "ticalcs_cable_attach failed\n");
+                status = APP_ERR_NO_CABLE;
             }
+        }
 
-            if (status == APP_OK)
+        if (status == APP_OK)
+        {
+            session->link_generation = calc_discovery_generation();
+            ticables_options_set_timeout(session->cable, 250);
+            if (getenv(CALC_SESSION_METRICS_ENV) != NULL)
             {
-                ticables_options_set_timeout(session->cable, 250);
+                ticables_cable_metrics_start(session->cable);
+                ticalcs_calc_metrics_start(session->calc);
             }
         }
     }
 
-    if (devices != NULL)
-    {
-        ticables_free_usb_device_info(devices);
-    }
-
     if ((status != APP_OK) && (session != NULL))
     {
         calc_session_cleanup(session);
@@ -104,6 +132,10 @@ void calc_session_cleanup(CalcSession *session)
 {
     if (session != NULL)
     {
+        calc_session_stop_polling(session);
+        calc_string_cache_clear(session);
+        calc_session_dump_metrics(session);
+
         if (session->calc != NULL)
         {
             ticalcs_handle_del(session->calc);
@@ -116,22 +148,54 @@ void calc_session_cleanup(CalcSession *session)
             session->cable = NULL;
         }
 
-        session->poll_active = 0;
-        session->poll_thread_started = 0;
     }
 }
 
 int calc_session_start_polling(CalcSession *session, int interval_ms)
 {
+    struct CalcSessionLink *link = NULL;
     int status = APP_ERR_NO_CALC;
 
     if ((session != NULL) && (session->calc != NULL))
     {
+        if (session->poll_thread_started != 0)
+        {
+            return APP_OK;
+        }
+
+        link = (struct CalcSessionLink *)calloc(1u, sizeof(*link));
+        if (link == NULL)
+        {
+            return APP_ERR_ALLOC;
+        }
+
+        pthread_mutex_init(&link->lock, NULL);
+        pthread_cond_init(&link->wake, NULL);
+        pthread_cond_init(&link->done, NULL);
+        clock_gettime(CLOCK_REALTIME, &link->last_activity);
+        link->status.interval_ms = interval_ms;
+        /* Close-on-exec so the agent and other children do not inherit it. */
+        if (pipe2(link->status_fds, O_NONBLOCK | O_CLOEXEC) == 0)
+        {
+            link->status_fds_open = 1;
+        }
+
         session->poll_interval_ms = interval_ms;
         session->poll_active = 1;
-        if (pthread_create(&session->poll_thread, NULL, calc_session_polling_thread, session) != 0)
+        session->link = link;
+        if (pthread_create(&session->poll_thread, NULL, calc_session_io_thread, session) != 0)
         {
             session->poll_active = 0;
+            session->link = NULL;
+            if (link->status_fds_open != 0)
+            {
+                close(link->status_fds[0]);
+                close(link->status_fds[1]);
+            }
+            pthread_cond_destroy(&link->done);
+            pthread_cond_destroy(&link->wake);
+            pthread_mutex_destroy(&link->lock);
+            free(link);
             status = APP_ERR_THREAD;
         }
         else
@@ -144,54 +208,517 @@ int calc_session_start_polling(CalcSession *session, int interval_ms)
     return status;
 }
 
+/* Commands still queued are executed before the thread exits. */
 void calc_session_stop_polling(CalcSession *session)
 {
+    struct CalcSessionLink *link = NULL;
+
+    if ((session != NULL) && (session->poll_thread_started != 0))
+    {
+        link = session->link;
+
+        pthread_mutex_lock(&link->lock);
+        link->stopping = 1;
+        pthread_cond_signal(&link->wake);
+        pthread_mutex_unlock(&link->lock);
+
+        pthread_join(session->poll_thread, NULL);
+        session->poll_thread_started = 0;
+        session->poll_active = 0;
+        session->link = NULL;
+
+        if (link->status_fds_open != 0)
+        {
+            close(link->status_fds[0]);
+            close(link->status_fds[1]);
+        }
+        pthread_cond_destroy(&link->done);
+        pthread_cond_destroy(&link->wake);
+        pthread_mutex_destroy(&link->lock);
+        free(link);
+    }
+}
+
+/*
+ * Queue fn for the I/O thread and return at once; several commands may be
+ * in flight. Without an I/O thread (or from the I/O thread itself) the
+ * command runs inline and the future is already complete on return.
+ */
+int calc_session_submit(CalcSession *session, CalcSessionFuture *future, calc_session_command_fn fn, void *arg)
+{
+    struct CalcSessionLink *link = NULL;
+
+    if ((session == NULL) || (future == NULL) || (fn == NULL))
+    {
+        return APP_ERR_IO;
+    }
+
+    future->fn = fn;
+    future->arg = arg;
+    future->result = APP_ERR_NOT_READY;
+    future->done = 0;
+    future->next = NULL;
+
+    link = session->link;
+    if ((link == NULL) || (calc_session_on_io_thread(session) != 0))
+    {
+        future->result = fn(session, arg);
+        future->done = 1;
+        return APP_OK;
+    }
+
+    pthread_mutex_lock(&link->lock);
+    if (link->tail != NULL)
+    {
+        link->tail->next = future;
+    }
+    else
+    {
+        link->head = future;
+    }
+    link->tail = future;
+    pthread_cond_signal(&link->wake);
+    pthread_mutex_unlock(&link->lock);
+
+    return APP_OK;
+}
+
+/* Block until the command completed; returns its result. */
+int calc_session_wait(CalcSession *session, CalcSessionFuture *future)
+{
+    struct CalcSessionLink *link = NULL;
+
+    if ((session == NULL) || (future == NULL))
+    {
+        return APP_ERR_IO;
+    }
+
+    link = session->link;
+    if (link != NULL)
+    {
+        pthread_mutex_lock(&link->lock);
+        while (future->done == 0)
+        {
+            pthread_cond_wait(&link->done, &link->lock);
+        }
+        pthread_mutex_unlock(&link->lock);
+    }
+
+    return future->result;
+}
+
+int calc_session_call(CalcSession *session, calc_session_command_fn fn, void *arg)
+{
+    CalcSessionFuture future;
+    int status = calc_session_submit(session, &future, fn, arg);
+
+    if (status == APP_OK)
+    {
+        status = calc_session_wait(session, &future);
+    }
+
+    return status;
+}
+
+/* ticalcs_calc_isready through the I/O thread: 0 when the calculator answered. */
+int calc_session_isready(CalcSession *session)
+{
+    if ((session == NULL) || (session->calc == NULL))
+    {
+        return APP_ERR_NO_CALC;
+    }
+
+    return calc_session_call(session, calc_session_isready_command, NULL);
+}
+
+/*
+ * Register fn to be told about readiness changes and reattaches. It runs on
+ * the I/O thread, so it must be quick; link commands issued from it run inline.
+ * Safe to call while polling: the pair is swapped under the link lock.
+ */
+void calc_session_set_status_callback(CalcSession *session, calc_session_status_fn fn, void *user_data)
+{
+    struct CalcSessionLink *link = NULL;
+
     if (session != NULL)
     {
-        if (session->poll_thread_started != 0)
+        link = session->link;
+        if (link != NULL)
         {
-            session->poll_active = 0;
-            pthread_join(session->poll_thread, NULL);
-            session->poll_thread_started = 0;
+            pthread_mutex_lock(&link->lock);
+        }
+        session->status_callback = fn;
+        session->status_user_data = user_data;
+        if (link != NULL)
+        {
+            pthread_mutex_unlock(&link->lock);
         }
     }
 }
 
-static void *calc_session_polling_thread(void *arg)
+/* Last state seen by the monitor, without any link traffic. */
+int calc_session_get_status(CalcSession *session, CalcSessionStatus *out_status)
 {
-    CalcSession *session = (CalcSession *)arg;
-    unsigned int cycle_count = 0u;
-    int last_ready = -1;
+    struct CalcSessionLink *link = NULL;
 
-    if (session == NULL)
+    if ((session == NULL) || (out_status == NULL))
     {
-        return NULL;
+        return APP_ERR_IO;
     }
 
-    while ((session->poll_active != 0) && (cycle_count < CALC_SESSION_MAX_POLL_CYCLES))
+    link = session->link;
+    if (link == NULL)
     {
-        if (session->calc != NULL)
+        memset(out_status, 0, sizeof(*out_status));
+        return APP_ERR_NOT_READY;
+    }
+
+    pthread_mutex_lock(&link->lock);
+    *out_status = link->status;
+    pthread_mutex_unlock(&link->lock);
+
+    return APP_OK;
+}
+
+/*
+ * Descriptor that becomes readable on every status change, for callers
+ * with their own event loop. Drain it, then call calc_session_get_status.
+ */
+int calc_session_status_fd(CalcSession *session)
+{
+    if ((session == NULL) || (session->link == NULL) || (session->link->status_fds_open == 0))
+    {
+        return -1;
+    }
+
+    return session->link->status_fds[0];
+}
+
+/*
+ * Reopen the cable after it was unplugged, keeping the handles and the
+ * detected models: no enumeration and no probe. Retries with a bounded
+ * exponential backoff, waking up early on hotplug events.
+ */
+int calc_session_reattach(CalcSession *session)
+{
+    if ((session == NULL) || (session->calc == NULL) || (session->cable == NULL))
+    {
+        return APP_ERR_NO_CALC;
+    }
+
+    return calc_session_call(session, calc_session_reattach_command, NULL);
+}
+
+static int calc_session_reattach_command(CalcSession *session, void *arg)
+{
+    int status = APP_ERR_NO_CALC;
+    int delay_ms = CALC_SESSION_REATTACH_MIN_MS;
+    int attempt;
+
+    (void)arg;
+
+    for (attempt = 0; (attempt < CALC_SESSION_REATTACH_ATTEMPTS) && (status != APP_OK); attempt++)
+    {
+        unsigned int generation = calc_discovery_generation();
+
+        ticalcs_cable_detach(session->calc);
+        if ((ticalcs_cable_attach(session->calc, session->cable) == 0) && (ticalcs_calc_isready(session->calc) == 0))
+        {
+            session->link_generation = generation;
+            status = APP_OK;
+        }
+        else
         {
-            int ready = ticalcs_calc_isready(session->calc);
-            if ((ready == 0) && (last_ready != 1))
+            calc_discovery_wait(generation, delay_ms);
+            delay_ms = (delay_ms * 2 > CALC_SESSION_REATTACH_MAX_MS) ? CALC_SESSION_REATTACH_MAX_MS : delay_ms * 2;
+        }
+    }
+
+    if (status != APP_OK)
+    {
+        fprintf(stderr, "Calculator did not come back after %d attempts\n", CALC_SESSION_REATTACH_ATTEMPTS);
+    }
+
+    return status;
+}
+
+/* Cheap check before a transfer: reattach only if a hotplug event happened since. */
+int calc_session_ensure_link(CalcSession *session)
+{
+    int status = APP_ERR_NO_CALC;
+
+    if ((session != NULL) && (session->calc != NULL))
+    {
+        status = APP_OK;
+        if (session->link_generation != calc_discovery_generation())
+        {
+            status = calc_session_reattach(session);
+        }
+    }
+
+    return status;
+}
+
+/* PORT_1 is the first USB device, PORT_2 the second and so on (see calc_pool.c). */
+static int calc_session_device_index(const CalcSession *session)
+{
+    return (session->port_number > PORT_1) ? ((int)session->port_number - (int)PORT_1) : 0;
+}
+
+static int calc_session_detect(CalcSession *session)
+{
+    CableDeviceInfo *devices = NULL;
+    CableDeviceInfo *device = NULL;
+    int device_count = 0;
+    int index = calc_session_device_index(session);
+    int status = calc_discovery_lookup(index, &session->cable_model, &session->calc_model);
+
+    if (status == APP_OK)
+    {
+        printf("Cached calculator model: %s\n", ticalcs_model_to_string(session->calc_model));
+        return APP_OK;
+    }
+
+    ticables_get_usb_device_info(&devices, &device_count);
+    if (device_count <= index)
+    {
+        fprintf(stderr, "No USB calculator detected\n");
+        status = APP_ERR_NO_CALC;
+    }
+    else if ((device = &devices[index])->family == CABLE_FAMILY_UNKNOWN)
+    {
+        fprintf(stderr, "Unsupported cable family\n");
+        status = APP_ERR_NO_CABLE;
+    }
+    else
+    {
+        status = APP_OK;
+        session->cable_model = (device->family == CABLE_FAMILY_DBUS) ? CABLE_SLV : CABLE_USB;
+        session->calc_model = ticalcs_device_info_to_model(device);
+        session->calc_model = ticalcs_remap_model_from_usb(session->cable_model, session->calc_model);
+
+        printf("Detected calculator model: %s\n", ticalcs_model_to_string(session->calc_model));
+        if (session->calc_model == CALC_NONE)
+        {
+            int probe_status = ticalcs_probe(session->cable_model, session->port_number, &session->calc_model, 1);
+            if (probe_status != 0)
             {
-                printf("[poll] Calculator ready\n");
-                fflush(stdout);
-                last_ready = 1;
+                fprintf(stderr, "No calculator found during probe\n");
+                status = APP_ERR_NO_CALC;
             }
-            else if ((ready != 0) && (last_ready != 0))
+            else
             {
-                printf("[poll] Calculator not ready\n");
-                fflush(stdout);
-                last_ready = 0;
+                printf("Probed calculator model: %s\n", ticalcs_model_to_string(session->calc_model));
             }
         }
+        else if (session->calc_model != CALC_TI83P)
+        {
+            fprintf(stderr, "Warning: detected model is not TI-83 Plus\n");
+        }
+
+        if (status == APP_OK)
+        {
+            calc_discovery_remember(index, session->cable_model, session->calc_model);
+        }
+    }
+
+    if (devices != NULL)
+    {
+        ticables_free_usb_device_info(devices);
+    }
 
-        usleep((useconds_t)(session->poll_interval_ms * 1000));
-        cycle_count++;
+    return status;
+}
+
+static void calc_session_dump_metrics(CalcSession *session)
+{
+    char buffer[8192];
+
+    if ((session->cable != NULL) && (ticables_cable_metrics_json(session->cable, buffer, sizeof(buffer)) > 0))
+    {
+        fprintf(stderr, "cable metrics: %s\n", buffer);
+    }
+
+    if ((session->calc != NULL) && (ticalcs_calc_metrics_json(session->calc, buffer, sizeof(buffer)) > 0))
+    {
+        fprintf(stderr, "calc metrics: %s\n", buffer);
     }
+}
+
+static int calc_session_isready_command(CalcSession *session, void *arg)
+{
+    (void)arg;
+
+    return ticalcs_calc_isready(session->calc);
+}
+
+static void *calc_session_io_thread(void *arg)
+{
+    CalcSession *session = (CalcSession *)arg;
+    struct CalcSessionLink *link = session->link;
+    unsigned int cycle_count = 0u;
 
-    session->poll_active = 0;
+    pthread_mutex_lock(&link->lock);
+    link->thread = pthread_self();
+    for (;;)
+    {
+        CalcSessionFuture *future = link->head;
+        struct timespec now;
+        struct timespec due;
+
+        if (future != NULL)
+        {
+            link->head = future->next;
+            if (link->head == NULL)
+            {
+                link->tail = NULL;
+            }
+            pthread_mutex_unlock(&link->lock);
+
+            future->result = future->fn(session, future->arg);
+
+            pthread_mutex_lock(&link->lock);
+            future->done = 1;
+            clock_gettime(CLOCK_REALTIME, &link->last_activity);
+            pthread_cond_broadcast(&link->done);
+            continue;
+        }
+
+        if (link->stopping != 0)
+        {
+            break;
+        }
+
+        /* Any command proves the link is alive: probe only after a full idle interval. */
+        clock_gettime(CLOCK_REALTIME, &now);
+        calc_session_deadline(&due, &link->last_activity, link->status.interval_ms);
+        if ((cycle_count < CALC_SESSION_MAX_POLL_CYCLES) &&
+            ((now.tv_sec > due.tv_sec) || ((now.tv_sec == due.tv_sec) && (now.tv_nsec >= due.tv_nsec))))
+        {
+            pthread_mutex_unlock(&link->lock);
+            calc_session_keepalive(session);
+            cycle_count++;
+            pthread_mutex_lock(&link->lock);
+            clock_gettime(CLOCK_REALTIME, &link->last_activity);
+            continue;
+        }
+
+        if (cycle_count < CALC_SESSION_MAX_POLL_CYCLES)
+        {
+            pthread_cond_timedwait(&link->wake, &link->lock, &due);
+        }
+        else
+        {
+            pthread_cond_wait(&link->wake, &link->lock);
+        }
+    }
+    pthread_mutex_unlock(&link->lock);
 
     return NULL;
 }
+
+/*
+ * One readiness probe. The interval doubles while the state is stable (up to
+ * CALC_SESSION_MONITOR_BACKOFF times the configured one) and drops to
+ * CALC_SESSION_MONITOR_MIN_MS while the calculator does not answer.
+ */
+static void calc_session_keepalive(CalcSession *session)
+{
+    struct CalcSessionLink *link = session->link;
+    CalcSessionStatus status;
+    CalcSessionState previous;
+    struct timespec start;
+    struct timespec end;
+    int max_interval_ms = session->poll_interval_ms * CALC_SESSION_MONITOR_BACKOFF;
+    int reattached = 0;
+    int ready;
+
+    /* A hotplug event since the last cycle: get the link back without a full reopen. */
+    if ((session->link_generation != calc_discovery_generation()) &&
+        (calc_session_ensure_link(session) == APP_OK))
+    {
+        reattached = 1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ready = ticalcs_calc_isready(session->calc);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    pthread_mutex_lock(&link->lock);
+    previous = link->status.state;
+    link->status.state = (ready == 0) ? CALC_SESSION_STATE_READY : CALC_SESSION_STATE_NOT_READY;
+    link->status.last_error = ready;
+    link->status.probe_count++;
+    link->status.reattach_count += (unsigned int)reattached;
+    if (ready != 0)
+    {
+        link->status.interval_ms = (session->poll_interval_ms < CALC_SESSION_MONITOR_MIN_MS) ? session->poll_interval_ms : CALC_SESSION_MONITOR_MIN_MS;
+    }
+    else
+    {
+        link->status.latency_us = (unsigned int)(((end.tv_sec - start.tv_sec) * 1000000L) +
+                                                 ((end.tv_nsec - start.tv_nsec) / 1000L));
+        if (previous != CALC_SESSION_STATE_READY)
+        {
+            link->status.interval_ms = session->poll_interval_ms;
+        }
+        else if (link->status.interval_ms * 2 < max_interval_ms)
+        {
+            link->status.interval_ms *= 2;
+        }
+        else
+        {
+            link->status.interval_ms = max_interval_ms;
+        }
+    }
+    status = link->status;
+    pthread_mutex_unlock(&link->lock);
+
+    if ((previous != status.state) || (reattached != 0))
+    {
+        calc_session_publish(session, &status);
+    }
+}
+
+static void calc_session_publish(CalcSession *session, const CalcSessionStatus *status)
+{
+    struct CalcSessionLink *link = session->link;
+    calc_session_status_fn callback = NULL;
+    void *user_data = NULL;
+    char byte = 0;
+
+    if (link->status_fds_open != 0)
+    {
+        if (write(link->status_fds[1], &byte, 1) < 0)
+        {
+            /* Pipe full: the reader has not caught up and will see the latest status anyway. */
+        }
+    }
+
+    pthread_mutex_lock(&link->lock);
+    callback = session->status_callback;
+    user_data = session->status_user_data;
+    pthread_mutex_unlock(&link->lock);
+
+    if (callback != NULL)
+    {
+        callback(status, user_data);
+    }
+}
+
+static int calc_session_on_io_thread(const CalcSession *session)
+{
+    return pthread_equal(pthread_self(), session->link->thread) != 0;
+}
+
+static void calc_session_deadline(struct timespec *deadline, const struct timespec *from, int timeout_ms)
+{
+    *deadline = *from;
+    deadline->tv_sec += timeout_ms / 1000;
+    deadline->tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline->tv_nsec >= 1000000000L)
+    {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+}
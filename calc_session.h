@@ -21,6 +21,28 @@ enum
     APP_ERR_CRYPTO
 };
 
+typedef struct CalcSessionFuture CalcSessionFuture;
+
+typedef enum
+{
+    CALC_SESSION_STATE_UNKNOWN = 0,
+    CALC_SESSION_STATE_READY,
+    CALC_SESSION_STATE_NOT_READY
+} CalcSessionState;
+
+/* Snapshot published by the readiness monitor of the I/O thread. */
+typedef struct
+{
+    CalcSessionState state;
+    int last_error;             /* ticalcs_calc_isready result of the last probe */
+    unsigned int latency_us;    /* round trip of the last successful probe */
+    int interval_ms;            /* current probe interval */
+    unsigned int probe_count;
+    unsigned int reattach_count;
+} CalcSessionStatus;
+
+typedef void (*calc_session_status_fn)(const CalcSessionStatus *status, void *user_data);
+
 typedef struct
 {
     CableHandle *cable;
@@ -32,12 +54,39 @@ typedef struct
     volatile int poll_active;
     int poll_thread_started;
     pthread_t poll_thread;
+    unsigned int link_generation;
+    struct CalcSessionLink *link;
+    calc_session_status_fn status_callback;
+    void *status_user_data;
+    struct CalcStringCache *string_cache;
 } CalcSession;
 
+/* Runs on the session I/O thread, which owns session->calc and session->cable. */
+typedef int (*calc_session_command_fn)(CalcSession *session, void *arg);
+
+/* Caller-owned handle on a queued command; valid until calc_session_wait returned. */
+struct CalcSessionFuture
+{
+    calc_session_command_fn fn;
+    void *arg;
+    int result;
+    int done;
+    CalcSessionFuture *next;
+};
+
 int calc_session_open(CalcSession *session);
 void calc_session_cleanup(CalcSession *session);
 int calc_session_start_polling(CalcSession *session, int interval_ms);
 void calc_session_stop_polling(CalcSession *session);
+int calc_session_submit(CalcSession *session, CalcSessionFuture *future, calc_session_command_fn fn, void *arg);
+int calc_session_wait(CalcSession *session, CalcSessionFuture *future);
+int calc_session_call(CalcSession *session, calc_session_command_fn fn, void *arg);
+int calc_session_isready(CalcSession *session);
+void calc_session_set_status_callback(CalcSession *session, calc_session_status_fn fn, void *user_data);
+int calc_session_get_status(CalcSession *session, CalcSessionStatus *out_status);
+int calc_session_status_fd(CalcSession *session);
+int calc_session_reattach(CalcSession *session);
+int calc_session_ensure_link(CalcSession *session);
 
 #ifdef __cplusplus
 }
@@ -5,12 +5,62 @@
 #include <stdint.h>
 
 #include "calc_string_store.h"
+#include "wallet_crypto.h"
 
 #include "tifiles.h"
 #include "ticonv.h"
 
+typedef struct
+{
+    FileContent *content;
+    VarEntry *request;
+} CalcVarTransfer;
+
+#define CALC_STRING_CACHE_SLOTS 10u
+
+typedef struct
+{
+    int valid;
+    char var_name[VARNAME_MAX];
+    VarEntry request;
+    uint32_t size;
+    FileAttr attr;
+    size_t len;
+    uint8_t data[255];
+} CalcStringCacheEntry;
+
+struct CalcStringCache
+{
+    int trusted;
+    unsigned int link_generation;
+    unsigned int next_victim;
+    CalcStringCacheEntry entries[CALC_STRING_CACHE_SLOTS];
+};
+
+typedef struct
+{
+    size_t count;
+    FileContent **contents;
+    VarEntry *requests;
+    int *statuses;
+} CalcVarBatch;
+
+static int send_var_command(CalcSession *session, void *arg);
+static int recv_var_command(CalcSession *session, void *arg);
+static int recv_var_batch_command(CalcSession *session, void *arg);
+static void report_send_error(int transfer_result);
+static int cache_validate(CalcSession *session);
+static int cache_validate_command(CalcSession *session, void *arg);
+static CalcStringCacheEntry *cache_find(CalcSession *session, const char *var_name);
+static int cache_get(CalcSession *session, const char *var_name, uint8_t *out_data, size_t out_size, size_t *out_len);
+static void cache_put(CalcSession *session, const char *var_name, const uint8_t *data, size_t len, uint32_t size, FileAttr attr);
+static void cache_evict(CalcStringCacheEntry *entry);
 static int build_string_entry(CalcSession *session, const char *var_name, const char *payload, FileContent **out_content);
 static int build_binary_entry(CalcSession *session, const char *var_name, const uint8_t *payload, size_t payload_len, FileContent **out_content);
+static int build_binary_content(CalcSession *session, const CalcBinaryString *items, size_t count, FileContent **out_content);
+static int build_binary_var(CalcSession *session, uint8_t string_type, const char *var_name, const uint8_t *payload, size_t payload_len, VarEntry **out_entry);
+static int build_string_request(CalcSession *session, const char *var_name, VarEntry *request);
+static int copy_binary_payload(const FileContent *content, uint8_t *out_data, size_t out_size, size_t *out_len);
 
 int calc_store_persistent_string(CalcSession *session, const char *var_name, const char *payload)
 {
@@ -21,23 +71,15 @@ int calc_store_persistent_string(CalcSession *session, const char *var_name, con
     {
         if ((var_name != NULL) && (payload != NULL))
         {
+            /* Text strings are not cached: drop any binary copy of the slot. */
+            cache_evict(cache_find(session, var_name));
             status = build_string_entry(session, var_name, payload, &content);
             if (status == APP_OK)
             {
-                int transfer_result = ticalcs_calc_send_var(session->calc, MODE_NORMAL, content);
+                int transfer_result = calc_session_call(session, send_var_command, content);
                 if (transfer_result != 0)
                 {
-                    char *error_text = NULL;
-                    if ((ticalcs_error_get(transfer_result, &error_text) == 0) && (error_text != NULL))
-                    {
-                        fprintf(stderr, "ticalcs_calc_send_var failed: %s\n", error_text);
-                        ticalcs_error_free(error_text);
-                    }
-                    else
-                    {
-                        fprintf(stderr, "ticalcs_calc_send_var failed with code %d\n", transfer_result);
-                    }
-
+                    report_send_error(transfer_result);
                     status = APP_ERR_IO;
                 }
             }
@@ -58,10 +100,8 @@ int calc_store_persistent_string(CalcSession *session, const char *var_name, con
 
 int calc_fetch_string(CalcSession *session, const char *var_name, FileContent **out_content)
 {
-    char *tokenized_name = NULL;
     FileContent *content = NULL;
     VarEntry request;
-    uint8_t string_type = 0u;
     int status = APP_ERR_NO_CALC;
 
     if ((session != NULL) && (session->calc != NULL))
@@ -70,29 +110,24 @@ int calc_fetch_string(CalcSession *session, const char *var_name, FileContent **
         if ((var_name != NULL) && (out_content != NULL))
         {
             *out_content = NULL;
-            string_type = tifiles_string2vartype(session->calc_model, "String");
-            if (string_type != 0u)
+            if (build_string_request(session, var_name, &request) == APP_OK)
             {
-                tokenized_name = ticonv_varname_tokenize(session->calc_model, var_name, string_type);
-                if (tokenized_name != NULL)
+                content = tifiles_content_create_regular(session->calc_model);
+                if (content == NULL)
                 {
-                    content = tifiles_content_create_regular(session->calc_model);
-                    if (content == NULL)
-                    {
-                        status = APP_ERR_ALLOC;
-                    }
-                    else
-                    {
-                        memset(&request, 0, sizeof(request));
-                        request.type = string_type;
-                        strncpy(request.name, tokenized_name, sizeof(request.name) - 1u);
+                    status = APP_ERR_ALLOC;
+                }
+                else
+                {
+                    CalcVarTransfer transfer;
 
-                        if (ticalcs_calc_recv_var(session->calc, MODE_NORMAL, content, &request) == 0)
-                        {
-                            *out_content = content;
-                            status = APP_OK;
-                            content = NULL;
-                        }
+                    transfer.content = content;
+                    transfer.request = &request;
+                    if (calc_session_call(session, recv_var_command, &transfer) == 0)
+                    {
+                        *out_content = content;
+                        status = APP_OK;
+                        content = NULL;
                     }
                 }
             }
@@ -104,11 +139,6 @@ int calc_fetch_string(CalcSession *session, const char *var_name, FileContent **
         tifiles_content_delete_regular(content);
     }
 
-    if (tokenized_name != NULL)
-    {
-        ticonv_varname_free(tokenized_name);
-    }
-
     return status;
 }
 
@@ -122,25 +152,69 @@ int calc_store_binary_string(CalcSession *session, const char *var_name, const u
         status = APP_ERR_IO;
         if ((var_name != NULL) && (payload != NULL))
         {
+            cache_evict(cache_find(session, var_name));
             status = build_binary_entry(session, var_name, payload, payload_len, &content);
             if (status == APP_OK)
             {
-                int transfer_result = ticalcs_calc_send_var(session->calc, MODE_NORMAL, content);
+                int transfer_result = calc_session_call(session, send_var_command, content);
                 if (transfer_result != 0)
                 {
-                    char *error_text = NULL;
-                    if ((ticalcs_error_get(transfer_result, &error_text) == 0) && (error_text != NULL))
-                    {
-                        fprintf(stderr, "ticalcs_calc_send_var failed: %s\n", error_text);
-                        ticalcs_error_free(error_text);
-                    }
-                    else
-                    {
-                        fprintf(stderr, "ticalcs_calc_send_var failed with code %d\n", transfer_result);
-                    }
+                    report_send_error(transfer_result);
+                    status = APP_ERR_IO;
+                }
+                else
+                {
+                    cache_put(session, var_name, payload, payload_len, content->entries[0]->size, content->entries[0]->attr);
+                }
+            }
+        }
+    }
 
+    if (content != NULL)
+    {
+        tifiles_content_delete_regular(content);
+    }
+
+    return status;
+}
+
+/*
+ * Store several string variables in a single multi-entry transfer, instead
+ * of one full send_var exchange per variable.
+ */
+int calc_store_binary_strings(CalcSession *session, const CalcBinaryString *items, size_t count)
+{
+    FileContent *content = NULL;
+    int status = APP_ERR_NO_CALC;
+    size_t i;
+
+    if ((session != NULL) && (session->calc != NULL))
+    {
+        status = APP_ERR_IO;
+        if ((items != NULL) && (count > 0u))
+        {
+            for (i = 0u; i < count; i++)
+            {
+                cache_evict(cache_find(session, items[i].var_name));
+            }
+
+            status = build_binary_content(session, items, count, &content);
+            if (status == APP_OK)
+            {
+                int transfer_result = calc_session_call(session, send_var_command, content);
+                if (transfer_result != 0)
+                {
+                    report_send_error(transfer_result);
                     status = APP_ERR_IO;
                 }
+                else
+                {
+                    for (i = 0u; i < count; i++)
+                    {
+                        cache_put(session, items[i].var_name, items[i].payload, items[i].payload_len,
+                                  content->entries[i]->size, content->entries[i]->attr);
+                    }
+                }
             }
         }
     }
@@ -153,6 +227,99 @@ int calc_store_binary_string(CalcSession *session, const char *var_name, const u
     return status;
 }
 
+/* Link operations go through the session I/O thread; building entries does not. */
+static int send_var_command(CalcSession *session, void *arg)
+{
+    return ticalcs_calc_send_var(session->calc, MODE_NORMAL, (FileContent *)arg);
+}
+
+static int recv_var_command(CalcSession *session, void *arg)
+{
+    CalcVarTransfer *transfer = (CalcVarTransfer *)arg;
+
+    return ticalcs_calc_recv_var(session->calc, MODE_NORMAL, transfer->content, transfer->request);
+}
+
+/* One directory listing, then back-to-back requests for the variables present. */
+static int recv_var_batch_command(CalcSession *session, void *arg)
+{
+    CalcVarBatch *batch = (CalcVarBatch *)arg;
+    GNode *vars = NULL;
+    GNode *apps = NULL;
+    size_t i;
+
+    if (ticalcs_calc_get_dirlist(session->calc, &vars, &apps) != 0)
+    {
+        fprintf(stderr, "ticalcs_calc_get_dirlist failed\n");
+        return APP_ERR_IO;
+    }
+
+    for (i = 0u; i < batch->count; i++)
+    {
+        if (batch->contents[i] == NULL)
+        {
+            continue;
+        }
+
+        if (ticalcs_dirlist_ve_exist(vars, &batch->requests[i]) == NULL)
+        {
+            batch->statuses[i] = APP_ERR_IO;
+        }
+        else if (ticalcs_calc_recv_var(session->calc, MODE_NORMAL, batch->contents[i], &batch->requests[i]) == 0)
+        {
+            batch->statuses[i] = APP_OK;
+        }
+        else
+        {
+            batch->statuses[i] = APP_ERR_IO;
+        }
+    }
+
+    ticalcs_dirlist_destroy(&vars);
+    ticalcs_dirlist_destroy(&apps);
+
+    return APP_OK;
+}
+
+static void report_send_error(int transfer_result)
+{
+    char *error_text = NULL;
+
+    if ((ticalcs_error_get(transfer_result, &error_text) == 0) && (error_text != NULL))
+    {
+        fprintf(stderr, "ticalcs_calc_send_var failed: %s\n", error_text);
+        ticalcs_error_free(error_text);
+    }
+    else
+    {
+        fprintf(stderr, "ticalcs_calc_send_var failed with code %d\n", transfer_result);
+    }
+}
+
+static int build_string_request(CalcSession *session, const char *var_name, VarEntry *request)
+{
+    char *tokenized_name = NULL;
+    uint8_t string_type = tifiles_string2vartype(session->calc_model, "String");
+
+    if (string_type == 0u)
+    {
+        return APP_ERR_IO;
+    }
+
+    tokenized_name = ticonv_varname_tokenize(session->calc_model, var_name, string_type);
+    if (tokenized_name == NULL)
+    {
+        return APP_ERR_IO;
+    }
+
+    memset(request, 0, sizeof(*request));
+    request->type = string_type;
+    strncpy(request->name, tokenized_name, sizeof(request->name) - 1u);
+    ticonv_varname_free(tokenized_name);
+
+    return APP_OK;
+}
+
 static int build_string_entry(CalcSession *session, const char *var_name, const char *payload, FileContent **out_content)
 {
     FileContent *content = NULL;
@@ -336,15 +503,22 @@ static int build_string_entry(CalcSession *session, const char *var_name, const
 }
 
 static int build_binary_entry(CalcSession *session, const char *var_name, const uint8_t *payload, size_t payload_len, FileContent **out_content)
+{
+    CalcBinaryString item;
+
+    item.var_name = var_name;
+    item.payload = payload;
+    item.payload_len = payload_len;
+
+    return build_binary_content(session, &item, 1u, out_content);
+}
+
+static int build_binary_content(CalcSession *session, const CalcBinaryString *items, size_t count, FileContent **out_content)
 {
     FileContent *content = NULL;
-    VarEntry *entry = NULL;
-    uint8_t *data = NULL;
-    char *tokenized_name = NULL;
-    size_t entry_size = 0u;
-    size_t name_len = 0u;
     uint8_t string_type = 0u;
     int status = APP_ERR_IO;
+    size_t i;
 
     if (out_content == NULL)
     {
@@ -358,21 +532,76 @@ static int build_binary_entry(CalcSession *session, const char *var_name, const
         return APP_ERR_NO_CALC;
     }
 
-    if ((var_name == NULL) || (payload == NULL))
+    if ((items == NULL) || (count == 0u))
     {
         return APP_ERR_IO;
     }
 
-    if (payload_len > 255u)
+    string_type = tifiles_string2vartype(session->calc_model, "String");
+    if (string_type == 0u)
     {
-        fprintf(stderr, "Binary payload exceeds 255 byte limit (%zu)\n", payload_len);
+        fprintf(stderr, "String vartype lookup failed for model %s\n", ticalcs_model_to_string(session->calc_model));
         return APP_ERR_IO;
     }
 
-    string_type = tifiles_string2vartype(session->calc_model, "String");
-    if (string_type == 0u)
+    content = tifiles_content_create_regular(session->calc_model);
+    if (content == NULL)
     {
-        fprintf(stderr, "String vartype lookup failed for model %s\n", ticalcs_model_to_string(session->calc_model));
+        return APP_ERR_ALLOC;
+    }
+
+    content->model = session->calc_model;
+    content->model_dst = session->calc_model;
+    (void)snprintf(content->comment, sizeof(content->comment), "Pushed from c_wallet");
+
+    content->entries = tifiles_ve_create_array((int)count);
+    if (content->entries == NULL)
+    {
+        status = APP_ERR_ALLOC;
+    }
+    else
+    {
+        status = APP_OK;
+        for (i = 0u; (i < count) && (status == APP_OK); i++)
+        {
+            status = build_binary_var(session, string_type, items[i].var_name, items[i].payload, items[i].payload_len,
+                                      &content->entries[i]);
+            if (status == APP_OK)
+            {
+                content->num_entries++;
+            }
+        }
+    }
+
+    if (status == APP_OK)
+    {
+        *out_content = content;
+    }
+    else
+    {
+        tifiles_content_delete_regular(content);
+    }
+
+    return status;
+}
+
+static int build_binary_var(CalcSession *session, uint8_t string_type, const char *var_name, const uint8_t *payload, size_t payload_len, VarEntry **out_entry)
+{
+    VarEntry *entry = NULL;
+    uint8_t *data = NULL;
+    char *tokenized_name = NULL;
+    size_t entry_size = 0u;
+    size_t name_len = 0u;
+    int status = APP_ERR_IO;
+
+    if ((var_name == NULL) || (payload == NULL))
+    {
+        return APP_ERR_IO;
+    }
+
+    if (payload_len > 255u)
+    {
+        fprintf(stderr, "Binary payload exceeds 255 byte limit (%zu)\n", payload_len);
         return APP_ERR_IO;
     }
 
@@ -403,76 +632,36 @@ static int build_binary_entry(CalcSession *session, const char *var_name, const
             memcpy(data + 1u, payload, payload_len);
         }
 
-        content = tifiles_content_create_regular(session->calc_model);
-        if (content == NULL)
+        entry = tifiles_ve_create();
+        if (entry == NULL)
         {
+            tifiles_ve_free_data(data);
             status = APP_ERR_ALLOC;
         }
         else
         {
-            entry = tifiles_ve_create();
-            if (entry == NULL)
-            {
-                status = APP_ERR_ALLOC;
-            }
-            else
-            {
-                memset(entry, 0, sizeof(*entry));
-                entry->type = string_type;
-                entry->attr = ATTRB_NONE;
-                entry->version = 0;
-                entry->size = (uint32_t)entry_size;
-                entry->data = data;
-                entry->action = 0;
-
-                name_len = strlen(tokenized_name);
-                if (name_len > (sizeof(entry->name) - 1u))
-                {
-                    name_len = sizeof(entry->name) - 1u;
-                }
-                memcpy(entry->name, tokenized_name, name_len);
-                entry->name[name_len] = '\0';
+            memset(entry, 0, sizeof(*entry));
+            entry->type = string_type;
+            entry->attr = ATTRB_NONE;
+            entry->version = 0;
+            entry->size = (uint32_t)entry_size;
+            entry->data = data;
+            entry->action = 0;
 
-                content->model = session->calc_model;
-                content->model_dst = session->calc_model;
-                (void)snprintf(content->comment, sizeof(content->comment), "Pushed from c_wallet");
-
-                content->entries = tifiles_ve_create_array(1);
-                if (content->entries == NULL)
-                {
-                    status = APP_ERR_ALLOC;
-                }
-                else
-                {
-                    content->entries[0] = entry;
-                    content->num_entries = 1;
-                    *out_content = content;
-                    status = APP_OK;
-                }
+            name_len = strlen(tokenized_name);
+            if (name_len > (sizeof(entry->name) - 1u))
+            {
+                name_len = sizeof(entry->name) - 1u;
             }
-        }
-    }
+            memcpy(entry->name, tokenized_name, name_len);
+            entry->name[name_len] = '\0';
 
-    if (status != APP_OK)
-    {
-        if (content != NULL)
-        {
-            tifiles_content_delete_regular(content);
-        }
-        else if (entry != NULL)
-        {
-            tifiles_ve_delete(entry);
-        }
-        else if (data != NULL)
-        {
-            tifiles_ve_free_data(data);
+            *out_entry = entry;
+            status = APP_OK;
         }
     }
 
-    if (tokenized_name != NULL)
-    {
-        ticonv_varname_free(tokenized_name);
-    }
+    ticonv_varname_free(tokenized_name);
 
     return status;
 }
@@ -480,7 +669,6 @@ static int build_binary_entry(CalcSession *session, const char *var_name, const
 int calc_fetch_binary_string(CalcSession *session, const char *var_name, uint8_t *out_data, size_t out_size, size_t *out_len)
 {
     FileContent *content = NULL;
-    VarEntry *entry = NULL;
     int status = APP_ERR_IO;
 
     if ((session == NULL) || (var_name == NULL) || (out_data == NULL) || (out_len == NULL))
@@ -490,12 +678,147 @@ int calc_fetch_binary_string(CalcSession *session, const char *var_name, uint8_t
 
     *out_len = 0u;
 
+    if (cache_get(session, var_name, out_data, out_size, out_len) == APP_OK)
+    {
+        return APP_OK;
+    }
+
     status = calc_fetch_string(session, var_name, &content);
     if (status != APP_OK)
     {
         return status;
     }
 
+    status = copy_binary_payload(content, out_data, out_size, out_len);
+    if (status == APP_OK)
+    {
+        cache_put(session, var_name, out_data, *out_len, content->entries[0]->size, content->entries[0]->attr);
+    }
+
+    if (content != NULL)
+    {
+        if ((content->num_entries > 0) && (content->entries[0]->data != NULL))
+        {
+            wallet_secure_zero(content->entries[0]->data, content->entries[0]->size);
+        }
+        tifiles_content_delete_regular(content);
+    }
+
+    return status;
+}
+
+/*
+ * Fetch several string variables with one directory listing and
+ * back-to-back requests, all in a single I/O thread command. Variables
+ * missing from the listing fail with APP_ERR_IO without any request.
+ * Returns APP_OK when every item was fetched, else the first item error.
+ */
+int calc_fetch_binary_strings(CalcSession *session, CalcBinaryStringFetch *items, size_t count)
+{
+    CalcVarBatch batch;
+    int status = APP_ERR_NO_CALC;
+    size_t pending = 0u;
+    size_t i;
+
+    if ((session == NULL) || (session->calc == NULL))
+    {
+        return APP_ERR_NO_CALC;
+    }
+
+    if ((items == NULL) || (count == 0u))
+    {
+        return APP_ERR_IO;
+    }
+
+    memset(&batch, 0, sizeof(batch));
+    batch.count = count;
+    batch.contents = (FileContent **)calloc(count, sizeof(*batch.contents));
+    batch.requests = (VarEntry *)calloc(count, sizeof(*batch.requests));
+    batch.statuses = (int *)calloc(count, sizeof(*batch.statuses));
+    if ((batch.contents == NULL) || (batch.requests == NULL) || (batch.statuses == NULL))
+    {
+        status = APP_ERR_ALLOC;
+    }
+    else
+    {
+        status = APP_OK;
+        for (i = 0u; i < count; i++)
+        {
+            items[i].out_len = 0u;
+            batch.statuses[i] = APP_ERR_IO;
+            if ((items[i].var_name == NULL) || (items[i].out_data == NULL) ||
+                (build_string_request(session, items[i].var_name, &batch.requests[i]) != APP_OK))
+            {
+                continue;
+            }
+
+            if (cache_get(session, items[i].var_name, items[i].out_data, items[i].out_size, &items[i].out_len) == APP_OK)
+            {
+                batch.statuses[i] = APP_OK;
+                continue;
+            }
+            pending++;
+
+            batch.contents[i] = tifiles_content_create_regular(session->calc_model);
+            if (batch.contents[i] == NULL)
+            {
+                batch.statuses[i] = APP_ERR_ALLOC;
+            }
+        }
+
+        if ((pending > 0u) && (calc_session_call(session, recv_var_batch_command, &batch) != APP_OK))
+        {
+            for (i = 0u; i < count; i++)
+            {
+                if (batch.contents[i] != NULL)
+                {
+                    batch.statuses[i] = APP_ERR_IO;
+                }
+            }
+        }
+
+        for (i = 0u; i < count; i++)
+        {
+            items[i].status = batch.statuses[i];
+            if ((items[i].status == APP_OK) && (batch.contents[i] != NULL))
+            {
+                items[i].status = copy_binary_payload(batch.contents[i], items[i].out_data, items[i].out_size, &items[i].out_len);
+                if (items[i].status == APP_OK)
+                {
+                    cache_put(session, items[i].var_name, items[i].out_data, items[i].out_len,
+                              batch.contents[i]->entries[0]->size, batch.contents[i]->entries[0]->attr);
+                }
+            }
+
+            if ((status == APP_OK) && (items[i].status != APP_OK))
+            {
+                status = items[i].status;
+            }
+        }
+    }
+
+    if (batch.contents != NULL)
+    {
+        for (i = 0u; i < count; i++)
+        {
+            if (batch.contents[i] != NULL)
+            {
+                tifiles_content_delete_regular(batch.contents[i]);
+            }
+        }
+        free(batch.contents);
+    }
+    free(batch.requests);
+    free(batch.statuses);
+
+    return status;
+}
+
+static int copy_binary_payload(const FileContent *content, uint8_t *out_data, size_t out_size, size_t *out_len)
+{
+    const VarEntry *entry = NULL;
+    int status = APP_ERR_IO;
+
     if ((content == NULL) || (content->num_entries == 0u) || (content->entries == NULL) || (content->entries[0] == NULL))
     {
         status = APP_ERR_IO;
@@ -524,10 +847,187 @@ int calc_fetch_binary_string(CalcSession *session, const char *var_name, uint8_t
         }
     }
 
-    if (content != NULL)
+    return status;
+}
+
+void calc_string_cache_invalidate(CalcSession *session)
+{
+    if ((session != NULL) && (session->string_cache != NULL))
     {
-        tifiles_content_delete_regular(content);
+        session->string_cache->trusted = 0;
+    }
+}
+
+void calc_string_cache_clear(CalcSession *session)
+{
+    if ((session != NULL) && (session->string_cache != NULL))
+    {
+        wallet_secure_zero(session->string_cache, sizeof(*session->string_cache));
+        free(session->string_cache);
+        session->string_cache = NULL;
+    }
+}
+
+/* Make sure the cache can be trusted, revalidating it with a directory listing if needed. */
+static int cache_validate(CalcSession *session)
+{
+    struct CalcStringCache *cache = session->string_cache;
+    int status = APP_OK;
+
+    if (cache == NULL)
+    {
+        cache = (struct CalcStringCache *)calloc(1u, sizeof(*cache));
+        if (cache == NULL)
+        {
+            return APP_ERR_ALLOC;
+        }
+        cache->trusted = 1;
+        cache->link_generation = session->link_generation;
+        session->string_cache = cache;
+    }
+
+    if ((cache->trusted == 0) || (cache->link_generation != session->link_generation))
+    {
+        unsigned int held = 0u;
+        unsigned int i;
+
+        for (i = 0u; i < CALC_STRING_CACHE_SLOTS; i++)
+        {
+            held += (cache->entries[i].valid != 0) ? 1u : 0u;
+        }
+
+        /* Nothing to check against the listing, so skip the round trip. */
+        status = (held > 0u) ? calc_session_call(session, cache_validate_command, cache) : APP_OK;
+        if (status == APP_OK)
+        {
+            cache->trusted = 1;
+            cache->link_generation = session->link_generation;
+        }
     }
 
     return status;
 }
+
+static int cache_validate_command(CalcSession *session, void *arg)
+{
+    struct CalcStringCache *cache = (struct CalcStringCache *)arg;
+    GNode *vars = NULL;
+    GNode *apps = NULL;
+    unsigned int i;
+
+    if (ticalcs_calc_get_dirlist(session->calc, &vars, &apps) != 0)
+    {
+        return APP_ERR_IO;
+    }
+
+    for (i = 0u; i < CALC_STRING_CACHE_SLOTS; i++)
+    {
+        CalcStringCacheEntry *entry = &cache->entries[i];
+        VarEntry *found = NULL;
+
+        if (entry->valid == 0)
+        {
+            continue;
+        }
+
+        found = ticalcs_dirlist_ve_exist(vars, &entry->request);
+        if ((found == NULL) || (found->size != entry->size) || (found->attr != entry->attr))
+        {
+            cache_evict(entry);
+        }
+    }
+
+    ticalcs_dirlist_destroy(&vars);
+    ticalcs_dirlist_destroy(&apps);
+
+    return APP_OK;
+}
+
+static CalcStringCacheEntry *cache_find(CalcSession *session, const char *var_name)
+{
+    unsigned int i;
+
+    if ((session == NULL) || (session->string_cache == NULL) || (var_name == NULL))
+    {
+        return NULL;
+    }
+
+    for (i = 0u; i < CALC_STRING_CACHE_SLOTS; i++)
+    {
+        CalcStringCacheEntry *entry = &session->string_cache->entries[i];
+        if ((entry->valid != 0) && (strcmp(entry->var_name, var_name) == 0))
+        {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+static int cache_get(CalcSession *session, const char *var_name, uint8_t *out_data, size_t out_size, size_t *out_len)
+{
+    CalcStringCacheEntry *entry = NULL;
+
+    if (cache_validate(session) != APP_OK)
+    {
+        return APP_ERR_IO;
+    }
+
+    entry = cache_find(session, var_name);
+    if ((entry == NULL) || (entry->len > out_size))
+    {
+        return APP_ERR_IO;
+    }
+
+    memcpy(out_data, entry->data, entry->len);
+    *out_len = entry->len;
+
+    return APP_OK;
+}
+
+static void cache_put(CalcSession *session, const char *var_name, const uint8_t *data, size_t len, uint32_t size, FileAttr attr)
+{
+    struct CalcStringCache *cache = session->string_cache;
+    CalcStringCacheEntry *entry = NULL;
+    unsigned int i;
+
+    if ((cache == NULL) || (len > sizeof(entry->data)) || (strlen(var_name) >= sizeof(entry->var_name)))
+    {
+        return;
+    }
+
+    entry = cache_find(session, var_name);
+    for (i = 0u; (entry == NULL) && (i < CALC_STRING_CACHE_SLOTS); i++)
+    {
+        if (cache->entries[i].valid == 0)
+        {
+            entry = &cache->entries[i];
+        }
+    }
+
+    if (entry == NULL)
+    {
+        entry = &cache->entries[cache->next_victim];
+        cache->next_victim = (cache->next_victim + 1u) % CALC_STRING_CACHE_SLOTS;
+    }
+
+    cache_evict(entry);
+    if (build_string_request(session, var_name, &entry->request) == APP_OK)
+    {
+        strcpy(entry->var_name, var_name);
+        memcpy(entry->data, data, len);
+        entry->len = len;
+        entry->size = size;
+        entry->attr = attr;
+        entry->valid = 1;
+    }
+}
+
+/* Cached payloads hold encrypted keys: wipe them rather than just dropping them. */
+static void cache_evict(CalcStringCacheEntry *entry)
+{
+    if (entry != NULL)
+    {
+        wallet_secure_zero(entry, sizeof(*entry));
+    }
+}
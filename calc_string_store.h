@@ -10,10 +10,44 @@
 extern "C" {
 #endif
 
+/* One (name, payload) pair of a batched store. */
+typedef struct
+{
+    const char *var_name;
+    const uint8_t *payload;
+    size_t payload_len;
+} CalcBinaryString;
+
+/* One variable of a batched fetch; out_len and status are filled in. */
+typedef struct
+{
+    const char *var_name;
+    uint8_t *out_data;
+    size_t out_size;
+    size_t out_len;
+    int status;
+} CalcBinaryStringFetch;
+
 int calc_store_persistent_string(CalcSession *session, const char *var_name, const char *payload);
 int calc_fetch_string(CalcSession *session, const char *var_name, FileContent **out_content);
 int calc_store_binary_string(CalcSession *session, const char *var_name, const uint8_t *payload, size_t payload_len);
 int calc_fetch_binary_string(CalcSession *session, const char *var_name, uint8_t *out_data, size_t out_size, size_t *out_len);
+int calc_store_binary_strings(CalcSession *session, const CalcBinaryString *items, size_t count);
+int calc_fetch_binary_strings(CalcSession *session, CalcBinaryStringFetch *items, size_t count);
+
+/*
+ * Binary string fetches are served from a per-session host cache, filled on
+ * fetch and written through on store. The cache is trusted while the link
+ * generation is unchanged; after a reattach or calc_string_cache_invalidate
+ * it is checked once against a directory listing (name, size, attributes)
+ * and entries that no longer match are wiped.
+ *
+ * The user can edit or delete a slot on the calculator at any time, so
+ * callers invalidate at the start of every user-level operation (each menu
+ * command, each FFI fetch); repeated fetches within one operation still hit.
+ */
+void calc_string_cache_invalidate(CalcSession *session);
+void calc_string_cache_clear(CalcSession *session);
 
 #ifdef __cplusplus
 }
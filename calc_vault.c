@@ -0,0 +1,642 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "calc_vault.h"
+
+#include "tifiles.h"
+#include "ticonv.h"
+
+#define CALC_VAULT_HEADER_LEN 8u
+#define CALC_VAULT_RECORD_LEN (2u + CALC_VAULT_LABEL_LEN + WALLET_PUBLIC_KEY_LEN + 6u)
+
+typedef struct
+{
+    FileContent *content;
+    VarEntry request;
+    int found;
+} CalcVaultTransfer;
+
+static int vault_request(CalcSession *session, VarEntry *request);
+static int vault_recv_command(CalcSession *session, void *arg);
+static int vault_send_command(CalcSession *session, void *arg);
+static size_t vault_image_len(const CalcVault *vault, size_t data_len);
+static int vault_reserve(CalcVault *vault, size_t data_len);
+static int vault_compact(CalcVault *vault);
+static void vault_put_u16(uint8_t *out, size_t value);
+static uint16_t vault_get_u16(const uint8_t *in);
+
+void calc_vault_init(CalcVault *vault)
+{
+    if (vault != NULL)
+    {
+        memset(vault, 0, sizeof(*vault));
+    }
+}
+
+void calc_vault_free(CalcVault *vault)
+{
+    if (vault != NULL)
+    {
+        if (vault->data != NULL)
+        {
+            wallet_secure_zero(vault->data, vault->data_capacity);
+            free(vault->data);
+        }
+        wallet_secure_zero(vault, sizeof(*vault));
+    }
+}
+
+int calc_vault_load(CalcSession *session, CalcVault *vault)
+{
+    CalcVaultTransfer transfer;
+    int status = APP_ERR_NO_CALC;
+
+    if ((session == NULL) || (session->calc == NULL) || (vault == NULL))
+    {
+        return APP_ERR_NO_CALC;
+    }
+
+    calc_vault_free(vault);
+
+    memset(&transfer, 0, sizeof(transfer));
+    status = vault_request(session, &transfer.request);
+    if (status == APP_OK)
+    {
+        transfer.content = tifiles_content_create_regular(session->calc_model);
+        if (transfer.content == NULL)
+        {
+            status = APP_ERR_ALLOC;
+        }
+    }
+
+    if (status == APP_OK)
+    {
+        status = calc_session_call(session, vault_recv_command, &transfer);
+    }
+
+    if ((status == APP_OK) && (transfer.found != 0))
+    {
+        VarEntry *entry = NULL;
+
+        if ((transfer.content->num_entries > 0) && (transfer.content->entries[0] != NULL))
+        {
+            entry = transfer.content->entries[0];
+        }
+
+        /* AppVar data: u16 length word, then the vault image. */
+        if ((entry == NULL) || (entry->data == NULL) || (entry->size < 2u) ||
+            ((size_t)vault_get_u16(entry->data) > (entry->size - 2u)))
+        {
+            fprintf(stderr, "%s is not a valid wallet vault\n", CALC_VAULT_VAR_NAME);
+            status = APP_ERR_IO;
+        }
+        else
+        {
+            status = calc_vault_decode(vault, entry->data + 2u, vault_get_u16(entry->data));
+        }
+
+        if ((entry != NULL) && (entry->data != NULL))
+        {
+            wallet_secure_zero(entry->data, entry->size);
+        }
+    }
+
+    if (transfer.content != NULL)
+    {
+        tifiles_content_delete_regular(transfer.content);
+    }
+
+    return status;
+}
+
+int calc_vault_save(CalcSession *session, const CalcVault *vault)
+{
+    FileContent *content = NULL;
+    VarEntry *entry = NULL;
+    VarEntry request;
+    uint8_t *image = NULL;
+    size_t image_len = 0u;
+    int status = APP_ERR_NO_CALC;
+
+    if ((session == NULL) || (session->calc == NULL) || (vault == NULL))
+    {
+        return APP_ERR_NO_CALC;
+    }
+
+    status = vault_request(session, &request);
+    if (status == APP_OK)
+    {
+        status = calc_vault_encode(vault, &image, &image_len);
+    }
+
+    if (status == APP_OK)
+    {
+        content = tifiles_content_create_regular(session->calc_model);
+        if (content == NULL)
+        {
+            status = APP_ERR_ALLOC;
+        }
+    }
+
+    if (status == APP_OK)
+    {
+        content->model = session->calc_model;
+        content->model_dst = session->calc_model;
+        (void)snprintf(content->comment, sizeof(content->comment), "Pushed from c_wallet");
+
+        content->entries = tifiles_ve_create_array(1);
+        entry = tifiles_ve_create();
+        if ((content->entries == NULL) || (entry == NULL))
+        {
+            tifiles_ve_delete(entry);
+            status = APP_ERR_ALLOC;
+        }
+        else
+        {
+            memset(entry, 0, sizeof(*entry));
+            entry->data = (uint8_t *)tifiles_ve_alloc_data(image_len + 2u);
+            if (entry->data == NULL)
+            {
+                tifiles_ve_delete(entry);
+                status = APP_ERR_ALLOC;
+            }
+            else
+            {
+                memcpy(entry->name, request.name, sizeof(entry->name));
+                entry->type = request.type;
+                entry->attr = ATTRB_NONE;
+                entry->size = (uint32_t)(image_len + 2u);
+                vault_put_u16(entry->data, image_len);
+                memcpy(entry->data + 2u, image, image_len);
+                content->entries[0] = entry;
+                content->num_entries = 1;
+            }
+        }
+    }
+
+    if (status == APP_OK)
+    {
+        int transfer_result = calc_session_call(session, vault_send_command, content);
+        if (transfer_result != 0)
+        {
+            fprintf(stderr, "Failed to send %s (error %d)\n", CALC_VAULT_VAR_NAME, transfer_result);
+            status = APP_ERR_IO;
+        }
+    }
+
+    if (image != NULL)
+    {
+        wallet_secure_zero(image, image_len);
+        free(image);
+    }
+
+    if (content != NULL)
+    {
+        if ((content->num_entries > 0) && (content->entries[0]->data != NULL))
+        {
+            wallet_secure_zero(content->entries[0]->data, content->entries[0]->size);
+        }
+        tifiles_content_delete_regular(content);
+    }
+
+    return status;
+}
+
+int calc_vault_find(const CalcVault *vault, const char *label)
+{
+    unsigned int i;
+
+    if ((vault == NULL) || (label == NULL))
+    {
+        return -1;
+    }
+
+    for (i = 0u; i < vault->entry_count; i++)
+    {
+        if (strncmp(vault->entries[i].label, label, CALC_VAULT_LABEL_LEN) == 0)
+        {
+            return (int)i;
+        }
+    }
+
+    return -1;
+}
+
+int calc_vault_put(CalcVault *vault, CalcVaultKind kind, const char *label, const uint8_t *public_key, const uint8_t *payload, size_t payload_len)
+{
+    CalcVaultEntry *entry = NULL;
+    int index = -1;
+    int status = APP_OK;
+
+    if ((vault == NULL) || (label == NULL) || (label[0] == '\0') || (public_key == NULL) ||
+        ((payload == NULL) && (payload_len > 0u)))
+    {
+        return APP_ERR_IO;
+    }
+
+    if ((strlen(label) > CALC_VAULT_LABEL_LEN) || (payload_len > CALC_VAULT_MAX_SIZE))
+    {
+        fprintf(stderr, "Vault entry '%s' is too large\n", label);
+        return APP_ERR_IO;
+    }
+
+    index = calc_vault_find(vault, label);
+    if (index >= 0)
+    {
+        entry = &vault->entries[index];
+    }
+    else if (vault->entry_count >= CALC_VAULT_MAX_ENTRIES)
+    {
+        fprintf(stderr, "Wallet vault is full (%u entries)\n", CALC_VAULT_MAX_ENTRIES);
+        return APP_ERR_IO;
+    }
+    else
+    {
+        entry = &vault->entries[vault->entry_count];
+        memset(entry, 0, sizeof(*entry));
+        (void)snprintf(entry->label, sizeof(entry->label), "%s", label);
+        vault->entry_count++;
+    }
+
+    if (payload_len > entry->capacity)
+    {
+        if (vault_image_len(vault, vault->data_len + payload_len) > CALC_VAULT_MAX_SIZE)
+        {
+            status = vault_compact(vault);
+        }
+
+        if ((status == APP_OK) && (vault_image_len(vault, vault->data_len + payload_len) > CALC_VAULT_MAX_SIZE))
+        {
+            fprintf(stderr, "Wallet vault would exceed %u bytes\n", CALC_VAULT_MAX_SIZE);
+            status = APP_ERR_IO;
+        }
+
+        if (status == APP_OK)
+        {
+            status = vault_reserve(vault, vault->data_len + payload_len);
+        }
+
+        if (status == APP_OK)
+        {
+            /* Does not fit in place: the old bytes become dead space until the next compaction. */
+            wallet_secure_zero(vault->data + entry->offset, entry->capacity);
+            entry->offset = (uint16_t)vault->data_len;
+            entry->capacity = (uint16_t)payload_len;
+            vault->data_len += payload_len;
+        }
+    }
+
+    if (status == APP_OK)
+    {
+        entry->kind = (uint8_t)kind;
+        memcpy(entry->public_key, public_key, WALLET_PUBLIC_KEY_LEN);
+        if (payload_len > 0u)
+        {
+            memcpy(vault->data + entry->offset, payload, payload_len);
+        }
+        if (entry->capacity > payload_len)
+        {
+            wallet_secure_zero(vault->data + entry->offset + payload_len, entry->capacity - payload_len);
+        }
+        entry->length = (uint16_t)payload_len;
+    }
+    else if (index < 0)
+    {
+        vault->entry_count--;
+        memset(entry, 0, sizeof(*entry));
+    }
+
+    return status;
+}
+
+int calc_vault_get(const CalcVault *vault, int index, uint8_t *out_data, size_t out_size, size_t *out_len)
+{
+    const CalcVaultEntry *entry = NULL;
+
+    if ((vault == NULL) || (out_data == NULL) || (out_len == NULL) ||
+        (index < 0) || ((unsigned int)index >= vault->entry_count))
+    {
+        return APP_ERR_IO;
+    }
+
+    entry = &vault->entries[index];
+    if (entry->length > out_size)
+    {
+        return APP_ERR_IO;
+    }
+
+    if (entry->length > 0u)
+    {
+        memcpy(out_data, vault->data + entry->offset, entry->length);
+    }
+    *out_len = entry->length;
+
+    return APP_OK;
+}
+
+int calc_vault_remove(CalcVault *vault, const char *label)
+{
+    int index = calc_vault_find(vault, label);
+    unsigned int i;
+
+    if (index < 0)
+    {
+        return APP_ERR_IO;
+    }
+
+    wallet_secure_zero(vault->data + vault->entries[index].offset, vault->entries[index].capacity);
+    for (i = (unsigned int)index; (i + 1u) < vault->entry_count; i++)
+    {
+        vault->entries[i] = vault->entries[i + 1u];
+    }
+    vault->entry_count--;
+    memset(&vault->entries[vault->entry_count], 0, sizeof(vault->entries[0]));
+
+    return APP_OK;
+}
+
+int calc_vault_encode(const CalcVault *vault, uint8_t **out_image, size_t *out_len)
+{
+    uint8_t *image = NULL;
+    uint8_t *record = NULL;
+    size_t image_len = 0u;
+    unsigned int i;
+
+    if ((vault == NULL) || (out_image == NULL) || (out_len == NULL))
+    {
+        return APP_ERR_IO;
+    }
+
+    *out_image = NULL;
+    *out_len = 0u;
+
+    image_len = vault_image_len(vault, vault->data_len);
+    if (image_len > CALC_VAULT_MAX_SIZE)
+    {
+        return APP_ERR_IO;
+    }
+
+    image = (uint8_t *)calloc(1u, image_len);
+    if (image == NULL)
+    {
+        return APP_ERR_ALLOC;
+    }
+
+    image[0] = 'C';
+    image[1] = 'W';
+    image[2] = 'V';
+    image[3] = CALC_VAULT_VERSION;
+    vault_put_u16(image + 4u, vault->entry_count);
+    vault_put_u16(image + 6u, vault->data_len);
+
+    record = image + CALC_VAULT_HEADER_LEN;
+    for (i = 0u; i < vault->entry_count; i++)
+    {
+        const CalcVaultEntry *entry = &vault->entries[i];
+
+        record[0] = entry->kind;
+        record[1] = entry->flags;
+        memcpy(record + 2u, entry->label, strlen(entry->label));
+        memcpy(record + 2u + CALC_VAULT_LABEL_LEN, entry->public_key, WALLET_PUBLIC_KEY_LEN);
+        vault_put_u16(record + CALC_VAULT_RECORD_LEN - 6u, entry->offset);
+        vault_put_u16(record + CALC_VAULT_RECORD_LEN - 4u, entry->length);
+        vault_put_u16(record + CALC_VAULT_RECORD_LEN - 2u, entry->capacity);
+        record += CALC_VAULT_RECORD_LEN;
+    }
+
+    if (vault->data_len > 0u)
+    {
+        memcpy(record, vault->data, vault->data_len);
+    }
+
+    *out_image = image;
+    *out_len = image_len;
+
+    return APP_OK;
+}
+
+int calc_vault_decode(CalcVault *vault, const uint8_t *image, size_t image_len)
+{
+    const uint8_t *record = NULL;
+    size_t count = 0u;
+    size_t data_len = 0u;
+    int status = APP_OK;
+    size_t i;
+
+    if ((vault == NULL) || (image == NULL))
+    {
+        return APP_ERR_IO;
+    }
+
+    calc_vault_free(vault);
+
+    if ((image_len < CALC_VAULT_HEADER_LEN) || (image[0] != 'C') || (image[1] != 'W') || (image[2] != 'V'))
+    {
+        fprintf(stderr, "%s is not a valid wallet vault\n", CALC_VAULT_VAR_NAME);
+        return APP_ERR_IO;
+    }
+
+    if (image[3] != CALC_VAULT_VERSION)
+    {
+        fprintf(stderr, "Unsupported wallet vault version %u\n", image[3]);
+        return APP_ERR_IO;
+    }
+
+    count = vault_get_u16(image + 4u);
+    data_len = vault_get_u16(image + 6u);
+    if ((count > CALC_VAULT_MAX_ENTRIES) ||
+        (image_len < (CALC_VAULT_HEADER_LEN + (count * CALC_VAULT_RECORD_LEN) + data_len)))
+    {
+        fprintf(stderr, "Wallet vault index is truncated\n");
+        return APP_ERR_IO;
+    }
+
+    status = vault_reserve(vault, data_len);
+    if (status != APP_OK)
+    {
+        return status;
+    }
+
+    record = image + CALC_VAULT_HEADER_LEN;
+    for (i = 0u; (i < count) && (status == APP_OK); i++)
+    {
+        CalcVaultEntry *entry = &vault->entries[i];
+
+        entry->kind = record[0];
+        entry->flags = record[1];
+        memcpy(entry->label, record + 2u, CALC_VAULT_LABEL_LEN);
+        entry->label[CALC_VAULT_LABEL_LEN] = '\0';
+        memcpy(entry->public_key, record + 2u + CALC_VAULT_LABEL_LEN, WALLET_PUBLIC_KEY_LEN);
+        entry->offset = vault_get_u16(record + CALC_VAULT_RECORD_LEN - 6u);
+        entry->length = vault_get_u16(record + CALC_VAULT_RECORD_LEN - 4u);
+        entry->capacity = vault_get_u16(record + CALC_VAULT_RECORD_LEN - 2u);
+        if ((entry->length > entry->capacity) || (((size_t)entry->offset + entry->capacity) > data_len))
+        {
+            fprintf(stderr, "Wallet vault entry %zu is out of bounds\n", i);
+            status = APP_ERR_IO;
+        }
+        record += CALC_VAULT_RECORD_LEN;
+    }
+
+    if (status == APP_OK)
+    {
+        vault->entry_count = (unsigned int)count;
+        if (data_len > 0u)
+        {
+            memcpy(vault->data, record, data_len);
+        }
+        vault->data_len = data_len;
+    }
+    else
+    {
+        calc_vault_free(vault);
+    }
+
+    return status;
+}
+
+static int vault_request(CalcSession *session, VarEntry *request)
+{
+    char *tokenized_name = NULL;
+    uint8_t appvar_type = tifiles_string2vartype(session->calc_model, "AppVar");
+
+    if (appvar_type == 0u)
+    {
+        fprintf(stderr, "AppVar vartype lookup failed for model %s\n", ticalcs_model_to_string(session->calc_model));
+        return APP_ERR_IO;
+    }
+
+    tokenized_name = ticonv_varname_tokenize(session->calc_model, CALC_VAULT_VAR_NAME, appvar_type);
+    if (tokenized_name == NULL)
+    {
+        return APP_ERR_IO;
+    }
+
+    memset(request, 0, sizeof(*request));
+    request->type = appvar_type;
+    strncpy(request->name, tokenized_name, sizeof(request->name) - 1u);
+    ticonv_varname_free(tokenized_name);
+
+    return APP_OK;
+}
+
+/* Directory listing first so a calculator without a vault is not an error. */
+static int vault_recv_command(CalcSession *session, void *arg)
+{
+    CalcVaultTransfer *transfer = (CalcVaultTransfer *)arg;
+    GNode *vars = NULL;
+    GNode *apps = NULL;
+    int status = APP_OK;
+
+    if (ticalcs_calc_get_dirlist(session->calc, &vars, &apps) != 0)
+    {
+        fprintf(stderr, "ticalcs_calc_get_dirlist failed\n");
+        return APP_ERR_IO;
+    }
+
+    transfer->found = (ticalcs_dirlist_ve_exist(vars, &transfer->request) != NULL);
+    if ((transfer->found != 0) &&
+        (ticalcs_calc_recv_var(session->calc, MODE_NORMAL, transfer->content, &transfer->request) != 0))
+    {
+        status = APP_ERR_IO;
+    }
+
+    ticalcs_dirlist_destroy(&vars);
+    ticalcs_dirlist_destroy(&apps);
+
+    return status;
+}
+
+static int vault_send_command(CalcSession *session, void *arg)
+{
+    return ticalcs_calc_send_var(session->calc, MODE_NORMAL, (FileContent *)arg);
+}
+
+static size_t vault_image_len(const CalcVault *vault, size_t data_len)
+{
+    return CALC_VAULT_HEADER_LEN + ((size_t)vault->entry_count * CALC_VAULT_RECORD_LEN) + data_len;
+}
+
+/* Grows the payload area; the old copy is wiped rather than left to realloc. */
+static int vault_reserve(CalcVault *vault, size_t data_len)
+{
+    uint8_t *data = NULL;
+    size_t capacity = (vault->data_capacity > 0u) ? vault->data_capacity : 256u;
+
+    if ((data_len <= vault->data_capacity) && (vault->data != NULL))
+    {
+        return APP_OK;
+    }
+
+    while (capacity < data_len)
+    {
+        capacity *= 2u;
+    }
+
+    data = (uint8_t *)calloc(1u, capacity);
+    if (data == NULL)
+    {
+        return APP_ERR_ALLOC;
+    }
+
+    if (vault->data != NULL)
+    {
+        memcpy(data, vault->data, vault->data_len);
+        wallet_secure_zero(vault->data, vault->data_capacity);
+        free(vault->data);
+    }
+
+    vault->data = data;
+    vault->data_capacity = capacity;
+
+    return APP_OK;
+}
+
+/* Packs live payloads back to back, dropping slack and the space of replaced entries. */
+static int vault_compact(CalcVault *vault)
+{
+    uint8_t *data = NULL;
+    size_t offset = 0u;
+    unsigned int i;
+
+    if (vault->data == NULL)
+    {
+        return APP_OK;
+    }
+
+    data = (uint8_t *)calloc(1u, vault->data_capacity);
+    if (data == NULL)
+    {
+        return APP_ERR_ALLOC;
+    }
+
+    for (i = 0u; i < vault->entry_count; i++)
+    {
+        CalcVaultEntry *entry = &vault->entries[i];
+
+        memcpy(data + offset, vault->data + entry->offset, entry->length);
+        entry->offset = (uint16_t)offset;
+        entry->capacity = entry->length;
+        offset += entry->length;
+    }
+
+    wallet_secure_zero(vault->data, vault->data_capacity);
+    free(vault->data);
+    vault->data = data;
+    vault->data_len = offset;
+
+    return APP_OK;
+}
+
+static void vault_put_u16(uint8_t *out, size_t value)
+{
+    out[0] = (uint8_t)(value & 0xFFu);
+    out[1] = (uint8_t)((value >> 8) & 0xFFu);
+}
+
+static uint16_t vault_get_u16(const uint8_t *in)
+{
+    return (uint16_t)(in[0] | ((uint16_t)in[1] << 8));
+}
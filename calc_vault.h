@@ -0,0 +1,79 @@
+#ifndef CALC_VAULT_H
+#define CALC_VAULT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "calc_session.h"
+#include "wallet_crypto.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CALC_VAULT_VAR_NAME "CWALLET"
+#define CALC_VAULT_VERSION 1u
+#define CALC_VAULT_MAX_ENTRIES 64u
+#define CALC_VAULT_LABEL_LEN 8u
+#define CALC_VAULT_MAX_SIZE 16384u
+
+typedef enum
+{
+    CALC_VAULT_KEYPAIR = 1,
+    CALC_VAULT_CONTACT,
+    CALC_VAULT_NONCE_ACCOUNT
+} CalcVaultKind;
+
+/* One index record; payload bytes live at offset in the vault data area. */
+typedef struct
+{
+    uint8_t kind;
+    uint8_t flags;
+    char label[CALC_VAULT_LABEL_LEN + 1u];
+    uint8_t public_key[WALLET_PUBLIC_KEY_LEN];
+    uint16_t offset;
+    uint16_t length;
+    uint16_t capacity;
+} CalcVaultEntry;
+
+/*
+ * Every wallet entry kept in a single TI-83+ AppVar:
+ *
+ *   "CWV" version u16:count u16:data_len
+ *   count x { kind flags label[8] public_key[32] u16:offset u16:length u16:capacity }
+ *   data_len bytes of payloads
+ *
+ * All integers are little endian. The index sits in front so every public key
+ * is known after one transfer; payloads (encrypted key blobs, address book
+ * records, ...) are rewritten in place when the new value fits their capacity.
+ */
+typedef struct
+{
+    unsigned int entry_count;
+    CalcVaultEntry entries[CALC_VAULT_MAX_ENTRIES];
+    uint8_t *data;
+    size_t data_len;
+    size_t data_capacity;
+} CalcVault;
+
+void calc_vault_init(CalcVault *vault);
+/* Wipes and frees the payload area. */
+void calc_vault_free(CalcVault *vault);
+
+/* One transfer; a calculator without the AppVar yields an empty vault. */
+int calc_vault_load(CalcSession *session, CalcVault *vault);
+int calc_vault_save(CalcSession *session, const CalcVault *vault);
+
+int calc_vault_find(const CalcVault *vault, const char *label);
+int calc_vault_put(CalcVault *vault, CalcVaultKind kind, const char *label, const uint8_t *public_key, const uint8_t *payload, size_t payload_len);
+int calc_vault_get(const CalcVault *vault, int index, uint8_t *out_data, size_t out_size, size_t *out_len);
+int calc_vault_remove(CalcVault *vault, const char *label);
+
+int calc_vault_encode(const CalcVault *vault, uint8_t **out_image, size_t *out_len);
+int calc_vault_decode(CalcVault *vault, const uint8_t *image, size_t image_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
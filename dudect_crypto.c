@@ -0,0 +1,487 @@
+/* clock_gettime, getopt and sched_setaffinity with CMAKE_C_EXTENSIONS off */
+#define _GNU_SOURCE
+
+#include <math.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ed25519.h"
+#include "fe.h"
+#include "ge.h"
+#include "wallet_crypto.h"
+
+/*
+ * dudect-style leakage test (Reparaz, Balasch, Verbauwhede, "Dude, is my code
+ * constant time?"). Every measurement times one call on either a fixed input
+ * (class 0) or a fresh random one (class 1), with the class picked at random.
+ * Welch's t-test then compares the two timing distributions. One pass uses all
+ * samples, CT_PERCENTILES passes drop samples above successively lower
+ * percentiles, and one second-order pass looks at the centred squares. A
+ * constant-time function keeps |t| small however many samples are taken.
+ */
+#define CT_INPUT_LEN 128u
+#define CT_BATCH 10000u
+#define CT_PERCENTILES 20u
+#define CT_TESTS (1u + CT_PERCENTILES + 1u)
+/* Cropped and second-order passes are ignored until both classes have this many samples. */
+#define CT_MIN_CLASS_SAMPLES 1000.0
+/* dudect's "probably not constant time" cutoff. */
+#define CT_DEFAULT_THRESHOLD 10.0
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CT_HAVE_TSC 1
+#else
+#define CT_HAVE_TSC 0
+#endif
+
+typedef struct
+{
+    uint8_t fixed[CT_INPUT_LEN];
+    uint8_t public_key[32];
+    uint8_t output[64];
+    fe field;
+} CtState;
+
+typedef void (*CtPrepareFn)(CtState *state, uint8_t *input, int fixed_class);
+typedef void (*CtRunFn)(CtState *state, const uint8_t *input);
+
+typedef struct
+{
+    const char *name;
+    CtPrepareFn prepare;
+    CtRunFn run;
+    size_t default_samples;
+} CtCase;
+
+typedef struct
+{
+    double mean[2];
+    double m2[2];
+    double count[2];
+} CtWelch;
+
+typedef struct
+{
+    int cpu;
+    size_t samples;
+    const char *filter;
+    double threshold;
+} CtOptions;
+
+static void usage(const char *program);
+static int pin_to_cpu(int cpu);
+static uint64_t read_ticks(void);
+static int compare_u64(const void *a, const void *b);
+static void welch_push(CtWelch *test, double value, int fixed_class);
+static double welch_t(const CtWelch *test);
+static double crop_fraction(size_t index);
+static void pass_label(size_t pass, char *out, size_t out_size);
+static int run_case(const CtCase *test, CtState *state, size_t samples, double *out_max_t, size_t *out_pass);
+
+static void prepare_fe_cmov(CtState *state, uint8_t *input, int fixed_class);
+static void run_fe_cmov(CtState *state, const uint8_t *input);
+static void prepare_scalarmult_base(CtState *state, uint8_t *input, int fixed_class);
+static void run_scalarmult_base(CtState *state, const uint8_t *input);
+static void prepare_sign(CtState *state, uint8_t *input, int fixed_class);
+static void run_sign(CtState *state, const uint8_t *input);
+static void prepare_mac_compare(CtState *state, uint8_t *input, int fixed_class);
+static void run_mac_compare(CtState *state, const uint8_t *input);
+
+static const CtCase ct_cases[] = {
+    { "fe_cmov", prepare_fe_cmov, run_fe_cmov, 4000000u },
+    { "wallet_constant_time_compare", prepare_mac_compare, run_mac_compare, 4000000u },
+    { "ge_scalarmult_base", prepare_scalarmult_base, run_scalarmult_base, 1000000u },
+    { "ed25519_sign", prepare_sign, run_sign, 1000000u },
+};
+
+int main(int argc, char **argv)
+{
+    CtOptions options = { 0, 0u, NULL, CT_DEFAULT_THRESHOLD };
+    CtState *state = NULL;
+    unsigned int leaks = 0u;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "c:n:f:t:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'c':
+                options.cpu = atoi(optarg);
+                break;
+            case 'n':
+                options.samples = (size_t)strtoull(optarg, NULL, 10);
+                break;
+            case 'f':
+                options.filter = optarg;
+                break;
+            case 't':
+                options.threshold = atof(optarg);
+                break;
+            default:
+                usage(argv[0]);
+                return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    if ((optind != argc) || (options.threshold <= 0.0))
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if ((options.cpu >= 0) && (pin_to_cpu(options.cpu) != 0))
+    {
+        fprintf(stderr, "Could not pin to CPU %d; results may be noisy.\n", options.cpu);
+    }
+
+    state = calloc(1u, sizeof(*state));
+    if (state == NULL)
+    {
+        fprintf(stderr, "Out of memory.\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("%-30s %10s %10s %-10s %s\n", "function", "samples", "max |t|", "pass", "verdict");
+
+    for (size_t index = 0u; index < sizeof(ct_cases) / sizeof(ct_cases[0]); index++)
+    {
+        const CtCase *test = &ct_cases[index];
+        size_t samples = (options.samples != 0u) ? options.samples : test->default_samples;
+        double max_t = 0.0;
+        size_t pass = 0u;
+        char label[16];
+        int leaked = 0;
+
+        if ((options.filter != NULL) && (strstr(test->name, options.filter) == NULL))
+        {
+            continue;
+        }
+
+        if (wallet_random_bytes(state->fixed, sizeof(state->fixed)) != APP_OK)
+        {
+            fprintf(stderr, "%s: setup failed.\n", test->name);
+            free(state);
+            return EXIT_FAILURE;
+        }
+
+        if (run_case(test, state, samples, &max_t, &pass) != APP_OK)
+        {
+            fprintf(stderr, "%s: measurement failed.\n", test->name);
+            free(state);
+            return EXIT_FAILURE;
+        }
+
+        leaked = (max_t > options.threshold);
+        pass_label(pass, label, sizeof(label));
+        printf("%-30s %10zu %10.2f %-10s %s\n", test->name, samples, max_t, label, leaked ? "LEAK" : "ok");
+        fflush(stdout);
+        if (leaked)
+        {
+            leaks++;
+        }
+    }
+
+    wallet_secure_zero(state, sizeof(*state));
+    free(state);
+
+    if (leaks != 0u)
+    {
+        fprintf(stderr, "%u function(s) show input-dependent timing (|t| > %.1f).\n", leaks, options.threshold);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static void usage(const char *program)
+{
+    fprintf(stderr,
+            "Usage: %s [-c cpu] [-n samples] [-f filter] [-t threshold]\n"
+            "Times fe_cmov, the wallet blob MAC comparison, ge_scalarmult_base and\n"
+            "ed25519_sign on fixed against random secret inputs and runs Welch's t-test\n"
+            "on the two timing distributions, dudect style. Exits non-zero when any\n"
+            "|t| exceeds threshold (default 10). samples overrides the per-function\n"
+            "count (1-4 million); the first batch of %u only sets the crop points.\n"
+            "Runs on one thread pinned to cpu (default 0, -1 to leave unpinned).\n",
+            program, CT_BATCH);
+}
+
+static int pin_to_cpu(int cpu)
+{
+#ifdef __linux__
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set);
+#else
+    (void)cpu;
+    return -1;
+#endif
+}
+
+static uint64_t read_ticks(void)
+{
+#if CT_HAVE_TSC
+    return __builtin_ia32_rdtsc();
+#else
+    struct timespec now;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000000u) + (uint64_t)now.tv_nsec;
+#endif
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t left = *(const uint64_t *)a;
+    uint64_t right = *(const uint64_t *)b;
+
+    return (left > right) - (left < right);
+}
+
+/* Crop points 1 - 0.5^(10 (i + 1) / CT_PERCENTILES) of the first batch, as in dudect. */
+static double crop_fraction(size_t index)
+{
+    return 1.0 - pow(0.5, 10.0 * (double)(index + 1u) / (double)CT_PERCENTILES);
+}
+
+static void pass_label(size_t pass, char *out, size_t out_size)
+{
+    if (pass == 0u)
+    {
+        (void)snprintf(out, out_size, "all");
+    }
+    else if (pass == CT_TESTS - 1u)
+    {
+        (void)snprintf(out, out_size, "2nd order");
+    }
+    else
+    {
+        (void)snprintf(out, out_size, "crop %.1f%%", crop_fraction(pass - 1u) * 100.0);
+    }
+}
+
+/* Welford's running mean and sum of squared deviations, per class. */
+static void welch_push(CtWelch *test, double value, int fixed_class)
+{
+    int slot = fixed_class ? 0 : 1;
+    double delta = value - test->mean[slot];
+
+    test->count[slot] += 1.0;
+    test->mean[slot] += delta / test->count[slot];
+    test->m2[slot] += delta * (value - test->mean[slot]);
+}
+
+static double welch_t(const CtWelch *test)
+{
+    double variance0 = 0.0;
+    double variance1 = 0.0;
+    double denominator = 0.0;
+
+    if ((test->count[0] < 2.0) || (test->count[1] < 2.0))
+    {
+        return 0.0;
+    }
+
+    variance0 = test->m2[0] / (test->count[0] - 1.0);
+    variance1 = test->m2[1] / (test->count[1] - 1.0);
+    denominator = sqrt((variance0 / test->count[0]) + (variance1 / test->count[1]));
+    if (denominator == 0.0)
+    {
+        return 0.0;
+    }
+
+    return fabs(test->mean[0] - test->mean[1]) / denominator;
+}
+
+/*
+ * Inputs and classes for a whole batch are drawn before any timing, so the
+ * random number generator never runs between the two reads of the clock.
+ */
+static int run_case(const CtCase *test, CtState *state, size_t samples, double *out_max_t, size_t *out_pass)
+{
+    CtWelch tests[CT_TESTS];
+    uint64_t crop[CT_PERCENTILES];
+    uint8_t *inputs = malloc((size_t)CT_BATCH * CT_INPUT_LEN);
+    uint8_t *classes = malloc(CT_BATCH);
+    uint64_t *ticks = malloc(CT_BATCH * sizeof(uint64_t));
+    size_t done = 0u;
+    int have_crop = 0;
+    int status = APP_OK;
+
+    if ((inputs == NULL) || (classes == NULL) || (ticks == NULL))
+    {
+        free(inputs);
+        free(classes);
+        free(ticks);
+        return APP_ERR_ALLOC;
+    }
+
+    memset(tests, 0, sizeof(tests));
+    memset(crop, 0, sizeof(crop));
+
+    while ((status == APP_OK) && (done < samples + CT_BATCH))
+    {
+        status = wallet_random_bytes(classes, CT_BATCH);
+        if (status == APP_OK)
+        {
+            status = wallet_random_bytes(inputs, (size_t)CT_BATCH * CT_INPUT_LEN);
+        }
+        for (size_t i = 0u; (status == APP_OK) && (i < CT_BATCH); i++)
+        {
+            classes[i] = (uint8_t)(classes[i] & 1u);
+            test->prepare(state, inputs + (i * CT_INPUT_LEN), classes[i]);
+        }
+
+        for (size_t i = 0u; (status == APP_OK) && (i < CT_BATCH); i++)
+        {
+            uint64_t start = read_ticks();
+
+            test->run(state, inputs + (i * CT_INPUT_LEN));
+            ticks[i] = read_ticks() - start;
+        }
+
+        if (status != APP_OK)
+        {
+            break;
+        }
+
+        if (!have_crop)
+        {
+            qsort(ticks, CT_BATCH, sizeof(uint64_t), compare_u64);
+            for (size_t i = 0u; i < CT_PERCENTILES; i++)
+            {
+                crop[i] = ticks[(size_t)(crop_fraction(i) * (double)CT_BATCH)];
+            }
+            have_crop = 1;
+            done += CT_BATCH;
+            continue;
+        }
+
+        for (size_t i = 0u; i < CT_BATCH; i++)
+        {
+            double value = (double)ticks[i];
+            int fixed_class = (classes[i] != 0u);
+
+            welch_push(&tests[0], value, fixed_class);
+            for (size_t p = 0u; p < CT_PERCENTILES; p++)
+            {
+                if (ticks[i] < crop[p])
+                {
+                    welch_push(&tests[1u + p], value, fixed_class);
+                }
+            }
+
+            if ((tests[0].count[0] > CT_MIN_CLASS_SAMPLES) && (tests[0].count[1] > CT_MIN_CLASS_SAMPLES))
+            {
+                double centred = value - tests[0].mean[fixed_class ? 0 : 1];
+
+                welch_push(&tests[CT_TESTS - 1u], centred * centred, fixed_class);
+            }
+        }
+        done += CT_BATCH;
+    }
+
+    *out_max_t = 0.0;
+    *out_pass = 0u;
+    for (size_t i = 0u; i < CT_TESTS; i++)
+    {
+        double t = welch_t(&tests[i]);
+
+        if ((i != 0u) &&
+            ((tests[i].count[0] < CT_MIN_CLASS_SAMPLES) || (tests[i].count[1] < CT_MIN_CLASS_SAMPLES)))
+        {
+            continue;
+        }
+
+        if (t > *out_max_t)
+        {
+            *out_max_t = t;
+            *out_pass = i;
+        }
+    }
+
+    wallet_secure_zero(inputs, (size_t)CT_BATCH * CT_INPUT_LEN);
+    free(inputs);
+    free(classes);
+    free(ticks);
+
+    return status;
+}
+
+/* Secret: the move flag. Both field elements are random in either class. */
+static void prepare_fe_cmov(CtState *state, uint8_t *input, int fixed_class)
+{
+    (void)state;
+    if (fixed_class)
+    {
+        input[64] = 0u;
+    }
+}
+
+static void run_fe_cmov(CtState *state, const uint8_t *input)
+{
+    fe g;
+
+    fe_frombytes(state->field, input);
+    fe_frombytes(g, input + 32);
+    fe_cmov(state->field, g, (unsigned int)(input[64] & 1u));
+}
+
+/* Secret: the scalar. The fixed class uses zero, whose digits all select the identity. */
+static void prepare_scalarmult_base(CtState *state, uint8_t *input, int fixed_class)
+{
+    (void)state;
+    if (fixed_class)
+    {
+        memset(input, 0, 32u);
+    }
+    input[31] &= 127u;
+}
+
+static void run_scalarmult_base(CtState *state, const uint8_t *input)
+{
+    ge_p3 point;
+
+    ge_scalarmult_base(&point, input);
+    ge_p3_tobytes(state->output, &point);
+}
+
+/*
+ * Secret: the seed; the message is fixed. The public key only enters the
+ * challenge hash, so one key serves both classes without changing the work.
+ */
+static void prepare_sign(CtState *state, uint8_t *input, int fixed_class)
+{
+    if (fixed_class)
+    {
+        memcpy(input, state->fixed, 32u);
+    }
+    memcpy(input + 32, state->fixed + 32, 32u);
+}
+
+static void run_sign(CtState *state, const uint8_t *input)
+{
+    ed25519_sign(state->output, input + 32, 32u, state->public_key, input);
+}
+
+/* Secret: where a forged MAC first differs. The fixed class matches in full. */
+static void prepare_mac_compare(CtState *state, uint8_t *input, int fixed_class)
+{
+    memcpy(input + WALLET_MAC_LEN, state->fixed, WALLET_MAC_LEN);
+    if (fixed_class)
+    {
+        memcpy(input, state->fixed, WALLET_MAC_LEN);
+    }
+}
+
+static void run_mac_compare(CtState *state, const uint8_t *input)
+{
+    state->output[0] = (uint8_t)wallet_constant_time_compare(input, input + WALLET_MAC_LEN, WALLET_MAC_LEN);
+}
@@ -3,6 +3,8 @@
 
 #include <stddef.h>
 
+#include "sha512.h"
+
 #if defined(_WIN32)
     #if defined(ED25519_BUILD_DLL)
         #define ED25519_DECLSPEC __declspec(dllexport)
@@ -19,14 +21,36 @@
 extern "C" {
 #endif
 
+#define ED25519_KEYPAIR_BATCH 128
+
+/* one piece of a message that is signed as the concatenation of all pieces */
+typedef struct {
+    const unsigned char *data;
+    size_t len;
+} ed25519_segment;
+
+/* expanded key and the nonce hash state after its secret prefix, reusable across signatures */
+typedef struct {
+    unsigned char expanded_private[64];
+    unsigned char public_key[32];
+    sha512_context nonce_prefix;
+} ed25519_signer;
+
 #ifndef ED25519_NO_SEED
 int ED25519_DECLSPEC ed25519_create_seed(unsigned char *seed);
 #endif
 
 /* private_key must point to a 32-byte seed; the function copies the seed if provided */
 void ED25519_DECLSPEC ed25519_create_keypair(unsigned char *public_key, unsigned char *private_key, const unsigned char *seed);
+/* count keypairs from count consecutive 32-byte seeds, sharing one field inversion per ED25519_KEYPAIR_BATCH keys; same output as count single calls */
+void ED25519_DECLSPEC ed25519_create_keypairs_batch(unsigned char *public_keys, unsigned char *private_keys, const unsigned char *seeds, size_t count);
 void ED25519_DECLSPEC ed25519_derive_public_key(unsigned char *public_key, const unsigned char *private_key);
 void ED25519_DECLSPEC ed25519_sign(unsigned char *signature, const unsigned char *message, size_t message_len, const unsigned char *public_key, const unsigned char *private_key);
+void ED25519_DECLSPEC ed25519_signer_init(ed25519_signer *signer, const unsigned char *public_key, const unsigned char *private_key);
+/* signs segments[0] || ... || segments[count - 1] without joining them, with the same signature as ed25519_sign over the joined message;
+   each segment is hashed twice (nonce, then challenge), so the data must not change during the call */
+void ED25519_DECLSPEC ed25519_signer_sign(const ed25519_signer *signer, unsigned char *signature, const ed25519_segment *segments, size_t count);
+void ED25519_DECLSPEC ed25519_signer_wipe(ed25519_signer *signer);
 int ED25519_DECLSPEC ed25519_verify(const unsigned char *signature, const unsigned char *message, size_t message_len, const unsigned char *public_key);
 /* private_key updates are unsupported when using 32-byte seeds; pass NULL to update only the public key */
 void ED25519_DECLSPEC ed25519_add_scalar(unsigned char *public_key, unsigned char *private_key, const unsigned char *scalar);
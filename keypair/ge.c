@@ -65,15 +65,20 @@ B is the Ed25519 base point (x,4/5) with x positive.
 */
 
 void ge_double_scalarmult_vartime(ge_p2 *r, const unsigned char *a, const ge_p3 *A, const unsigned char *b) {
-    signed char aslide[256];
-    signed char bslide[256];
-    ge_cached Ai[8]; /* A,3A,5A,7A,9A,11A,13A,15A */
+    ge_cached Ai[8];
+
+    ge_p3_to_cached_multiples(Ai, A);
+    ge_double_scalarmult_vartime_cached(r, a, Ai, b);
+}
+
+/*
+Ai = A,3A,5A,7A,9A,11A,13A,15A
+*/
+
+void ge_p3_to_cached_multiples(ge_cached *Ai, const ge_p3 *A) {
     ge_p1p1 t;
     ge_p3 u;
     ge_p3 A2;
-    int i;
-    slide(aslide, a);
-    slide(bslide, b);
     ge_p3_to_cached(&Ai[0], A);
     ge_p3_dbl(&t, A);
     ge_p1p1_to_p3(&A2, &t);
@@ -98,6 +103,20 @@ void ge_double_scalarmult_vartime(ge_p2 *r, const unsigned char *a, const ge_p3
     ge_add(&t, &A2, &Ai[6]);
     ge_p1p1_to_p3(&u, &t);
     ge_p3_to_cached(&Ai[7], &u);
+}
+
+/*
+r = a * A + b * B, with A given as its ge_p3_to_cached_multiples table.
+*/
+
+void ge_double_scalarmult_vartime_cached(ge_p2 *r, const unsigned char *a, const ge_cached *Ai, const unsigned char *b) {
+    signed char aslide[256];
+    signed char bslide[256];
+    ge_p1p1 t;
+    ge_p3 u;
+    int i;
+    slide(aslide, a);
+    slide(bslide, b);
     ge_p2_0(r);
 
     for (i = 255; i >= 0; --i) {
@@ -330,6 +349,47 @@ void ge_p3_tobytes(unsigned char *s, const ge_p3 *h) {
 }
 
 
+/*
+Encodes count points into s (32 bytes each) with a single fe_invert,
+using Montgomery's trick: scratch (count elements) holds the running
+products Z0*Z1*...*Zi, and each 1/Zi is peeled off the inverse of the
+full product on the way back. Output matches ge_p3_tobytes per point.
+*/
+
+void ge_p3_batch_tobytes(unsigned char *s, const ge_p3 *h, fe *scratch, size_t count) {
+    fe inv;
+    fe recip;
+    fe x;
+    fe y;
+    size_t i;
+
+    if (count == 0) {
+        return;
+    }
+
+    fe_copy(scratch[0], h[0].Z);
+    for (i = 1; i < count; ++i) {
+        fe_mul(scratch[i], scratch[i - 1], h[i].Z);
+    }
+
+    fe_invert(inv, scratch[count - 1]);
+
+    for (i = count - 1; i > 0; --i) {
+        fe_mul(recip, inv, scratch[i - 1]);
+        fe_mul(inv, inv, h[i].Z);
+        fe_mul(x, h[i].X, recip);
+        fe_mul(y, h[i].Y, recip);
+        fe_tobytes(s + 32 * i, y);
+        s[32 * i + 31] ^= fe_isnegative(x) << 7;
+    }
+
+    fe_mul(x, h[0].X, inv);
+    fe_mul(y, h[0].Y, inv);
+    fe_tobytes(s, y);
+    s[31] ^= fe_isnegative(x) << 7;
+}
+
+
 static unsigned char equal(signed char b, signed char c) {
     unsigned char ub = b;
     unsigned char uc = c;
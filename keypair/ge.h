@@ -1,6 +1,8 @@
 #ifndef GE_H
 #define GE_H
 
+#include <stddef.h>
+
 #include "fe.h"
 
 
@@ -52,12 +54,14 @@ typedef struct {
 } ge_cached;
 
 void ge_p3_tobytes(unsigned char *s, const ge_p3 *h);
+void ge_p3_batch_tobytes(unsigned char *s, const ge_p3 *h, fe *scratch, size_t count);
 void ge_tobytes(unsigned char *s, const ge_p2 *h);
 int ge_frombytes_negate_vartime(ge_p3 *h, const unsigned char *s);
 
 void ge_add(ge_p1p1 *r, const ge_p3 *p, const ge_cached *q);
 void ge_sub(ge_p1p1 *r, const ge_p3 *p, const ge_cached *q);
 void ge_double_scalarmult_vartime(ge_p2 *r, const unsigned char *a, const ge_p3 *A, const unsigned char *b);
+void ge_double_scalarmult_vartime_cached(ge_p2 *r, const unsigned char *a, const ge_cached *Ai, const unsigned char *b);
 void ge_madd(ge_p1p1 *r, const ge_p3 *p, const ge_precomp *q);
 void ge_msub(ge_p1p1 *r, const ge_p3 *p, const ge_precomp *q);
 void ge_scalarmult_base(ge_p3 *h, const unsigned char *a);
@@ -69,6 +73,7 @@ void ge_p2_dbl(ge_p1p1 *r, const ge_p2 *p);
 void ge_p3_0(ge_p3 *h);
 void ge_p3_dbl(ge_p1p1 *r, const ge_p3 *p);
 void ge_p3_to_cached(ge_cached *r, const ge_p3 *p);
+void ge_p3_to_cached_multiples(ge_cached *Ai, const ge_p3 *A);
 void ge_p3_to_p2(ge_p2 *r, const ge_p3 *p);
 
 #endif
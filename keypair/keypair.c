@@ -24,6 +24,36 @@ void ed25519_create_keypair(unsigned char *public_key, unsigned char *private_ke
     }
 }
 
+void ed25519_create_keypairs_batch(unsigned char *public_keys, unsigned char *private_keys, const unsigned char *seeds, size_t count) {
+    unsigned char expanded_seed[64];
+    ge_p3 points[ED25519_KEYPAIR_BATCH];
+    fe scratch[ED25519_KEYPAIR_BATCH];
+    size_t done = 0;
+    size_t chunk;
+    size_t i;
+
+    while (done < count) {
+        chunk = count - done;
+        if (chunk > ED25519_KEYPAIR_BATCH) {
+            chunk = ED25519_KEYPAIR_BATCH;
+        }
+
+        for (i = 0; i < chunk; ++i) {
+            ed25519_expand_seed(expanded_seed, seeds + 32 * (done + i));
+            ge_scalarmult_base(&points[i], expanded_seed);
+        }
+
+        ge_p3_batch_tobytes(public_keys + 32 * done, points, scratch, chunk);
+        done += chunk;
+    }
+
+    if (private_keys != NULL) {
+        memcpy(private_keys, seeds, 32 * count);
+    }
+
+    memset(expanded_seed, 0, sizeof(expanded_seed));
+}
+
 void ed25519_derive_public_key(unsigned char *public_key, const unsigned char *private_key) {
     unsigned char expanded_seed[64];
     ge_p3 A;
@@ -1,6 +1,238 @@
 #include "fixedint.h"
 #include "sc.h"
 
+#if defined(ED25519_SC64) && defined(__SIZEOF_INT128__)
+
+/*
+64-bit backend: four 64-bit limbs, __int128 products and Barrett reduction
+(HAC 14.42 with b = 2^64, k = 4). Both constants are sparse, which keeps the
+reduction to 24 limb products: l = 2^252 + (two limbs), and
+mu = floor(2^512 / l) = 2^260 - d with d three limbs. Branch-free like the
+ref10 code below; outputs are identical.
+*/
+
+__extension__ typedef unsigned __int128 sc_uint128;
+
+/* low two limbs of l; the rest is 2^252 */
+static const uint64_t sc_l0 = 0x5812631a5cf5d3edULL;
+static const uint64_t sc_l1 = 0x14def9dea2f79cd6ULL;
+
+/* d = 2^260 - floor(2^512 / l) */
+static const uint64_t sc_d[3] = {
+    0x12631a5cf5d3ece5ULL, 0xdef9dea2f79cd658ULL, 0x0000000000000014ULL
+};
+
+static uint64_t load_8(const unsigned char *in) {
+    uint64_t result;
+
+    result = (uint64_t) in[0];
+    result |= ((uint64_t) in[1]) << 8;
+    result |= ((uint64_t) in[2]) << 16;
+    result |= ((uint64_t) in[3]) << 24;
+    result |= ((uint64_t) in[4]) << 32;
+    result |= ((uint64_t) in[5]) << 40;
+    result |= ((uint64_t) in[6]) << 48;
+    result |= ((uint64_t) in[7]) << 56;
+
+    return result;
+}
+
+static void store_8(unsigned char *out, uint64_t in) {
+    out[0] = (unsigned char) in;
+    out[1] = (unsigned char) (in >> 8);
+    out[2] = (unsigned char) (in >> 16);
+    out[3] = (unsigned char) (in >> 24);
+    out[4] = (unsigned char) (in >> 32);
+    out[5] = (unsigned char) (in >> 40);
+    out[6] = (unsigned char) (in >> 48);
+    out[7] = (unsigned char) (in >> 56);
+}
+
+/* (carry:out) = a * b + acc + carry */
+#define SC64_MAC(out, carry, a, b, acc) \
+    do { \
+        sc_uint128 t_ = (sc_uint128) (a) * (b) + (acc) + (carry); \
+        (out) = (uint64_t) t_; \
+        (carry) = (uint64_t) (t_ >> 64); \
+    } while (0)
+
+/* (borrow:out) = a - b - borrow, borrow ending as 0 or 1 */
+#define SC64_SBB(out, borrow, a, b) \
+    do { \
+        sc_uint128 d_ = (sc_uint128) (a) - (b) - (borrow); \
+        (out) = (uint64_t) d_; \
+        (borrow) = (uint64_t) (d_ >> 64) & 1; \
+    } while (0)
+
+/* r = r - l if r >= l, without branching on r. */
+static void sc64_sub_l_if_ge(uint64_t r[5]) {
+    uint64_t t0, t1, t2, t3, t4;
+    uint64_t borrow = 0;
+    uint64_t mask;
+
+    SC64_SBB(t0, borrow, r[0], sc_l0);
+    SC64_SBB(t1, borrow, r[1], sc_l1);
+    SC64_SBB(t2, borrow, r[2], 0);
+    SC64_SBB(t3, borrow, r[3], 0x1000000000000000ULL);
+    SC64_SBB(t4, borrow, r[4], 0);
+
+    mask = borrow - 1; /* all ones when there was no borrow, i.e. r >= l */
+
+    r[0] = (t0 & mask) | (r[0] & ~mask);
+    r[1] = (t1 & mask) | (r[1] & ~mask);
+    r[2] = (t2 & mask) | (r[2] & ~mask);
+    r[3] = (t3 & mask) | (r[3] & ~mask);
+    r[4] = (t4 & mask) | (r[4] & ~mask);
+}
+
+/* out = x mod l for x < 2^512 */
+static void sc64_barrett(uint64_t out[4], const uint64_t x[8]) {
+    const uint64_t *q1 = x + 3; /* floor(x / 2^192) */
+    uint64_t p[8] = {0};
+    uint64_t y[10];
+    uint64_t r[5];
+    uint64_t borrow = 0;
+    uint64_t carry;
+    int i;
+
+    /* p = q1 * d */
+    for (i = 0; i < 5; ++i) {
+        carry = 0;
+        SC64_MAC(p[i], carry, q1[i], sc_d[0], p[i]);
+        SC64_MAC(p[i + 1], carry, q1[i], sc_d[1], p[i + 1]);
+        SC64_MAC(p[i + 2], carry, q1[i], sc_d[2], p[i + 2]);
+        p[i + 3] = carry;
+    }
+
+    /* y = q1 * mu = q1 * 2^260 - p; q3 = y[5..9] */
+    SC64_SBB(y[0], borrow, 0, p[0]);
+    SC64_SBB(y[1], borrow, 0, p[1]);
+    SC64_SBB(y[2], borrow, 0, p[2]);
+    SC64_SBB(y[3], borrow, 0, p[3]);
+    SC64_SBB(y[4], borrow, q1[0] << 4, p[4]);
+    SC64_SBB(y[5], borrow, (q1[0] >> 60) | (q1[1] << 4), p[5]);
+    SC64_SBB(y[6], borrow, (q1[1] >> 60) | (q1[2] << 4), p[6]);
+    SC64_SBB(y[7], borrow, (q1[2] >> 60) | (q1[3] << 4), p[7]);
+    SC64_SBB(y[8], borrow, (q1[3] >> 60) | (q1[4] << 4), 0);
+    SC64_SBB(y[9], borrow, q1[4] >> 60, 0);
+
+    /* r2 = q3 * l mod 2^320, with l = l0 + l1 * 2^64 + 2^252 */
+    {
+        uint64_t r2[5] = {0};
+
+        for (i = 0; i < 5; ++i) {
+            carry = 0;
+            SC64_MAC(r2[i], carry, y[5 + i], sc_l0, r2[i]);
+            if (i < 4) {
+                SC64_MAC(r2[i + 1], carry, y[5 + i], sc_l1, r2[i + 1]);
+                if (i < 3) {
+                    r2[i + 2] += carry;
+                }
+            }
+        }
+
+        carry = 0;
+        SC64_MAC(r2[3], carry, y[5] << 60, 1, r2[3]);
+        r2[4] += (y[5] >> 4) + (y[6] << 60) + carry;
+
+        /* r = (x mod 2^320) - r2, wrapping mod 2^320; the result is below 3l */
+        borrow = 0;
+        SC64_SBB(r[0], borrow, x[0], r2[0]);
+        SC64_SBB(r[1], borrow, x[1], r2[1]);
+        SC64_SBB(r[2], borrow, x[2], r2[2]);
+        SC64_SBB(r[3], borrow, x[3], r2[3]);
+        SC64_SBB(r[4], borrow, x[4], r2[4]);
+    }
+
+    sc64_sub_l_if_ge(r);
+    sc64_sub_l_if_ge(r);
+
+    out[0] = r[0];
+    out[1] = r[1];
+    out[2] = r[2];
+    out[3] = r[3];
+}
+
+/*
+Input:
+  s[0]+256*s[1]+...+256^63*s[63] = s
+
+Output:
+  s[0]+256*s[1]+...+256^31*s[31] = s mod l
+  where l = 2^252 + 27742317777372353535851937790883648493.
+  Overwrites s in place.
+*/
+
+void sc_reduce(unsigned char *s) {
+    uint64_t x[8];
+    uint64_t r[4];
+    int i;
+
+    for (i = 0; i < 8; ++i) {
+        x[i] = load_8(s + 8 * i);
+    }
+
+    sc64_barrett(r, x);
+
+    for (i = 0; i < 4; ++i) {
+        store_8(s + 8 * i, r[i]);
+    }
+}
+
+/*
+Input:
+  a[0]+256*a[1]+...+256^31*a[31] = a
+  b[0]+256*b[1]+...+256^31*b[31] = b
+  c[0]+256*c[1]+...+256^31*c[31] = c
+
+Output:
+  s[0]+256*s[1]+...+256^31*s[31] = (ab+c) mod l
+  where l = 2^252 + 27742317777372353535851937790883648493.
+*/
+
+void sc_muladd(unsigned char *s, const unsigned char *a, const unsigned char *b, const unsigned char *c) {
+    uint64_t al[4];
+    uint64_t bl[4];
+    uint64_t x[8] = {0};
+    uint64_t r[4];
+    uint64_t carry = 0;
+    int i;
+    int j;
+
+    for (i = 0; i < 4; ++i) {
+        al[i] = load_8(a + 8 * i);
+        bl[i] = load_8(b + 8 * i);
+    }
+
+    for (i = 0; i < 4; ++i) {
+        carry = 0;
+
+        for (j = 0; j < 4; ++j) {
+            sc_uint128 t = (sc_uint128) al[i] * bl[j] + x[i + j] + carry;
+            x[i + j] = (uint64_t) t;
+            carry = (uint64_t) (t >> 64);
+        }
+
+        x[i + 4] = carry;
+    }
+
+    /* ab + c < 2^512 even for 256-bit inputs, so one reduction covers it. */
+    carry = 0;
+    for (i = 0; i < 8; ++i) {
+        sc_uint128 t = (sc_uint128) x[i] + ((i < 4) ? load_8(c + 8 * i) : 0) + carry;
+        x[i] = (uint64_t) t;
+        carry = (uint64_t) (t >> 64);
+    }
+
+    sc64_barrett(r, x);
+
+    for (i = 0; i < 4; ++i) {
+        store_8(s + 8 * i, r[i]);
+    }
+}
+
+#else
+
 static uint64_t load_3(const unsigned char *in) {
     uint64_t result;
 
@@ -807,3 +1039,5 @@ void sc_muladd(unsigned char *s, const unsigned char *a, const unsigned char *b,
     s[30] = (unsigned char) (s11 >> 9);
     s[31] = (unsigned char) (s11 >> 17);
 }
+
+#endif
@@ -6,7 +6,12 @@
 #include <windows.h>
 #include <wincrypt.h>
 #else
-#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/random.h>
+#endif
 #endif
 
 int ed25519_create_seed(unsigned char *seed) {
@@ -24,14 +29,47 @@ int ed25519_create_seed(unsigned char *seed) {
 
     CryptReleaseContext(prov, 0);
 #else
-    FILE *f = fopen("/dev/urandom", "rb");
+    size_t offset = 0;
+    int fd = -1;
 
-    if (f == NULL) {
-        return 1;
+    while (offset < 32) {
+        ssize_t received;
+
+#if defined(__linux__)
+        if (fd < 0) {
+            received = getrandom(seed + offset, 32 - offset, 0);
+            if (received < 0 && errno == ENOSYS) {
+                fd = open("/dev/urandom", O_RDONLY);
+                if (fd < 0) {
+                    return 1;
+                }
+                continue;
+            }
+        } else
+#endif
+        {
+            if (fd < 0) {
+                fd = open("/dev/urandom", O_RDONLY);
+                if (fd < 0) {
+                    return 1;
+                }
+            }
+            received = read(fd, seed + offset, 32 - offset);
+        }
+
+        if (received > 0) {
+            offset += (size_t)received;
+        } else if (received == 0 || errno != EINTR) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            return 1;
+        }
     }
 
-    fread(seed, 1, 32, f);
-    fclose(f);
+    if (fd >= 0) {
+        close(fd);
+    }
 #endif
 
     return 0;
@@ -1,3 +1,5 @@
+#include <string.h>
+
 #include "ed25519.h"
 #include "sha512.h"
 #include "ge.h"
@@ -10,18 +12,45 @@ static void ed25519_expand_seed(unsigned char expanded[64], const unsigned char
     expanded[31] |= 64;
 }
 
+static void ed25519_wipe(void *buffer, size_t len) {
+    volatile unsigned char *p = (volatile unsigned char *) buffer;
+
+    while (len > 0) {
+        *p++ = 0;
+        --len;
+    }
+}
+
 void ed25519_sign(unsigned char *signature, const unsigned char *message, size_t message_len, const unsigned char *public_key, const unsigned char *private_key) {
+    ed25519_signer signer;
+    ed25519_segment segment;
+
+    segment.data = message;
+    segment.len = message_len;
+    ed25519_signer_init(&signer, public_key, private_key);
+    ed25519_signer_sign(&signer, signature, &segment, 1);
+    ed25519_signer_wipe(&signer);
+}
+
+void ed25519_signer_init(ed25519_signer *signer, const unsigned char *public_key, const unsigned char *private_key) {
+    ed25519_expand_seed(signer->expanded_private, private_key);
+    memcpy(signer->public_key, public_key, 32);
+
+    sha512_init(&signer->nonce_prefix);
+    sha512_update(&signer->nonce_prefix, signer->expanded_private + 32, 32);
+}
+
+void ed25519_signer_sign(const ed25519_signer *signer, unsigned char *signature, const ed25519_segment *segments, size_t count) {
     sha512_context hash;
     unsigned char hram[64];
     unsigned char r[64];
     ge_p3 R;
-    unsigned char expanded_private[64];
+    size_t i;
 
-    ed25519_expand_seed(expanded_private, private_key);
-
-    sha512_init(&hash);
-    sha512_update(&hash, expanded_private + 32, 32);
-    sha512_update(&hash, message, message_len);
+    hash = signer->nonce_prefix;
+    for (i = 0; i < count; ++i) {
+        sha512_update(&hash, segments[i].data, segments[i].len);
+    }
     sha512_final(&hash, r);
 
     sc_reduce(r);
@@ -30,10 +59,20 @@ void ed25519_sign(unsigned char *signature, const unsigned char *message, size_t
 
     sha512_init(&hash);
     sha512_update(&hash, signature, 32);
-    sha512_update(&hash, public_key, 32);
-    sha512_update(&hash, message, message_len);
+    sha512_update(&hash, signer->public_key, 32);
+    for (i = 0; i < count; ++i) {
+        sha512_update(&hash, segments[i].data, segments[i].len);
+    }
     sha512_final(&hash, hram);
 
     sc_reduce(hram);
-    sc_muladd(signature + 32, hram, expanded_private, r);
+    sc_muladd(signature + 32, hram, signer->expanded_private, r);
+
+    ed25519_wipe(&hash, sizeof(hash));
+    ed25519_wipe(r, sizeof(r));
+    ed25519_wipe(&R, sizeof(R));
+}
+
+void ed25519_signer_wipe(ed25519_signer *signer) {
+    ed25519_wipe(signer, sizeof(*signer));
 }
@@ -20,8 +20,13 @@
 #include "tifiles.h"
 #include "ed25519.h"
 #include "calc_session.h"
+#include "calc_discovery.h"
+#include "calc_pool.h"
 #include "calc_string_store.h"
+#include "calc_vault.h"
 #include "wallet_crypto.h"
+#include "wallet_agent.h"
+#include "wallet_verify.h"
 #include "solana_encoding.h"
 #include "solana_client.h"
 
@@ -31,6 +36,9 @@
 #define MENU_OPTION_AIRDROP 3
 #define MENU_OPTION_BALANCE 4
 #define MENU_OPTION_SEND 5
+#define MENU_OPTION_VAULT 6
+#define MENU_OPTION_AGENT 7
+#define MENU_OPTION_REPLICATE 8
 
 #define STRING_VAR_NAME_LENGTH 4
 #define STRING_VAR_BUFFER_LENGTH 5
@@ -59,9 +67,60 @@ static void print_menu(void)
     printf(" %d) Request SOL airdrop\n", MENU_OPTION_AIRDROP);
     printf(" %d) Fetch balance\n", MENU_OPTION_BALANCE);
     printf(" %d) Send SOL transfer\n", MENU_OPTION_SEND);
+    printf(" %d) Show wallet vault\n", MENU_OPTION_VAULT);
+    printf(" %d) Unlock keypair in signing agent\n", MENU_OPTION_AGENT);
+    printf(" %d) Copy keypair to every connected calculator\n", MENU_OPTION_REPLICATE);
     printf(" %d) Exit\n", MENU_OPTION_EXIT);
 }
 
+/*
+ * Called from the menu loop before each prompt: drains the session status
+ * pipe and reports what the readiness monitor saw meanwhile, so nothing is
+ * printed from the I/O thread into a password or menu prompt.
+ */
+static void print_link_status(CalcSession *session, unsigned int *reattach_count)
+{
+    CalcSessionStatus status;
+    int fd = calc_session_status_fd(session);
+    int changed = 0;
+
+    if (fd < 0)
+    {
+        return;
+    }
+
+#ifndef _WIN32
+    {
+        char drain[16];
+
+        while (read(fd, drain, sizeof(drain)) > 0)
+        {
+            changed = 1;
+        }
+    }
+#endif
+
+    if ((changed == 0) || (calc_session_get_status(session, &status) != APP_OK))
+    {
+        return;
+    }
+
+    if (status.reattach_count != *reattach_count)
+    {
+        printf("[poll] Calculator reattached\n");
+        *reattach_count = status.reattach_count;
+    }
+
+    if (status.state == CALC_SESSION_STATE_READY)
+    {
+        printf("[poll] Calculator ready (%u us)\n", status.latency_us);
+    }
+    else
+    {
+        printf("[poll] Calculator not ready\n");
+    }
+}
+
 static int read_line(char *buffer, size_t size)
 {
     int status = 0;
@@ -823,6 +882,39 @@ static int prompt_base58_public_key(const char *prompt,
     return status;
 }
 
+/* 1 when the running agent holds the key for public_key. */
+static int agent_holds_key(const uint8_t *public_key)
+{
+    char socket_path[WALLET_AGENT_PATH_MAX];
+    uint8_t agent_public_key[WALLET_PUBLIC_KEY_LEN];
+
+    if ((wallet_agent_default_path(socket_path, sizeof(socket_path)) != APP_OK) ||
+        (wallet_agent_public_key(socket_path, agent_public_key) != APP_OK))
+    {
+        return 0;
+    }
+
+    return memcmp(agent_public_key, public_key, WALLET_PUBLIC_KEY_LEN) == 0;
+}
+
+static int sign_with_agent(const uint8_t *public_key, const uint8_t *message, size_t message_len, uint8_t *signature)
+{
+    char socket_path[WALLET_AGENT_PATH_MAX];
+    int status = wallet_agent_default_path(socket_path, sizeof(socket_path));
+
+    if (status == APP_OK)
+    {
+        status = wallet_agent_sign(socket_path, public_key, message, message_len, signature);
+        if (status != APP_OK)
+        {
+            fprintf(stderr, "Signing agent refused the request (error %d).\n", status);
+        }
+    }
+
+    return status;
+}
+
+/* A NULL private_key signs through the agent instead. */
 static int solana_build_transfer_transaction(const uint8_t *from_public_key,
                                              const uint8_t *to_public_key,
                                              uint64_t lamports,
@@ -835,9 +927,10 @@ static int solana_build_transfer_transaction(const uint8_t *from_public_key,
                                              char *out_signature_base58,
                                              size_t signature_base58_size)
 {
-    uint8_t message[SOLANA_MAX_MESSAGE_LEN];
     uint8_t transaction[SOLANA_MAX_TRANSACTION_LEN];
     uint8_t signature[64];
+    /* Built in place after the signature count and signature, so it is never copied. */
+    uint8_t *message = transaction + 1u + sizeof(signature);
     uint8_t instruction_data[12];
     uint8_t memo_program_id[WALLET_PUBLIC_KEY_LEN];
     size_t message_len = 0u;
@@ -852,7 +945,7 @@ static int solana_build_transfer_transaction(const uint8_t *from_public_key,
     int status = APP_ERR_IO;
 
     if ((from_public_key == NULL) || (to_public_key == NULL) || (recent_blockhash == NULL) ||
-        (private_key == NULL) || (out_base64 == NULL))
+        (out_base64 == NULL))
     {
         return APP_ERR_IO;
     }
@@ -862,7 +955,6 @@ static int solana_build_transfer_transaction(const uint8_t *from_public_key,
         return APP_ERR_IO;
     }
 
-    memset(message, 0, sizeof(message));
     memset(transaction, 0, sizeof(transaction));
     memset(signature, 0, sizeof(signature));
     memset(instruction_data, 0, sizeof(instruction_data));
@@ -888,19 +980,19 @@ static int solana_build_transfer_transaction(const uint8_t *from_public_key,
     if (status == APP_OK)
     {
         int append_status = 0;
-        append_status = solana_append_u8(message, sizeof(message), &message_len, 1u);
-        append_status &= solana_append_u8(message, sizeof(message), &message_len, 0u);
-        append_status &= solana_append_u8(message, sizeof(message), &message_len, readonly_unsigned);
-        append_status &= solana_append_shortvec(message, sizeof(message), &message_len, account_key_count);
-        append_status &= solana_append_bytes(message, sizeof(message), &message_len, from_public_key, WALLET_PUBLIC_KEY_LEN);
-        append_status &= solana_append_bytes(message, sizeof(message), &message_len, to_public_key, WALLET_PUBLIC_KEY_LEN);
-        append_status &= solana_append_bytes(message, sizeof(message), &message_len, SOLANA_SYSTEM_PROGRAM_ID, WALLET_PUBLIC_KEY_LEN);
+        append_status = solana_append_u8(message, SOLANA_MAX_MESSAGE_LEN, &message_len, 1u);
+        append_status &= solana_append_u8(message, SOLANA_MAX_MESSAGE_LEN, &message_len, 0u);
+        append_status &= solana_append_u8(message, SOLANA_MAX_MESSAGE_LEN, &message_len, readonly_unsigned);
+        append_status &= solana_append_shortvec(message, SOLANA_MAX_MESSAGE_LEN, &message_len, account_key_count);
+        append_status &= solana_append_bytes(message, SOLANA_MAX_MESSAGE_LEN, &message_len, from_public_key, WALLET_PUBLIC_KEY_LEN);
+        append_status &= solana_append_bytes(message, SOLANA_MAX_MESSAGE_LEN, &message_len, to_public_key, WALLET_PUBLIC_KEY_LEN);
+        append_status &= solana_append_bytes(message, SOLANA_MAX_MESSAGE_LEN, &message_len, SOLANA_SYSTEM_PROGRAM_ID, WALLET_PUBLIC_KEY_LEN);
         if ((include_memo != 0) && (append_status != 0))
         {
-            append_status &= solana_append_bytes(message, sizeof(message), &message_len, memo_program_id, sizeof(memo_program_id));
+            append_status &= solana_append_bytes(message, SOLANA_MAX_MESSAGE_LEN, &message_len, memo_program_id, sizeof(memo_program_id));
         }
-        append_status &= solana_append_bytes(message, sizeof(message), &message_len, recent_blockhash, WALLET_PUBLIC_KEY_LEN);
-        append_status &= solana_append_shortvec(message, sizeof(message), &message_len, instruction_count);
+        append_status &= solana_append_bytes(message, SOLANA_MAX_MESSAGE_LEN, &message_len, recent_blockhash, WALLET_PUBLIC_KEY_LEN);
+        append_status &= solana_append_shortvec(message, SOLANA_MAX_MESSAGE_LEN, &message_len, instruction_count);
 
         if (append_status == 0)
         {
@@ -911,10 +1003,10 @@ static int solana_build_transfer_transaction(const uint8_t *from_public_key,
     if (status == APP_OK)
     {
         int header_status = 0;
-        header_status = solana_append_u8(message, sizeof(message), &message_len, 2u);
-        header_status &= solana_append_shortvec(message, sizeof(message), &message_len, 2u);
-        header_status &= solana_append_u8(message, sizeof(message), &message_len, 0u);
-        header_status &= solana_append_u8(message, sizeof(message), &message_len, 1u);
+        header_status = solana_append_u8(message, SOLANA_MAX_MESSAGE_LEN, &message_len, 2u);
+        header_status &= solana_append_shortvec(message, SOLANA_MAX_MESSAGE_LEN, &message_len, 2u);
+        header_status &= solana_append_u8(message, SOLANA_MAX_MESSAGE_LEN, &message_len, 0u);
+        header_status &= solana_append_u8(message, SOLANA_MAX_MESSAGE_LEN, &message_len, 1u);
         if (header_status == 0)
         {
             status = APP_ERR_IO;
@@ -936,8 +1028,8 @@ static int solana_build_transfer_transaction(const uint8_t *from_public_key,
         instruction_data[10] = (uint8_t)((lamports >> 48u) & 0xffu);
         instruction_data[11] = (uint8_t)((lamports >> 56u) & 0xffu);
 
-        if ((solana_append_shortvec(message, sizeof(message), &message_len, sizeof(instruction_data)) == 0) ||
-            (solana_append_bytes(message, sizeof(message), &message_len, instruction_data, sizeof(instruction_data)) == 0))
+        if ((solana_append_shortvec(message, SOLANA_MAX_MESSAGE_LEN, &message_len, sizeof(instruction_data)) == 0) ||
+            (solana_append_bytes(message, SOLANA_MAX_MESSAGE_LEN, &message_len, instruction_data, sizeof(instruction_data)) == 0))
         {
             status = APP_ERR_IO;
         }
@@ -947,10 +1039,10 @@ static int solana_build_transfer_transaction(const uint8_t *from_public_key,
     {
         int memo_status = 0;
         memo_program_index = (uint8_t)(account_key_count - 1u);
-        memo_status = solana_append_u8(message, sizeof(message), &message_len, memo_program_index);
-        memo_status &= solana_append_shortvec(message, sizeof(message), &message_len, 0u);
-        memo_status &= solana_append_shortvec(message, sizeof(message), &message_len, memo_len);
-        memo_status &= solana_append_bytes(message, sizeof(message), &message_len, (const uint8_t *)memo, memo_len);
+        memo_status = solana_append_u8(message, SOLANA_MAX_MESSAGE_LEN, &message_len, memo_program_index);
+        memo_status &= solana_append_shortvec(message, SOLANA_MAX_MESSAGE_LEN, &message_len, 0u);
+        memo_status &= solana_append_shortvec(message, SOLANA_MAX_MESSAGE_LEN, &message_len, memo_len);
+        memo_status &= solana_append_bytes(message, SOLANA_MAX_MESSAGE_LEN, &message_len, (const uint8_t *)memo, memo_len);
         if (memo_status == 0)
         {
             status = APP_ERR_IO;
@@ -959,13 +1051,35 @@ static int solana_build_transfer_transaction(const uint8_t *from_public_key,
 
     if (status == APP_OK)
     {
-        ed25519_sign(signature, message, message_len, from_public_key, private_key);
+        if (private_key != NULL)
+        {
+            ed25519_sign(signature, message, message_len, from_public_key, private_key);
+        }
+        else
+        {
+            status = sign_with_agent(from_public_key, message, message_len, signature);
+        }
+    }
+
+    /* Never broadcast a bad signature, whether it came from a faulty sign or from the agent. */
+    if ((status == APP_OK) && (wallet_verify(signature, message, message_len, from_public_key) == 0))
+    {
+        fprintf(stderr, "Transaction signature does not verify against the sender key.\n");
+        status = APP_ERR_CRYPTO;
+    }
+
+    if (status == APP_OK)
+    {
         if ((solana_append_shortvec(transaction, sizeof(transaction), &transaction_len, 1u) == 0) ||
             (solana_append_bytes(transaction, sizeof(transaction), &transaction_len, signature, sizeof(signature)) == 0) ||
-            (solana_append_bytes(transaction, sizeof(transaction), &transaction_len, message, message_len) == 0))
+            (transaction + transaction_len != message))
         {
             status = APP_ERR_IO;
         }
+        else
+        {
+            transaction_len += message_len;
+        }
     }
 
     if (status == APP_OK)
@@ -986,7 +1100,6 @@ static int solana_build_transfer_transaction(const uint8_t *from_public_key,
     }
 
     wallet_secure_zero(signature, sizeof(signature));
-    wallet_secure_zero(message, sizeof(message));
     wallet_secure_zero(transaction, sizeof(transaction));
     wallet_secure_zero(instruction_data, sizeof(instruction_data));
     wallet_secure_zero(memo_program_id, sizeof(memo_program_id));
@@ -994,6 +1107,18 @@ static int solana_build_transfer_transaction(const uint8_t *from_public_key,
     return status;
 }
 
+/* A public key followed by exactly one v1 or v2 blob. */
+static int stored_payload_valid(const uint8_t *payload, size_t payload_len)
+{
+    if (payload_len <= WALLET_PUBLIC_KEY_LEN)
+    {
+        return 0;
+    }
+
+    return wallet_blob_length(payload + WALLET_PUBLIC_KEY_LEN, payload_len - WALLET_PUBLIC_KEY_LEN) ==
+           (payload_len - WALLET_PUBLIC_KEY_LEN);
+}
+
 static int fetch_wallet_payload(CalcSession *session,
                                 char *var_buffer,
                                 size_t var_buffer_len,
@@ -1002,9 +1127,8 @@ static int fetch_wallet_payload(CalcSession *session,
                                 size_t blob_len)
 {
     int status = APP_ERR_IO;
-    FileContent *content = NULL;
-    VarEntry *entry = NULL;
-    uint8_t payload_length = 0u;
+    uint8_t payload[STORED_KEY_PAYLOAD_LEN];
+    size_t payload_length = 0u;
 
     if ((session == NULL) || (var_buffer == NULL) || (public_key == NULL) || (blob == NULL))
     {
@@ -1023,60 +1147,32 @@ static int fetch_wallet_payload(CalcSession *session,
         return APP_ERR_IO;
     }
 
-    status = calc_fetch_string(session, var_buffer, &content);
+    /* Served from the host cache when the slot has not changed since the last read. */
+    status = calc_fetch_binary_string(session, var_buffer, payload, sizeof(payload), &payload_length);
     if (status != APP_OK)
     {
-        fprintf(stderr, "Failed to fetch %s (error %d).\n", var_buffer, status);
+        fprintf(stderr, "%s is missing or does not contain an encrypted key (error %d).\n", var_buffer, status);
     }
-
-    if (status == APP_OK)
+    else if (!stored_payload_valid(payload, payload_length))
     {
-        if ((content == NULL) || (content->num_entries == 0) || (content->entries[0] == NULL))
-        {
-            fprintf(stderr, "%s is empty or missing.\n", var_buffer);
-            status = APP_ERR_IO;
-        }
-        else
-        {
-            entry = content->entries[0];
-            if ((entry->data == NULL) || (entry->size < (STORED_KEY_PAYLOAD_LEN + 1u)))
-            {
-                fprintf(stderr, "%s does not contain an encrypted key.\n", var_buffer);
-                status = APP_ERR_IO;
-            }
-            else
-            {
-                payload_length = entry->data[0];
-                if ((payload_length != STORED_KEY_PAYLOAD_LEN) || (payload_length > (entry->size - 1u)))
-                {
-                    fprintf(stderr, "Stored data size is invalid (%u bytes).\n", payload_length);
-                    status = APP_ERR_IO;
-                }
-                else
-                {
-                    memcpy(public_key, entry->data + 1u, WALLET_PUBLIC_KEY_LEN);
-                    memcpy(blob, entry->data + 1u + WALLET_PUBLIC_KEY_LEN, WALLET_BLOB_LEN);
-                    status = APP_OK;
-                }
-            }
-        }
+        fprintf(stderr, "Stored data size is invalid (%u bytes).\n", (unsigned int)payload_length);
+        status = APP_ERR_IO;
     }
-
-    if ((status != APP_OK) || (entry == NULL))
+    else
     {
-        wallet_secure_zero(public_key, WALLET_PUBLIC_KEY_LEN);
-        wallet_secure_zero(blob, blob_len);
+        /* v1 blobs are shorter; the tail stays zeroed. */
+        memset(blob, 0, blob_len);
+        memcpy(public_key, payload, WALLET_PUBLIC_KEY_LEN);
+        memcpy(blob, payload + WALLET_PUBLIC_KEY_LEN, payload_length - WALLET_PUBLIC_KEY_LEN);
     }
 
-    if ((entry != NULL) && (entry->data != NULL) && (entry->size > 0u))
+    if (status != APP_OK)
     {
-        wallet_secure_zero(entry->data, entry->size);
+        wallet_secure_zero(public_key, WALLET_PUBLIC_KEY_LEN);
+        wallet_secure_zero(blob, blob_len);
     }
 
-    if (content != NULL)
-    {
-        tifiles_content_delete_regular(content);
-    }
+    wallet_secure_zero(payload, sizeof(payload));
 
     return status;
 }
@@ -1092,6 +1188,7 @@ static int create_encrypted_keypair(CalcSession *session)
     uint8_t public_key[WALLET_PUBLIC_KEY_LEN];
     uint8_t blob[WALLET_BLOB_LEN];
     uint8_t storage_payload[STORED_KEY_PAYLOAD_LEN];
+    WalletKdfParams kdf_params;
 
     if (session != NULL)
     {
@@ -1123,7 +1220,7 @@ static int create_encrypted_keypair(CalcSession *session)
 
         if (flow_status == APP_OK)
         {
-            if (ed25519_create_seed(seed) != 0)
+            if (wallet_random_bytes(seed, sizeof(seed)) != APP_OK)
             {
                 fprintf(stderr, "Failed to generate secure seed.\n");
                 flow_status = APP_ERR_CRYPTO;
@@ -1133,7 +1230,20 @@ static int create_encrypted_keypair(CalcSession *session)
                 ed25519_create_keypair(public_key, private_key, seed);
                 wallet_secure_zero(seed, sizeof(seed));
 
-                flow_status = wallet_encrypt_private_key(password, private_key, sizeof(private_key), blob, sizeof(blob));
+                printf("Calibrating key derivation for this host...\n");
+                if (wallet_kdf_calibrate(WALLET_KDF_ARGON2ID, WALLET_KDF_TARGET_MS, &kdf_params) == APP_OK)
+                {
+                    printf("Using Argon2id with %u MiB, %u passes.\n",
+                           (unsigned int)(kdf_params.cost / 1024u), (unsigned int)kdf_params.passes);
+                }
+                else
+                {
+                    wallet_kdf_default_params(&kdf_params);
+                    printf("Argon2id unavailable; using PBKDF2 with %u iterations.\n", (unsigned int)kdf_params.cost);
+                }
+
+                flow_status = wallet_encrypt_private_key_kdf(password, &kdf_params, private_key, sizeof(private_key),
+                                                             blob, sizeof(blob));
                 if (flow_status != APP_OK)
                 {
                     fprintf(stderr, "Failed to encrypt private key (error %d).\n", flow_status);
@@ -1483,6 +1593,7 @@ static int send_sol_transaction(CalcSession *session)
     size_t default_memo_len = strlen(SOLANA_DEFAULT_MEMO);
     size_t memo_index = 0u;
     int ascii_ok = 1;
+    int use_agent = 0;
 
     memset(&client, 0, sizeof(client));
     memset(blob, 0, sizeof(blob));
@@ -1598,7 +1709,13 @@ static int send_sol_transaction(CalcSession *session)
             }
         }
 
-        if (flow_status == APP_OK)
+        if ((flow_status == APP_OK) && (agent_holds_key(public_key) != 0))
+        {
+            printf("Signing with the unlocked key held by the agent.\n");
+            use_agent = 1;
+        }
+
+        if ((flow_status == APP_OK) && (use_agent == 0))
         {
             if (prompt_password(password, sizeof(password), "Enter password to decrypt wallet: ") == 0)
             {
@@ -1660,7 +1777,7 @@ static int send_sol_transaction(CalcSession *session)
                                                             recipient_public_key,
                                                             lamports,
                                                             recent_blockhash,
-                                                            private_key,
+                                                            (use_agent != 0) ? NULL : private_key,
                                                             (memo_len > 0u) ? memo_buffer : NULL,
                                                             memo_len,
                                                             transaction_base64,
@@ -1761,9 +1878,312 @@ static int send_sol_transaction(CalcSession *session)
     return status;
 }
 
+/* Decrypts a slot once and hands the key to a background agent; a running agent is offered a lock instead. */
+static int unlock_keypair_in_agent(CalcSession *session)
+{
+    char socket_path[WALLET_AGENT_PATH_MAX];
+    char var_buffer[STRING_VAR_BUFFER_LENGTH] = {0};
+    char password[PASSWORD_BUFFER_LENGTH];
+    uint8_t blob[WALLET_BLOB_LEN];
+    uint8_t public_key[WALLET_PUBLIC_KEY_LEN];
+    uint8_t private_key[WALLET_PRIVATE_KEY_LEN];
+    int status = wallet_agent_default_path(socket_path, sizeof(socket_path));
+
+    if (status != APP_OK)
+    {
+        fprintf(stderr, "Signing agent is not available on this platform.\n");
+        return status;
+    }
+
+    if (wallet_agent_public_key(socket_path, public_key) == APP_OK)
+    {
+        print_base58("Agent holds key: ", public_key, sizeof(public_key));
+        if (prompt_yes_no("Lock it now? (y/N): ") == 1)
+        {
+            status = wallet_agent_lock(socket_path);
+            if (status == APP_OK)
+            {
+                printf("Agent locked; key wiped.\n");
+            }
+        }
+        return status;
+    }
+
+    memset(password, 0, sizeof(password));
+    memset(private_key, 0, sizeof(private_key));
+
+    status = fetch_wallet_payload(session, var_buffer, sizeof(var_buffer), public_key, blob, sizeof(blob));
+    if (status == APP_OK)
+    {
+        if (prompt_password(password, sizeof(password), "Enter password to unlock wallet: ") == 0)
+        {
+            status = APP_ERR_IO;
+        }
+        else
+        {
+            status = wallet_decrypt_private_key(password, blob, sizeof(blob), private_key, sizeof(private_key));
+            if (status != APP_OK)
+            {
+                fprintf(stderr, "Unable to decrypt private key (error %d).\n", status);
+            }
+        }
+    }
+
+    wallet_secure_zero(password, sizeof(password));
+    wallet_secure_zero(blob, sizeof(blob));
+
+    if (status == APP_OK)
+    {
+        /* Wipes private_key whatever the outcome. */
+        status = wallet_agent_start(socket_path, public_key, private_key, WALLET_AGENT_IDLE_TIMEOUT_S);
+        if (status == APP_OK)
+        {
+            printf("Key from %s unlocked in the agent at %s for %u s of inactivity.\n",
+                   var_buffer, socket_path, WALLET_AGENT_IDLE_TIMEOUT_S);
+        }
+        else
+        {
+            fprintf(stderr, "Failed to start signing agent (error %d).\n", status);
+        }
+    }
+
+    wallet_secure_zero(private_key, sizeof(private_key));
+
+    return status;
+}
+
+/* Calculators known to discovery, or every pool slot when it is not running (absent ones are skipped). */
+/*
+ * Units known to discovery, which is started here if it failed at launch.
+ * Without it only the calculator this session is attached to is known, so
+ * no ports are opened blind.
+ */
+static int count_connected_calculators(void)
+{
+    CableModel cable_model;
+    CalcModel calc_model;
+    int count = 0;
+    int index = 0;
+
+    if ((calc_discovery_running() == 0) && (calc_discovery_start() != APP_OK))
+    {
+        fprintf(stderr, "USB hotplug discovery unavailable; only the attached calculator is known.\n");
+        return 1;
+    }
+
+    for (index = 0; index < CALC_POOL_MAX_DEVICES; index++)
+    {
+        if (calc_discovery_lookup(index, &cable_model, &calc_model) != APP_ERR_NO_CALC)
+        {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/*
+ * Writes one keypair slot to the same slot of every connected calculator,
+ * one pool worker per unit. The session lets go of its cable while the pool
+ * owns the units and reattaches afterwards.
+ */
+static int replicate_keypair_slot(CalcSession *session)
+{
+    char var_buffer[STRING_VAR_BUFFER_LENGTH] = {0};
+    uint8_t payload[STORED_KEY_PAYLOAD_LEN];
+    uint8_t blob[WALLET_BLOB_LEN];
+    CalcJob jobs[CALC_POOL_MAX_DEVICES];
+    CalcPool *pool = NULL;
+    size_t payload_len = 0u;
+    int device_count = count_connected_calculators();
+    unsigned int copied = 0u;
+    int status = APP_OK;
+    int index = 0;
+
+    if (device_count < 2)
+    {
+        printf("Only one calculator is connected; nothing to copy to.\n");
+        return APP_OK;
+    }
+
+    status = fetch_wallet_payload(session, var_buffer, sizeof(var_buffer), payload, blob, sizeof(blob));
+    if (status == APP_OK)
+    {
+        payload_len = WALLET_PUBLIC_KEY_LEN + wallet_blob_length(blob, sizeof(blob));
+        memcpy(payload + WALLET_PUBLIC_KEY_LEN, blob, payload_len - WALLET_PUBLIC_KEY_LEN);
+        pool = (CalcPool *)malloc(sizeof(*pool));
+        if (pool == NULL)
+        {
+            status = APP_ERR_ALLOC;
+        }
+    }
+    wallet_secure_zero(blob, sizeof(blob));
+
+    if (status == APP_OK)
+    {
+        calc_session_stop_polling(session);
+        ticalcs_cable_detach(session->calc);
+
+        status = calc_pool_open(pool, device_count);
+        if (status == APP_OK)
+        {
+            memset(jobs, 0, sizeof(jobs));
+            for (index = 0; index < pool->worker_count; index++)
+            {
+                jobs[index].type = CALC_JOB_STORE;
+                jobs[index].device = index;
+                (void)snprintf(jobs[index].var_name, sizeof(jobs[index].var_name), "%s", var_buffer);
+                jobs[index].payload = payload;
+                jobs[index].payload_len = payload_len;
+                if (calc_pool_submit(pool, &jobs[index]) != APP_OK)
+                {
+                    jobs[index].status = APP_ERR_NO_CALC;
+                }
+            }
+
+            calc_pool_wait(pool);
+            for (index = 0; index < pool->worker_count; index++)
+            {
+                if (jobs[index].status == APP_OK)
+                {
+                    copied++;
+                }
+                else if (pool->workers[index].online != 0)
+                {
+                    fprintf(stderr, "Calculator %d: copy failed (error %d).\n", index, jobs[index].status);
+                }
+            }
+            calc_pool_close(pool);
+            printf("%s written to %u calculator(s).\n", var_buffer, copied);
+        }
+
+        /* The pool rewrote the slot behind the host cache. */
+        calc_string_cache_invalidate(session);
+        if (calc_session_reattach(session) != APP_OK)
+        {
+            fprintf(stderr, "Calculator link lost, reconnect the cable.\n");
+        }
+        (void)calc_session_start_polling(session, 1000);
+    }
+
+    free(pool);
+    wallet_secure_zero(payload, sizeof(payload));
+
+    return status;
+}
+
+/* Copies the keypairs found in Str0-Str9 into the vault, in one batched fetch. */
+static int import_string_slots(CalcSession *session, CalcVault *vault)
+{
+    CalcBinaryStringFetch items[10];
+    uint8_t payloads[10][STORED_KEY_PAYLOAD_LEN];
+    char names[10][STRING_VAR_BUFFER_LENGTH];
+    unsigned int imported = 0u;
+    int status = APP_OK;
+    int index = 0;
+
+    for (index = 0; index < 10; index++)
+    {
+        (void)snprintf(names[index], sizeof(names[index]), "Str%d", index);
+        items[index].var_name = names[index];
+        items[index].out_data = payloads[index];
+        items[index].out_size = sizeof(payloads[index]);
+        items[index].out_len = 0u;
+        items[index].status = APP_ERR_IO;
+    }
+
+    /* Empty slots only fail their own item. */
+    (void)calc_fetch_binary_strings(session, items, 10u);
+
+    for (index = 0; (index < 10) && (status == APP_OK); index++)
+    {
+        if ((items[index].status == APP_OK) && stored_payload_valid(payloads[index], items[index].out_len))
+        {
+            status = calc_vault_put(vault, CALC_VAULT_KEYPAIR, names[index], payloads[index],
+                                    payloads[index] + WALLET_PUBLIC_KEY_LEN,
+                                    items[index].out_len - WALLET_PUBLIC_KEY_LEN);
+            if (status == APP_OK)
+            {
+                imported++;
+            }
+        }
+    }
+
+    wallet_secure_zero(payloads, sizeof(payloads));
+
+    if ((status == APP_OK) && (imported > 0u))
+    {
+        status = calc_vault_save(session, vault);
+    }
+
+    if (status == APP_OK)
+    {
+        printf("Imported %u keypair(s) into %s.\n", imported, CALC_VAULT_VAR_NAME);
+    }
+
+    return status;
+}
+
+static int show_wallet_vault(CalcSession *session)
+{
+    CalcVault *vault = NULL;
+    int status = APP_ERR_NO_CALC;
+    unsigned int index = 0u;
+
+    if ((session == NULL) || (session->calc == NULL))
+    {
+        return APP_ERR_NO_CALC;
+    }
+
+    vault = (CalcVault *)malloc(sizeof(*vault));
+    if (vault == NULL)
+    {
+        return APP_ERR_ALLOC;
+    }
+    calc_vault_init(vault);
+
+    status = calc_vault_load(session, vault);
+    if ((status == APP_OK) && (vault->entry_count == 0u))
+    {
+        printf("No wallet vault on the calculator.\n");
+        if (prompt_yes_no("Import keypairs from Str0-Str9? (y/N): ") == 1)
+        {
+            status = import_string_slots(session, vault);
+        }
+    }
+
+    if (status == APP_OK)
+    {
+        for (index = 0u; index < vault->entry_count; index++)
+        {
+            const CalcVaultEntry *entry = &vault->entries[index];
+            const char *kind = "keypair";
+            char label[32];
+
+            if (entry->kind == CALC_VAULT_CONTACT)
+            {
+                kind = "contact";
+            }
+            else if (entry->kind == CALC_VAULT_NONCE_ACCOUNT)
+            {
+                kind = "nonce";
+            }
+
+            (void)snprintf(label, sizeof(label), " %-8s %-8s ", entry->label, kind);
+            print_base58(label, entry->public_key, sizeof(entry->public_key));
+        }
+    }
+
+    calc_vault_free(vault);
+    free(vault);
+
+    return status;
+}
+
 int main(void)
 {
     int err = APP_OK;
+    unsigned int reattach_count = 0u;
     CalcSession session;
     memset(&session, 0, sizeof(session));
     session.port_number = PORT_1;
@@ -1771,6 +2191,10 @@ int main(void)
     ticables_library_init();
     tifiles_library_init();
     ticalcs_library_init();
+    if (calc_discovery_start() != APP_OK)
+    {
+        fprintf(stderr, "USB hotplug discovery unavailable\n");
+    }
 
     err = calc_session_open(&session);
     if (err == APP_OK)
@@ -1778,18 +2202,18 @@ int main(void)
         err = calc_session_start_polling(&session, 1000);
         if (err == APP_OK)
         {
-            if (ticalcs_calc_isready(session.calc) == 0)
+            if (calc_session_isready(&session) == 0)
             {
                 char input_buffer[32];
                 int exit_menu = 0;
                 printf("Calculator responded to RDY ping\n");
-                calc_session_stop_polling(&session);
 
                 while (exit_menu == 0)
                 {
                     char *endptr = NULL;
                     long choice = 0;
 
+                    print_link_status(&session, &reattach_count);
                     print_menu();
                     printf("Select an option: ");
 
@@ -1808,6 +2232,13 @@ int main(void)
                         }
                         else
                         {
+                            if (calc_session_ensure_link(&session) != APP_OK)
+                            {
+                                fprintf(stderr, "Calculator link lost, reconnect the cable.\n");
+                            }
+                            /* Slots may have been edited on the calculator since the last command. */
+                            calc_string_cache_invalidate(&session);
+
                             switch (choice)
                             {
                                 case MENU_OPTION_CREATE:
@@ -1855,6 +2286,33 @@ int main(void)
                                     }
                                     break;
                                 }
+                                case MENU_OPTION_VAULT:
+                                {
+                                    int vault_status = show_wallet_vault(&session);
+                                    if (vault_status != APP_OK)
+                                    {
+                                        fprintf(stderr, "Wallet vault failed (error %d).\n", vault_status);
+                                    }
+                                    break;
+                                }
+                                case MENU_OPTION_AGENT:
+                                {
+                                    int agent_status = unlock_keypair_in_agent(&session);
+                                    if (agent_status != APP_OK)
+                                    {
+                                        fprintf(stderr, "Signing agent failed (error %d).\n", agent_status);
+                                    }
+                                    break;
+                                }
+                                case MENU_OPTION_REPLICATE:
+                                {
+                                    int replicate_status = replicate_keypair_slot(&session);
+                                    if (replicate_status != APP_OK)
+                                    {
+                                        fprintf(stderr, "Keypair copy failed (error %d).\n", replicate_status);
+                                    }
+                                    break;
+                                }
                                 case MENU_OPTION_EXIT:
                                 {
                                     printf("Exiting menu.\n");
@@ -1881,6 +2339,7 @@ int main(void)
     
     calc_session_stop_polling(&session);
     calc_session_cleanup(&session);
+    calc_discovery_stop();
     ticalcs_library_exit();
     tifiles_library_exit();
     ticables_library_exit();
@@ -0,0 +1,415 @@
+/* clock_gettime and getopt with CMAKE_C_EXTENSIONS off */
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Differential fuzzer for the two scalar backends in keypair/sc.c. The file is
+ * compiled twice into this binary, once as the ref10 21-bit limb code and once
+ * with ED25519_SC64, under renamed entry points. Every input goes through
+ * both, and through a slow bit-serial reduction mod l that arbitrates when they
+ * disagree. sc_muladd inputs cover reduced scalars, clamped private keys (as
+ * ed25519_sign passes them) and arbitrary 256-bit values; sc_reduce inputs
+ * cover arbitrary 512-bit values and multiples of l plus small offsets.
+ * Afterwards both backends are timed, so ED25519_SC64 can be judged on this
+ * host.
+ */
+
+#define sc_reduce sc_reduce_ref10
+#define sc_muladd sc_muladd_ref10
+#include "sc.c"
+#undef sc_reduce
+#undef sc_muladd
+
+#define ED25519_SC64
+#define sc_reduce sc_reduce_sc64
+#define sc_muladd sc_muladd_sc64
+void sc_reduce(unsigned char *s);
+void sc_muladd(unsigned char *s, const unsigned char *a, const unsigned char *b, const unsigned char *c);
+#include "sc.c"
+#undef sc_reduce
+#undef sc_muladd
+
+#define SC_FUZZ_DEFAULT_ITERATIONS 100000u
+#define SC_FUZZ_DEFAULT_SEED 0x5c64f022u
+#define SC_FUZZ_BENCH_CALLS 200000u
+#define SC_FUZZ_CLASSES 4u
+
+/* l = 2^252 + 27742317777372353535851937790883648493, little-endian */
+static const uint8_t sc_fuzz_l[32] = {
+    0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10
+};
+
+static void usage(const char *program);
+static uint64_t next_random(uint64_t *state);
+static void fill_random(uint64_t *state, uint8_t *out, size_t len);
+static void make_scalar(uint64_t *state, uint8_t out[32], unsigned int input_class);
+static void make_wide(uint64_t *state, uint8_t out[64], unsigned int input_class);
+static void slow_muladd_wide(uint8_t out[64], const uint8_t a[32], const uint8_t b[32], const uint8_t c[32]);
+static void slow_reduce(uint8_t out[32], const uint8_t in[64]);
+static int check_reduce(const uint8_t in[64], uint64_t iteration);
+static int check_muladd(const uint8_t a[32], const uint8_t b[32], const uint8_t c[32], uint64_t iteration);
+static void print_hex(const char *label, const uint8_t *data, size_t len);
+static double elapsed_ns(const struct timespec *start, const struct timespec *end);
+static void bench_backends(void);
+
+int main(int argc, char **argv)
+{
+    unsigned long long iterations = SC_FUZZ_DEFAULT_ITERATIONS;
+    uint64_t seed = SC_FUZZ_DEFAULT_SEED;
+    uint64_t state;
+    unsigned long long mismatches = 0u;
+    int bench = 1;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "n:s:qh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                iterations = strtoull(optarg, NULL, 10);
+                break;
+            case 's':
+                seed = (uint64_t)strtoull(optarg, NULL, 0);
+                break;
+            case 'q':
+                bench = 0;
+                break;
+            default:
+                usage(argv[0]);
+                return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    if (optind != argc)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+#ifndef __SIZEOF_INT128__
+    printf("No __int128 on this compiler: both builds are ref10, nothing to compare.\n");
+#endif
+
+    state = seed;
+    for (unsigned long long i = 0u; i < iterations; i++)
+    {
+        unsigned int input_class = (unsigned int)(i % SC_FUZZ_CLASSES);
+        uint8_t wide[64];
+        uint8_t a[32];
+        uint8_t b[32];
+        uint8_t c[32];
+
+        make_wide(&state, wide, input_class);
+        mismatches += (unsigned long long)check_reduce(wide, i);
+
+        make_scalar(&state, a, input_class);
+        make_scalar(&state, b, (input_class + 1u) % SC_FUZZ_CLASSES);
+        make_scalar(&state, c, (input_class + 2u) % SC_FUZZ_CLASSES);
+        mismatches += (unsigned long long)check_muladd(a, b, c, i);
+
+        if (mismatches > 10u)
+        {
+            break;
+        }
+    }
+
+    printf("sc_reduce/sc_muladd: %llu iterations, seed 0x%llx, %llu mismatches\n",
+           iterations, (unsigned long long)seed, mismatches);
+
+    if ((mismatches == 0u) && (bench != 0))
+    {
+        bench_backends();
+    }
+
+    return (mismatches == 0u) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void usage(const char *program)
+{
+    fprintf(stderr,
+            "Usage: %s [-n iterations] [-s seed] [-q]\n"
+            "Feeds random and edge-case scalars through the ref10 and ED25519_SC64\n"
+            "builds of keypair/sc.c and a slow reference reduction mod l, and exits\n"
+            "non-zero on any difference (default %u iterations). Unless -q is given,\n"
+            "then times sc_reduce and sc_muladd on both backends.\n",
+            program, SC_FUZZ_DEFAULT_ITERATIONS);
+}
+
+/* splitmix64: reproducible from the seed, which is all a fuzzer needs */
+static uint64_t next_random(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static void fill_random(uint64_t *state, uint8_t *out, size_t len)
+{
+    for (size_t i = 0u; i < len; i++)
+    {
+        if ((i % 8u) == 0u)
+        {
+            uint64_t word = next_random(state);
+
+            for (size_t j = 0u; (j < 8u) && (i + j < len); j++)
+            {
+                out[i + j] = (uint8_t)(word >> (8u * j));
+            }
+        }
+    }
+}
+
+/* 0: below 2^252 (reduced), 1: clamped private key, 2: any 256-bit value, 3: edge value */
+static void make_scalar(uint64_t *state, uint8_t out[32], unsigned int input_class)
+{
+    uint64_t pick;
+
+    fill_random(state, out, 32u);
+    switch (input_class)
+    {
+        case 0:
+            out[31] &= 0x0f;
+            break;
+        case 1:
+            out[0] &= 248;
+            out[31] &= 63;
+            out[31] |= 64;
+            break;
+        case 2:
+            break;
+        default:
+            pick = next_random(state) % 6u;
+            if (pick == 0u)
+            {
+                memset(out, 0, 32u);
+            }
+            else if (pick == 1u)
+            {
+                memset(out, 0xff, 32u);
+            }
+            else
+            {
+                /* l - 1, l, l + 1 and l + 2; the low byte of l never carries or borrows here */
+                memcpy(out, sc_fuzz_l, 32u);
+                out[0] = (uint8_t)(out[0] + pick - 3u);
+            }
+            break;
+    }
+}
+
+/* 0-2: any 512-bit value, top-heavy or not; 3: l * m + small offset */
+static void make_wide(uint64_t *state, uint8_t out[64], unsigned int input_class)
+{
+    uint8_t m[32];
+    uint8_t offset[32];
+
+    fill_random(state, out, 64u);
+    switch (input_class)
+    {
+        case 0:
+            break;
+        case 1:
+            memset(out + 32, 0xff, 32u);
+            break;
+        case 2:
+            memset(out + 32, 0, 32u);
+            break;
+        default:
+            fill_random(state, m, sizeof(m));
+            memset(offset, 0, sizeof(offset));
+            offset[0] = (uint8_t)(next_random(state) % 3u);
+            slow_muladd_wide(out, sc_fuzz_l, m, offset);
+            break;
+    }
+}
+
+/* out = a * b + c as a 512-bit little-endian value */
+static void slow_muladd_wide(uint8_t out[64], const uint8_t a[32], const uint8_t b[32], const uint8_t c[32])
+{
+    uint32_t acc[65] = {0};
+
+    for (size_t i = 0u; i < 32u; i++)
+    {
+        for (size_t j = 0u; j < 32u; j++)
+        {
+            acc[i + j] += (uint32_t)a[i] * b[j];
+        }
+        acc[i] += c[i];
+    }
+
+    for (size_t i = 0u; i < 64u; i++)
+    {
+        acc[i + 1u] += acc[i] >> 8;
+        out[i] = (uint8_t)acc[i];
+    }
+}
+
+/* Bit-serial reduction mod l: r = 2r + bit, minus l when r >= l. */
+static void slow_reduce(uint8_t out[32], const uint8_t in[64])
+{
+    uint8_t r[33] = {0};
+
+    for (int bit = 511; bit >= 0; bit--)
+    {
+        uint8_t diff[33];
+        unsigned int carry = (unsigned int)((in[bit / 8] >> (bit % 8)) & 1u);
+        int borrow = 0;
+
+        for (size_t i = 0u; i < 33u; i++)
+        {
+            unsigned int v = ((unsigned int)r[i] << 1) | carry;
+
+            carry = v >> 8;
+            r[i] = (uint8_t)v;
+        }
+
+        for (size_t i = 0u; i < 33u; i++)
+        {
+            int v = (int)r[i] - ((i < 32u) ? sc_fuzz_l[i] : 0) - borrow;
+
+            borrow = (v < 0);
+            diff[i] = (uint8_t)(v + (borrow ? 256 : 0));
+        }
+
+        if (borrow == 0)
+        {
+            memcpy(r, diff, sizeof(r));
+        }
+    }
+
+    memcpy(out, r, 32u);
+}
+
+static int check_reduce(const uint8_t in[64], uint64_t iteration)
+{
+    uint8_t ref10[64];
+    uint8_t sc64[64];
+    uint8_t expected[32];
+
+    memcpy(ref10, in, 64u);
+    memcpy(sc64, in, 64u);
+    sc_reduce_ref10(ref10);
+    sc_reduce_sc64(sc64);
+    slow_reduce(expected, in);
+
+    if ((memcmp(ref10, expected, 32u) == 0) && (memcmp(sc64, expected, 32u) == 0))
+    {
+        return 0;
+    }
+
+    printf("sc_reduce mismatch at iteration %llu\n", (unsigned long long)iteration);
+    print_hex("  in      ", in, 64u);
+    print_hex("  ref10   ", ref10, 32u);
+    print_hex("  sc64    ", sc64, 32u);
+    print_hex("  expected", expected, 32u);
+    return 1;
+}
+
+static int check_muladd(const uint8_t a[32], const uint8_t b[32], const uint8_t c[32], uint64_t iteration)
+{
+    uint8_t ref10[32];
+    uint8_t sc64[32];
+    uint8_t wide[64];
+    uint8_t expected[32];
+
+    sc_muladd_ref10(ref10, a, b, c);
+    sc_muladd_sc64(sc64, a, b, c);
+    slow_muladd_wide(wide, a, b, c);
+    slow_reduce(expected, wide);
+
+    if ((memcmp(ref10, expected, 32u) == 0) && (memcmp(sc64, expected, 32u) == 0))
+    {
+        return 0;
+    }
+
+    printf("sc_muladd mismatch at iteration %llu\n", (unsigned long long)iteration);
+    print_hex("  a       ", a, 32u);
+    print_hex("  b       ", b, 32u);
+    print_hex("  c       ", c, 32u);
+    print_hex("  ref10   ", ref10, 32u);
+    print_hex("  sc64    ", sc64, 32u);
+    print_hex("  expected", expected, 32u);
+    return 1;
+}
+
+static void print_hex(const char *label, const uint8_t *data, size_t len)
+{
+    printf("%s ", label);
+    for (size_t i = 0u; i < len; i++)
+    {
+        printf("%02x", data[i]);
+    }
+    printf("\n");
+}
+
+static double elapsed_ns(const struct timespec *start, const struct timespec *end)
+{
+    return (double)(end->tv_sec - start->tv_sec) * 1e9 + (double)(end->tv_nsec - start->tv_nsec);
+}
+
+static void bench_backends(void)
+{
+    static const char *names[2] = { "ref10", "sc64" };
+    uint8_t wide[64];
+    uint8_t a[32];
+    uint8_t b[32];
+    uint8_t c[32];
+    uint64_t state = SC_FUZZ_DEFAULT_SEED;
+
+    fill_random(&state, wide, sizeof(wide));
+    make_scalar(&state, a, 0u);
+    make_scalar(&state, b, 1u);
+    make_scalar(&state, c, 0u);
+
+    printf("%-8s %16s %16s\n", "backend", "sc_reduce ns", "sc_muladd ns");
+    for (int backend = 0; backend < 2; backend++)
+    {
+        struct timespec start;
+        struct timespec end;
+        double reduce_ns;
+        double muladd_ns;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (unsigned int i = 0u; i < SC_FUZZ_BENCH_CALLS; i++)
+        {
+            /* the output feeds the next call so it cannot be hoisted */
+            wide[32] ^= (uint8_t)i;
+            if (backend == 0)
+            {
+                sc_reduce_ref10(wide);
+            }
+            else
+            {
+                sc_reduce_sc64(wide);
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        reduce_ns = elapsed_ns(&start, &end) / SC_FUZZ_BENCH_CALLS;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (unsigned int i = 0u; i < SC_FUZZ_BENCH_CALLS; i++)
+        {
+            if (backend == 0)
+            {
+                sc_muladd_ref10(c, a, b, c);
+            }
+            else
+            {
+                sc_muladd_sc64(c, a, b, c);
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        muladd_ns = elapsed_ns(&start, &end) / SC_FUZZ_BENCH_CALLS;
+
+        printf("%-8s %16.1f %16.1f\n", names[backend], reduce_ns, muladd_ns);
+    }
+}
@@ -0,0 +1,676 @@
+/* setenv with CMAKE_C_EXTENSIONS off */
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "calc_pool.h"
+#include "calc_session.h"
+#include "calc_string_store.h"
+#include "calc_vault.h"
+#include "ed25519.h"
+#include "wallet_crypto.h"
+
+/*
+ * Drives calc_session and calc_string_store through the simulated TI-83 Plus
+ * link (CWALLET_SIM_LINK), so the whole path from the session I/O thread to
+ * the DBUS packets runs without a calculator. Prints one line per case and
+ * exits non-zero if any fails.
+ */
+#define SIM_TEST_LINK "latency=0"
+#define SIM_TEST_PAYLOAD_LEN 96u
+#define SIM_TEST_POOL_DEVICES 3
+#define SIM_TEST_PASSWORD "correct horse"
+/* The vault image layout from calc_vault.h, for the decode bounds tests. */
+#define SIM_TEST_VAULT_HEADER_LEN 8u
+#define SIM_TEST_VAULT_RECORD_LEN (2u + CALC_VAULT_LABEL_LEN + WALLET_PUBLIC_KEY_LEN + 6u)
+
+static int report(const char *name, int ok);
+static void fill_payload(uint8_t *payload, size_t len, uint8_t seed);
+static int test_session(CalcSession *session);
+static int test_binary_string(CalcSession *session);
+static int test_text_string(CalcSession *session);
+static int test_batch(CalcSession *session);
+static int delete_var_command(CalcSession *session, void *arg);
+static int test_stale_cache(CalcSession *session);
+static size_t sim_packet(uint8_t *out, uint8_t cmd, const uint8_t *data, size_t len);
+static int bad_xdp_command(CalcSession *session, void *arg);
+static int test_bad_xdp(CalcSession *session);
+static int vault_matches(const CalcVault *vault, const char *label, CalcVaultKind kind, const uint8_t *public_key,
+                         const uint8_t *payload, size_t payload_len);
+static int test_vault(CalcSession *session);
+static int test_vault_compaction(void);
+static int test_vault_decode_bounds(void);
+static int test_pool(void);
+
+int main(void)
+{
+    CalcSession session;
+    int failures = 0;
+
+    setenv("CWALLET_SIM_LINK", SIM_TEST_LINK, 1);
+    ticables_library_init();
+    tifiles_library_init();
+    ticalcs_library_init();
+
+    memset(&session, 0, sizeof(session));
+    if (calc_session_open(&session) != APP_OK)
+    {
+        failures += report("open simulated session", 0);
+    }
+    else
+    {
+        failures += test_session(&session);
+        failures += test_binary_string(&session);
+        failures += test_text_string(&session);
+        failures += test_batch(&session);
+        failures += test_stale_cache(&session);
+        failures += test_bad_xdp(&session);
+        failures += test_vault(&session);
+        calc_session_cleanup(&session);
+    }
+    failures += test_vault_compaction();
+    failures += test_vault_decode_bounds();
+    failures += test_pool();
+
+    ticalcs_library_exit();
+    tifiles_library_exit();
+    ticables_library_exit();
+
+    if (failures != 0)
+    {
+        printf("%d simulated link test(s) failed\n", failures);
+        return EXIT_FAILURE;
+    }
+
+    printf("All simulated link tests passed\n");
+    return EXIT_SUCCESS;
+}
+
+static int report(const char *name, int ok)
+{
+    printf("%-48s %s\n", name, ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+static void fill_payload(uint8_t *payload, size_t len, uint8_t seed)
+{
+    for (size_t i = 0u; i < len; i++)
+    {
+        payload[i] = (uint8_t)(seed + 13u * i);
+    }
+}
+
+/* Readiness inline, then again through the I/O thread once polling runs. */
+static int test_session(CalcSession *session)
+{
+    CalcSessionStatus status;
+    int failures = 0;
+
+    failures += report("session isready (inline)", calc_session_isready(session) == 0);
+    failures += report("session start polling", calc_session_start_polling(session, 1000) == APP_OK);
+    failures += report("session isready (I/O thread)", calc_session_isready(session) == 0);
+    failures += report("session status snapshot", calc_session_get_status(session, &status) == APP_OK);
+
+    return failures;
+}
+
+/* Store, then fetch from the host cache and again over the link with the cache dropped. */
+static int test_binary_string(CalcSession *session)
+{
+    uint8_t payload[SIM_TEST_PAYLOAD_LEN];
+    uint8_t output[SIM_TEST_PAYLOAD_LEN];
+    size_t output_len = 0u;
+    int failures = 0;
+    int ok;
+
+    fill_payload(payload, sizeof(payload), 0x11u);
+    failures += report("store binary Str1", calc_store_binary_string(session, "Str1", payload, sizeof(payload)) == APP_OK);
+
+    memset(output, 0, sizeof(output));
+    ok = (calc_fetch_binary_string(session, "Str1", output, sizeof(output), &output_len) == APP_OK) &&
+         (output_len == sizeof(payload)) && (memcmp(output, payload, sizeof(payload)) == 0);
+    failures += report("fetch binary Str1 (cached)", ok);
+
+    calc_string_cache_clear(session);
+    memset(output, 0, sizeof(output));
+    ok = (calc_fetch_binary_string(session, "Str1", output, sizeof(output), &output_len) == APP_OK) &&
+         (output_len == sizeof(payload)) && (memcmp(output, payload, sizeof(payload)) == 0);
+    failures += report("fetch binary Str1 (over the link)", ok);
+
+    ok = (calc_fetch_binary_string(session, "Str9", output, sizeof(output), &output_len) != APP_OK);
+    failures += report("fetch missing Str9 fails", ok);
+
+    return failures;
+}
+
+static int test_text_string(CalcSession *session)
+{
+    FileContent *content = NULL;
+    int failures = 0;
+    int ok;
+
+    failures += report("store text Str2", calc_store_persistent_string(session, "Str2", "HELLO") == APP_OK);
+
+    ok = (calc_fetch_string(session, "Str2", &content) == APP_OK) && (content != NULL) &&
+         (content->num_entries == 1) && (content->entries[0]->size > 0u);
+    failures += report("fetch text Str2", ok);
+    if (content != NULL)
+    {
+        tifiles_content_delete_regular(content);
+    }
+
+    return failures;
+}
+
+/* Two stored in one transfer, fetched back with a missing third in the same batch. */
+static int test_batch(CalcSession *session)
+{
+    uint8_t payload_a[40];
+    uint8_t payload_b[SIM_TEST_PAYLOAD_LEN];
+    uint8_t output[3][SIM_TEST_PAYLOAD_LEN];
+    CalcBinaryString items[2];
+    CalcBinaryStringFetch fetches[3];
+    int failures = 0;
+    int ok;
+
+    fill_payload(payload_a, sizeof(payload_a), 0x5au);
+    fill_payload(payload_b, sizeof(payload_b), 0xa5u);
+    items[0].var_name = "Str3";
+    items[0].payload = payload_a;
+    items[0].payload_len = sizeof(payload_a);
+    items[1].var_name = "Str4";
+    items[1].payload = payload_b;
+    items[1].payload_len = sizeof(payload_b);
+    failures += report("batch store Str3, Str4", calc_store_binary_strings(session, items, 2u) == APP_OK);
+
+    calc_string_cache_clear(session);
+    memset(fetches, 0, sizeof(fetches));
+    fetches[0].var_name = "Str3";
+    fetches[1].var_name = "Str4";
+    fetches[2].var_name = "Str8";
+    for (size_t i = 0u; i < 3u; i++)
+    {
+        fetches[i].out_data = output[i];
+        fetches[i].out_size = sizeof(output[i]);
+    }
+
+    ok = (calc_fetch_binary_strings(session, fetches, 3u) != APP_OK) &&
+         (fetches[0].status == APP_OK) && (fetches[0].out_len == sizeof(payload_a)) &&
+         (memcmp(output[0], payload_a, sizeof(payload_a)) == 0) &&
+         (fetches[1].status == APP_OK) && (fetches[1].out_len == sizeof(payload_b)) &&
+         (memcmp(output[1], payload_b, sizeof(payload_b)) == 0) &&
+         (fetches[2].status == APP_ERR_IO);
+    failures += report("batch fetch Str3, Str4, missing Str8", ok);
+
+    return failures;
+}
+
+/* Deletes a string variable straight through ticalcs, the way an edit on the calculator bypasses the host cache. */
+static int delete_var_command(CalcSession *session, void *arg)
+{
+    const char *var_name = (const char *)arg;
+    uint8_t string_type = tifiles_string2vartype(session->calc_model, "String");
+    char *tokenized_name = ticonv_varname_tokenize(session->calc_model, var_name, string_type);
+    VarEntry request;
+    int result = -1;
+
+    if (tokenized_name != NULL)
+    {
+        memset(&request, 0, sizeof(request));
+        request.type = string_type;
+        strncpy(request.name, tokenized_name, sizeof(request.name) - 1u);
+        result = ticalcs_calc_del_var(session->calc, &request);
+        ticonv_varname_free(tokenized_name);
+    }
+
+    return result;
+}
+
+/* A cached slot deleted behind the cache must not be served once the cache is invalidated. */
+static int test_stale_cache(CalcSession *session)
+{
+    uint8_t payload[SIM_TEST_PAYLOAD_LEN];
+    uint8_t output[SIM_TEST_PAYLOAD_LEN];
+    size_t output_len = 0u;
+    int failures = 0;
+    int ok;
+
+    fill_payload(payload, sizeof(payload), 0x77u);
+    ok = (calc_store_binary_string(session, "Str6", payload, sizeof(payload)) == APP_OK) &&
+         (calc_fetch_binary_string(session, "Str6", output, sizeof(output), &output_len) == APP_OK) &&
+         (calc_session_call(session, delete_var_command, (void *)"Str6") == 0);
+    failures += report("delete cached Str6 behind the cache", ok);
+
+    calc_string_cache_invalidate(session);
+    ok = (calc_fetch_binary_string(session, "Str6", output, sizeof(output), &output_len) != APP_OK);
+    failures += report("deleted Str6 not served after invalidate", ok);
+
+    return failures;
+}
+
+/* One PC-to-calculator DBUS packet; len 65536 goes out as a zero length field. */
+static size_t sim_packet(uint8_t *out, uint8_t cmd, const uint8_t *data, size_t len)
+{
+    uint16_t sum = 0u;
+
+    out[0] = 0x23u;
+    out[1] = cmd;
+    out[2] = (uint8_t)(len & 0xFFu);
+    out[3] = (uint8_t)((len >> 8) & 0xFFu);
+    for (size_t i = 0u; i < len; i++)
+    {
+        out[4u + i] = data[i];
+        sum = (uint16_t)(sum + data[i]);
+    }
+    out[4u + len] = (uint8_t)(sum & 0xFFu);
+    out[5u + len] = (uint8_t)(sum >> 8);
+
+    return len + 6u;
+}
+
+/*
+ * Raw packets straight to the cable: an RTS for a 16-byte string followed by
+ * a 40-byte XDP must be refused with a SKP, and a data packet whose zero
+ * length field stands for 65536 bytes must get an ERR.
+ */
+static int bad_xdp_command(CalcSession *session, void *arg)
+{
+    uint8_t *packet = (uint8_t *)arg;
+    uint8_t header[13];
+    uint8_t payload[40];
+    uint8_t reply[8];
+    size_t len = 0u;
+    int ok = 1;
+
+    memset(header, 0, sizeof(header));
+    header[0] = 16u;
+    header[2] = tifiles_string2vartype(session->calc_model, "String");
+    header[3] = 0xAAu;
+    header[4] = 0x07u;
+    len = sim_packet(packet, 0xC9u, header, sizeof(header));
+    ok &= (ticables_cable_send(session->cable, packet, (uint32_t)len) == 0) &&
+          (ticables_cable_recv(session->cable, reply, 8u) == 0) &&
+          (reply[1] == 0x56u) && (reply[5] == 0x09u);
+
+    memset(payload, 0x5a, sizeof(payload));
+    len = sim_packet(packet, 0x15u, payload, sizeof(payload));
+    ok &= (ticables_cable_send(session->cable, packet, (uint32_t)len) == 0) &&
+          (ticables_cable_recv(session->cable, reply, 7u) == 0) &&
+          (reply[1] == 0x36u) && (reply[4] == 3u);
+
+    memset(packet + 4u, 0, 65536u);
+    len = sim_packet(packet, 0x15u, packet + 4u, 65536u);
+    ok &= (ticables_cable_send(session->cable, packet, (uint32_t)len) == 0) &&
+          (ticables_cable_recv(session->cable, reply, 4u) == 0) && (reply[1] == 0x5Au);
+
+    return ok ? 0 : -1;
+}
+
+static int test_bad_xdp(CalcSession *session)
+{
+    uint8_t *packet = (uint8_t *)malloc(65536u + 6u);
+    uint8_t payload[SIM_TEST_PAYLOAD_LEN];
+    uint8_t output[SIM_TEST_PAYLOAD_LEN];
+    size_t output_len = 0u;
+    int failures = 0;
+    int ok;
+
+    if (packet == NULL)
+    {
+        return report("sim rejects mismatched and 65536-byte XDP", 0);
+    }
+
+    ok = (calc_session_call(session, bad_xdp_command, packet) == 0);
+    failures += report("sim rejects mismatched and 65536-byte XDP", ok);
+    free(packet);
+
+    fill_payload(payload, sizeof(payload), 0x3cu);
+    calc_string_cache_clear(session);
+    ok = (calc_store_binary_string(session, "Str7", payload, sizeof(payload)) == APP_OK) &&
+         (calc_fetch_binary_string(session, "Str7", output, sizeof(output), &output_len) == APP_OK) &&
+         (output_len == sizeof(payload)) && (memcmp(output, payload, sizeof(payload)) == 0);
+    failures += report("link still in step after the rejects", ok);
+
+    return failures;
+}
+
+static int vault_matches(const CalcVault *vault, const char *label, CalcVaultKind kind, const uint8_t *public_key,
+                         const uint8_t *payload, size_t payload_len)
+{
+    uint8_t output[SIM_TEST_PAYLOAD_LEN];
+    size_t output_len = 0u;
+    int index = calc_vault_find(vault, label);
+
+    return (index >= 0) && (vault->entries[index].kind == (uint8_t)kind) &&
+           (memcmp(vault->entries[index].public_key, public_key, WALLET_PUBLIC_KEY_LEN) == 0) &&
+           (calc_vault_get(vault, index, output, sizeof(output), &output_len) == APP_OK) &&
+           (output_len == payload_len) && (memcmp(output, payload, payload_len) == 0);
+}
+
+/*
+ * Entries of every kind saved as the CWALLET AppVar and loaded back, then
+ * overwritten in place with a shorter payload and moved by a longer one.
+ */
+static int test_vault(CalcSession *session)
+{
+    CalcVault *saved = (CalcVault *)calloc(1u, sizeof(*saved));
+    CalcVault *loaded = (CalcVault *)calloc(1u, sizeof(*loaded));
+    uint8_t keys[3][WALLET_PUBLIC_KEY_LEN];
+    uint8_t payloads[3][SIM_TEST_PAYLOAD_LEN];
+    uint8_t *image = NULL;
+    uint8_t *reencoded = NULL;
+    size_t image_len = 0u;
+    size_t reencoded_len = 0u;
+    size_t data_len = 0u;
+    uint16_t offset = 0u;
+    int failures = 0;
+    int ok;
+
+    if ((saved == NULL) || (loaded == NULL))
+    {
+        free(saved);
+        free(loaded);
+        return report("vault allocate", 0);
+    }
+
+    calc_vault_init(saved);
+    calc_vault_init(loaded);
+    for (int i = 0; i < 3; i++)
+    {
+        memset(keys[i], 0xa0 + i, sizeof(keys[i]));
+        fill_payload(payloads[i], sizeof(payloads[i]), (uint8_t)(0x60u + i));
+    }
+
+    ok = (calc_vault_put(saved, CALC_VAULT_KEYPAIR, "KEY1", keys[0], payloads[0], 80u) == APP_OK) &&
+         (calc_vault_put(saved, CALC_VAULT_CONTACT, "BOB", keys[1], payloads[1], 24u) == APP_OK) &&
+         (calc_vault_put(saved, CALC_VAULT_NONCE_ACCOUNT, "NONCE001", keys[2], payloads[2], 0u) == APP_OK) &&
+         (calc_vault_encode(saved, &image, &image_len) == APP_OK) &&
+         (calc_vault_decode(loaded, image, image_len) == APP_OK) &&
+         (calc_vault_encode(loaded, &reencoded, &reencoded_len) == APP_OK) &&
+         (reencoded_len == image_len) && (memcmp(reencoded, image, image_len) == 0) &&
+         (loaded->entry_count == 3u) &&
+         vault_matches(loaded, "KEY1", CALC_VAULT_KEYPAIR, keys[0], payloads[0], 80u) &&
+         vault_matches(loaded, "BOB", CALC_VAULT_CONTACT, keys[1], payloads[1], 24u) &&
+         vault_matches(loaded, "NONCE001", CALC_VAULT_NONCE_ACCOUNT, keys[2], payloads[2], 0u);
+    failures += report("vault encode/decode round trip", ok);
+
+    ok = (calc_vault_save(session, saved) == APP_OK) && (calc_vault_load(session, loaded) == APP_OK) &&
+         (loaded->entry_count == 3u) &&
+         vault_matches(loaded, "KEY1", CALC_VAULT_KEYPAIR, keys[0], payloads[0], 80u) &&
+         vault_matches(loaded, "BOB", CALC_VAULT_CONTACT, keys[1], payloads[1], 24u) &&
+         vault_matches(loaded, "NONCE001", CALC_VAULT_NONCE_ACCOUNT, keys[2], payloads[2], 0u);
+    failures += report("vault save/load over the link", ok);
+
+    /* A shorter payload reuses the slot and wipes the slack behind it. */
+    data_len = saved->data_len;
+    offset = saved->entries[0].offset;
+    ok = (calc_vault_put(saved, CALC_VAULT_KEYPAIR, "KEY1", keys[0], payloads[1], 40u) == APP_OK) &&
+         (saved->data_len == data_len) && (saved->entries[0].offset == offset) &&
+         (saved->entries[0].capacity == 80u) && (saved->entries[0].length == 40u) &&
+         (saved->data[offset + 40u] == 0u) && (saved->data[offset + 79u] == 0u) &&
+         (calc_vault_save(session, saved) == APP_OK) && (calc_vault_load(session, loaded) == APP_OK) &&
+         vault_matches(loaded, "KEY1", CALC_VAULT_KEYPAIR, keys[0], payloads[1], 40u) &&
+         vault_matches(loaded, "BOB", CALC_VAULT_CONTACT, keys[1], payloads[1], 24u);
+    failures += report("vault overwrite in place", ok);
+
+    /* A longer one moves to the end and wipes the old slot. */
+    ok = (calc_vault_put(saved, CALC_VAULT_CONTACT, "BOB", keys[1], payloads[2], 64u) == APP_OK) &&
+         (saved->entries[1].offset == data_len) && (saved->data_len == data_len + 64u) &&
+         (saved->data[80u] == 0u) && (saved->data[80u + 23u] == 0u) &&
+         (calc_vault_save(session, saved) == APP_OK) && (calc_vault_load(session, loaded) == APP_OK) &&
+         vault_matches(loaded, "BOB", CALC_VAULT_CONTACT, keys[1], payloads[2], 64u) &&
+         vault_matches(loaded, "KEY1", CALC_VAULT_KEYPAIR, keys[0], payloads[1], 40u);
+    failures += report("vault overwrite that outgrows its slot", ok);
+
+    free(image);
+    free(reencoded);
+    calc_vault_free(saved);
+    calc_vault_free(loaded);
+    free(saved);
+    free(loaded);
+
+    return failures;
+}
+
+/* A put that only fits once the space of a removed entry is reclaimed. */
+static int test_vault_compaction(void)
+{
+    CalcVault *vault = (CalcVault *)calloc(1u, sizeof(*vault));
+    size_t large = (CALC_VAULT_MAX_SIZE - SIM_TEST_VAULT_HEADER_LEN - 3u * SIM_TEST_VAULT_RECORD_LEN) / 2u;
+    uint8_t *payloads[3] = { NULL, NULL, NULL };
+    uint8_t key[WALLET_PUBLIC_KEY_LEN];
+    size_t output_len = 0u;
+    int ok = 0;
+
+    for (int i = 0; i < 3; i++)
+    {
+        payloads[i] = (uint8_t *)malloc(large);
+        if (payloads[i] != NULL)
+        {
+            fill_payload(payloads[i], large, (uint8_t)(0x90u + i));
+        }
+    }
+
+    if ((vault != NULL) && (payloads[0] != NULL) && (payloads[1] != NULL) && (payloads[2] != NULL))
+    {
+        calc_vault_init(vault);
+        memset(key, 0x5c, sizeof(key));
+        ok = (calc_vault_put(vault, CALC_VAULT_CONTACT, "A", key, payloads[0], large) == APP_OK) &&
+             (calc_vault_put(vault, CALC_VAULT_CONTACT, "B", key, payloads[1], large) == APP_OK) &&
+             (calc_vault_put(vault, CALC_VAULT_CONTACT, "C", key, payloads[2], 16u) != APP_OK) &&
+             (vault->entry_count == 2u) &&
+             (calc_vault_remove(vault, "A") == APP_OK) && (vault->data_len == 2u * large) &&
+             (calc_vault_put(vault, CALC_VAULT_CONTACT, "C", key, payloads[2], large) == APP_OK) &&
+             (vault->entry_count == 2u) && (vault->data_len == 2u * large) &&
+             (vault->entries[0].offset == 0u) && (vault->entries[1].offset == large) &&
+             (calc_vault_get(vault, calc_vault_find(vault, "B"), payloads[0], large, &output_len) == APP_OK) &&
+             (output_len == large) && (memcmp(payloads[0], payloads[1], large) == 0) &&
+             (calc_vault_get(vault, calc_vault_find(vault, "C"), payloads[0], large, &output_len) == APP_OK) &&
+             (output_len == large) && (memcmp(payloads[0], payloads[2], large) == 0);
+        calc_vault_free(vault);
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        free(payloads[i]);
+    }
+    free(vault);
+
+    return report("vault compaction reclaims removed space", ok);
+}
+
+/* Images that claim more than they hold must be refused and leave the vault empty. */
+static int test_vault_decode_bounds(void)
+{
+    CalcVault *vault = (CalcVault *)calloc(1u, sizeof(*vault));
+    uint8_t key[WALLET_PUBLIC_KEY_LEN];
+    uint8_t payload[32];
+    uint8_t *image = NULL;
+    uint8_t *record = NULL;
+    size_t image_len = 0u;
+    size_t data_len = 0u;
+    int failures = 0;
+    int ok;
+
+    if (vault == NULL)
+    {
+        return report("vault allocate", 0);
+    }
+
+    calc_vault_init(vault);
+    memset(key, 0x3c, sizeof(key));
+    fill_payload(payload, sizeof(payload), 0x21u);
+    if ((calc_vault_put(vault, CALC_VAULT_KEYPAIR, "KEY1", key, payload, sizeof(payload)) != APP_OK) ||
+        (calc_vault_put(vault, CALC_VAULT_CONTACT, "BOB", key, payload, 8u) != APP_OK) ||
+        (calc_vault_encode(vault, &image, &image_len) != APP_OK))
+    {
+        calc_vault_free(vault);
+        free(vault);
+        return report("vault encode", 0);
+    }
+    data_len = vault->data_len;
+    record = image + SIM_TEST_VAULT_HEADER_LEN + SIM_TEST_VAULT_RECORD_LEN;
+
+    /* Second record: offset + capacity one past the data area. */
+    record[SIM_TEST_VAULT_RECORD_LEN - 2u] = (uint8_t)(data_len - record[SIM_TEST_VAULT_RECORD_LEN - 6u] + 1u);
+    ok = (calc_vault_decode(vault, image, image_len) != APP_OK) && (vault->entry_count == 0u) && (vault->data == NULL);
+    record[SIM_TEST_VAULT_RECORD_LEN - 2u] = 8u;
+    ok &= (calc_vault_decode(vault, image, image_len) == APP_OK) && (vault->entry_count == 2u);
+    failures += report("vault decode rejects offset + capacity > data", ok);
+
+    ok = (calc_vault_decode(vault, image, SIM_TEST_VAULT_HEADER_LEN + SIM_TEST_VAULT_RECORD_LEN + 10u) != APP_OK) &&
+         (calc_vault_decode(vault, image, image_len - 1u) != APP_OK) &&
+         (calc_vault_decode(vault, image, SIM_TEST_VAULT_HEADER_LEN - 1u) != APP_OK) &&
+         (vault->entry_count == 0u);
+    failures += report("vault decode rejects a truncated image", ok);
+
+    image[1] = 'X';
+    ok = (calc_vault_decode(vault, image, image_len) != APP_OK);
+    image[1] = 'W';
+    image[3] = CALC_VAULT_VERSION + 1u;
+    ok &= (calc_vault_decode(vault, image, image_len) != APP_OK) && (vault->entry_count == 0u);
+    failures += report("vault decode rejects bad magic and version", ok);
+
+    free(image);
+    calc_vault_free(vault);
+    free(vault);
+
+    return failures;
+}
+
+/*
+ * A pool over three simulated units, each with its own variable store:
+ * pinned stores and fetches stay on their unit, unpinned stores spread, and
+ * signing with a wrong password fails once, without a retry, and is counted
+ * as failed rather than completed.
+ */
+static int test_pool(void)
+{
+    CalcPool *pool = (CalcPool *)calloc(1u, sizeof(*pool));
+    CalcJob jobs[SIM_TEST_POOL_DEVICES];
+    CalcJob spread[2 * SIM_TEST_POOL_DEVICES];
+    CalcJob sign_ok;
+    CalcJob sign_bad;
+    uint8_t payloads[SIM_TEST_POOL_DEVICES][SIM_TEST_PAYLOAD_LEN];
+    uint8_t outputs[SIM_TEST_POOL_DEVICES][SIM_TEST_PAYLOAD_LEN];
+    uint8_t key_payload[WALLET_PUBLIC_KEY_LEN + WALLET_BLOB_LEN];
+    uint8_t seed[WALLET_SEED_LEN];
+    uint8_t private_key[WALLET_PRIVATE_KEY_LEN];
+    static const uint8_t message[] = "pool signing test";
+    WalletKdfParams kdf = { WALLET_KDF_PBKDF2_SHA512, 1000u, 0u, 0u };
+    unsigned long completed = 0u;
+    unsigned long failed = 0u;
+    int failures = 0;
+    int ok;
+
+    if ((pool == NULL) || (calc_pool_open(pool, SIM_TEST_POOL_DEVICES) != APP_OK))
+    {
+        free(pool);
+        return report("pool open", 0);
+    }
+    failures += report("pool open", pool->worker_count == SIM_TEST_POOL_DEVICES);
+
+    /* Different bytes in Str1 of every unit, read back from the same unit. */
+    memset(jobs, 0, sizeof(jobs));
+    ok = 1;
+    for (int i = 0; i < SIM_TEST_POOL_DEVICES; i++)
+    {
+        fill_payload(payloads[i], sizeof(payloads[i]), (uint8_t)(0x30u + i));
+        jobs[i].type = CALC_JOB_STORE;
+        jobs[i].device = i;
+        strcpy(jobs[i].var_name, "Str1");
+        jobs[i].payload = payloads[i];
+        jobs[i].payload_len = sizeof(payloads[i]);
+        ok &= (calc_pool_submit(pool, &jobs[i]) == APP_OK);
+    }
+    calc_pool_wait(pool);
+    for (int i = 0; i < SIM_TEST_POOL_DEVICES; i++)
+    {
+        ok &= (jobs[i].status == APP_OK) && (jobs[i].executed_on == i);
+        memset(&jobs[i], 0, sizeof(jobs[i]));
+        jobs[i].type = CALC_JOB_FETCH;
+        jobs[i].device = i;
+        strcpy(jobs[i].var_name, "Str1");
+        jobs[i].out_data = outputs[i];
+        jobs[i].out_size = sizeof(outputs[i]);
+        ok &= (calc_pool_submit(pool, &jobs[i]) == APP_OK);
+    }
+    calc_pool_wait(pool);
+    for (int i = 0; i < SIM_TEST_POOL_DEVICES; i++)
+    {
+        ok &= (jobs[i].status == APP_OK) && (jobs[i].out_len == sizeof(payloads[i])) &&
+              (memcmp(outputs[i], payloads[i], sizeof(payloads[i])) == 0);
+    }
+    failures += report("pool pinned store and fetch per unit", ok);
+
+    memset(spread, 0, sizeof(spread));
+    ok = 1;
+    for (size_t i = 0u; i < sizeof(spread) / sizeof(spread[0]); i++)
+    {
+        spread[i].type = CALC_JOB_STORE;
+        spread[i].device = CALC_POOL_ANY_DEVICE;
+        strcpy(spread[i].var_name, "Str2");
+        spread[i].payload = payloads[0];
+        spread[i].payload_len = 40u;
+        ok &= (calc_pool_submit(pool, &spread[i]) == APP_OK);
+    }
+    calc_pool_wait(pool);
+    for (size_t i = 0u; i < sizeof(spread) / sizeof(spread[0]); i++)
+    {
+        ok &= (spread[i].status == APP_OK) && (spread[i].executed_on >= 0) &&
+              (spread[i].executed_on < SIM_TEST_POOL_DEVICES);
+    }
+    failures += report("pool unpinned stores", ok);
+
+    /* An encrypted keypair on unit 1, signed with the right and a wrong password. */
+    memset(seed, 0x42, sizeof(seed));
+    ed25519_create_keypair(key_payload, private_key, seed);
+    ok = (wallet_encrypt_private_key_kdf(SIM_TEST_PASSWORD, &kdf, private_key, sizeof(private_key),
+                                         key_payload + WALLET_PUBLIC_KEY_LEN, WALLET_BLOB_LEN) == APP_OK);
+    memset(&jobs[0], 0, sizeof(jobs[0]));
+    jobs[0].type = CALC_JOB_STORE;
+    jobs[0].device = 1;
+    strcpy(jobs[0].var_name, "Str3");
+    jobs[0].payload = key_payload;
+    jobs[0].payload_len = sizeof(key_payload);
+    ok &= (calc_pool_submit(pool, &jobs[0]) == APP_OK);
+    calc_pool_wait(pool);
+    ok &= (jobs[0].status == APP_OK);
+
+    for (int i = 0; i < SIM_TEST_POOL_DEVICES; i++)
+    {
+        completed += pool->workers[i].completed;
+        failed += pool->workers[i].failed;
+    }
+
+    memset(&sign_ok, 0, sizeof(sign_ok));
+    sign_ok.type = CALC_JOB_SIGN;
+    sign_ok.device = 1;
+    strcpy(sign_ok.var_name, "Str3");
+    sign_ok.password = SIM_TEST_PASSWORD;
+    sign_ok.message = message;
+    sign_ok.message_len = sizeof(message);
+    sign_bad = sign_ok;
+    sign_bad.password = "wrong horse";
+    ok &= (calc_pool_submit(pool, &sign_ok) == APP_OK) && (calc_pool_submit(pool, &sign_bad) == APP_OK);
+    calc_pool_wait(pool);
+
+    ok &= (sign_ok.status == APP_OK) && (memcmp(sign_ok.public_key, key_payload, WALLET_PUBLIC_KEY_LEN) == 0) &&
+          (ed25519_verify(sign_ok.signature, message, sizeof(message), key_payload) == 1);
+    failures += report("pool sign job", ok);
+
+    ok = (sign_bad.status == APP_ERR_CRYPTO) && (sign_bad.attempts == 1) &&
+         (pool->workers[1].online != 0) &&
+         (pool->workers[0].completed + pool->workers[1].completed + pool->workers[2].completed == completed + 1u) &&
+         (pool->workers[0].failed + pool->workers[1].failed + pool->workers[2].failed == failed + 1u);
+    failures += report("pool wrong password counts as failed", ok);
+
+    calc_pool_close(pool);
+    free(pool);
+    wallet_secure_zero(private_key, sizeof(private_key));
+
+    return failures;
+}
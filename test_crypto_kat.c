@@ -0,0 +1,771 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ed25519.h"
+#include "wallet_aead.h"
+#include "wallet_argon2.h"
+#include "wallet_crypto.h"
+#include "wallet_hd.h"
+#include "wallet_verify.h"
+
+/*
+ * Known-answer tests for the wallet crypto. Every case compares against
+ * published vectors or output from an independent implementation, so a
+ * change that alters the bytes the wallet format depends on fails here
+ * rather than in a user's unlock. Prints one line per case and exits
+ * non-zero if any fails.
+ */
+#define KAT_MAX_OUTPUT 1024u
+
+typedef struct
+{
+    const char *password;
+    size_t password_len;
+    const char *salt;
+    size_t salt_len;
+    uint32_t iterations;
+    size_t output_len;
+    const char *expected_hex;
+} KatPbkdf2Vector;
+
+/*
+ * The first two are the usual PBKDF2-HMAC-SHA512 vectors; the longer outputs
+ * are from OpenSSL (Python hashlib.pbkdf2_hmac). 653 bytes is eleven blocks,
+ * more than the eight lanes, with a partial last block.
+ */
+static const KatPbkdf2Vector kat_pbkdf2_vectors[] = {
+    { "password", 8u, "salt", 4u, 1u, 64u,
+      "867f70cf1ade02cff3752599a3a53dc4af34c7a669815ae5d513554e1c8cf252"
+      "c02d470a285a0501bad999bfe943c08f050235d7d68b1da55e63f73b60a57fce" },
+    { "password", 8u, "salt", 4u, 4096u, 64u,
+      "d197b1b33db0143e018b12f3d1d1479e6cdebdcc97c5c0f87f6902e072f457b5"
+      "143f30602641b3d55cd335988cb36b84376060ecd532e039b742a239434af2d5" },
+    { "password", 8u, "salt", 4u, 1u, 200u,
+      "867f70cf1ade02cff3752599a3a53dc4af34c7a669815ae5d513554e1c8cf252"
+      "c02d470a285a0501bad999bfe943c08f050235d7d68b1da55e63f73b60a57fce"
+      "7b532e206c2967d4c7d2ffa460539fc4d4e5eec70125d74c6c7cf86d25284f29"
+      "7907fcea1ad214effdbea23e1312084eabb180ab72edbac45ea2a53f5f5b9fe1"
+      "ec722ddabc96fa0d0bad974b1a0f706d9a7f08ec7f7968048469466e29ccb462"
+      "8e314a11fd50f4ccec7970c13e940c0ddc97004a2cd0dcf1a41a26380c2dac96"
+      "6aa077a8bad210ba" },
+    { "pass\0word", 9u, "sa\0lt", 5u, 1000u, 130u,
+      "c50f36d34df3c2310621ce3b3815bb63af64415840884f3902e1566a4486e598"
+      "11df5459af650b62035052e6eb80d08f37c8a0a40ad8e9a0116e9522eacb08f3"
+      "1ca1ce501149ee819329c731015a710c3f9dd4ba689c2af930fb55111744dac5"
+      "751c8501739ec034871a51bc12ed30919e0ee6e8484e5c52bcd1b3509be8d46d"
+      "08b0" },
+    { "passwordPASSWORDpassword", 24u, "saltSALTsaltSALT", 16u, 4096u, 653u,
+      "0697a650f36d9436cce4b2da03b8425695b5e85a0886ea5cd8c001f0ad05bea9"
+      "6f8f379da22de48858a63c7ba442d79757b9d5864316dc281408c4db18502f6d"
+      "3e414ef1889e9319d51fbe17ebc1d047fc0ad6c0c7252583dac0ac0753a890eb"
+      "e198d4d02ede1a43a86ce07488b9967048215c5f245e504e1d2eabfa54aa30f3"
+      "c941b4786661b6e6bf5b9795a7af9d35d5a7954c5103fdc51fc4174e75e44003"
+      "8ec5efb2cb42fae036143fdc38493d420fda493b00c86f5c5b89e091f9ba41d8"
+      "a61db225f7b39c2f07672d96a265029a2ac0db8228d63076bcd2f57da4c29227"
+      "ad56069e6fbabd22ab49ea4836c6d62ca16cb9e76936a1dc1f6c8aeb03f648e4"
+      "43c02f00a90b46a6b8a49004d2d9475ec146fab8be9ea6b8e8b76b9d5ebe8288"
+      "b5cb867e66e763d41c7ee7266c9b2c5ae86a39c33ef39f9f3108bc3d56bcd0cd"
+      "71bf75b2f57459c6d0b11fb804fe63ced935453606cfc850d375fa590abe4338"
+      "37d2dcfdaecb14bf1f2a6a869ff2c60247f957a9c92125cbadd334a9ac2df6d2"
+      "591da16b14793067052d872889a51db5efb32f5858b400f4c5e46b2d693bd6ac"
+      "0063f88bf784976f69bfc7083ab16fb5777f62acf08de01110a08e9cef073e0a"
+      "53da3420e94b48e9975ccc8d462eae8b9976421ae987784cce1a21c468384290"
+      "16a74b2668db10b32881bf7a97cbdfc020ee65685c7741dc92e1c70b16f25dc7"
+      "99f1ec7bd54682ff9314d2de84a4a741923e64df1474922909c80f47a7244bfc"
+      "6bc4a251dd3ab905d3f9fa4690a796d0b8912bb469c05657becd4b578ac1dae5"
+      "ddee519749b145f0223027657ff123e3bcd0760957267c323c2e6c5d628f693a"
+      "e6566953f4935f746abc912513899f8d87e79be3f4055ada5e20532dae4b5192"
+      "6674d4350ba8b1af792a6362ac" },
+};
+
+typedef struct
+{
+    uint32_t passes;
+    uint32_t memory_kib;
+    uint32_t lanes;
+    const char *password;
+    const char *salt;
+    const char *expected_hex;
+} KatArgon2Vector;
+
+/* Argon2id v0x13 from the PHC reference implementation's src/test.c (no secret, no associated data). */
+static const KatArgon2Vector kat_argon2_vectors[] = {
+    { 2u, 1u << 16, 1u, "password", "somesalt", "09316115d5cf24ed5a15a31a3ba326e5cf32edc24702987c02b6566f61913cf7" },
+    { 2u, 1u << 8, 1u, "password", "somesalt", "9dfeb910e80bad0311fee20f9c0e2b12c17987b4cac90c2ef54d5b3021c68bfe" },
+    { 2u, 1u << 8, 2u, "password", "somesalt", "6d093c501fd5999645e0ea3bf620d7b8be7fd2db59c20d9fff9539da2bf57037" },
+    { 1u, 1u << 16, 1u, "password", "somesalt", "f6a5adc1ba723dddef9b5ac1d464e180fcd9dffc9d1cbf76cca2fed795d9ca98" },
+    { 4u, 1u << 16, 1u, "password", "somesalt", "9025d48e68ef7395cca9079da4c4ec3affb3c8911fe4f86d1a2520856f63172c" },
+    { 2u, 1u << 16, 1u, "differentpassword", "somesalt", "0b84d652cf6b0c4beaef0dfe278ba6a80df6696281d7e0d2891b817d8c458fde" },
+    { 2u, 1u << 16, 1u, "password", "diffsalt", "bdf32b05ccc42eb15d58fd19b1f856b113da1e9a5874fdcc544308565aa8141c" },
+};
+
+/*
+ * v2 blobs written by this tree for KAT_BLOB_PASSWORD over the 64-byte key
+ * k[i] = 7i + 1: PBKDF2 at 1000 iterations, then Argon2id with 64 KiB, two
+ * passes and one lane. They must keep decrypting whatever the code turns into.
+ */
+#define KAT_BLOB_PASSWORD "correct horse"
+
+static const char *const kat_blob_v2_fixtures[] = {
+    "0201000003e80000007dfcbbb9148026a0a5eff204237321d2815edf02637d4e9f7f4626eb95603f682b7a5b6fc6a40b"
+    "451811add8aedb95099e9d1a4d622d93bf6863eb86b4821063e27ee1d5a9d27eab0bcf24d466c652b294a6516cef25a6"
+    "32b530a486163f1651039cb457dfd82c31960407d5779904e2bc72b2fd434dc3c4b224898a",
+    "02020000004000020122c5989b74986b8dcec731a4d3f045cb81807fcd94ff42eb2b4e09d159e4a758ff2189a13cc221"
+    "43c5d79ba0a0387b336d5518c591282bb857331a0fce84765f3be8cf9f9f7bf4dce08cf068decf8ccf9a551072625118"
+    "20441a74d447557e518b99ede2e0c48d4ee0fbce4df2de7f64005c215d1c8d72468c9627af",
+};
+
+/*
+ * A v1 blob (fixed 200000 PBKDF2 iterations, no KDF header) for the same
+ * password and key, with salt 10..1f and nonce 20..2b, written by an
+ * independent implementation of the format.
+ */
+static const char kat_blob_v1_fixture[] =
+    "01101112131415161718191a1b1c1d1e1f202122232425262728292a2b9f3f30334d8fe0f60889c330c507115b4d4e79"
+    "8a692472ee0fecfde7861cd22970c2e9ebda7afc50119b92d76a5f54eb4a845adf34a2aa33112ae29094c78f1efb3296"
+    "ccc7d2424f71dc291c362ade68d12a7118c3d8226c8d36e856b0f2a1e9";
+
+/* RFC 8439 section 2.8.2 */
+static const char kat_aead_plaintext[] =
+    "Ladies and Gentlemen of the class of '99: If I could offer you only one tip for the future, sunscreen would be it.";
+static const char kat_aead_key_hex[] = "808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f";
+static const char kat_aead_nonce_hex[] = "070000004041424344454647";
+static const char kat_aead_ad_hex[] = "50515253c0c1c2c3c4c5c6c7";
+static const char kat_aead_ciphertext_hex[] =
+    "d31a8d34648e60db7b86afbc53ef7ec2a4aded51296e08fea9e2b5a736ee62d63dbea45e8ca9671282fafb69da92728b"
+    "1a71de0a9e060b2905d6a5b67ecd3b3692ddbd7f2d778b8c9803aee328091b58fab324e4fad675945585808b4831d7bc"
+    "3ff4def08e4b7a9de576d26586cec64b6116";
+static const char kat_aead_tag_hex[] = "1ae10b594f09e26a7e902ecbd0600691";
+
+/* SLIP-0010 ed25519 test vector 1: the private key at each depth of m/0'/1'/2'/2'/1000000000'. */
+static const char kat_hd_seed_hex[] = "000102030405060708090a0b0c0d0e0f";
+static const char kat_hd_path[] = "m/0'/1'/2'/2'/1000000000'";
+static const char *const kat_hd_keys_hex[] = {
+    "68e0fe46dfb67e368c75379acec591dad19df3cde26e63b93a8e704f1dade7a3",
+    "b1d0bad404bf35da785a64ca1ac54b2617211d2777696fbffaf208f746ae84f2",
+    "92a5b23c0b8a99e37d07df3fb9966917f5d06e02ddbd909c7e184371463e9fc9",
+    "30d1dc7e5fc04c31219ab25a27ae00b50f6fd66622f6e9c913253d6511d1e662",
+    "8f94d394a8e8fd6b1bc2f3f49f5c47e385281d5c17e65324b0f62483e37e8793",
+};
+static const char kat_hd_leaf_public_hex[] = "3c24da049451555d51a7014a37337aa4e12d41e485abccfa46b47dfb2af54b7a";
+
+#define KAT_SIGNER_KEYS 2000u
+#define KAT_SIGNER_MESSAGE_MAX 300u
+
+/* Either side of the ED25519_KEYPAIR_BATCH chunk, and several chunks. */
+static const size_t kat_batch_sizes[] = { 1u, 127u, 128u, 129u, 1000u };
+
+/* Enough keys, visited round-robin, that every first check of a key is a cache miss. */
+#define KAT_VERIFY_KEYS (3u * WALLET_VERIFY_CACHE_ENTRIES)
+#define KAT_VERIFY_ROUNDS 3u
+
+/* The group order l, little endian. */
+static const uint8_t kat_group_order[32] = {
+    0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10
+};
+
+static size_t hex_decode(const char *hex, uint8_t *out, size_t out_len);
+static int report(const char *name, int ok);
+static int all_zero(const uint8_t *data, size_t len);
+static int test_pbkdf2(void);
+static int test_argon2id(void);
+static int test_blob_v1(void);
+static int test_blob_v2(void);
+static int test_blob_cost_ceiling(void);
+static int test_aead(void);
+static int test_hd(void);
+static int test_signer(void);
+static int test_keypair_batch(void);
+static int verify_agrees(const uint8_t *signature, const uint8_t *message, size_t message_len,
+                         const uint8_t *public_key, int expected);
+static int test_wallet_verify(void);
+
+int main(void)
+{
+    int failures = 0;
+
+    failures += test_pbkdf2();
+    failures += test_argon2id();
+    failures += test_blob_v1();
+    failures += test_blob_v2();
+    failures += test_blob_cost_ceiling();
+    failures += test_aead();
+    failures += test_hd();
+    failures += test_signer();
+    failures += test_keypair_batch();
+    failures += test_wallet_verify();
+
+    if (failures != 0)
+    {
+        printf("%d known-answer test(s) failed\n", failures);
+        return EXIT_FAILURE;
+    }
+
+    printf("All known-answer tests passed\n");
+    return EXIT_SUCCESS;
+}
+
+static size_t hex_decode(const char *hex, uint8_t *out, size_t out_len)
+{
+    size_t len = strlen(hex) / 2u;
+
+    if (len > out_len)
+    {
+        return 0u;
+    }
+
+    for (size_t i = 0u; i < len; i++)
+    {
+        unsigned int byte = 0u;
+
+        if (sscanf(hex + 2u * i, "%2x", &byte) != 1)
+        {
+            return 0u;
+        }
+        out[i] = (uint8_t)byte;
+    }
+
+    return len;
+}
+
+static int report(const char *name, int ok)
+{
+    printf("%-48s %s\n", name, ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+static int all_zero(const uint8_t *data, size_t len)
+{
+    uint8_t bits = 0u;
+
+    for (size_t i = 0u; i < len; i++)
+    {
+        bits |= data[i];
+    }
+
+    return bits == 0u;
+}
+
+/* Each vector with lanes off (one thread) and on (the default eight). */
+static int test_pbkdf2(void)
+{
+    static const unsigned int lane_settings[] = { 1u, 0u };
+    int failures = 0;
+
+    for (size_t index = 0u; index < sizeof(kat_pbkdf2_vectors) / sizeof(kat_pbkdf2_vectors[0]); index++)
+    {
+        const KatPbkdf2Vector *vector = &kat_pbkdf2_vectors[index];
+        uint8_t expected[KAT_MAX_OUTPUT];
+        size_t expected_len = hex_decode(vector->expected_hex, expected, sizeof(expected));
+
+        for (size_t setting = 0u; setting < sizeof(lane_settings) / sizeof(lane_settings[0]); setting++)
+        {
+            uint8_t output[KAT_MAX_OUTPUT];
+            char name[64];
+            int ok;
+
+            memset(output, 0, sizeof(output));
+            ok = (expected_len == vector->output_len) &&
+                 (wallet_pbkdf2_hmac_sha512((const uint8_t *)vector->password, vector->password_len,
+                                            (const uint8_t *)vector->salt, vector->salt_len,
+                                            vector->iterations, output, vector->output_len,
+                                            lane_settings[setting]) == APP_OK) &&
+                 (memcmp(output, expected, expected_len) == 0);
+
+            snprintf(name, sizeof(name), "pbkdf2-hmac-sha512 #%zu (%zu bytes, %s)",
+                     index + 1u, vector->output_len, (lane_settings[setting] == 1u) ? "serial" : "lanes");
+            failures += report(name, ok);
+        }
+    }
+
+    return failures;
+}
+
+static int test_argon2id(void)
+{
+    int failures = 0;
+
+    for (size_t index = 0u; index < sizeof(kat_argon2_vectors) / sizeof(kat_argon2_vectors[0]); index++)
+    {
+        const KatArgon2Vector *vector = &kat_argon2_vectors[index];
+        uint8_t expected[32];
+        uint8_t output[32];
+        char name[64];
+        int ok;
+
+        ok = (hex_decode(vector->expected_hex, expected, sizeof(expected)) == sizeof(expected)) &&
+             (wallet_argon2id((const uint8_t *)vector->password, strlen(vector->password),
+                              (const uint8_t *)vector->salt, strlen(vector->salt),
+                              vector->passes, vector->memory_kib, vector->lanes,
+                              output, sizeof(output)) == APP_OK) &&
+             (memcmp(output, expected, sizeof(expected)) == 0);
+
+        snprintf(name, sizeof(name), "argon2id t=%u m=%u p=%u %s/%s",
+                 (unsigned int)vector->passes, (unsigned int)vector->memory_kib, (unsigned int)vector->lanes,
+                 vector->password, vector->salt);
+        failures += report(name, ok);
+    }
+
+    return failures;
+}
+
+/* Fixtures decrypt; fresh blobs round-trip their header; any header, ciphertext or MAC edit fails. */
+static int test_blob_v1(void)
+{
+    uint8_t blob[WALLET_BLOB_V1_LEN];
+    uint8_t key[WALLET_PRIVATE_KEY_LEN];
+    uint8_t output[WALLET_PRIVATE_KEY_LEN];
+    WalletKdfParams params;
+    int failures = 0;
+    int ok;
+
+    for (size_t i = 0u; i < sizeof(key); i++)
+    {
+        key[i] = (uint8_t)(7u * i + 1u);
+    }
+
+    memset(&params, 0, sizeof(params));
+    ok = (hex_decode(kat_blob_v1_fixture, blob, sizeof(blob)) == sizeof(blob)) &&
+         (wallet_blob_length(blob, sizeof(blob)) == WALLET_BLOB_V1_LEN) &&
+         (wallet_blob_kdf_params(blob, sizeof(blob), &params) == APP_OK) &&
+         (params.id == WALLET_KDF_PBKDF2_SHA512) && (params.cost == WALLET_KDF_PBKDF2_DEFAULT_ITERATIONS) &&
+         (wallet_decrypt_private_key(KAT_BLOB_PASSWORD, blob, sizeof(blob), output, sizeof(output)) == APP_OK) &&
+         (memcmp(output, key, sizeof(key)) == 0);
+    failures += report("blob v1 fixture", ok);
+
+    blob[WALLET_BLOB_V1_LEN - 1u] ^= 0x01u;
+    ok = (wallet_decrypt_private_key(KAT_BLOB_PASSWORD, blob, sizeof(blob), output, sizeof(output)) != APP_OK) &&
+         all_zero(output, sizeof(output));
+    failures += report("blob v1 rejects a MAC edit", ok);
+
+    return failures;
+}
+
+static int test_blob_v2(void)
+{
+    static const WalletKdfParams params[] = {
+        { WALLET_KDF_PBKDF2_SHA512, 1000u, 0u, 0u },
+        { WALLET_KDF_ARGON2ID, 64u, 2u, 1u },
+    };
+    /* Cost bytes 1-3 are left alone: raising them is valid but makes the KDF run for minutes. */
+    static const size_t tamper_offsets[] = { 0u, 1u, 5u, 6u, 7u, 8u, 9u + WALLET_SALT_LEN, WALLET_BLOB_LEN - 1u };
+    uint8_t key[WALLET_PRIVATE_KEY_LEN];
+    int failures = 0;
+
+    for (size_t i = 0u; i < sizeof(key); i++)
+    {
+        key[i] = (uint8_t)(7u * i + 1u);
+    }
+
+    for (size_t index = 0u; index < sizeof(params) / sizeof(params[0]); index++)
+    {
+        const char *kdf_name = (params[index].id == WALLET_KDF_ARGON2ID) ? "argon2id" : "pbkdf2";
+        uint8_t blob[WALLET_BLOB_LEN];
+        uint8_t output[WALLET_PRIVATE_KEY_LEN];
+        WalletKdfParams read_back;
+        char name[64];
+        int ok;
+
+        ok = (hex_decode(kat_blob_v2_fixtures[index], blob, sizeof(blob)) == sizeof(blob)) &&
+             (wallet_decrypt_private_key(KAT_BLOB_PASSWORD, blob, sizeof(blob), output, sizeof(output)) == APP_OK) &&
+             (memcmp(output, key, sizeof(key)) == 0);
+        snprintf(name, sizeof(name), "blob v2 fixture (%s)", kdf_name);
+        failures += report(name, ok);
+
+        memset(&read_back, 0, sizeof(read_back));
+        ok = (wallet_encrypt_private_key_kdf(KAT_BLOB_PASSWORD, &params[index], key, sizeof(key), blob, sizeof(blob)) == APP_OK) &&
+             (blob[0] == WALLET_BLOB_VERSION) &&
+             (wallet_blob_length(blob, sizeof(blob)) == WALLET_BLOB_LEN) &&
+             (wallet_blob_kdf_params(blob, sizeof(blob), &read_back) == APP_OK) &&
+             (read_back.id == params[index].id) && (read_back.cost == params[index].cost) &&
+             (read_back.passes == params[index].passes) && (read_back.lanes == params[index].lanes) &&
+             (wallet_decrypt_private_key(KAT_BLOB_PASSWORD, blob, sizeof(blob), output, sizeof(output)) == APP_OK) &&
+             (memcmp(output, key, sizeof(key)) == 0);
+        snprintf(name, sizeof(name), "blob v2 round trip (%s)", kdf_name);
+        failures += report(name, ok);
+
+        ok = (wallet_decrypt_private_key("correct horse!", blob, sizeof(blob), output, sizeof(output)) != APP_OK);
+        for (size_t t = 0u; t < sizeof(tamper_offsets) / sizeof(tamper_offsets[0]); t++)
+        {
+            blob[tamper_offsets[t]] ^= 0x01u;
+            ok &= (wallet_decrypt_private_key(KAT_BLOB_PASSWORD, blob, sizeof(blob), output, sizeof(output)) != APP_OK);
+            blob[tamper_offsets[t]] ^= 0x01u;
+        }
+        snprintf(name, sizeof(name), "blob v2 rejects edits (%s)", kdf_name);
+        failures += report(name, ok);
+    }
+
+    return failures;
+}
+
+static int test_aead(void)
+{
+    uint8_t key[WALLET_AEAD_KEY_LEN];
+    uint8_t nonce[WALLET_AEAD_NONCE_LEN];
+    uint8_t ad[12];
+    uint8_t expected[sizeof(kat_aead_plaintext) - 1u];
+    uint8_t expected_tag[WALLET_AEAD_TAG_LEN];
+    uint8_t buffer[sizeof(kat_aead_plaintext) - 1u];
+    uint8_t tag[WALLET_AEAD_TAG_LEN];
+    size_t length = sizeof(kat_aead_plaintext) - 1u;
+    int failures = 0;
+    int ok;
+
+    ok = (hex_decode(kat_aead_key_hex, key, sizeof(key)) == sizeof(key)) &&
+         (hex_decode(kat_aead_nonce_hex, nonce, sizeof(nonce)) == sizeof(nonce)) &&
+         (hex_decode(kat_aead_ad_hex, ad, sizeof(ad)) == sizeof(ad)) &&
+         (hex_decode(kat_aead_ciphertext_hex, expected, sizeof(expected)) == sizeof(expected)) &&
+         (hex_decode(kat_aead_tag_hex, expected_tag, sizeof(expected_tag)) == sizeof(expected_tag)) &&
+         (wallet_aead_encrypt(key, nonce, ad, sizeof(ad), (const uint8_t *)kat_aead_plaintext, length, buffer, tag) == APP_OK) &&
+         (memcmp(buffer, expected, length) == 0) &&
+         (memcmp(tag, expected_tag, sizeof(tag)) == 0);
+    failures += report("chacha20-poly1305 rfc8439 2.8.2 seal", ok);
+
+    ok = (wallet_aead_decrypt(key, nonce, ad, sizeof(ad), expected, length, expected_tag, buffer) == APP_OK) &&
+         (memcmp(buffer, kat_aead_plaintext, length) == 0);
+    failures += report("chacha20-poly1305 rfc8439 2.8.2 open", ok);
+
+    /* A flipped tag, ciphertext or AD bit fails and leaves no plaintext behind. */
+    memcpy(tag, expected_tag, sizeof(tag));
+    tag[0] ^= 0x01u;
+    ok = (wallet_aead_decrypt(key, nonce, ad, sizeof(ad), expected, length, tag, buffer) == APP_ERR_CRYPTO) &&
+         all_zero(buffer, length);
+    expected[length - 1u] ^= 0x80u;
+    ok &= (wallet_aead_decrypt(key, nonce, ad, sizeof(ad), expected, length, expected_tag, buffer) == APP_ERR_CRYPTO) &&
+          all_zero(buffer, length);
+    expected[length - 1u] ^= 0x80u;
+    ad[0] ^= 0x01u;
+    ok &= (wallet_aead_decrypt(key, nonce, ad, sizeof(ad), expected, length, expected_tag, buffer) == APP_ERR_CRYPTO) &&
+          all_zero(buffer, length);
+    failures += report("chacha20-poly1305 tag mismatch", ok);
+
+    return failures;
+}
+
+/*
+ * Every prefix of the vector path from a fresh context, then the same keys
+ * again once the context has cached the intermediate nodes, both deepest
+ * first (resumes from the cached parent) and shallowest first (cache hits).
+ */
+static int test_hd(void)
+{
+    static const char *const pass_names[] = { "fresh", "cached, deepest first", "cached, shallowest first" };
+    WalletHdContext ctx;
+    uint8_t seed[16];
+    uint32_t path[WALLET_HD_MAX_DEPTH];
+    size_t depth = 0u;
+    int failures = 0;
+
+    if ((hex_decode(kat_hd_seed_hex, seed, sizeof(seed)) != sizeof(seed)) ||
+        (wallet_hd_parse_path(kat_hd_path, path, WALLET_HD_MAX_DEPTH, &depth) != APP_OK) ||
+        (depth != sizeof(kat_hd_keys_hex) / sizeof(kat_hd_keys_hex[0])) ||
+        (wallet_hd_init(&ctx, seed, sizeof(seed)) != APP_OK))
+    {
+        return report("slip-0010 vector 1 setup", 0);
+    }
+
+    for (size_t pass = 0u; pass < sizeof(pass_names) / sizeof(pass_names[0]); pass++)
+    {
+        char name[64];
+        int ok = 1;
+
+        for (size_t step = 0u; step < depth; step++)
+        {
+            size_t prefix = (pass == 1u) ? depth - step : step + 1u;
+            uint8_t expected[WALLET_SEED_LEN];
+            uint8_t output[WALLET_SEED_LEN];
+
+            ok &= (hex_decode(kat_hd_keys_hex[prefix - 1u], expected, sizeof(expected)) == sizeof(expected)) &&
+                  (wallet_hd_derive(&ctx, path, prefix, output) == APP_OK) &&
+                  (memcmp(output, expected, sizeof(expected)) == 0);
+        }
+
+        snprintf(name, sizeof(name), "slip-0010 vector 1 (%s)", pass_names[pass]);
+        failures += report(name, ok);
+    }
+
+    {
+        uint8_t expected_public[WALLET_PUBLIC_KEY_LEN];
+        uint8_t public_key[WALLET_PUBLIC_KEY_LEN];
+        uint8_t private_key[WALLET_PRIVATE_KEY_LEN];
+        int ok;
+
+        ok = (hex_decode(kat_hd_leaf_public_hex, expected_public, sizeof(expected_public)) == sizeof(expected_public)) &&
+             (wallet_hd_derive_keypair(&ctx, path, depth, public_key, private_key) == APP_OK) &&
+             (memcmp(public_key, expected_public, sizeof(public_key)) == 0);
+        failures += report("slip-0010 vector 1 leaf keypair", ok);
+    }
+
+    wallet_hd_clear(&ctx);
+    return failures;
+}
+
+/*
+ * For KAT_SIGNER_KEYS deterministic seeds, one ed25519_signer signs three
+ * messages (empty, short, longer than a SHA-512 block) split into one, two
+ * and several segments, and each signature must equal ed25519_sign over the
+ * joined message and verify.
+ */
+static int test_signer(void)
+{
+    uint8_t message[KAT_SIGNER_MESSAGE_MAX];
+    uint64_t state = 0x243f6a8885a308d3ull;
+    int ok = 1;
+
+    for (uint32_t key_index = 0u; (key_index < KAT_SIGNER_KEYS) && (ok != 0); key_index++)
+    {
+        static const size_t lengths[] = { 0u, 41u, KAT_SIGNER_MESSAGE_MAX };
+        uint8_t seed[WALLET_SEED_LEN];
+        uint8_t public_key[WALLET_PUBLIC_KEY_LEN];
+        uint8_t private_key[WALLET_PRIVATE_KEY_LEN];
+        ed25519_signer signer;
+
+        for (size_t i = 0u; i < sizeof(seed); i++)
+        {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            seed[i] = (uint8_t)(state >> 56);
+        }
+        for (size_t i = 0u; i < sizeof(message); i++)
+        {
+            message[i] = (uint8_t)(key_index + 31u * i);
+        }
+
+        ed25519_create_keypair(public_key, private_key, seed);
+        ed25519_signer_init(&signer, public_key, private_key);
+
+        for (size_t m = 0u; m < sizeof(lengths) / sizeof(lengths[0]); m++)
+        {
+            size_t length = lengths[m];
+            size_t cut = (key_index * 7u) % (length + 1u);
+            ed25519_segment segments[4];
+            uint8_t expected[64];
+            uint8_t signature[64];
+
+            ed25519_sign(expected, message, length, public_key, private_key);
+            ok &= ed25519_verify(expected, message, length, public_key);
+
+            segments[0].data = message;
+            segments[0].len = length;
+            ed25519_signer_sign(&signer, signature, segments, 1u);
+            ok &= (memcmp(signature, expected, sizeof(signature)) == 0);
+
+            segments[0].len = cut;
+            segments[1].data = message + cut;
+            segments[1].len = length - cut;
+            ed25519_signer_sign(&signer, signature, segments, 2u);
+            ok &= (memcmp(signature, expected, sizeof(signature)) == 0);
+
+            segments[0].len = 0u;
+            segments[1].data = message;
+            segments[1].len = cut / 2u;
+            segments[2].data = message + cut / 2u;
+            segments[2].len = cut - cut / 2u;
+            segments[3].data = message + cut;
+            segments[3].len = length - cut;
+            ed25519_signer_sign(&signer, signature, segments, 4u);
+            ok &= (memcmp(signature, expected, sizeof(signature)) == 0);
+        }
+
+        ed25519_signer_wipe(&signer);
+    }
+
+    return report("ed25519 signer matches ed25519_sign (2000 keys)", ok);
+}
+
+/* Batched keygen must give the same keys as one ed25519_create_keypair per seed. */
+static int test_keypair_batch(void)
+{
+    int failures = 0;
+
+    for (size_t n = 0u; n < sizeof(kat_batch_sizes) / sizeof(kat_batch_sizes[0]); n++)
+    {
+        size_t count = kat_batch_sizes[n];
+        uint8_t *seeds = (uint8_t *)malloc(count * WALLET_SEED_LEN);
+        uint8_t *public_keys = (uint8_t *)malloc(count * WALLET_PUBLIC_KEY_LEN);
+        uint8_t *private_keys = (uint8_t *)malloc(count * WALLET_SEED_LEN);
+        uint64_t state = 0x13198a2e03707344ull + count;
+        char name[64];
+        int ok = (seeds != NULL) && (public_keys != NULL) && (private_keys != NULL);
+
+        if (ok != 0)
+        {
+            for (size_t i = 0u; i < count * WALLET_SEED_LEN; i++)
+            {
+                state = state * 6364136223846793005ull + 1442695040888963407ull;
+                seeds[i] = (uint8_t)(state >> 56);
+            }
+
+            memset(public_keys, 0, count * WALLET_PUBLIC_KEY_LEN);
+            ed25519_create_keypairs_batch(public_keys, private_keys, seeds, count);
+            ok = (memcmp(private_keys, seeds, count * WALLET_SEED_LEN) == 0);
+
+            for (size_t i = 0u; (i < count) && (ok != 0); i++)
+            {
+                uint8_t public_key[WALLET_PUBLIC_KEY_LEN];
+                uint8_t private_key[WALLET_PRIVATE_KEY_LEN];
+
+                ed25519_create_keypair(public_key, private_key, seeds + i * WALLET_SEED_LEN);
+                ok = (memcmp(public_keys + i * WALLET_PUBLIC_KEY_LEN, public_key, sizeof(public_key)) == 0);
+            }
+        }
+
+        (void)snprintf(name, sizeof(name), "ed25519 batch keygen matches single (%zu)", count);
+        failures += report(name, ok);
+        free(seeds);
+        free(public_keys);
+        free(private_keys);
+    }
+
+    return failures;
+}
+
+/* expected < 0 only asks wallet_verify and ed25519_verify to agree. */
+static int verify_agrees(const uint8_t *signature, const uint8_t *message, size_t message_len,
+                         const uint8_t *public_key, int expected)
+{
+    int reference = ed25519_verify(signature, message, message_len, public_key);
+    int cached = wallet_verify(signature, message, message_len, public_key);
+
+    return (cached == reference) && ((expected < 0) || (cached == expected));
+}
+
+/*
+ * wallet_verify against ed25519_verify over more keys than its cache holds,
+ * each checked several rounds so keys are evicted and decoded again: valid
+ * signatures, a tampered R, S, message and public key, another signer's key,
+ * and S + l, which both must treat alike.
+ */
+static int test_wallet_verify(void)
+{
+    static uint8_t public_keys[KAT_VERIFY_KEYS][WALLET_PUBLIC_KEY_LEN];
+    static uint8_t signatures[KAT_VERIFY_KEYS][64];
+    uint8_t message[64];
+    uint64_t state = 0xa4093822299f31d0ull;
+    int valid_ok = 1;
+    int tampered_ok = 1;
+    int non_canonical_ok = 1;
+    int failures = 0;
+
+    wallet_verify_cache_clear();
+    for (uint32_t k = 0u; k < KAT_VERIFY_KEYS; k++)
+    {
+        uint8_t seed[WALLET_SEED_LEN];
+        uint8_t private_key[WALLET_PRIVATE_KEY_LEN];
+
+        for (size_t i = 0u; i < sizeof(seed); i++)
+        {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            seed[i] = (uint8_t)(state >> 56);
+        }
+        for (size_t i = 0u; i < sizeof(message); i++)
+        {
+            message[i] = (uint8_t)(k + 17u * i);
+        }
+        ed25519_create_keypair(public_keys[k], private_key, seed);
+        ed25519_sign(signatures[k], message, sizeof(message), public_keys[k], private_key);
+    }
+
+    for (uint32_t round = 0u; round < KAT_VERIFY_ROUNDS; round++)
+    {
+        for (uint32_t k = 0u; k < KAT_VERIFY_KEYS; k++)
+        {
+            uint8_t signature[64];
+            uint8_t public_key[WALLET_PUBLIC_KEY_LEN];
+            unsigned int carry = 0u;
+
+            for (size_t i = 0u; i < sizeof(message); i++)
+            {
+                message[i] = (uint8_t)(k + 17u * i);
+            }
+
+            valid_ok &= verify_agrees(signatures[k], message, sizeof(message), public_keys[k], 1);
+
+            memcpy(signature, signatures[k], sizeof(signature));
+            signature[(k + round) % 32u] ^= 0x01u;
+            tampered_ok &= verify_agrees(signature, message, sizeof(message), public_keys[k], 0);
+
+            memcpy(signature, signatures[k], sizeof(signature));
+            signature[32u + (k + round) % 31u] ^= 0x02u;
+            tampered_ok &= verify_agrees(signature, message, sizeof(message), public_keys[k], 0);
+
+            message[(k * 5u + round) % sizeof(message)] ^= 0x80u;
+            tampered_ok &= verify_agrees(signatures[k], message, sizeof(message), public_keys[k], 0);
+            message[(k * 5u + round) % sizeof(message)] ^= 0x80u;
+
+            /* A flipped bit may or may not still decode as a point; neither may verify. */
+            memcpy(public_key, public_keys[k], sizeof(public_key));
+            public_key[(k + 3u * round) % 31u] ^= 0x04u;
+            tampered_ok &= verify_agrees(signatures[k], message, sizeof(message), public_key, 0);
+            tampered_ok &= verify_agrees(signatures[k], message, sizeof(message),
+                                         public_keys[(k + 1u) % KAT_VERIFY_KEYS], 0);
+
+            memcpy(signature, signatures[k], sizeof(signature));
+            for (size_t i = 0u; i < 32u; i++)
+            {
+                carry += (unsigned int)signature[32u + i] + kat_group_order[i];
+                signature[32u + i] = (uint8_t)carry;
+                carry >>= 8;
+            }
+            non_canonical_ok &= verify_agrees(signature, message, sizeof(message), public_keys[k], -1);
+
+            valid_ok &= verify_agrees(signatures[k], message, sizeof(message), public_keys[k], 1);
+        }
+    }
+
+    failures += report("wallet_verify accepts valid signatures", valid_ok);
+    failures += report("wallet_verify rejects tampered sig, msg and key", tampered_ok);
+    failures += report("wallet_verify matches ed25519_verify on S + l", non_canonical_ok);
+
+    wallet_verify_cache_clear();
+
+    return failures;
+}
+
+/*
+ * Headers asking for more than the cost ceilings must be refused before
+ * the KDF runs; deriving any of these would take seconds to minutes.
+ */
+static int test_blob_cost_ceiling(void)
+{
+    static const WalletKdfParams over[] = {
+        { WALLET_KDF_PBKDF2_SHA512, WALLET_KDF_PBKDF2_MAX_ITERATIONS + 1u, 0u, 0u },
+        { WALLET_KDF_PBKDF2_SHA512, 0xffffffffu, 0u, 0u },
+        { WALLET_KDF_ARGON2ID, WALLET_KDF_ARGON2_MAX_MEMORY_KIB + 1024u, 1u, 1u },
+        { WALLET_KDF_ARGON2ID, WALLET_KDF_ARGON2_MIN_MEMORY_KIB, WALLET_KDF_ARGON2_MAX_PASSES + 1u, 1u },
+    };
+    uint8_t key[WALLET_PRIVATE_KEY_LEN];
+    uint8_t blob[WALLET_BLOB_LEN];
+    uint8_t output[WALLET_PRIVATE_KEY_LEN];
+    clock_t start = 0;
+    int ok = 1;
+
+    memset(key, 0x42, sizeof(key));
+    if (hex_decode(kat_blob_v2_fixtures[0], blob, sizeof(blob)) != sizeof(blob))
+    {
+        return report("blob header over the cost ceiling", 0);
+    }
+
+    start = clock();
+    for (size_t i = 0u; i < sizeof(over) / sizeof(over[0]); i++)
+    {
+        /* The on-disk header: id, cost u32, passes u16, lanes u8, big-endian. */
+        blob[1] = (uint8_t)over[i].id;
+        blob[2] = (uint8_t)(over[i].cost >> 24);
+        blob[3] = (uint8_t)(over[i].cost >> 16);
+        blob[4] = (uint8_t)(over[i].cost >> 8);
+        blob[5] = (uint8_t)over[i].cost;
+        blob[6] = (uint8_t)(over[i].passes >> 8);
+        blob[7] = (uint8_t)over[i].passes;
+        blob[8] = (uint8_t)over[i].lanes;
+
+        ok &= (wallet_decrypt_private_key(KAT_BLOB_PASSWORD, blob, sizeof(blob), output, sizeof(output)) == APP_ERR_CRYPTO);
+        ok &= (wallet_encrypt_private_key_kdf(KAT_BLOB_PASSWORD, &over[i], key, sizeof(key), blob, sizeof(blob)) != APP_OK);
+    }
+    ok &= ((double)(clock() - start) / CLOCKS_PER_SEC) < 0.5;
+
+    return report("blob header over the cost ceiling", ok);
+}
@@ -22,6 +22,16 @@
 /* 
 	This unit allows to trace bytes which are transferred between PC
 	and TI calculator.
+
+	The transfer threads only copy the bytes into a lock-free ring of
+	fixed-size records (several producers, one consumer); a background
+	thread drains the ring and runs the writers and decoders, so that
+	logging does not slow transfers down. When the ring is full, records
+	are dropped and counted rather than blocking the transfer.
+
+	Each record carries the cable model of the handle that produced it,
+	so handles of different models sharing the logger are each decoded
+	with their own decoders.
 */
 
 #ifdef HAVE_CONFIG_H
@@ -40,15 +50,178 @@
 #include "logging.h"
 #include "data_log.h"
 
+#include "log_bin.h"
 #include "log_hex.h"
 #include "log_dbus.h"
 #include "log_dusb.h"
 #include "log_nsp.h"
 
+#define LOG_RING_SLOTS		4096	// must be a power of two
+#define LOG_RING_PAYLOAD	240
+
+typedef struct
+{
+	volatile gint	seq;
+	uint8_t		dir;
+	uint8_t		model;
+	uint8_t		len;
+	uint64_t	timestamp;
+	uint8_t		data[LOG_RING_PAYLOAD];
+} LogRecord;
+
+static LogRecord *ring = NULL;
+static volatile gint enqueue_pos = 0;
+static guint dequeue_pos = 0;
+static volatile gint dropped = 0;
+static volatile gint running = 0;
+static GThread *drain_thread = NULL;
+
+// users, start and stop are serialized by users_lock
+static GMutex users_lock;
+static int users = 0;
+
+// decoders are started by the drain thread on the first record of their
+// cable family, and stopped once it has been joined
+static int usb_started = 0;
+static int dbus_started = 0;
+
+// the drain thread sleeps on drain_cond when the ring is empty
+static GMutex drain_lock;
+static GCond drain_cond;
+static volatile gint drain_waiting = 0;
+
+static int log_ring_push(int dir, CableModel model, uint64_t timestamp, const uint8_t *data, uint32_t len)
+{
+	guint pos = (guint)g_atomic_int_get(&enqueue_pos);
+
+	for (;;)
+	{
+		LogRecord *rec = &ring[pos & (LOG_RING_SLOTS - 1)];
+		gint diff = (gint)((guint)g_atomic_int_get(&rec->seq) - pos);
+
+		if (diff == 0)
+		{
+			if (g_atomic_int_compare_and_exchange(&enqueue_pos, (gint)pos, (gint)(pos + 1)))
+			{
+				rec->dir = (uint8_t)dir;
+				rec->model = (uint8_t)model;
+				rec->len = (uint8_t)len;
+				rec->timestamp = timestamp;
+				memcpy(rec->data, data, len);
+				g_atomic_int_set(&rec->seq, (gint)(pos + 1));
+				return 0;
+			}
+			pos = (guint)g_atomic_int_get(&enqueue_pos);
+		}
+		else if (diff < 0)
+		{
+			// ring full: never stall the transfer thread
+			g_atomic_int_inc(&dropped);
+			return 1;
+		}
+		else
+		{
+			pos = (guint)g_atomic_int_get(&enqueue_pos);
+		}
+	}
+}
+
+static int log_ring_pop(void)
+{
+	LogRecord *rec = &ring[dequeue_pos & (LOG_RING_SLOTS - 1)];
+
+	if ((guint)g_atomic_int_get(&rec->seq) != dequeue_pos + 1)
+	{
+		return 0;
+	}
+
+	log_bin_N(rec->dir, rec->model, rec->timestamp, rec->data, rec->len);
+	log_hex_N(rec->dir, rec->data, rec->len);
+
+	if (rec->model == CABLE_USB)
+	{
+		if (!usb_started)
+		{
+			log_dusb_start();
+			log_nsp_start();
+			usb_started = 1;
+		}
+		log_dusb_N(rec->dir, rec->data, rec->len);
+		log_nsp_N(rec->dir, rec->data, rec->len);
+	}
+	else
+	{
+		if (!dbus_started)
+		{
+			log_dbus_start();
+			dbus_started = 1;
+		}
+		log_dbus_N(rec->dir, rec->data, rec->len);
+	}
+
+	g_atomic_int_set(&rec->seq, (gint)(dequeue_pos + LOG_RING_SLOTS));
+	dequeue_pos++;
+
+	return 1;
+}
+
+static int log_ring_empty(void)
+{
+	LogRecord *rec = &ring[dequeue_pos & (LOG_RING_SLOTS - 1)];
+
+	return (guint)g_atomic_int_get(&rec->seq) != dequeue_pos + 1;
+}
+
+static void log_drain_wake(void)
+{
+	g_mutex_lock(&drain_lock);
+	g_cond_signal(&drain_cond);
+	g_mutex_unlock(&drain_lock);
+}
+
+static gpointer log_drain(gpointer arg)
+{
+	(void)arg;
+
+	while (g_atomic_int_get(&running))
+	{
+		if (log_ring_pop())
+		{
+			continue;
+		}
+
+		// announce the sleep before the last look at the ring, so that a
+		// producer either sees drain_waiting or its record is seen here
+		g_mutex_lock(&drain_lock);
+		g_atomic_int_set(&drain_waiting, 1);
+		while (g_atomic_int_get(&running) && log_ring_empty())
+		{
+			g_cond_wait(&drain_cond, &drain_lock);
+		}
+		g_atomic_int_set(&drain_waiting, 0);
+		g_mutex_unlock(&drain_lock);
+	}
+
+	// flush whatever was queued before stopping
+	while (log_ring_pop());
+
+	return NULL;
+}
+
 int log_start(CableHandle *h)
 {
 	gchar *tmp;
 	int ret;
+	guint i;
+
+	(void)h;
+
+	g_mutex_lock(&users_lock);
+	if (users++ > 0)
+	{
+		g_mutex_unlock(&users_lock);
+		return 0;
+	}
 
 	tmp = g_strconcat(g_get_home_dir(), G_DIR_SEPARATOR_S, LOG_DIR, NULL);
 	if (!g_mkdir_with_parents(tmp, 0750))
@@ -56,18 +229,7 @@ int log_start(CableHandle *h)
 		ret = log_hex_start();
 		if (!ret)
 		{
-			if (h->model == CABLE_USB)
-			{
-				ret = log_dusb_start();
-				if (!ret)
-				{
-					ret = log_nsp_start();
-				}
-			}
-			else
-			{
-				ret = log_dbus_start();
-			}
+			ret = log_bin_start();
 		}
 	}
 	else
@@ -77,21 +239,63 @@ int log_start(CableHandle *h)
 	}
 	g_free(tmp);
 
+	if (!ret)
+	{
+		ring = (LogRecord *)g_malloc0(LOG_RING_SLOTS * sizeof(LogRecord));
+		for (i = 0; i < LOG_RING_SLOTS; i++)
+		{
+			ring[i].seq = (gint)i;
+		}
+		enqueue_pos = 0;
+		dequeue_pos = 0;
+		dropped = 0;
+		usb_started = 0;
+		dbus_started = 0;
+		running = 1;
+
+		drain_thread = g_thread_try_new("ticables-log", log_drain, NULL, NULL);
+		if (drain_thread == NULL)
+		{
+			ticables_critical("Failed to start logging thread");
+			running = 0;
+			g_free(ring);
+			ring = NULL;
+			ret = 1;
+		}
+	}
+
+	if (ret)
+	{
+		users--;
+	}
+	g_mutex_unlock(&users_lock);
+
 	return ret;
 }
 
 int log_N(CableHandle *h, int dir, const uint8_t *data, uint32_t len)
 {
-	log_hex_N(dir, data, len);
+	uint64_t timestamp;
+	CableModel model = (h != NULL) ? h->model : CABLE_NUL;
 
-	if (h->model == CABLE_USB)
+	if (ring == NULL)
 	{
-		log_dusb_N(dir, data, len);
-		log_nsp_N(dir, data, len);
+		return 1;
 	}
-	else
+
+	timestamp = (uint64_t)g_get_monotonic_time();
+	while (len > 0)
+	{
+		uint32_t n = (len > LOG_RING_PAYLOAD) ? LOG_RING_PAYLOAD : len;
+
+		log_ring_push(dir, model, timestamp, data, n);
+		data += n;
+		len -= n;
+	}
+
+	if (g_atomic_int_get(&drain_waiting))
 	{
-		log_dbus_N(dir, data, len);
+		log_drain_wake();
 	}
 
 	return 0;
@@ -99,17 +303,45 @@ int log_N(CableHandle *h, int dir, const uint8_t *data, uint32_t len)
 
 int log_stop(CableHandle *h)
 {
+	(void)h;
+
+	g_mutex_lock(&users_lock);
+	if (users == 0 || --users > 0)
+	{
+		g_mutex_unlock(&users_lock);
+		return 0;
+	}
+
+	if (drain_thread != NULL)
+	{
+		g_atomic_int_set(&running, 0);
+		log_drain_wake();
+		g_thread_join(drain_thread);
+		drain_thread = NULL;
+	}
+
+	if (dropped)
+	{
+		ticables_warning("Data logger dropped %d records (ring full)", dropped);
+	}
+
+	g_free(ring);
+	ring = NULL;
+
 	log_hex_stop();
+	log_bin_stop();
 
-	if (h->model == CABLE_USB)
+	if (usb_started)
 	{
 		log_dusb_stop();
 		log_nsp_stop();
 	}
-	else
+	if (dbus_started)
 	{
 		log_dbus_stop();
 	}
 
+	g_mutex_unlock(&users_lock);
+
 	return 0;
 }
@@ -35,6 +35,7 @@
 
 #define LOG_DIR		".ticables"
 #define HEX_FILE	"ticables-log.hex"
+#define BIN_FILE	"ticables-log.bin"
 
 // Functions
 
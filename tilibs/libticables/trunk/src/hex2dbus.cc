@@ -24,6 +24,7 @@
 
 #include "ticables.h"
 #include "internal.h"
+#include "log_dbus.h"
 
 static const unsigned char machine_id[] =
 {
@@ -135,6 +136,79 @@ static int fill_buf(FILE *f, char data, int flush)
 	return 0;
 }
 
+/**
+ * dbus_decomp_packet:
+ * @fo: output stream, or NULL to only check for a complete packet.
+ * @buffer: raw bytes, starting at a packet boundary.
+ * @len: number of bytes available in @buffer.
+ *
+ * Incremental counterpart of dbus_decomp(): decodes a single packet into @fo,
+ * using the same output format.
+ *
+ * Return value: the number of bytes consumed, 0 if @buffer does not hold a
+ * complete packet yet, or a negative value if it does not start with a packet.
+ **/
+int dbus_decomp_packet(FILE *fo, const uint8_t *buffer, uint32_t len)
+{
+	unsigned int length, j;
+	uint32_t total;
+	int idx;
+
+	if (len < 4)
+	{
+		return 0;
+	}
+
+	if (machine_id[is_a_machine_id(buffer[0])] == 0xff)
+	{
+		return -1;
+	}
+	idx = is_a_command_id(buffer[1]);
+	if (command_id[idx] == 0xff)
+	{
+		return -2;
+	}
+
+	length = buffer[2] | (((unsigned int)buffer[3]) << 8);
+	total = 4;
+	if (cmd_with_data[idx] && length > 0)
+	{
+		total += length + 2;
+	}
+	if (len < total)
+	{
+		return 0;
+	}
+	if (fo == NULL)
+	{
+		return (int)total;
+	}
+
+	fprintf(fo, "%02X %02X %02X %02X", buffer[0], buffer[1], length >> 8, length & 0xff);
+	for (j = 4; j <= WIDTH; j++)
+	{
+		fprintf(fo, "   ");
+	}
+	fprintf(fo, "  | ");
+	fprintf(fo, "%s: %s\n", machine_way[is_a_machine_id(buffer[0])], command_name[idx]);
+
+	if (total > 4)
+	{
+		for (j = 0; j < length; j++)
+		{
+			fill_buf(fo, buffer[4 + j], 0);
+		}
+		fill_buf(fo, 0, !0);
+
+		fprintf(fo, "    ");
+		fprintf(fo, "%02X ", buffer[4 + length]);
+		fprintf(fo, "%02X ", buffer[5 + length]);
+		fprintf(fo, "\n");
+	}
+
+	return (int)total;
+}
+
 /*
   Format of data: 8 hexadecimal numbers with spaces
 */
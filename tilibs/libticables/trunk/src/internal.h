@@ -22,6 +22,8 @@
 #ifndef __TICABLES_INTERNAL__
 #define __TICABLES_INTERNAL__
 
+#include <glib.h>
+
 #define VALIDATE_NONNULL(ptr) \
 	do \
 	{ \
@@ -100,17 +102,59 @@ static inline void ticables_event_fill_data(CableEventData * event, uint8_t * da
 	event->data.data.len = len;
 }
 
+// link_xxx.c
+void ticables_event_trace(CableHandle * handle, const CableEventData * event);
+
+// metrics.c
+void ticables_metrics_record(CableHandle * handle, CableFnctsIdx operation, int64_t start, int retval, uint32_t len);
+
+// Start time of a measured operation, 0 when metrics are disabled.
+static inline int64_t ticables_metrics_clock(CableHandle * handle)
+{
+	return handle->metrics != NULL ? g_get_monotonic_time() : 0;
+}
+
+static inline uint32_t ticables_event_type_to_mask(CableEventType type)
+{
+	if (type >= CABLE_EVENT_TYPE_USER)
+	{
+		return CABLE_EVENT_MASK_USER;
+	}
+	if (type >= CABLE_EVENT_TYPE_BEFORE_GENERIC_OPERATION)
+	{
+		return CABLE_EVENT_MASK_GENERIC;
+	}
+	if (type >= CABLE_EVENT_TYPE_BEFORE_SEND)
+	{
+		return 1U << (type - CABLE_EVENT_TYPE_BEFORE_SEND);
+	}
+	return CABLE_EVENT_MASK_LIFECYCLE;
+}
+
+// Cheap test done before building an event, so that unsubscribed events cost nothing.
+static inline int ticables_event_wanted(CableHandle * handle, CableEventType type)
+{
+	return (handle->event_hook != NULL || handle->trace != NULL) && (handle->event_mask & ticables_event_type_to_mask(type));
+}
+
 static inline int ticables_event_send_simple_generic(CableHandle * handle, CableEventType type, int retval, CableFnctsIdx operation)
 {
 	int ret = retval;
 
-	if (handle->event_hook)
+	if (ticables_event_wanted(handle, type))
 	{
 		CableEventData event;
 		ticables_event_fill_header(handle, &event, type, retval, operation);
 		memset((void *)&event.data, 0, sizeof(event.data));
 		handle->event_count++;
-		ret = handle->event_hook(handle, handle->event_count, &event, handle->user_pointer);
+		if (handle->trace)
+		{
+			ticables_event_trace(handle, &event);
+		}
+		if (handle->event_hook)
+		{
+			ret = handle->event_hook(handle, handle->event_count, &event, handle->user_pointer);
+		}
 	}
 
 	return ret;
@@ -125,15 +169,24 @@ static inline int ticables_event_send(CableHandle * handle, CableEventData * eve
 {
 	int ret = event->retval;
 
-	if (handle->event_hook)
+	if (ticables_event_wanted(handle, event->type))
 	{
 		handle->event_count++;
-		ret = handle->event_hook(handle, handle->event_count, event, handle->user_pointer);
+		if (handle->trace)
+		{
+			ticables_event_trace(handle, event);
+		}
+		if (handle->event_hook)
+		{
+			ret = handle->event_hook(handle, handle->event_count, event, handle->user_pointer);
+		}
 	}
 
 	return ret;
 }
 
+#define USB_MAX_CABLES	4
+
 typedef struct {
 	uint16_t    vid;
 	uint16_t    pid;
@@ -142,7 +195,8 @@ typedef struct {
 	void *dev;
 } USBCableInfo;
 
-int usb_probe_device_info(const USBCableInfo **list, int *count);
+// Fills list (USB_MAX_CABLES entries) with a snapshot of the devices found.
+int usb_probe_device_info(USBCableInfo *list, int *count);
 void translate_usb_device_info(CableDeviceInfo *info, const USBCableInfo *usbinfo);
 
 int dbus_decomp(const char *filename, int resync);
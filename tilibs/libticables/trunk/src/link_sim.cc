@@ -0,0 +1,762 @@
+/* Hey EMACS -*- linux-c -*- */
+/* $Id$ */
+
+/*  libticables2 - link cable library, a part of the TiLP project
+ *  Copyright (C) 1999-2005  Romain Lievin
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/* Simulated TI-83 Plus link unit */
+
+/*
+ * This unit does not talk to any hardware: the other end of the cable is an
+ * in-process DBUS peer which behaves like a TI-83 Plus in silent link mode.
+ * It answers RDY, RTS, REQ, CTS, XDP, ACK, EOT and DEL packets and keeps a
+ * small variable store (RAM or archive) for the lifetime of the handle, so
+ * that the calculator protocol layers can be exercised without a device.
+ *
+ * The link speed can be modelled through the device string, which is a comma
+ * separated list of key=value pairs:
+ *   bandwidth=<bytes per second>   (0: unlimited, the default)
+ *   latency=<microseconds>         (turnaround per packet, default 0)
+ *   ram=<bytes>                    (free RAM, default 24000)
+ *   flash=<bytes>                  (free archive, default 163840)
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifndef NO_CABLE_SIM
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __WIN32__
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "ticables.h"
+#include "logging.h"
+#include "error.h"
+#include "gettext.h"
+#include "internal.h"
+
+/* DBUS machine IDs and commands used by a TI-83 Plus (see libticalcs2 dbus_pkt.h) */
+#define SIM_MID_PC        0x23
+#define SIM_MID_CALC      0x73
+
+#define SIM_CMD_VAR       0x06
+#define SIM_CMD_CTS       0x09
+#define SIM_CMD_XDP       0x15
+#define SIM_CMD_SKP       0x36
+#define SIM_CMD_SID       0x47
+#define SIM_CMD_ACK       0x56
+#define SIM_CMD_ERR       0x5A
+#define SIM_CMD_RDY       0x68
+#define SIM_CMD_DEL       0x88
+#define SIM_CMD_EOT       0x92
+#define SIM_CMD_REQ       0xA2
+#define SIM_CMD_IND       0xB7
+#define SIM_CMD_RTS       0xC9
+
+#define SIM_REJ_SKIP      2
+#define SIM_REJ_MEMORY    3
+
+#define SIM_TYPE_DIR      0x19
+#define SIM_ATTR_ARCHIVED 0x80
+
+#define SIM_MAX_VARS      32
+#define SIM_MAX_PACKET    (4 + 65536 + 2)
+
+#define SIM_DEFAULT_RAM   24000
+#define SIM_DEFAULT_FLASH 163840
+
+typedef struct
+{
+	int		used;
+	uint8_t		type;
+	char		name[8];
+	uint8_t		attr;
+	uint8_t		version;
+	uint16_t	size;
+	uint8_t*	data;
+} SimVar;
+
+typedef enum
+{
+	SIM_IDLE = 0,
+	SIM_WAIT_XDP,		// RTS accepted, waiting for the variable data
+	SIM_WAIT_EOT,		// data stored, waiting for the end of transmission
+	SIM_WAIT_CTS,		// VAR header sent, waiting for the PC to accept it
+	SIM_DIRLIST		// directory listing in progress, one VAR per ACK
+} SimState;
+
+typedef struct
+{
+	SimVar		vars[SIM_MAX_VARS];
+	uint32_t	ram_free;
+	uint32_t	flash_free;
+
+	uint32_t	bandwidth;	// bytes per second, 0 = unlimited
+	uint32_t	latency;	// microseconds per packet
+
+	SimState	state;
+	SimVar		pending;	// header of the variable being sent/received
+	int		cursor;		// next entry of the directory listing
+
+	uint8_t*	in;		// packet being received from the PC
+	uint32_t	in_len;
+
+	uint8_t*	out;		// bytes queued for the PC
+	uint32_t	out_len;
+	uint32_t	out_pos;
+	uint32_t	out_size;
+} SimLink;
+
+#define sim_link(h) ((SimLink *)((h)->priv2))
+
+static void sim_delay(const SimLink *s, uint32_t len, int turnaround)
+{
+	uint64_t us = 0;
+
+	if (s->bandwidth)
+	{
+		us += ((uint64_t)len * 1000000UL) / s->bandwidth;
+	}
+	if (turnaround)
+	{
+		us += s->latency;
+	}
+	if (us)
+	{
+#ifdef __WIN32__
+		Sleep((DWORD)((us + 999) / 1000));
+#else
+		usleep((useconds_t)us);
+#endif
+	}
+}
+
+static uint16_t sim_checksum(const uint8_t *data, uint32_t len)
+{
+	uint16_t sum = 0;
+	uint32_t i;
+
+	for (i = 0; i < len; i++)
+	{
+		sum += data[i];
+	}
+
+	return sum;
+}
+
+static int sim_has_data(uint8_t cmd)
+{
+	switch (cmd)
+	{
+	case SIM_CMD_VAR:
+	case SIM_CMD_XDP:
+	case SIM_CMD_SKP:
+	case SIM_CMD_SID:
+	case SIM_CMD_REQ:
+	case SIM_CMD_IND:
+	case SIM_CMD_RTS:
+	case SIM_CMD_DEL:
+		return !0;
+	default:
+		return 0;
+	}
+}
+
+static int sim_queue(SimLink *s, uint8_t cmd, const uint8_t *data, uint16_t len)
+{
+	uint32_t needed = s->out_len + 4 + (data != NULL ? len + 2 : 0);
+	uint8_t *p;
+
+	if (needed > s->out_size)
+	{
+		uint32_t size = s->out_size ? s->out_size : 256;
+		while (size < needed)
+		{
+			size *= 2;
+		}
+		p = (uint8_t *)realloc(s->out, size);
+		if (p == NULL)
+		{
+			return ERR_WRITE_ERROR;
+		}
+		s->out = p;
+		s->out_size = size;
+	}
+
+	p = s->out + s->out_len;
+	p[0] = SIM_MID_CALC;
+	p[1] = cmd;
+	p[2] = len & 0xFF;
+	p[3] = (len >> 8) & 0xFF;
+	if (data != NULL)
+	{
+		uint16_t sum = sim_checksum(data, len);
+
+		memcpy(p + 4, data, len);
+		p[4 + len] = sum & 0xFF;
+		p[5 + len] = (sum >> 8) & 0xFF;
+	}
+	s->out_len = needed;
+
+	return 0;
+}
+
+static int sim_queue_header(SimLink *s, uint8_t cmd, const SimVar *v)
+{
+	uint8_t buf[13];
+
+	buf[0] = v->size & 0xFF;
+	buf[1] = (v->size >> 8) & 0xFF;
+	buf[2] = v->type;
+	memcpy(buf + 3, v->name, 8);
+	buf[11] = v->version;
+	buf[12] = v->attr;
+
+	return sim_queue(s, cmd, buf, sizeof(buf));
+}
+
+static int sim_queue_rej(SimLink *s, uint8_t code)
+{
+	return sim_queue(s, SIM_CMD_SKP, &code, 1);
+}
+
+static void sim_parse_header(SimVar *v, const uint8_t *data, uint16_t len)
+{
+	memset(v, 0, sizeof(*v));
+	if (len >= 11)
+	{
+		v->size = data[0] | ((uint16_t)data[1] << 8);
+		v->type = data[2];
+		memcpy(v->name, data + 3, 8);
+	}
+	if (len >= 13)
+	{
+		v->version = data[11];
+		v->attr = data[12] & SIM_ATTR_ARCHIVED;
+	}
+}
+
+static SimVar* sim_find(SimLink *s, uint8_t type, const char *name)
+{
+	int i;
+
+	for (i = 0; i < SIM_MAX_VARS; i++)
+	{
+		SimVar *v = &s->vars[i];
+		if (v->used && v->type == type && !memcmp(v->name, name, 8))
+		{
+			return v;
+		}
+	}
+
+	return NULL;
+}
+
+static void sim_release(SimLink *s, SimVar *v)
+{
+	if (v->attr & SIM_ATTR_ARCHIVED)
+	{
+		s->flash_free += v->size;
+	}
+	else
+	{
+		s->ram_free += v->size;
+	}
+	free(v->data);
+	memset(v, 0, sizeof(*v));
+}
+
+/* Check that the pending variable fits, counting the space freed by the copy it replaces */
+static int sim_fits(SimLink *s, const SimVar *v)
+{
+	SimVar *old = sim_find(s, v->type, v->name);
+	uint32_t ram = s->ram_free;
+	uint32_t flash = s->flash_free;
+	int i, slot = (old != NULL);
+
+	if (old != NULL)
+	{
+		if (old->attr & SIM_ATTR_ARCHIVED)
+		{
+			flash += old->size;
+		}
+		else
+		{
+			ram += old->size;
+		}
+	}
+	for (i = 0; !slot && i < SIM_MAX_VARS; i++)
+	{
+		slot = !s->vars[i].used;
+	}
+
+	if (!slot)
+	{
+		return 0;
+	}
+
+	return (v->attr & SIM_ATTR_ARCHIVED) ? (v->size <= flash) : (v->size <= ram);
+}
+
+static int sim_store(SimLink *s, const uint8_t *data, uint16_t len)
+{
+	SimVar *v = sim_find(s, s->pending.type, s->pending.name);
+	int i;
+
+	if (v != NULL)
+	{
+		sim_release(s, v);
+	}
+	for (i = 0; v == NULL && i < SIM_MAX_VARS; i++)
+	{
+		if (!s->vars[i].used)
+		{
+			v = &s->vars[i];
+		}
+	}
+	if (v == NULL)
+	{
+		return ERR_WRITE_ERROR;
+	}
+
+	*v = s->pending;
+	v->size = len;
+	v->data = (uint8_t *)malloc(len ? len : 1);
+	if (v->data == NULL)
+	{
+		memset(v, 0, sizeof(*v));
+		return ERR_WRITE_ERROR;
+	}
+	memcpy(v->data, data, len);
+	v->used = 1;
+
+	if (v->attr & SIM_ATTR_ARCHIVED)
+	{
+		s->flash_free -= len;
+	}
+	else
+	{
+		s->ram_free -= len;
+	}
+
+	return 0;
+}
+
+static int sim_next_dir_entry(SimLink *s)
+{
+	while (s->cursor < SIM_MAX_VARS)
+	{
+		const SimVar *v = &s->vars[s->cursor++];
+		if (v->used)
+		{
+			return sim_queue_header(s, SIM_CMD_VAR, v);
+		}
+	}
+
+	s->state = SIM_IDLE;
+	return sim_queue(s, SIM_CMD_EOT, NULL, 0);
+}
+
+/* Handle one complete packet from the PC and queue the calculator's answer */
+static int sim_process(SimLink *s, uint8_t cmd, const uint8_t *data, uint16_t len)
+{
+	int ret = 0;
+
+	switch (cmd)
+	{
+	case SIM_CMD_RDY:
+		ret = sim_queue(s, SIM_CMD_ACK, NULL, 0);
+		break;
+
+	case SIM_CMD_RTS:
+		sim_parse_header(&s->pending, data, len);
+		ret = sim_queue(s, SIM_CMD_ACK, NULL, 0);
+		if (!ret)
+		{
+			if (sim_fits(s, &s->pending))
+			{
+				s->state = SIM_WAIT_XDP;
+				ret = sim_queue(s, SIM_CMD_CTS, NULL, 0);
+			}
+			else
+			{
+				s->state = SIM_IDLE;
+				ret = sim_queue_rej(s, SIM_REJ_MEMORY);
+			}
+		}
+		break;
+
+	case SIM_CMD_XDP:
+		if (s->state == SIM_WAIT_XDP && len != s->pending.size)
+		{
+			// sim_fits() checked the RTS size; storing any other length would skew ram_free
+			ticables_warning(_("sim: %u-byte XDP after a %u-byte RTS, rejected"), len, s->pending.size);
+			s->state = SIM_IDLE;
+			ret = sim_queue_rej(s, SIM_REJ_MEMORY);
+		}
+		else
+		{
+			if (s->state == SIM_WAIT_XDP)
+			{
+				ret = sim_store(s, data, len);
+				s->state = SIM_WAIT_EOT;
+			}
+			if (!ret)
+			{
+				ret = sim_queue(s, SIM_CMD_ACK, NULL, 0);
+			}
+		}
+		break;
+
+	case SIM_CMD_REQ:
+		ret = sim_queue(s, SIM_CMD_ACK, NULL, 0);
+		if (!ret && len >= 3 && data[2] == SIM_TYPE_DIR)
+		{
+			uint8_t mem[2];
+
+			mem[0] = (s->ram_free > 0xFFFF ? 0xFFFF : s->ram_free) & 0xFF;
+			mem[1] = ((s->ram_free > 0xFFFF ? 0xFFFF : s->ram_free) >> 8) & 0xFF;
+			s->state = SIM_DIRLIST;
+			s->cursor = 0;
+			ret = sim_queue(s, SIM_CMD_XDP, mem, sizeof(mem));
+		}
+		else if (!ret)
+		{
+			SimVar *v;
+
+			sim_parse_header(&s->pending, data, len);
+			v = sim_find(s, s->pending.type, s->pending.name);
+			if (v != NULL)
+			{
+				s->pending = *v;
+				s->state = SIM_WAIT_CTS;
+				ret = sim_queue_header(s, SIM_CMD_VAR, v);
+			}
+			else
+			{
+				s->state = SIM_IDLE;
+				ret = sim_queue_rej(s, SIM_REJ_SKIP);
+			}
+		}
+		break;
+
+	case SIM_CMD_CTS:
+		ret = sim_queue(s, SIM_CMD_ACK, NULL, 0);
+		if (!ret && s->state == SIM_WAIT_CTS)
+		{
+			SimVar *v = sim_find(s, s->pending.type, s->pending.name);
+			s->state = SIM_IDLE;
+			if (v != NULL)
+			{
+				ret = sim_queue(s, SIM_CMD_XDP, v->data, v->size);
+			}
+		}
+		break;
+
+	case SIM_CMD_ACK:
+		if (s->state == SIM_DIRLIST)
+		{
+			ret = sim_next_dir_entry(s);
+		}
+		break;
+
+	case SIM_CMD_EOT:
+		s->state = SIM_IDLE;
+		break;
+
+	case SIM_CMD_DEL:
+		{
+			SimVar hdr;
+			SimVar *v;
+
+			sim_parse_header(&hdr, data, len);
+			v = sim_find(s, hdr.type, hdr.name);
+			if (v != NULL)
+			{
+				sim_release(s, v);
+			}
+			ret = sim_queue(s, SIM_CMD_ACK, NULL, 0);
+			if (!ret)
+			{
+				ret = sim_queue(s, SIM_CMD_ACK, NULL, 0);
+			}
+		}
+		break;
+
+	case SIM_CMD_SKP:
+		s->state = SIM_IDLE;
+		ret = sim_queue(s, SIM_CMD_ACK, NULL, 0);
+		break;
+
+	default:
+		ticables_info(_("sim: unhandled command 0x%02X"), cmd);
+		break;
+	}
+
+	return ret;
+}
+
+static void sim_parse_device(SimLink *s, const char *device)
+{
+	const char *p = device;
+
+	while (p != NULL && *p)
+	{
+		const char *eq = strchr(p, '=');
+		unsigned long value;
+
+		if (eq == NULL)
+		{
+			break;
+		}
+		value = strtoul(eq + 1, NULL, 10);
+
+		if (!strncmp(p, "bandwidth", eq - p))
+		{
+			s->bandwidth = (uint32_t)value;
+		}
+		else if (!strncmp(p, "latency", eq - p))
+		{
+			s->latency = (uint32_t)value;
+		}
+		else if (!strncmp(p, "ram", eq - p))
+		{
+			s->ram_free = (uint32_t)value;
+		}
+		else if (!strncmp(p, "flash", eq - p))
+		{
+			s->flash_free = (uint32_t)value;
+		}
+		else
+		{
+			ticables_warning(_("sim: unknown device option '%.*s'"), (int)(eq - p), p);
+		}
+
+		p = strchr(eq, ',');
+		if (p != NULL)
+		{
+			p++;
+		}
+	}
+}
+
+static int sim_open(CableHandle *h)
+{
+	SimLink *s = (SimLink *)calloc(1, sizeof(SimLink));
+
+	if (s == NULL)
+	{
+		return ERR_NOT_OPEN;
+	}
+
+	s->in = (uint8_t *)malloc(SIM_MAX_PACKET);
+	if (s->in == NULL)
+	{
+		free(s);
+		return ERR_NOT_OPEN;
+	}
+
+	s->ram_free = SIM_DEFAULT_RAM;
+	s->flash_free = SIM_DEFAULT_FLASH;
+	sim_parse_device(s, h->device);
+
+	h->priv2 = (void *)s;
+
+	return 0;
+}
+
+static int sim_close(CableHandle *h)
+{
+	SimLink *s = sim_link(h);
+
+	if (s != NULL)
+	{
+		int i;
+
+		for (i = 0; i < SIM_MAX_VARS; i++)
+		{
+			free(s->vars[i].data);
+		}
+		free(s->in);
+		free(s->out);
+		free(s);
+		h->priv2 = NULL;
+	}
+
+	return 0;
+}
+
+static int sim_reset(CableHandle *h)
+{
+	SimLink *s = sim_link(h);
+
+	s->state = SIM_IDLE;
+	s->in_len = 0;
+	s->out_len = s->out_pos = 0;
+
+	return 0;
+}
+
+static int sim_put(CableHandle *h, uint8_t *data, uint32_t len)
+{
+	SimLink *s = sim_link(h);
+	uint32_t i;
+	int ret = 0;
+
+	sim_delay(s, len, 0);
+
+	for (i = 0; i < len && !ret; i++)
+	{
+		uint32_t expected;
+
+		s->in[s->in_len++] = data[i];
+		if (s->in_len < 4)
+		{
+			continue;
+		}
+
+		expected = 4;
+		if (sim_has_data(s->in[1]))
+		{
+			uint32_t plen = s->in[2] | ((uint32_t)s->in[3] << 8);
+			expected += (plen ? plen : 65536) + 2;
+		}
+		if (s->in_len < expected)
+		{
+			continue;
+		}
+
+		if (s->in[0] != SIM_MID_PC)
+		{
+			ticables_warning(_("sim: dropping packet for machine ID 0x%02X"), s->in[0]);
+		}
+		else if (expected == 4)
+		{
+			ret = sim_process(s, s->in[1], NULL, 0);
+		}
+		else if (expected - 6 > 0xFFFF)
+		{
+			// A zero length field means 65536 bytes, which no 16-bit variable size can describe
+			ticables_warning(_("sim: rejecting 65536-byte packet 0x%02X"), s->in[1]);
+			s->state = SIM_IDLE;
+			ret = sim_queue(s, SIM_CMD_ERR, NULL, 0);
+		}
+		else
+		{
+			uint16_t plen = (uint16_t)(expected - 6);
+			uint16_t sum = s->in[expected - 2] | ((uint16_t)s->in[expected - 1] << 8);
+
+			if (sum != sim_checksum(s->in + 4, plen))
+			{
+				ret = sim_queue(s, SIM_CMD_ERR, NULL, 0);
+			}
+			else
+			{
+				ret = sim_process(s, s->in[1], s->in + 4, plen);
+			}
+		}
+		s->in_len = 0;
+		sim_delay(s, 0, 1);
+	}
+
+	return ret;
+}
+
+static int sim_get(CableHandle *h, uint8_t *data, uint32_t len)
+{
+	SimLink *s = sim_link(h);
+
+	if (s->out_len - s->out_pos < len)
+	{
+		return ERR_READ_TIMEOUT;
+	}
+
+	sim_delay(s, len, 0);
+	memcpy(data, s->out + s->out_pos, len);
+	s->out_pos += len;
+	if (s->out_pos == s->out_len)
+	{
+		s->out_pos = s->out_len = 0;
+	}
+
+	return 0;
+}
+
+static int sim_check(CableHandle *h, int *status)
+{
+	SimLink *s = sim_link(h);
+
+	*status = (s->out_len > s->out_pos) ? STATUS_RX : STATUS_NONE;
+
+	return 0;
+}
+
+static int sim_set_device(CableHandle *h, const char * device)
+{
+	if (device != NULL)
+	{
+		char * device2 = strdup(device);
+		if (device2 != NULL)
+		{
+			free(h->device);
+			h->device = device2;
+		}
+		else
+		{
+			ticables_warning(_("unable to set device %s.\n"), device);
+		}
+		return 0;
+	}
+	return ERR_ILLEGAL_ARG;
+}
+
+static int sim_get_device_info(CableHandle *h, CableDeviceInfo *info)
+{
+	(void)h;
+	info->family = CABLE_FAMILY_DBUS;
+	info->variant = CABLE_VARIANT_UNKNOWN;
+	return 0;
+}
+
+extern const CableFncts cable_sim =
+{
+	CABLE_SIM,
+	"SIM",
+	N_("Simulator"),
+	N_("In-process simulated TI-83 Plus link"),
+	0,
+	&noop_prepare,
+	&sim_open, &sim_close, &sim_reset, &noop_probe, NULL,
+	&sim_put, &sim_get, &sim_check,
+	&noop_set_red_wire, &noop_set_white_wire,
+	&noop_get_red_wire, &noop_get_white_wire,
+	NULL, NULL,
+	&sim_set_device,
+	&sim_get_device_info
+};
+
+#endif
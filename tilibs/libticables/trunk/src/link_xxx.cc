@@ -161,7 +161,9 @@ int TICALL ticables_cable_reset(CableHandle* handle)
 			ret = ticables_event_send_simple_generic(handle, /* type */ CABLE_EVENT_TYPE_BEFORE_GENERIC_OPERATION, /* retval */ 0, /* operation */ CABLE_FNCT_RESET);
 			if (!ret)
 			{
+				int64_t start = ticables_metrics_clock(handle);
 				ret = cable->reset(handle);
+				ticables_metrics_record(handle, CABLE_FNCT_RESET, start, ret, 0);
 			}
 			ret = ticables_event_send_simple_generic(handle, /* type */ CABLE_EVENT_TYPE_AFTER_GENERIC_OPERATION, /* retval */ ret, /* operation */ CABLE_FNCT_RESET);
 		}
@@ -283,9 +285,12 @@ int TICALL ticables_cable_send(CableHandle* handle, uint8_t *data, uint32_t len)
 		ticables_critical("ticables_cable_send: len = 0\n");
 	}
 
-	ticables_event_fill_header(handle, &event, /* type */ CABLE_EVENT_TYPE_BEFORE_SEND, /* retval */ 0, /* operation */ CABLE_FNCT_LAST);
-	ticables_event_fill_data(&event, /* data */ data, /* len */ len);
-	ret = ticables_event_send(handle, &event);
+	if (ticables_event_wanted(handle, CABLE_EVENT_TYPE_BEFORE_SEND))
+	{
+		ticables_event_fill_header(handle, &event, /* type */ CABLE_EVENT_TYPE_BEFORE_SEND, /* retval */ 0, /* operation */ CABLE_FNCT_LAST);
+		ticables_event_fill_data(&event, /* data */ data, /* len */ len);
+		ret = ticables_event_send(handle, &event);
+	}
 
 	if (!ret)
 	{
@@ -295,16 +300,24 @@ int TICALL ticables_cable_send(CableHandle* handle, uint8_t *data, uint32_t len)
 			handle->rate.count += len;
 			if (cable->send)
 			{
-				ticables_event_fill_header(handle, &event, /* type */ CABLE_EVENT_TYPE_BEFORE_GENERIC_OPERATION, /* retval */ 0, /* operation */ CABLE_FNCT_SEND);
-				ticables_event_fill_data(&event, /* data */ data, /* len */ len);
-				ret = ticables_event_send(handle, &event);
+				if (ticables_event_wanted(handle, CABLE_EVENT_TYPE_BEFORE_GENERIC_OPERATION))
+				{
+					ticables_event_fill_header(handle, &event, /* type */ CABLE_EVENT_TYPE_BEFORE_GENERIC_OPERATION, /* retval */ 0, /* operation */ CABLE_FNCT_SEND);
+					ticables_event_fill_data(&event, /* data */ data, /* len */ len);
+					ret = ticables_event_send(handle, &event);
+				}
 				if (!ret)
 				{
+					int64_t start = ticables_metrics_clock(handle);
 					ret = cable->send(handle, data, len);
+					ticables_metrics_record(handle, CABLE_FNCT_SEND, start, ret, len);
+				}
+				if (ticables_event_wanted(handle, CABLE_EVENT_TYPE_AFTER_GENERIC_OPERATION))
+				{
+					ticables_event_fill_header(handle, &event, /* type */ CABLE_EVENT_TYPE_AFTER_GENERIC_OPERATION, /* retval */ ret, /* operation */ CABLE_FNCT_SEND);
+					ticables_event_fill_data(&event, /* data */ data, /* len */ len);
+					ret = ticables_event_send(handle, &event);
 				}
-				ticables_event_fill_header(handle, &event, /* type */ CABLE_EVENT_TYPE_AFTER_GENERIC_OPERATION, /* retval */ ret, /* operation */ CABLE_FNCT_SEND);
-				ticables_event_fill_data(&event, /* data */ data, /* len */ len);
-				ret = ticables_event_send(handle, &event);
 			}
 		}
 		else
@@ -314,9 +327,12 @@ int TICALL ticables_cable_send(CableHandle* handle, uint8_t *data, uint32_t len)
 		handle->busy = 0;
 	}
 
-	ticables_event_fill_header(handle, &event, /* type */ CABLE_EVENT_TYPE_AFTER_SEND, /* retval */ ret, /* operation */ CABLE_FNCT_LAST);
-	ticables_event_fill_data(&event, /* data */ data, /* len */ len);
-	ret = ticables_event_send(handle, &event);
+	if (ticables_event_wanted(handle, CABLE_EVENT_TYPE_AFTER_SEND))
+	{
+		ticables_event_fill_header(handle, &event, /* type */ CABLE_EVENT_TYPE_AFTER_SEND, /* retval */ ret, /* operation */ CABLE_FNCT_LAST);
+		ticables_event_fill_data(&event, /* data */ data, /* len */ len);
+		ret = ticables_event_send(handle, &event);
+	}
 
 	return ret;
 }
@@ -350,9 +366,12 @@ int TICALL ticables_cable_recv(CableHandle* handle, uint8_t *data, uint32_t len)
 		ticables_critical("ticables_cable_recv: len = 0\n");
 	}
 
-	ticables_event_fill_header(handle, &event, /* type */ CABLE_EVENT_TYPE_BEFORE_RECV, /* retval */ 0, /* operation */ CABLE_FNCT_LAST);
-	ticables_event_fill_data(&event, /* data */ data, /* len */ len);
-	ret = ticables_event_send(handle, &event);
+	if (ticables_event_wanted(handle, CABLE_EVENT_TYPE_BEFORE_RECV))
+	{
+		ticables_event_fill_header(handle, &event, /* type */ CABLE_EVENT_TYPE_BEFORE_RECV, /* retval */ 0, /* operation */ CABLE_FNCT_LAST);
+		ticables_event_fill_data(&event, /* data */ data, /* len */ len);
+		ret = ticables_event_send(handle, &event);
+	}
 	if (!ret)
 	{
 		handle->busy = 1;
@@ -361,16 +380,24 @@ int TICALL ticables_cable_recv(CableHandle* handle, uint8_t *data, uint32_t len)
 			handle->rate.count += len;
 			if (cable->recv)
 			{
-				ticables_event_fill_header(handle, &event, /* type */ CABLE_EVENT_TYPE_BEFORE_GENERIC_OPERATION, /* retval */ 0, /* operation */ CABLE_FNCT_RECV);
-				ticables_event_fill_data(&event, /* data */ data, /* len */ len);
-				ret = ticables_event_send(handle, &event);
+				if (ticables_event_wanted(handle, CABLE_EVENT_TYPE_BEFORE_GENERIC_OPERATION))
+				{
+					ticables_event_fill_header(handle, &event, /* type */ CABLE_EVENT_TYPE_BEFORE_GENERIC_OPERATION, /* retval */ 0, /* operation */ CABLE_FNCT_RECV);
+					ticables_event_fill_data(&event, /* data */ data, /* len */ len);
+					ret = ticables_event_send(handle, &event);
+				}
 				if (!ret)
 				{
+					int64_t start = ticables_metrics_clock(handle);
 					ret = cable->recv(handle, data, len);
+					ticables_metrics_record(handle, CABLE_FNCT_RECV, start, ret, len);
+				}
+				if (ticables_event_wanted(handle, CABLE_EVENT_TYPE_AFTER_GENERIC_OPERATION))
+				{
+					ticables_event_fill_header(handle, &event, /* type */ CABLE_EVENT_TYPE_AFTER_GENERIC_OPERATION, /* retval */ ret, /* operation */ CABLE_FNCT_RECV);
+					ticables_event_fill_data(&event, /* data */ data, /* len */ len);
+					ret = ticables_event_send(handle, &event);
 				}
-				ticables_event_fill_header(handle, &event, /* type */ CABLE_EVENT_TYPE_AFTER_GENERIC_OPERATION, /* retval */ ret, /* operation */ CABLE_FNCT_RECV);
-				ticables_event_fill_data(&event, /* data */ data, /* len */ len);
-				ret = ticables_event_send(handle, &event);
 			}
 		}
 		else
@@ -380,9 +407,12 @@ int TICALL ticables_cable_recv(CableHandle* handle, uint8_t *data, uint32_t len)
 		handle->busy = 0;
 	}
 
-	ticables_event_fill_header(handle, &event, /* type */ CABLE_EVENT_TYPE_AFTER_RECV, /* retval */ ret, /* operation */ CABLE_FNCT_LAST);
-	ticables_event_fill_data(&event, /* data */ data, /* len */ len);
-	ret = ticables_event_send(handle, &event);
+	if (ticables_event_wanted(handle, CABLE_EVENT_TYPE_AFTER_RECV))
+	{
+		ticables_event_fill_header(handle, &event, /* type */ CABLE_EVENT_TYPE_AFTER_RECV, /* retval */ ret, /* operation */ CABLE_FNCT_LAST);
+		ticables_event_fill_data(&event, /* data */ data, /* len */ len);
+		ret = ticables_event_send(handle, &event);
+	}
 
 	return ret;
 }
@@ -419,7 +449,9 @@ int TICALL ticables_cable_check(CableHandle* handle, CableStatus *status)
 			ret = ticables_event_send(handle, &event);
 			if (!ret)
 			{
+				int64_t start = ticables_metrics_clock(handle);
 				ret = cable->check(handle, (int *)status);
+				ticables_metrics_record(handle, CABLE_FNCT_CHECK, start, ret, 0);
 			}
 			ticables_event_fill_header(handle, &event, /* type */ CABLE_EVENT_TYPE_AFTER_GENERIC_OPERATION, /* retval */ ret, /* operation */ CABLE_FNCT_CHECK);
 			event.data.intval = *status;
@@ -877,6 +909,8 @@ int TICALL ticables_cable_get(CableHandle* handle, uint8_t *data)
  */
 ticables_pre_send_hook_type TICALL ticables_cable_get_pre_send_hook(CableHandle *handle)
 {
+	(void)handle;
+
 	ticables_critical("%s: deprecated function, does nothing anymore", __FUNCTION__);
 
 	return NULL;
@@ -892,6 +926,9 @@ ticables_pre_send_hook_type TICALL ticables_cable_get_pre_send_hook(CableHandle
  */
 ticables_pre_send_hook_type TICALL ticables_cable_set_pre_send_hook(CableHandle *handle, ticables_pre_send_hook_type hook)
 {
+	(void)handle;
+	(void)hook;
+
 	ticables_critical("%s: deprecated function, does nothing anymore", __FUNCTION__);
 
 	return NULL;
@@ -906,6 +943,8 @@ ticables_pre_send_hook_type TICALL ticables_cable_set_pre_send_hook(CableHandle
  */
 ticables_post_send_hook_type TICALL ticables_cable_get_post_send_hook(CableHandle *handle)
 {
+	(void)handle;
+
 	ticables_critical("%s: deprecated function, does nothing anymore", __FUNCTION__);
 
 	return NULL;
@@ -921,6 +960,9 @@ ticables_post_send_hook_type TICALL ticables_cable_get_post_send_hook(CableHandl
  */
 ticables_post_send_hook_type TICALL ticables_cable_set_post_send_hook(CableHandle *handle, ticables_post_send_hook_type hook)
 {
+	(void)handle;
+	(void)hook;
+
 	ticables_critical("%s: deprecated function, does nothing anymore", __FUNCTION__);
 
 	return NULL;
@@ -935,6 +977,8 @@ ticables_post_send_hook_type TICALL ticables_cable_set_post_send_hook(CableHandl
  */
 ticables_pre_recv_hook_type TICALL ticables_cable_get_pre_recv_hook(CableHandle *handle)
 {
+	(void)handle;
+
 	ticables_critical("%s: deprecated function, does nothing anymore", __FUNCTION__);
 
 	return NULL;
@@ -950,6 +994,9 @@ ticables_pre_recv_hook_type TICALL ticables_cable_get_pre_recv_hook(CableHandle
  */
 ticables_pre_recv_hook_type TICALL ticables_cable_set_pre_recv_hook(CableHandle *handle, ticables_pre_recv_hook_type hook)
 {
+	(void)handle;
+	(void)hook;
+
 	ticables_critical("%s: deprecated function, does nothing anymore", __FUNCTION__);
 
 	return NULL;
@@ -964,6 +1011,8 @@ ticables_pre_recv_hook_type TICALL ticables_cable_set_pre_recv_hook(CableHandle
  */
 ticables_post_recv_hook_type TICALL ticables_cable_get_post_recv_hook(CableHandle *handle)
 {
+	(void)handle;
+
 	ticables_critical("%s: deprecated function, does nothing anymore", __FUNCTION__);
 
 	return NULL;
@@ -979,6 +1028,9 @@ ticables_post_recv_hook_type TICALL ticables_cable_get_post_recv_hook(CableHandl
  */
 ticables_post_recv_hook_type TICALL ticables_cable_set_post_recv_hook(CableHandle *handle, ticables_post_recv_hook_type hook)
 {
+	(void)handle;
+	(void)hook;
+
 	ticables_critical("%s: deprecated function, does nothing anymore", __FUNCTION__);
 
 	return NULL;
@@ -1022,6 +1074,8 @@ ticables_event_hook_type TICALL ticables_cable_set_event_hook(CableHandle *handl
 
 	old_hook = handle->event_hook;
 	handle->event_hook = hook;
+	// A custom hook gets every event unless it narrows the mask afterwards.
+	handle->event_mask = CABLE_EVENT_MASK_ALL;
 
 	return old_hook;
 }
@@ -1103,15 +1157,230 @@ int TICALL ticables_cable_fire_user_event(CableHandle *handle, CableEventType ty
 
 	VALIDATE_HANDLE(handle);
 
-	if (handle->event_hook && type >= CABLE_EVENT_TYPE_USER)
+	if (type >= CABLE_EVENT_TYPE_USER && ticables_event_wanted(handle, type))
 	{
 		CableEventData event;
 		ticables_event_fill_header(handle, &event, /* type */ type, /* retval */ retval, /* operation */ CABLE_FNCT_LAST);
 		event.data.user_data.data = (uint8_t *)user_data;
 		event.data.user_data.len = user_len;
-		handle->event_count++;
-		ret = handle->event_hook(handle, handle->event_count, &event, handle->user_pointer);
+		ret = ticables_event_send(handle, &event);
 	}
 
 	return ret;
 }
+
+/**
+ * ticables_cable_get_event_mask:
+ * @handle: a previously allocated handle.
+ *
+ * Get the classes of events (CableEventMask) dispatched by this handle.
+ *
+ * Return value: a binary OR of CABLE_EVENT_MASK_* values.
+ */
+uint32_t TICALL ticables_cable_get_event_mask(CableHandle *handle)
+{
+	if (!ticables_validate_handle(handle))
+	{
+		ticables_critical("%s: handle is NULL", __FUNCTION__);
+		return 0;
+	}
+
+	return handle->event_mask;
+}
+
+/**
+ * ticables_cable_set_event_mask:
+ * @handle: a previously allocated handle.
+ * @mask: binary OR of CABLE_EVENT_MASK_* values.
+ *
+ * Select the classes of events dispatched to the event hook and trace ring.
+ * Events outside the mask are neither built nor counted.
+ * Note that ticables_cable_set_event_hook() resets the mask to CABLE_EVENT_MASK_ALL.
+ *
+ * Return value: the previous mask.
+ */
+uint32_t TICALL ticables_cable_set_event_mask(CableHandle *handle, uint32_t mask)
+{
+	uint32_t old_mask;
+
+	if (!ticables_validate_handle(handle))
+	{
+		ticables_critical("%s: handle is NULL", __FUNCTION__);
+		return 0;
+	}
+
+	old_mask = handle->event_mask;
+	handle->event_mask = mask & CABLE_EVENT_MASK_ALL;
+
+	return old_mask;
+}
+
+/*
+	Event trace ring: the thread driving the handle is the only writer, so
+	claiming a slot is a plain increment. Each slot carries a sequence number
+	which is cleared while the slot is being written, letting readers on other
+	threads detect and skip records that were overwritten under them.
+	trace_lock only keeps trace_read from using a ring that trace_stop is
+	freeing; the writer needs no lock, as trace_stop refuses busy handles.
+*/
+
+typedef struct
+{
+	volatile gint seq;
+	CableTraceEntry entry;
+} CableTraceSlot;
+
+typedef struct
+{
+	unsigned int size;	// power of two
+	volatile gint head;	// number of records written so far
+	CableTraceSlot *slots;
+} CableTrace;
+
+static GMutex trace_lock;
+
+void ticables_event_trace(CableHandle * handle, const CableEventData * event)
+{
+	CableTrace *trace = (CableTrace *)handle->trace;
+	guint pos = (guint)g_atomic_int_get(&trace->head);
+	CableTraceSlot *slot = &trace->slots[pos & (trace->size - 1)];
+	CableTraceEntry *entry = &slot->entry;
+
+	g_atomic_int_set(&slot->seq, 0);
+
+	entry->event_count = handle->event_count;
+	entry->type = event->type;
+	entry->operation = event->operation;
+	entry->retval = event->retval;
+	entry->len = 0;
+	if (   (event->type >= CABLE_EVENT_TYPE_BEFORE_SEND && event->type <= CABLE_EVENT_TYPE_AFTER_RECV)
+	    || (event->operation == CABLE_FNCT_SEND || event->operation == CABLE_FNCT_RECV))
+	{
+		entry->len = event->data.data.len;
+	}
+	entry->timestamp = g_get_monotonic_time();
+
+	g_atomic_int_set(&slot->seq, (gint)(pos + 1));
+	g_atomic_int_set(&trace->head, (gint)(pos + 1));
+}
+
+/**
+ * ticables_cable_trace_start:
+ * @handle: a previously allocated handle.
+ * @size: number of records kept (rounded up to a power of two).
+ *
+ * Start recording the events dispatched by this handle (see
+ * ticables_cable_set_event_mask) into a ring of the last @size records.
+ * Recording works with or without an event hook.
+ *
+ * Return value: 0 if successful, an error code otherwise.
+ */
+int TICALL ticables_cable_trace_start(CableHandle *handle, unsigned int size)
+{
+	CableTrace *trace;
+	unsigned int n = 1;
+
+	VALIDATE_HANDLE(handle);
+	RETURN_IF_HANDLE_BUSY(handle);
+
+	if (handle->trace != NULL || size == 0 || size > (1U << 20))
+	{
+		return ERR_ILLEGAL_ARG;
+	}
+
+	while (n < size)
+	{
+		n <<= 1;
+	}
+
+	trace = (CableTrace *)g_malloc0(sizeof(CableTrace));
+	trace->size = n;
+	trace->slots = (CableTraceSlot *)g_malloc0(n * sizeof(CableTraceSlot));
+	g_mutex_lock(&trace_lock);
+	handle->trace = trace;
+	g_mutex_unlock(&trace_lock);
+
+	return 0;
+}
+
+/**
+ * ticables_cable_trace_read:
+ * @handle: a previously allocated handle.
+ * @entries: where to store the records, oldest first.
+ * @max: capacity of @entries.
+ * @count: number of records stored.
+ *
+ * Copy the most recent trace records. This does not lock the handle and may
+ * be called from another thread while transfers are running; records being
+ * overwritten at that moment are skipped.
+ *
+ * Return value: 0 if successful, an error code otherwise.
+ */
+int TICALL ticables_cable_trace_read(CableHandle *handle, CableTraceEntry *entries, unsigned int max, unsigned int *count)
+{
+	CableTrace *trace;
+	guint head, first, pos;
+	unsigned int n = 0;
+
+	VALIDATE_HANDLE(handle);
+	VALIDATE_NONNULL(entries);
+	VALIDATE_NONNULL(count);
+
+	g_mutex_lock(&trace_lock);
+	trace = (CableTrace *)handle->trace;
+	if (trace == NULL)
+	{
+		g_mutex_unlock(&trace_lock);
+		return ERR_ILLEGAL_ARG;
+	}
+
+	head = (guint)g_atomic_int_get(&trace->head);
+	first = head - MIN(head, MIN(trace->size, max));
+	for (pos = first; pos != head; pos++)
+	{
+		CableTraceSlot *slot = &trace->slots[pos & (trace->size - 1)];
+
+		if ((guint)g_atomic_int_get(&slot->seq) != pos + 1)
+		{
+			continue;
+		}
+		entries[n] = slot->entry;
+		if ((guint)g_atomic_int_get(&slot->seq) == pos + 1)
+		{
+			n++;
+		}
+	}
+	g_mutex_unlock(&trace_lock);
+	*count = n;
+
+	return 0;
+}
+
+/**
+ * ticables_cable_trace_stop:
+ * @handle: a previously allocated handle.
+ *
+ * Stop recording events and release the trace ring.
+ *
+ * Return value: 0 if successful, an error code otherwise.
+ */
+int TICALL ticables_cable_trace_stop(CableHandle *handle)
+{
+	CableTrace *trace;
+
+	VALIDATE_HANDLE(handle);
+	RETURN_IF_HANDLE_BUSY(handle);
+
+	g_mutex_lock(&trace_lock);
+	trace = (CableTrace *)handle->trace;
+	handle->trace = NULL;
+	g_mutex_unlock(&trace_lock);
+
+	if (trace != NULL)
+	{
+		g_free(trace->slots);
+		g_free(trace);
+	}
+
+	return 0;
+}
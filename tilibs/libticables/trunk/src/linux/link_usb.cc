@@ -104,10 +104,6 @@
 #endif
 
 # define usb_busses	usb_get_busses()
-
-/* variables for slv_check and slv_bulk_read2 */
-static int io_pending = 0;
-static void *context = 0;
 #endif
 
 /* --- */
@@ -200,10 +196,6 @@ extern int usb_debug;
 		} \
 		return x; \
 	} while (0)
-
-/* variables for slv_check and slv_bulk_read2 */
-static int io_pending = 0;
-static struct usb_urb urb;
 #endif
 
 /* --- */
@@ -226,7 +218,7 @@ static struct usb_urb urb;
 
 /* Constants */
 
-#define MAX_CABLES   4
+#define MAX_CABLES   USB_MAX_CABLES
 
 #define VID_TI  0x0451     /* Texas Instruments, Inc.            */
 
@@ -255,9 +247,12 @@ static const usb_infos tigl_infos[] =
 	{0,      0,            NULL,                          NULL}
 };
 
-// list of devices found 
+// list of devices found, shared by all handles: only touch it with tigl_lock held.
+// usb_find_busses() & usb_find_devices() rebuild the libusb device list, hence
+// enumeration and usb_open() are serialized by the same lock.
 static USBCableInfo tigl_devices[MAX_CABLES+1];
 static int tigl_n_devices;
+static GMutex tigl_lock;
 
 // internal structure for holding data
 typedef struct
@@ -273,6 +268,14 @@ typedef struct
 	int               out_endpoint;
 	int               max_ps;
 	int               was_max_size_packet;
+
+	// state of the read left in flight by slv_check, picked up by slv_bulk_read2
+	int               io_pending;
+#if defined(__WIN32__)
+	void *            context;
+#elif defined(__LINUX__)
+	struct usb_urb    urb;	// keep last (flexible array member)
+#endif
 } usb_struct;
 
 // convenient macros
@@ -286,6 +289,12 @@ typedef struct
 #define rBufPtr             (((usb_struct *)(h->priv2))->rBufPtr)
 #define uInEnd              (((usb_struct *)(h->priv2))->in_endpoint)
 #define uOutEnd             (((usb_struct *)(h->priv2))->out_endpoint)
+#define io_pending          (((usb_struct *)(h->priv2))->io_pending)
+#if defined(__WIN32__)
+#define context             (((usb_struct *)(h->priv2))->context)
+#elif defined(__LINUX__)
+#define urb                 (((usb_struct *)(h->priv2))->urb)
+#endif
 
 /* Helpers (=driver API) */
 
@@ -384,22 +393,32 @@ static int tigl_enum(void)
 	return 0;
 }
 
-static int tigl_open(int id, usb_dev_handle **udh)
+static int tigl_open(CableHandle *h)
 {
 	int ret;
+	usb_dev_handle **udh = &uHdl;
 
+	g_mutex_lock(&tigl_lock);
 	ret = tigl_enum();
-	if (ret)
+	if (!ret)
 	{
-		return ret;
+		if (tigl_devices[h->address].dev != NULL)
+		{
+			cable_info = tigl_devices[h->address];
+			uDev = (struct usb_device *)(tigl_devices[h->address].dev);
+			*udh = usb_open(uDev);
+		}
+		else
+		{
+			ret = ERR_LIBUSB_OPEN;
+		}
 	}
-
-	if (tigl_devices[id].dev == NULL)
+	g_mutex_unlock(&tigl_lock);
+	if (ret)
 	{
-		return ERR_LIBUSB_OPEN;
+		return ret;
 	}
 
-	*udh = usb_open((struct usb_device *)(tigl_devices[id].dev));
 	if (*udh != NULL) 
 	{
 		/* only one configuration: #1 */
@@ -504,13 +523,11 @@ static int slv_open(CableHandle *h)
 	struct usb_endpoint_descriptor *endpoint;    
 
 	// open device
-	ret = tigl_open(h->address, &uHdl);
+	ret = tigl_open(h);
 	if (ret)
 	{
 		return ret;
 	}
-	cable_info = tigl_devices[h->address];
-	uDev = (struct usb_device *)(tigl_devices[h->address].dev);
 	uInEnd  = 0x81;
 	uOutEnd = 0x02;
 
@@ -650,7 +667,7 @@ static int send_block(CableHandle *h, uint8_t *data, int length)
 		return ERR_WRITE_ERROR;
 	}
 
-	if (tigl_devices[h->address].pid == PID_NSPIRE && length % max_ps == 0)
+	if (cable_info.pid == PID_NSPIRE && length % max_ps == 0)
 	{
 		ticables_info("XXX triggering an extra bulk write");
 		ret = usb_bulk_write(uHdl, uOutEnd, (char*)data, 0, to);
@@ -671,21 +688,22 @@ static int slv_put(CableHandle* h, uint8_t *data, uint32_t len)
 
 #ifdef __LINUX__
 #define MAX_READ_WRITE  (16 * 1024)
-static int slv_bulk_read2(usb_dev_handle *dev, int ep, char *bytes, int size,
+static int slv_bulk_read2(CableHandle *h, int ep, char *bytes, int size,
 	int timeout)
 {
 	// This is a variant of usb_bulk_read in libusb, edited to take the
 	// io_pending variable set in slv_check into account.
+	usb_dev_handle *dev = uHdl;
 	unsigned int bytesdone = 0, requested;
 	struct timeval tv, tv_ref, tv_now;
-	void *context;
+	void *reaped;
 	int ret, waiting;
 
 	/*
-	 * FIXME: The use of the URB interface is incorrect here if there are
-	 * multiple callers at the same time. We assume we're the only caller
-	 * and if we get completions from another caller, this code will fail
-	 * in interesting ways.
+	 * The URB lives in the handle and is reaped from this device's own file
+	 * descriptor, so handles on different devices don't see each other's
+	 * completions. A given handle must not be read from two threads at once
+	 * (the busy flag of libticables already prevents this).
 	 */
 
 	/*
@@ -737,7 +755,7 @@ static int slv_bulk_read2(usb_dev_handle *dev, int ep, char *bytes, int size,
 		FD_SET(dev->fd, &writefds);
 
 		waiting = 1;
-		while (((ret = ioctl(dev->fd, IOCTL_USB_REAPURBNDELAY, &context)) == -1) && waiting) {
+		while (((ret = ioctl(dev->fd, IOCTL_USB_REAPURBNDELAY, &reaped)) == -1) && waiting) {
 			tv.tv_sec = 0;
 			tv.tv_usec = 1000; // 1 msec
 			select(dev->fd + 1, NULL, &writefds, NULL, &tv); //sub second wait
@@ -789,7 +807,7 @@ static int slv_bulk_read2(usb_dev_handle *dev, int ep, char *bytes, int size,
 		 * then we need to reap it or else the next time we call this function,
 		 * we'll get the previous completion and exit early
 		 */
-		ioctl(dev->fd, IOCTL_USB_REAPURB, &context);
+		ioctl(dev->fd, IOCTL_USB_REAPURB, &reaped);
 
 		return rc;
 	}
@@ -800,13 +818,14 @@ static int slv_bulk_read2(usb_dev_handle *dev, int ep, char *bytes, int size,
 
 #ifdef _WIN32
 #define LIBUSB_MAX_READ_WRITE 0x10000
-static int slv_bulk_read2(usb_dev_handle *dev, int ep, char *bytes, int size,
+static int slv_bulk_read2(CableHandle *h, int ep, char *bytes, int size,
                    int timeout)
 {
 	// This is a variant of usb_bulk_read in libusb-win32, edited to take the
 	// io_pending variable set in slv_check into account and to use the public
 	// async API instead of the private one.
 
+	usb_dev_handle *dev = uHdl;
 	int transmitted = 0;
 	int ret;
 	int requested;
@@ -872,7 +891,7 @@ static int slv_get_(CableHandle *h, uint8_t *data)
 		{
 			// NOTE: slv_get() has already checked for uHdl != NULL .
 #if defined(__LINUX__) || defined(__WIN32__)
-			ret = slv_bulk_read2(uHdl, uInEnd, (char*)rBuf, max_ps, to);
+			ret = slv_bulk_read2(h, uInEnd, (char*)rBuf, max_ps, to);
 #else
 			ret = usb_bulk_read(uHdl, uInEnd, (char*)rBuf, max_ps, to);
 #endif
@@ -949,17 +968,17 @@ static int slv_get(CableHandle* h, uint8_t *data, uint32_t len)
 		}
 	}
 
-	if (!ret &&   (tigl_devices[h->address].pid == PID_NSPIRE   && was_max_size_packet != 0 && nBytesRead == 0)
-	           || (len == 0 && (   (tigl_devices[h->address].pid == PID_TI89TM   && was_max_size_packet != 0 && nBytesRead == 0)
-			            || (tigl_devices[h->address].pid == PID_TI84P    && was_max_size_packet != 0 && nBytesRead == 0)
-			            || (tigl_devices[h->address].pid == PID_TI84P_SE && was_max_size_packet != 0 && nBytesRead == 0)
+	if (!ret &&   (cable_info.pid == PID_NSPIRE   && was_max_size_packet != 0 && nBytesRead == 0)
+	           || (len == 0 && (   (cable_info.pid == PID_TI89TM   && was_max_size_packet != 0 && nBytesRead == 0)
+			            || (cable_info.pid == PID_TI84P    && was_max_size_packet != 0 && nBytesRead == 0)
+			            || (cable_info.pid == PID_TI84P_SE && was_max_size_packet != 0 && nBytesRead == 0)
 			           )
 	              )
 	   )
 	{
 		ticables_info("XXX triggering an extra bulk read");
 #if defined(__LINUX__) || defined(__WIN32__)
-		ret = slv_bulk_read2(uHdl, uInEnd, (char*)rBuf, max_ps, to);
+		ret = slv_bulk_read2(h, uInEnd, (char*)rBuf, max_ps, to);
 #else
 		ret = usb_bulk_read(uHdl, uInEnd, (char*)rBuf, max_ps, to);
 #endif
@@ -972,23 +991,33 @@ static int slv_get(CableHandle* h, uint8_t *data, uint32_t len)
 	return ret;
 }
 
-static int slv_probe(CableHandle *h)
+// enumerate devices and return the PID found at the handle's address (0 if none)
+static int tigl_probe_pid(CableHandle *h, uint16_t *pid)
 {
 	int ret;
-	int i;
 
+	g_mutex_lock(&tigl_lock);
 	ret = tigl_enum();
+	*pid = ret ? 0 : tigl_devices[h->address].pid;
+	g_mutex_unlock(&tigl_lock);
+
+	return ret;
+}
+
+static int slv_probe(CableHandle *h)
+{
+	int ret;
+	uint16_t pid;
+
+	ret = tigl_probe_pid(h, &pid);
 	if (ret)
 	{
 		return ret;
 	}
 
-	for(i = 0; i < MAX_CABLES; i++)
+	if (pid == PID_TIGLUSB)
 	{
-		if (tigl_devices[h->address].pid == PID_TIGLUSB)
-		{
-			return 0;
-		}
+		return 0;
 	}
 
 	return ERR_PROBE_FAILED;
@@ -997,23 +1026,20 @@ static int slv_probe(CableHandle *h)
 static int raw_probe(CableHandle *h)
 {
 	int ret;
-	int i;
+	uint16_t pid;
 
-	ret = tigl_enum();
+	ret = tigl_probe_pid(h, &pid);
 	if (ret)
 	{
 		return ret;
 	}
 
-	for(i = 0; i < MAX_CABLES; i++)
+	if (pid == PID_TI89TM ||
+	    pid == PID_TI84P ||
+	    pid == PID_TI84P_SE ||
+	    pid == PID_NSPIRE)
 	{
-		if (tigl_devices[h->address].pid == PID_TI89TM ||
-		    tigl_devices[h->address].pid == PID_TI84P ||
-		    tigl_devices[h->address].pid == PID_TI84P_SE ||
-		    tigl_devices[h->address].pid == PID_NSPIRE)
-		{
-			return 0;
-		}
+		return 0;
 	}
 
 	return ERR_PROBE_FAILED;
@@ -1026,7 +1052,7 @@ static int slv_check(CableHandle *h, int *status)
 	// adapted by Kevin Kofler for use here. It's required to get TiEmu 3 to
 	// work with the SilverLink.
 
-	void *context;
+	void *reaped;
 	int ret;
 
 	if (nBytesRead > 0)
@@ -1060,7 +1086,7 @@ static int slv_check(CableHandle *h, int *status)
 		io_pending = TRUE;
 	}
 
-	ret = ioctl(uHdl->fd, IOCTL_USB_REAPURBNDELAY, &context);
+	ret = ioctl(uHdl->fd, IOCTL_USB_REAPURBNDELAY, &reaped);
 	if (ret < 0 && errno != EAGAIN)
 	{
 		// Error, unlink URB and return failure.
@@ -1071,7 +1097,7 @@ static int slv_check(CableHandle *h, int *status)
 		 * then we need to reap it or else the next time we call this function,
 		 * we'll get the previous completion and exit early
 		 */
-		ioctl(uHdl->fd, IOCTL_USB_REAPURB, &context);
+		ioctl(uHdl->fd, IOCTL_USB_REAPURB, &reaped);
 
 		io_pending = FALSE;
 		return ERR_READ_ERROR;
@@ -1177,19 +1203,22 @@ extern const CableFncts cable_raw =
 
 //=======================
 
-// returns list of detected devices
-int usb_probe_device_info(const USBCableInfo **list, int *count)
+// copies the list of detected devices (at most USB_MAX_CABLES entries)
+int usb_probe_device_info(USBCableInfo *list, int *count)
 {
 	int ret;
+
+	g_mutex_lock(&tigl_lock);
 	if (!(ret = tigl_enum()))
 	{
-		*list = tigl_devices;
+		memcpy(list, tigl_devices, tigl_n_devices * sizeof(USBCableInfo));
 		*count = tigl_n_devices;
 	}
 	else
 	{
-		*list = NULL;
 		*count = 0;
 	}
+	g_mutex_unlock(&tigl_lock);
+
 	return ret;
 }
@@ -76,7 +76,7 @@
 
 /* Constants */
 
-#define MAX_CABLES   4
+#define MAX_CABLES   USB_MAX_CABLES
 
 #define VID_TI       0x0451     /* Texas Instruments, Inc.            */
 
@@ -105,9 +105,12 @@ static usb_infos tigl_infos[] =
 	{0,      0,            NULL,                          NULL}
 };
 
-// list of devices found
+// list of devices found, shared by all handles: only touch it with tigl_lock held.
+// Each entry holds a reference on its libusb_device, dropped at the next enumeration;
+// open handles take their own reference.
 static USBCableInfo tigl_devices[MAX_CABLES+1];
 static int tigl_n_devices;
+static GMutex tigl_lock;
 
 // internal structure for holding data
 typedef struct
@@ -123,12 +126,12 @@ typedef struct
 	int      out_endpoint;
 	int      max_ps;
 	int      was_max_ps;
-} usb_struct;
 
-// variables for slv_check and slv_bulk_read
-static int io_pending = 0;
-static struct libusb_transfer *transfer;
-static int completed = 0;
+	// read left in flight by slv_check, picked up by slv_bulk_read
+	int      io_pending;
+	struct libusb_transfer *transfer;
+	int      completed;
+} usb_struct;
 
 // convenient macros
 #define uDev       (((usb_struct *)(h->priv2))->device)
@@ -141,6 +144,9 @@ static int completed = 0;
 #define rBufPtr    (((usb_struct *)(h->priv2))->rBufPtr)
 #define uInEnd     (((usb_struct *)(h->priv2))->in_endpoint)
 #define uOutEnd    (((usb_struct *)(h->priv2))->out_endpoint)
+#define io_pending (((usb_struct *)(h->priv2))->io_pending)
+#define transfer   (((usb_struct *)(h->priv2))->transfer)
+#define completed  (((usb_struct *)(h->priv2))->completed)
 
 #if !HAVE_LIBUSB10_STRERROR
 #error Please use a version of libusb 1.0 which provides libusb_strerror() (>= 1.0.16).
@@ -184,23 +190,34 @@ static int tigl_find(void)
 	int j = 0;
 	int k;
 
-	if (cnt <= 0)
+	for (k = 0; k < tigl_n_devices; k++)
 	{
-		return 0;
+		libusb_unref_device((libusb_device *)tigl_devices[k].dev);
 	}
-
 	memset(tigl_devices, 0, sizeof(tigl_devices));
 	tigl_n_devices = 0;
 
-	for (i = 0; i < cnt; i++)
+	if (cnt < 0)
+	{
+		return 0;
+	}
+
+	// an empty list is still allocated
+	if (cnt == 0)
+	{
+		libusb_free_device_list(list, 1);
+		return 0;
+	}
+
+	for (i = 0; i < cnt && j < MAX_CABLES; i++)
 	{
 		libusb_device *device = list[i];
 		struct libusb_device_descriptor desc;
 		int r = libusb_get_device_descriptor(device, &desc);
 		if (r < 0)
 		{
-			fprintf(stderr, "failed to get device descriptor");
-			return r;
+			ticables_warning("failed to get device descriptor");
+			continue;
 		}
 		if (desc.idVendor == VID_TI)
 		{
@@ -217,17 +234,16 @@ static int tigl_find(void)
 						      desc.bcdDevice >> 8,
 						      desc.bcdDevice & 0xff);
 
-					tigl_devices[j++].dev = device;
+					tigl_devices[j++].dev = libusb_ref_device(device);
 					tigl_n_devices = j;
-
-					if (j >= MAX_CABLES)
-					{
-						return j;
-					}
+					break;
 				}
 			}
 		}
 	}
+
+	libusb_free_device_list(list, 1);
+
 	return j;
 }
 
@@ -246,18 +262,26 @@ static int tigl_enum(void)
 	return 0;
 }
 
-static int tigl_open(int id, libusb_device_handle ** udh)
+static int tigl_open(CableHandle *h)
 {
 	int ret;
+	libusb_device_handle **udh = &uHdl;
 
+	g_mutex_lock(&tigl_lock);
 	tigl_enum();
+	if (tigl_devices[h->address].dev != NULL)
+	{
+		cable_info = tigl_devices[h->address];
+		uDev = libusb_ref_device((libusb_device *)(tigl_devices[h->address].dev));
+	}
+	g_mutex_unlock(&tigl_lock);
 
-	if (tigl_devices[id].dev == NULL)
+	if (uDev == NULL)
 	{
 		return ERR_LIBUSB_OPEN;
 	}
 
-	if (!libusb_open((libusb_device *)(tigl_devices[id].dev), udh))
+	if (!libusb_open(uDev, udh))
 	{
 		/* only one configuration: #1 */
 		ret = libusb_set_configuration(*udh, 1);
@@ -271,6 +295,10 @@ static int tigl_open(int id, libusb_device_handle ** udh)
 		if (ret)
 		{
 			ticables_warning("libusb_claim_interface (%s).\n", libusb_strerror((libusb_error)ret));
+			libusb_close(*udh);
+			*udh = NULL;
+			libusb_unref_device(uDev);
+			uDev = NULL;
 			return ERR_LIBUSB_CLAIM;
 		}
 
@@ -278,14 +306,18 @@ static int tigl_open(int id, libusb_device_handle ** udh)
 	}
 	else
 	{
+		libusb_unref_device(uDev);
+		uDev = NULL;
 		return ERR_LIBUSB_OPEN;
 	}
 
 	return 0;
 }
 
-static int tigl_close(libusb_device_handle **udh)
+static int tigl_close(CableHandle *h)
 {
+	libusb_device_handle **udh = &uHdl;
+
 	// cancel any pending transfers to prevent a segfault in libusb
 	if (io_pending)
 	{
@@ -295,7 +327,7 @@ static int tigl_close(libusb_device_handle **udh)
 			libusb_cancel_transfer(transfer);
 			while (!completed)
 			{
-				if (libusb_handle_events(NULL) < 0)
+				if (libusb_handle_events_completed(NULL, &completed) < 0)
 				{
 					break;
 				}
@@ -380,14 +412,12 @@ static int slv_open(CableHandle *h)
 	const struct libusb_endpoint_descriptor *endpoint;
 
 	// open device
-	ret = tigl_open(h->address, &uHdl);
+	ret = tigl_open(h);
 	if (ret)
 	{
 		return ret;
 	}
 
-	cable_info = tigl_devices[h->address];
-	uDev = (libusb_device *)(tigl_devices[h->address].dev);
 	uInEnd  = 0x81;
 	uOutEnd = 0x02;
 
@@ -433,10 +463,14 @@ static int slv_close(CableHandle *h)
 {
 	if (uHdl != NULL)
 	{
-		tigl_close(&uHdl);
+		tigl_close(h);
 	}
 
-	uDev = NULL;
+	if (uDev != NULL)
+	{
+		libusb_unref_device(uDev);
+		uDev = NULL;
+	}
 
 	free(h->priv2);
 	h->priv2 = NULL;
@@ -517,7 +551,7 @@ static int send_block(CableHandle *h, uint8_t *data, int length)
 		return ERR_WRITE_ERROR;
 	}
 
-	if (tigl_devices[h->address].pid == PID_NSPIRE && length % max_ps == 0)
+	if (cable_info.pid == PID_NSPIRE && length % max_ps == 0)
 	{
 		ticables_info("XXX triggering an extra bulk write");
 		ret = libusb_bulk_transfer(uHdl, uOutEnd, (unsigned char*)data, 0, &tmp, to);
@@ -550,12 +584,16 @@ static void LIBUSB_CALL bulk_transfer_cb(struct libusb_transfer *transfer2)
 	/* caller interprets results and frees transfer */
 }
 
-static int slv_bulk_read(struct libusb_device_handle *dev_handle,
+static int slv_bulk_read(CableHandle *h,
 	unsigned char endpoint, unsigned char *buffer, int length,
 	int *transferred, unsigned int timeout)
 {
 	// This is a variant of libusb_bulk_transfer in libusb, edited to take
 	// the io_pending variable set in slv_check into account.
+	// The transfer and its completion flag live in the handle; waiting with
+	// libusb_handle_events_completed() lets several handles pump events of
+	// the shared libusb context from their own threads.
+	struct libusb_device_handle *dev_handle = uHdl;
 	int r;
 
 	if (io_pending)
@@ -585,7 +623,7 @@ static int slv_bulk_read(struct libusb_device_handle *dev_handle,
 
 	while (!completed)
 	{
-		r = libusb_handle_events(NULL);
+		r = libusb_handle_events_completed(NULL, &completed);
 		if (r < 0)
 		{
 			if (r == LIBUSB_ERROR_INTERRUPTED)
@@ -595,7 +633,7 @@ static int slv_bulk_read(struct libusb_device_handle *dev_handle,
 			libusb_cancel_transfer(transfer);
 			while (!completed)
 			{
-				if (libusb_handle_events(NULL) < 0)
+				if (libusb_handle_events_completed(NULL, &completed) < 0)
 				{
 					break;
 				}
@@ -645,7 +683,7 @@ static int slv_get_(CableHandle *h, uint8_t *data)
 		do
 		{
 			// NOTE: slv_get() has already checked for uHdl != NULL .
-			ret = slv_bulk_read(uHdl, uInEnd, (unsigned char*)rBuf, max_ps, &len, to);
+			ret = slv_bulk_read(h, uInEnd, (unsigned char*)rBuf, max_ps, &len, to);
 		}
 		while(!len && !ret);
 
@@ -710,15 +748,15 @@ static int slv_get(CableHandle* h, uint8_t *data, uint32_t len)
 
 	if (!ret && was_max_ps != 0 && nBytesRead == 0)
 	{
-		if (   tigl_devices[h->address].pid == PID_NSPIRE
-		    || len == 0 && (   tigl_devices[h->address].pid == PID_TI89TM
-		                    || tigl_devices[h->address].pid == PID_TI84P
-		                    || tigl_devices[h->address].pid == PID_TI84P_SE
+		if (   cable_info.pid == PID_NSPIRE
+		    || len == 0 && (   cable_info.pid == PID_TI89TM
+		                    || cable_info.pid == PID_TI84P
+		                    || cable_info.pid == PID_TI84P_SE
 		                   )
 		   )
 		{
 			ticables_info("XXX triggering an extra bulk read");
-			ret = slv_bulk_read(uHdl, uInEnd, (unsigned char*)data, max_ps, &tmp, to);
+			ret = slv_bulk_read(h, uInEnd, (unsigned char*)data, max_ps, &tmp, to);
 
 			if (ret == LIBUSB_ERROR_TIMEOUT)
 			{
@@ -738,23 +776,33 @@ static int slv_get(CableHandle* h, uint8_t *data, uint32_t len)
 	return ret;
 }
 
-static int slv_probe(CableHandle *h)
+// enumerate devices and return the PID found at the handle's address (0 if none)
+static int tigl_probe_pid(CableHandle *h, uint16_t *pid)
 {
 	int ret;
-	int i;
 
+	g_mutex_lock(&tigl_lock);
 	ret = tigl_enum();
+	*pid = ret ? 0 : tigl_devices[h->address].pid;
+	g_mutex_unlock(&tigl_lock);
+
+	return ret;
+}
+
+static int slv_probe(CableHandle *h)
+{
+	int ret;
+	uint16_t pid;
+
+	ret = tigl_probe_pid(h, &pid);
 	if (ret)
 	{
 		return ret;
 	}
 
-	for (i = 0; i < MAX_CABLES; i++)
+	if (pid == PID_TIGLUSB)
 	{
-		if (tigl_devices[h->address].pid == PID_TIGLUSB)
-		{
-			return 0;
-		}
+		return 0;
 	}
 
 	return ERR_PROBE_FAILED;
@@ -763,23 +811,20 @@ static int slv_probe(CableHandle *h)
 static int raw_probe(CableHandle *h)
 {
 	int ret;
-	int i;
+	uint16_t pid;
 
-	ret = tigl_enum();
+	ret = tigl_probe_pid(h, &pid);
 	if (ret)
 	{
 		return ret;
 	}
 
-	for(i = 0; i < MAX_CABLES; i++)
+	if (pid == PID_TI89TM ||
+	    pid == PID_TI84P ||
+	    pid == PID_TI84P_SE ||
+	    pid == PID_NSPIRE)
 	{
-		if (tigl_devices[h->address].pid == PID_TI89TM ||
-		    tigl_devices[h->address].pid == PID_TI84P ||
-		    tigl_devices[h->address].pid == PID_TI84P_SE ||
-		    tigl_devices[h->address].pid == PID_NSPIRE)
-		{
-			return 0;
-		}
+		return 0;
 	}
 
 	return ERR_PROBE_FAILED;
@@ -831,7 +876,7 @@ static int slv_check(CableHandle *h, int *status)
 
 	tv.tv_sec = 0;
 	tv.tv_usec = 0;
-	r = libusb_handle_events_timeout(NULL, &tv);
+	r = libusb_handle_events_timeout_completed(NULL, &tv, &completed);
 	if (r < 0)
 	{
 		if (r == LIBUSB_ERROR_INTERRUPTED)
@@ -841,7 +886,7 @@ static int slv_check(CableHandle *h, int *status)
 		libusb_cancel_transfer(transfer);
 		while (!completed)
 		{
-			if (libusb_handle_events(NULL) < 0)
+			if (libusb_handle_events_completed(NULL, &completed) < 0)
 			{
 				break;
 			}
@@ -909,19 +954,22 @@ extern const CableFncts cable_raw =
 
 //=======================
 
-// returns list of detected devices
-int usb_probe_device_info(const USBCableInfo **list, int *count)
+// copies the list of detected devices (at most USB_MAX_CABLES entries)
+int usb_probe_device_info(USBCableInfo *list, int *count)
 {
 	int ret;
+
+	g_mutex_lock(&tigl_lock);
 	if (!(ret = tigl_enum()))
 	{
-		*list = tigl_devices;
+		memcpy(list, tigl_devices, tigl_n_devices * sizeof(USBCableInfo));
 		*count = tigl_n_devices;
 	}
 	else
 	{
-		*list = NULL;
 		*count = 0;
 	}
+	g_mutex_unlock(&tigl_lock);
+
 	return ret;
 }
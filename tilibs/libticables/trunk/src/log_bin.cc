@@ -0,0 +1,112 @@
+/* Hey EMACS -*- linux-c -*- */
+/* $Id$ */
+
+/*  libticables2 - link cable library, a part of the TiLP project
+ *  Copyright (C) 1999-2005  Romain Lievin
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/* 
+	Binary logging (compact framed records, see log_bin.h).
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+
+#include "logging.h"
+#include "data_log.h"
+#include "log_bin.h"
+
+static char *ofn = NULL;
+static FILE *logfile = NULL;
+
+int log_bin_start(void)
+{
+	uint8_t hdr[12];
+	int ret;
+
+	ofn = g_strconcat(g_get_home_dir(), G_DIR_SEPARATOR_S, LOG_DIR, G_DIR_SEPARATOR_S, BIN_FILE, NULL);
+
+	logfile = fopen(ofn, "wb");
+	if (logfile != NULL)
+	{
+		memcpy(hdr, BIN_MAGIC, 8);
+		hdr[8] = BIN_VERSION & 0xFF;
+		hdr[9] = (BIN_VERSION >> 8) & 0xFF;
+		hdr[10] = hdr[11] = 0;
+		fwrite(hdr, sizeof(hdr), 1, logfile);
+		ret = 0;
+	}
+	else
+	{
+		ticables_critical("Unable to open %s for logging.\n", ofn);
+		ret = 1;
+	}
+
+	return ret;
+}
+
+int log_bin_N(int dir, int model, uint64_t timestamp, const uint8_t * data, uint32_t len)
+{
+	uint8_t hdr[12];
+	int i;
+
+	if (logfile == NULL)
+	{
+		return 1;
+	}
+
+	while (len > 0)
+	{
+		uint16_t n = (len > 0xFFFF) ? 0xFFFF : (uint16_t)len;
+
+		for (i = 0; i < 8; i++)
+		{
+			hdr[i] = (uint8_t)(timestamp >> (8 * i));
+		}
+		hdr[8] = (uint8_t)dir;
+		hdr[9] = (uint8_t)model;
+		hdr[10] = n & 0xFF;
+		hdr[11] = (n >> 8) & 0xFF;
+
+		fwrite(hdr, sizeof(hdr), 1, logfile);
+		fwrite(data, n, 1, logfile);
+
+		data += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+int log_bin_stop(void)
+{
+	if (logfile != NULL)
+	{
+		fclose(logfile);
+		logfile = NULL;
+	}
+
+	g_free(ofn);
+	ofn = NULL;
+
+	return 0;
+}
@@ -0,0 +1,41 @@
+/* Hey EMACS -*- linux-c -*- */
+/* $Id$ */
+
+/*  libticables2 - link cable library, a part of the TiLP project
+ *  Copyright (C) 1999-2005  Romain Lievin
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef __LOG_BIN__
+#define __LOG_BIN__
+
+/*
+	Binary capture format (all fields little-endian):
+
+	file header:  "TICBLOG" '\0', uint16 version (1), uint16 reserved
+	record:       uint64 timestamp (us, monotonic), uint8 direction (LOG_IN/LOG_OUT),
+	              uint8 cable model (CableModel of the logging handle), uint16 length,
+	              then <length> data bytes
+*/
+
+#define BIN_MAGIC	"TICBLOG"
+#define BIN_VERSION	1
+
+int log_bin_start(void);
+int log_bin_N(int dir, int model, uint64_t timestamp, const uint8_t *data, uint32_t len);
+int log_bin_stop(void);
+
+#endif
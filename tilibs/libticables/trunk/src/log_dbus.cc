@@ -38,53 +38,116 @@
 #include "internal.h"
 
 #define LOG_DBUS_FILE	"ticables-dbus.pkt"
+#define LOG_DBUS_MAX	(4 + 65536 + 2)
 
-static char *ifn = NULL;
 static char *ofn = NULL;
+static FILE *logfile = NULL;
+static uint8_t *pending = NULL;
+static uint32_t pending_len = 0;
+
+/*
+	Packets are decoded as the bytes come in (from the logging thread)
+	instead of re-reading the hex dump when logging stops.
+*/
+
+/* Decode every complete packet in the pending buffer, dropping bytes that cannot start one. */
+static void log_dbus_drain(void)
+{
+	while (pending_len > 0)
+	{
+		int ret = dbus_decomp_packet(logfile, pending, pending_len);
+
+		if (ret == 0)
+		{
+			break;
+		}
+		else if (ret > 0)
+		{
+			pending_len -= (uint32_t)ret;
+			memmove(pending, pending + ret, pending_len);
+		}
+		else
+		{
+			// not a packet boundary: drop one byte and try the next offset
+			fprintf(logfile, "Skipping unknown byte %02X\n", pending[0]);
+			memmove(pending, pending + 1, --pending_len);
+		}
+	}
+}
 
 int log_dbus_start(void)
 {
-	ifn = g_strconcat(g_get_home_dir(), G_DIR_SEPARATOR_S, LOG_DIR, G_DIR_SEPARATOR_S, HEX_FILE, NULL);
 	ofn = g_strconcat(g_get_home_dir(), G_DIR_SEPARATOR_S, LOG_DIR, G_DIR_SEPARATOR_S, LOG_DBUS_FILE, NULL);
 
+	logfile = fopen(ofn, "wt");
+	if (logfile == NULL)
+	{
+		ticables_critical("Unable to open %s for logging.\n", ofn);
+		g_free(ofn);
+		ofn = NULL;
+		return 1;
+	}
+	fprintf(logfile, "TI packet decompiler for D-BUS, version 1.2\n");
+
+	pending = (uint8_t *)g_malloc(LOG_DBUS_MAX);
+	pending_len = 0;
+
 	return 0;
 }
 
 int log_dbus_N(int dir, const uint8_t * data, uint32_t len)
 {
-	return 0;
-}
+	uint32_t i;
 
-int log_dbus_stop(void)
-{
-	char *r;
-	char * ifn2;
+	(void)dir;
 
-	if (!ifn || ! ofn)
+	if (logfile == NULL)
 	{
-		return 0;
+		return 1;
 	}
 
-	r = strrchr(ifn, '.');
-	if (r)
+	for (i = 0; i < len; i++)
 	{
-		*r = '\0';
+		pending[pending_len++] = data[i];
+		log_dbus_drain();
 	}
 
-	dbus_decomp(ifn, 0);
-	ifn2 = g_strconcat(ifn, ".pkt", NULL);
-	g_free(ifn);
-	ifn = ifn2;
+	return 0;
+}
 
-	g_unlink(ofn);
-	if (g_rename(ifn, ofn) < 0)
+int log_dbus_stop(void)
+{
+	if (logfile != NULL)
 	{
-		fprintf(stderr, "Failed to rename output file\n");
+		// the capture ended inside a "packet": if a complete one starts further in, its header was garbage
+		while (pending_len)
+		{
+			uint32_t skip = 1;
+
+			while (skip < pending_len && dbus_decomp_packet(NULL, pending + skip, pending_len - skip) <= 0)
+			{
+				skip++;
+			}
+			if (skip == pending_len)
+			{
+				fprintf(logfile, "Truncated packet (%u bytes)\n", pending_len);
+				break;
+			}
+
+			fprintf(logfile, "Skipping %u unknown bytes\n", skip);
+			pending_len -= skip;
+			memmove(pending, pending + skip, pending_len);
+			log_dbus_drain();
+		}
+		fclose(logfile);
+		logfile = NULL;
 	}
 
-	g_free(ifn); 
-	ifn = NULL;
-	g_free(ofn); 
+	g_free(pending);
+	pending = NULL;
+	pending_len = 0;
+
+	g_free(ofn);
 	ofn = NULL;
 
 	return 0;
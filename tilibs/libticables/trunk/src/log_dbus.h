@@ -26,4 +26,6 @@ int log_dbus_start(void);
 int log_dbus_N(int dir, const uint8_t *data, uint32_t len);
 int log_dbus_stop(void);
 
+int dbus_decomp_packet(FILE *fo, const uint8_t *buffer, uint32_t len);
+
 #endif
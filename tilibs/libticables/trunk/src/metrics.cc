@@ -0,0 +1,374 @@
+/* Hey EMACS -*- linux-c -*- */
+
+/*  libticables2 - link cable library, a part of the TiLP project
+ *  Copyright (C) 1999-2005  Romain Lievin
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+	Latency histograms and throughput counters.
+
+	Values below 16 us get one bucket each; above, every power of two is
+	split into 16 linear sub-buckets, so recording is a couple of shifts
+	and the relative error of a percentile stays under 1/16.
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ticables.h"
+#include "internal.h"
+#include "error.h"
+#include "logging.h"
+
+typedef struct
+{
+	GMutex lock;
+	CableHistogram histograms[CABLE_FNCT_LAST];
+	uint64_t bytes_sent;
+	uint64_t bytes_recv;
+	uint32_t timeouts;
+	uint32_t errors;
+} CableMetricsPriv;
+
+static const char * const fnct_names[CABLE_FNCT_LAST] =
+{
+	"prepare", "open", "close", "reset", "probe", "timeout", "send", "recv", "check",
+	"set_d0", "set_d1", "get_d0", "get_d1", "set_raw", "get_raw", "set_device", "get_device_info"
+};
+
+static unsigned int histogram_index(uint32_t value)
+{
+	unsigned int msb;
+
+	if (value < (1U << CABLE_HISTOGRAM_SUB_BITS))
+	{
+		return value;
+	}
+	msb = g_bit_storage(value) - 1;
+	return ((msb - CABLE_HISTOGRAM_SUB_BITS + 1) << CABLE_HISTOGRAM_SUB_BITS)
+	       + ((value >> (msb - CABLE_HISTOGRAM_SUB_BITS)) & ((1U << CABLE_HISTOGRAM_SUB_BITS) - 1));
+}
+
+// Largest value falling into bucket idx.
+static uint32_t histogram_value(unsigned int idx)
+{
+	unsigned int shift;
+	uint64_t sub;
+
+	if (idx < (1U << CABLE_HISTOGRAM_SUB_BITS))
+	{
+		return idx;
+	}
+	shift = (idx >> CABLE_HISTOGRAM_SUB_BITS) - 1;
+	sub = (idx & ((1U << CABLE_HISTOGRAM_SUB_BITS) - 1)) + (1U << CABLE_HISTOGRAM_SUB_BITS);
+	return (uint32_t)MIN(((sub + 1) << shift) - 1, (uint64_t)UINT32_MAX);
+}
+
+static uint32_t histogram_percentile(const CableHistogram *histogram, unsigned int percent)
+{
+	uint64_t target = (histogram->count * percent + 99) / 100;
+	uint64_t seen = 0;
+	unsigned int i;
+
+	for (i = 0; i < CABLE_HISTOGRAM_BUCKETS; i++)
+	{
+		seen += histogram->buckets[i];
+		if (seen >= target && seen > 0)
+		{
+			return MAX(MIN(histogram_value(i), histogram->max_us), histogram->min_us);
+		}
+	}
+
+	return histogram->max_us;
+}
+
+/**
+ * ticables_histogram_record:
+ * @histogram: a histogram, zeroed before first use.
+ * @value_us: value to record, in microseconds.
+ *
+ * Add a value to a latency histogram. Not thread-safe by itself.
+ **/
+void TICALL ticables_histogram_record(CableHistogram *histogram, uint32_t value_us)
+{
+	if (histogram == NULL)
+	{
+		return;
+	}
+
+	if (histogram->count == 0 || value_us < histogram->min_us)
+	{
+		histogram->min_us = value_us;
+	}
+	if (value_us > histogram->max_us)
+	{
+		histogram->max_us = value_us;
+	}
+	histogram->count++;
+	histogram->total_us += value_us;
+	histogram->buckets[histogram_index(value_us)]++;
+}
+
+/**
+ * ticables_histogram_stats:
+ * @histogram: a histogram.
+ * @stats: where to store the summary.
+ *
+ * Compute count, extrema and the 50th, 90th and 99th percentiles of a histogram.
+ **/
+void TICALL ticables_histogram_stats(const CableHistogram *histogram, CableLatencyStats *stats)
+{
+	if (histogram == NULL || stats == NULL)
+	{
+		return;
+	}
+
+	memset(stats, 0, sizeof(*stats));
+	if (histogram->count == 0)
+	{
+		return;
+	}
+
+	stats->count = histogram->count;
+	stats->total_us = histogram->total_us;
+	stats->min_us = histogram->min_us;
+	stats->max_us = histogram->max_us;
+	stats->p50_us = histogram_percentile(histogram, 50);
+	stats->p90_us = histogram_percentile(histogram, 90);
+	stats->p99_us = histogram_percentile(histogram, 99);
+}
+
+// Called by link_xxx.c after each measured cable operation.
+void ticables_metrics_record(CableHandle *handle, CableFnctsIdx operation, int64_t start, int retval, uint32_t len)
+{
+	CableMetricsPriv *metrics = (CableMetricsPriv *)handle->metrics;
+	int64_t elapsed;
+
+	if (metrics == NULL || start == 0 || (unsigned int)operation >= CABLE_FNCT_LAST)
+	{
+		return;
+	}
+
+	elapsed = g_get_monotonic_time() - start;
+	elapsed = MAX(elapsed, 0);
+
+	g_mutex_lock(&metrics->lock);
+	ticables_histogram_record(&metrics->histograms[operation], (uint32_t)MIN(elapsed, (int64_t)UINT32_MAX));
+	if (!retval)
+	{
+		if (operation == CABLE_FNCT_SEND)
+		{
+			metrics->bytes_sent += len;
+		}
+		else if (operation == CABLE_FNCT_RECV)
+		{
+			metrics->bytes_recv += len;
+		}
+	}
+	else if (retval == ERR_READ_TIMEOUT || retval == ERR_WRITE_TIMEOUT)
+	{
+		metrics->timeouts++;
+	}
+	else
+	{
+		metrics->errors++;
+	}
+	g_mutex_unlock(&metrics->lock);
+}
+
+/**
+ * ticables_cable_metrics_start:
+ * @handle: a previously allocated handle.
+ *
+ * Start collecting per-operation latency histograms (send, recv, check,
+ * reset) and byte / timeout / error counters on this handle.
+ *
+ * Return value: 0 if successful, an error code otherwise.
+ **/
+int TICALL ticables_cable_metrics_start(CableHandle *handle)
+{
+	CableMetricsPriv *metrics;
+
+	VALIDATE_HANDLE(handle);
+	RETURN_IF_HANDLE_BUSY(handle);
+
+	if (handle->metrics != NULL)
+	{
+		return ERR_ILLEGAL_ARG;
+	}
+
+	metrics = (CableMetricsPriv *)g_malloc0(sizeof(CableMetricsPriv));
+	g_mutex_init(&metrics->lock);
+	handle->metrics = metrics;
+
+	return 0;
+}
+
+/**
+ * ticables_cable_metrics_reset:
+ * @handle: a previously allocated handle.
+ *
+ * Clear the collected metrics. May be called while transfers are running.
+ *
+ * Return value: 0 if successful, an error code otherwise.
+ **/
+int TICALL ticables_cable_metrics_reset(CableHandle *handle)
+{
+	CableMetricsPriv *metrics;
+
+	VALIDATE_HANDLE(handle);
+
+	metrics = (CableMetricsPriv *)handle->metrics;
+	if (metrics == NULL)
+	{
+		return ERR_ILLEGAL_ARG;
+	}
+
+	g_mutex_lock(&metrics->lock);
+	memset(metrics->histograms, 0, sizeof(metrics->histograms));
+	metrics->bytes_sent = 0;
+	metrics->bytes_recv = 0;
+	metrics->timeouts = 0;
+	metrics->errors = 0;
+	g_mutex_unlock(&metrics->lock);
+
+	return 0;
+}
+
+/**
+ * ticables_cable_metrics_get:
+ * @handle: a previously allocated handle.
+ * @metrics: where to store the snapshot.
+ *
+ * Take a consistent snapshot of the collected metrics. May be called from
+ * another thread while transfers are running.
+ *
+ * Return value: 0 if successful, an error code otherwise.
+ **/
+int TICALL ticables_cable_metrics_get(CableHandle *handle, CableMetrics *metrics)
+{
+	CableMetricsPriv *priv;
+	unsigned int i;
+
+	VALIDATE_HANDLE(handle);
+	VALIDATE_NONNULL(metrics);
+
+	priv = (CableMetricsPriv *)handle->metrics;
+	if (priv == NULL)
+	{
+		return ERR_ILLEGAL_ARG;
+	}
+
+	g_mutex_lock(&priv->lock);
+	for (i = 0; i < CABLE_FNCT_LAST; i++)
+	{
+		ticables_histogram_stats(&priv->histograms[i], &metrics->latency[i]);
+	}
+	metrics->bytes_sent = priv->bytes_sent;
+	metrics->bytes_recv = priv->bytes_recv;
+	metrics->timeouts = priv->timeouts;
+	metrics->errors = priv->errors;
+	g_mutex_unlock(&priv->lock);
+
+	return 0;
+}
+
+/**
+ * ticables_cable_metrics_json:
+ * @handle: a previously allocated handle.
+ * @buffer: where to store the JSON text (may be NULL if @size is 0).
+ * @size: size of @buffer.
+ *
+ * Format a snapshot of the metrics as a JSON object. Only the operations
+ * which were measured at least once are listed.
+ *
+ * Return value: length of the JSON text like snprintf (the output was
+ * truncated if it is >= @size), or a negative error code.
+ **/
+int TICALL ticables_cable_metrics_json(CableHandle *handle, char *buffer, uint32_t size)
+{
+	CableMetrics metrics;
+	int ret;
+	unsigned int i;
+	int first = 1;
+	size_t len = 0;
+
+	ret = ticables_cable_metrics_get(handle, &metrics);
+	if (ret)
+	{
+		return -ret;
+	}
+
+#define JSON_APPEND(...) \
+	do { \
+		int n_ = snprintf(buffer ? buffer + MIN(len, (size_t)size) : NULL, size > len ? size - len : 0, __VA_ARGS__); \
+		if (n_ > 0) len += (size_t)n_; \
+	} while (0)
+
+	JSON_APPEND("{\"latency\":{");
+	for (i = 0; i < CABLE_FNCT_LAST; i++)
+	{
+		const CableLatencyStats *s = &metrics.latency[i];
+
+		if (s->count == 0)
+		{
+			continue;
+		}
+		JSON_APPEND("%s\"%s\":{\"count\":%llu,\"total_us\":%llu,\"min_us\":%u,\"max_us\":%u,\"p50_us\":%u,\"p90_us\":%u,\"p99_us\":%u}",
+		            first ? "" : ",", fnct_names[i],
+		            (unsigned long long)s->count, (unsigned long long)s->total_us,
+		            s->min_us, s->max_us, s->p50_us, s->p90_us, s->p99_us);
+		first = 0;
+	}
+	JSON_APPEND("},\"bytes_sent\":%llu,\"bytes_recv\":%llu,\"timeouts\":%u,\"errors\":%u}",
+	            (unsigned long long)metrics.bytes_sent, (unsigned long long)metrics.bytes_recv,
+	            metrics.timeouts, metrics.errors);
+
+#undef JSON_APPEND
+
+	return (int)len;
+}
+
+/**
+ * ticables_cable_metrics_stop:
+ * @handle: a previously allocated handle.
+ *
+ * Stop collecting metrics and release them.
+ *
+ * Return value: 0 if successful, an error code otherwise.
+ **/
+int TICALL ticables_cable_metrics_stop(CableHandle *handle)
+{
+	CableMetricsPriv *metrics;
+
+	VALIDATE_HANDLE(handle);
+	RETURN_IF_HANDLE_BUSY(handle);
+
+	metrics = (CableMetricsPriv *)handle->metrics;
+	if (metrics != NULL)
+	{
+		handle->metrics = NULL;
+		g_mutex_clear(&metrics->lock);
+		g_free(metrics);
+	}
+
+	return 0;
+}
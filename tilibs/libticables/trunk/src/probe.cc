@@ -270,11 +270,11 @@ int TICALL ticables_get_usb_devices(int **list, int *len)
 	if (list != NULL)
 	{
 		int ret = 0;
-		const USBCableInfo *info = NULL;
+		USBCableInfo info[USB_MAX_CABLES];
 		int i, n = 0;
 
 #if defined(__WIN32__) || (defined(HAVE_LIBUSB) || defined(HAVE_LIBUSB_1_0))
-		ret = usb_probe_device_info(&info, &n);
+		ret = usb_probe_device_info(info, &n);
 #endif
 		*list = (int *)calloc(1 + n, sizeof(int));
 		for (i = 0; i < n; i++)
@@ -415,11 +415,11 @@ int TICALL ticables_get_usb_device_info(CableDeviceInfo **list, int *len)
 	if (list != NULL)
 	{
 		int ret = 0;
-		const USBCableInfo *usbinfo = NULL;
+		USBCableInfo usbinfo[USB_MAX_CABLES];
 		int i, n = 0;
 
 #if defined(__WIN32__) || (defined(HAVE_LIBUSB) || defined(HAVE_LIBUSB_1_0))
-		ret = usb_probe_device_info(&usbinfo, &n);
+		ret = usb_probe_device_info(usbinfo, &n);
 #endif
 		*list = (CableDeviceInfo *)calloc(1 + n, sizeof(CableDeviceInfo));
 		for (i = 0; i < n; i++)
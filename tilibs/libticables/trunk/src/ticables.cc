@@ -86,6 +86,9 @@ static CableFncts const *const cables[] =
 #endif
 #if !defined(NO_CABLE_TCPS) && !defined(__WIN32__)
 	&cable_tcps,
+#endif
+#ifndef NO_CABLE_SIM
+	&cable_sim,
 #endif
 	NULL
 };
@@ -121,6 +124,9 @@ static const uint32_t supported_cables =
 #if !defined(NO_CABLE_TCPS) && !defined(__WIN32__)
 	| (1U << CABLE_TCPS)
 #endif
+#ifndef NO_CABLE_SIM
+	| (1U << CABLE_SIM)
+#endif
 ;
 
 /****************/
@@ -271,7 +277,7 @@ static int default_event_hook(CableHandle * handle, uint32_t event_count, const
 	(void)user_pointer;
 	const char * cablestr = ticables_model_to_string(ticables_get_model(handle));
 	const char * portstr = ticables_port_to_string(ticables_get_port(handle));
-	if (getenv("TICABLES_EVENT_DEBUG") != NULL)
+	if (handle->event_mask == CABLE_EVENT_MASK_ALL)
 	{
 		ticables_info("Event #%u type %d for cable %s port %s", event_count, event->type, cablestr, portstr);
 	}
@@ -335,6 +341,20 @@ CableHandle* TICALL ticables_handle_new(CableModel model, CablePort port)
 	{
 		handle->event_hook = default_event_hook;
 		//handle->event_count = 0;
+
+		// The default hook only needs the data events for logging; everything
+		// else is dispatched for debugging only.
+		if (getenv("TICABLES_EVENT_DEBUG") != NULL)
+		{
+			handle->event_mask = CABLE_EVENT_MASK_ALL;
+		}
+		else
+		{
+#ifdef ENABLE_LOGGING
+			handle->event_mask = CABLE_EVENT_MASK_AFTER_SEND | CABLE_EVENT_MASK_AFTER_RECV;
+#endif
+			handle->event_mask |= CABLE_EVENT_MASK_USER;
+		}
 	}
 
 	return handle;
@@ -355,6 +375,9 @@ int TICALL ticables_handle_del(CableHandle* handle)
 	free(handle->priv2);
 	handle->priv2 = NULL;
 
+	ticables_cable_trace_stop(handle);
+	ticables_cable_metrics_stop(handle);
+
 	free(handle->device);
 	handle->device = NULL;
 
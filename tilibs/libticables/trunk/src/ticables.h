@@ -65,7 +65,7 @@ typedef enum
 	CABLE_NUL = 0,
 	CABLE_GRY, CABLE_BLK, CABLE_PAR, CABLE_SLV, CABLE_USB,
 	CABLE_VTI, CABLE_TIE, CABLE_ILP, CABLE_DEV,
-	CABLE_TCPC, CABLE_TCPS,
+	CABLE_TCPC, CABLE_TCPS, CABLE_SIM,
 	CABLE_MAX
 } CableModel;
 
@@ -342,6 +342,111 @@ typedef struct
 
 typedef int (*ticables_event_hook_type)(CableHandle * handle, uint32_t event_count, const CableEventData * event, void * user_pointer);
 
+/**
+ * CableEventMask:
+ *
+ * Event classes a handle dispatches to its event hook and trace ring.
+ * Events whose class is not in the handle's mask are not built at all.
+ */
+typedef enum
+{
+	CABLE_EVENT_MASK_NONE        = 0,
+	CABLE_EVENT_MASK_BEFORE_SEND = 1 << 0,
+	CABLE_EVENT_MASK_AFTER_SEND  = 1 << 1,
+	CABLE_EVENT_MASK_BEFORE_RECV = 1 << 2,
+	CABLE_EVENT_MASK_AFTER_RECV  = 1 << 3,
+	CABLE_EVENT_MASK_GENERIC     = 1 << 4,   /* BEFORE/AFTER_GENERIC_OPERATION */
+	CABLE_EVENT_MASK_LIFECYCLE   = 1 << 5,   /* open, close, reset */
+	CABLE_EVENT_MASK_USER        = 1 << 6,
+	CABLE_EVENT_MASK_ALL         = (1 << 7) - 1
+} CableEventMask;
+
+/**
+ * CableTraceEntry:
+ * @event_count: event number, as passed to the event hook.
+ * @type: event type.
+ * @operation: generic operation, if any.
+ * @retval: return value carried by the event.
+ * @len: data length for send/recv events, 0 otherwise.
+ * @timestamp: monotonic time of the event, in microseconds.
+ *
+ * One record of the per-handle event trace ring.
+ */
+typedef struct
+{
+	uint32_t event_count;
+	CableEventType type;
+	CableFnctsIdx operation;
+	int retval;
+	uint32_t len;
+	int64_t timestamp;
+} CableTraceEntry;
+
+/* HDR-style histogram: 16 linear sub-buckets per power of two, i.e. about 6% precision from 1 us to 71 minutes */
+#define CABLE_HISTOGRAM_SUB_BITS	4
+#define CABLE_HISTOGRAM_BUCKETS		((32 - CABLE_HISTOGRAM_SUB_BITS + 1) << CABLE_HISTOGRAM_SUB_BITS)
+
+/**
+ * CableHistogram:
+ * @count: number of recorded values.
+ * @total_us: sum of recorded values.
+ * @min_us: smallest recorded value.
+ * @max_us: largest recorded value.
+ * @buckets: log-linear value buckets.
+ *
+ * Latency histogram, in microseconds.
+ */
+typedef struct
+{
+	uint64_t count;
+	uint64_t total_us;
+	uint32_t min_us;
+	uint32_t max_us;
+	uint32_t buckets[CABLE_HISTOGRAM_BUCKETS];
+} CableHistogram;
+
+/**
+ * CableLatencyStats:
+ * @count: number of operations.
+ * @total_us: cumulated time spent.
+ * @min_us: fastest operation.
+ * @max_us: slowest operation.
+ * @p50_us: median.
+ * @p90_us: 90th percentile.
+ * @p99_us: 99th percentile.
+ *
+ * Summary of a #CableHistogram.
+ */
+typedef struct
+{
+	uint64_t count;
+	uint64_t total_us;
+	uint32_t min_us;
+	uint32_t max_us;
+	uint32_t p50_us;
+	uint32_t p90_us;
+	uint32_t p99_us;
+} CableLatencyStats;
+
+/**
+ * CableMetrics:
+ * @latency: per cable function statistics, indexed by #CableFnctsIdx (send, recv, check and reset are measured).
+ * @bytes_sent: bytes sent successfully.
+ * @bytes_recv: bytes received successfully.
+ * @timeouts: operations which failed with a read or write timeout.
+ * @errors: operations which failed otherwise.
+ *
+ * Snapshot of the metrics collected on a cable handle.
+ */
+typedef struct
+{
+	CableLatencyStats latency[CABLE_FNCT_LAST];
+	uint64_t bytes_sent;
+	uint64_t bytes_recv;
+	uint32_t timeouts;
+	uint32_t errors;
+} CableMetrics;
+
 /**
  * CableHandle:
  * @model: cable model
@@ -364,6 +469,9 @@ typedef int (*ticables_event_hook_type)(CableHandle * handle, uint32_t event_cou
  * @event_hook: callback fired upon various events (replaces and expands on the deprecated callbacks).
  * @user_pointer: user-set pointer passed to the event callbacks.
  * @event_count: number of events sent since this handle was created.
+ * @event_mask: classes of events (CableEventMask) which are dispatched.
+ * @trace: event trace ring, if enabled.
+ * @metrics: latency histograms and counters, if enabled.
  *
  * A structure used to store information as an handle.
  * !!! This structure is for private use !!!
@@ -393,6 +501,10 @@ struct _CableHandle
 	ticables_event_hook_type event_hook;
 	void * user_pointer;
 	uint32_t event_count;
+
+	uint32_t event_mask;
+	void * trace;
+	void * metrics;
 };
 
 /**
@@ -498,6 +610,21 @@ typedef struct
 	TIEXPORT1 void * ticables_cable_set_event_user_pointer(CableHandle *handle, void * user_pointer);
 	TIEXPORT1 uint32_t TICALL ticables_cable_get_event_count(CableHandle *handle);
 	TIEXPORT1 int TICALL ticables_cable_fire_user_event(CableHandle *handle, CableEventType type, int retval, void * user_data, uint32_t user_len);
+	TIEXPORT1 uint32_t TICALL ticables_cable_get_event_mask(CableHandle *handle);
+	TIEXPORT1 uint32_t TICALL ticables_cable_set_event_mask(CableHandle *handle, uint32_t mask);
+	TIEXPORT1 int TICALL ticables_cable_trace_start(CableHandle *handle, unsigned int size);
+	TIEXPORT1 int TICALL ticables_cable_trace_read(CableHandle *handle, CableTraceEntry *entries, unsigned int max, unsigned int *count);
+	TIEXPORT1 int TICALL ticables_cable_trace_stop(CableHandle *handle);
+
+	// metrics.c
+	TIEXPORT1 void TICALL ticables_histogram_record(CableHistogram *histogram, uint32_t value_us);
+	TIEXPORT1 void TICALL ticables_histogram_stats(const CableHistogram *histogram, CableLatencyStats *stats);
+
+	TIEXPORT1 int TICALL ticables_cable_metrics_start(CableHandle *handle);
+	TIEXPORT1 int TICALL ticables_cable_metrics_reset(CableHandle *handle);
+	TIEXPORT1 int TICALL ticables_cable_metrics_get(CableHandle *handle, CableMetrics *metrics);
+	TIEXPORT1 int TICALL ticables_cable_metrics_json(CableHandle *handle, char *buffer, uint32_t size);
+	TIEXPORT1 int TICALL ticables_cable_metrics_stop(CableHandle *handle);
 
 	// type2str.c
 	TIEXPORT1 const char * TICALL ticables_model_to_string(CableModel model);
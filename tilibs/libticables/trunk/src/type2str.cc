@@ -50,6 +50,7 @@ const char *TICALL ticables_model_to_string(CableModel model)
 	//case CABLE_DEV: return "UsbKernel";
 	case CABLE_TCPC: return "TCPC";
 	case CABLE_TCPS: return "TCPS";
+	case CABLE_SIM: return "Simulator";
 	default: return "unknown";
 	}
 }
@@ -93,6 +94,8 @@ CableModel TICALL ticables_string_to_model(const char *str)
 		return CABLE_TCPC;
 	else if (!g_ascii_strcasecmp(str, "tcps") || !g_ascii_strcasecmp(str, "tcpserver"))
 		return CABLE_TCPS;
+	else if (!g_ascii_strcasecmp(str, "Simulator") || !g_ascii_strcasecmp(str, "sim"))
+		return CABLE_SIM;
 	// else fall through.
 
 	return CABLE_NUL;
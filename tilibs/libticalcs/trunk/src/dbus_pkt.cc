@@ -203,11 +203,16 @@ int TICALL dbus_send(CalcHandle* handle, uint8_t target, uint8_t cmd, uint16_t l
 
 	SET_HANDLE_BUSY_IF_NECESSARY(handle);
 
+	int64_t start = ticalcs_metrics_clock(handle);
+
 	ticables_progress_reset(handle->cable);
 
-	ticalcs_event_fill_header(handle, &event, /* type */ CALC_EVENT_TYPE_BEFORE_SEND_DBUS_PKT, /* retval */ 0, /* operation */ CALC_FNCT_LAST);
-	ticalcs_event_fill_dbus_pkt(&event, /* length */ length, /* id */ target, /* cmd */ cmd, /* data */ data);
-	ret = ticalcs_event_send(handle, &event);
+	if (ticalcs_event_wanted(handle, CALC_EVENT_TYPE_BEFORE_SEND_DBUS_PKT))
+	{
+		ticalcs_event_fill_header(handle, &event, /* type */ CALC_EVENT_TYPE_BEFORE_SEND_DBUS_PKT, /* retval */ 0, /* operation */ CALC_FNCT_LAST);
+		ticalcs_event_fill_dbus_pkt(&event, /* length */ length, /* id */ target, /* cmd */ cmd, /* data */ data);
+		ret = ticalcs_event_send(handle, &event);
+	}
 
 	if (!ret)
 	{
@@ -310,9 +315,14 @@ int TICALL dbus_send(CalcHandle* handle, uint8_t target, uint8_t cmd, uint16_t l
 		}
 	}
 
-	ticalcs_event_fill_header(handle, &event, /* type */ CALC_EVENT_TYPE_AFTER_SEND_DBUS_PKT, /* retval */ ret, /* operation */ CALC_FNCT_LAST);
-	ticalcs_event_fill_dbus_pkt(&event, /* length */ length, /* id */ target, /* cmd */ cmd, /* data */ data);
-	ret = ticalcs_event_send(handle, &event);
+	ticalcs_metrics_record(handle, CALC_METRICS_PROTOCOL_DBUS, /* recv */ 0, cmd, start, ret);
+
+	if (ticalcs_event_wanted(handle, CALC_EVENT_TYPE_AFTER_SEND_DBUS_PKT))
+	{
+		ticalcs_event_fill_header(handle, &event, /* type */ CALC_EVENT_TYPE_AFTER_SEND_DBUS_PKT, /* retval */ ret, /* operation */ CALC_FNCT_LAST);
+		ticalcs_event_fill_dbus_pkt(&event, /* length */ length, /* id */ target, /* cmd */ cmd, /* data */ data);
+		ret = ticalcs_event_send(handle, &event);
+	}
 
 	CLEAR_HANDLE_BUSY_IF_NECESSARY(handle);
 
@@ -332,9 +342,12 @@ int TICALL dbus_recv_header(CalcHandle *handle, uint8_t* host, uint8_t* cmd, uin
 
 	SET_HANDLE_BUSY_IF_NECESSARY(handle);
 
-	ticalcs_event_fill_header(handle, &event, /* type */ CALC_EVENT_TYPE_BEFORE_RECV_DBUS_PKT_HEADER, /* retval */ 0, /* operation */ CALC_FNCT_LAST);
-	ticalcs_event_fill_dbus_pkt(&event, /* length */ 0, /* id */ 0, /* cmd */ 0, /* data */ NULL);
-	ret = ticalcs_event_send(handle, &event);
+	if (ticalcs_event_wanted(handle, CALC_EVENT_TYPE_BEFORE_RECV_DBUS_PKT_HEADER))
+	{
+		ticalcs_event_fill_header(handle, &event, /* type */ CALC_EVENT_TYPE_BEFORE_RECV_DBUS_PKT_HEADER, /* retval */ 0, /* operation */ CALC_FNCT_LAST);
+		ticalcs_event_fill_dbus_pkt(&event, /* length */ 0, /* id */ 0, /* cmd */ 0, /* data */ NULL);
+		ret = ticalcs_event_send(handle, &event);
+	}
 
 	if (!ret)
 	{
@@ -361,9 +374,12 @@ int TICALL dbus_recv_header(CalcHandle *handle, uint8_t* host, uint8_t* cmd, uin
 		}
 	}
 
-	ticalcs_event_fill_header(handle, &event, /* type */ CALC_EVENT_TYPE_AFTER_RECV_DBUS_PKT_HEADER, /* retval */ ret, /* operation */ CALC_FNCT_LAST);
-	ticalcs_event_fill_dbus_pkt(&event, /* length */ *length, /* id */ *host, /* cmd */ *cmd, /* data */ NULL);
-	ret = ticalcs_event_send(handle, &event);
+	if (ticalcs_event_wanted(handle, CALC_EVENT_TYPE_AFTER_RECV_DBUS_PKT_HEADER))
+	{
+		ticalcs_event_fill_header(handle, &event, /* type */ CALC_EVENT_TYPE_AFTER_RECV_DBUS_PKT_HEADER, /* retval */ ret, /* operation */ CALC_FNCT_LAST);
+		ticalcs_event_fill_dbus_pkt(&event, /* length */ *length, /* id */ *host, /* cmd */ *cmd, /* data */ NULL);
+		ret = ticalcs_event_send(handle, &event);
+	}
 
 	CLEAR_HANDLE_BUSY_IF_NECESSARY(handle);
 
@@ -385,9 +401,12 @@ int TICALL dbus_recv_data(CalcHandle *handle, uint16_t* length, uint8_t* data)
 
 	SET_HANDLE_BUSY_IF_NECESSARY(handle);
 
-	ticalcs_event_fill_header(handle, &event, /* type */ CALC_EVENT_TYPE_BEFORE_RECV_DBUS_PKT_DATA, /* retval */ 0, /* operation */ CALC_FNCT_LAST);
-	ticalcs_event_fill_dbus_pkt(&event, /* length */ *length, /* id */ 0, /* cmd */ 0, /* data */ data);
-	ret = ticalcs_event_send(handle, &event);
+	if (ticalcs_event_wanted(handle, CALC_EVENT_TYPE_BEFORE_RECV_DBUS_PKT_DATA))
+	{
+		ticalcs_event_fill_header(handle, &event, /* type */ CALC_EVENT_TYPE_BEFORE_RECV_DBUS_PKT_DATA, /* retval */ 0, /* operation */ CALC_FNCT_LAST);
+		ticalcs_event_fill_dbus_pkt(&event, /* length */ *length, /* id */ 0, /* cmd */ 0, /* data */ data);
+		ret = ticalcs_event_send(handle, &event);
+	}
 
 	if (!ret)
 	{
@@ -463,9 +482,12 @@ int TICALL dbus_recv_data(CalcHandle *handle, uint16_t* length, uint8_t* data)
 		}
 	}
 
-	ticalcs_event_fill_header(handle, &event, /* type */ CALC_EVENT_TYPE_AFTER_RECV_DBUS_PKT_DATA, /* retval */ ret, /* operation */ CALC_FNCT_LAST);
-	ticalcs_event_fill_dbus_pkt(&event, /* length */ *length, /* id */ 0, /* cmd */ 0, /* data */ data);
-	ret = ticalcs_event_send(handle, &event);
+	if (ticalcs_event_wanted(handle, CALC_EVENT_TYPE_AFTER_RECV_DBUS_PKT_DATA))
+	{
+		ticalcs_event_fill_header(handle, &event, /* type */ CALC_EVENT_TYPE_AFTER_RECV_DBUS_PKT_DATA, /* retval */ ret, /* operation */ CALC_FNCT_LAST);
+		ticalcs_event_fill_dbus_pkt(&event, /* length */ *length, /* id */ 0, /* cmd */ 0, /* data */ data);
+		ret = ticalcs_event_send(handle, &event);
+	}
 
 	CLEAR_HANDLE_BUSY_IF_NECESSARY(handle);
 
@@ -493,6 +515,8 @@ int TICALL dbus_recv(CalcHandle* handle, uint8_t* host, uint8_t* cmd, uint16_t*
 	// Subroutines don't take busy if it's already taken.
 	SET_HANDLE_BUSY_IF_NECESSARY(handle);
 
+	int64_t start = ticalcs_metrics_clock(handle);
+
 	ret = dbus_recv_header(handle, host, cmd, length);
 	if (!ret)
 	{
@@ -536,6 +560,8 @@ int TICALL dbus_recv(CalcHandle* handle, uint8_t* host, uint8_t* cmd, uint16_t*
 		}
 	}
 
+	ticalcs_metrics_record(handle, CALC_METRICS_PROTOCOL_DBUS, /* recv */ 1, *cmd, start, ret);
+
 	CLEAR_HANDLE_BUSY_IF_NECESSARY(handle);
 
 	return ret;
@@ -554,6 +580,8 @@ int TICALL dbus_dissect(CalcModel model, FILE * f, const uint8_t * data, uint32_
 	VALIDATE_NONNULL(f);
 	VALIDATE_NONNULL(data);
 
+	(void)model;
+
 	if (len < 2 || len == 3 || len > 65536U + 6)
 	{
 		ticalcs_critical("Length %lu (%lX) is too small or too large for a valid DBUS packet", (unsigned long)len, (unsigned long)len);
@@ -69,7 +69,7 @@ int TICALL dusb_send(CalcHandle* handle, DUSBRawPacket* pkt)
 {
 	uint8_t buf[sizeof(pkt->data) + 5];
 	uint32_t size;
-	int ret;
+	int ret = 0;
 	CalcEventData event;
 
 	VALIDATE_HANDLE(handle);
@@ -77,9 +77,12 @@ int TICALL dusb_send(CalcHandle* handle, DUSBRawPacket* pkt)
 
 	SET_HANDLE_BUSY_IF_NECESSARY(handle);
 
-	ticalcs_event_fill_header(handle, &event, /* type */ CALC_EVENT_TYPE_BEFORE_SEND_DUSB_RPKT, /* retval */ 0, /* operation */ CALC_FNCT_LAST);
-	ticalcs_event_fill_dusb_rpkt(&event, /* size */ pkt->size, /* type */ pkt->type, /* data */ pkt->data);
-	ret = ticalcs_event_send(handle, &event);
+	if (ticalcs_event_wanted(handle, CALC_EVENT_TYPE_BEFORE_SEND_DUSB_RPKT))
+	{
+		ticalcs_event_fill_header(handle, &event, /* type */ CALC_EVENT_TYPE_BEFORE_SEND_DUSB_RPKT, /* retval */ 0, /* operation */ CALC_FNCT_LAST);
+		ticalcs_event_fill_dusb_rpkt(&event, /* size */ pkt->size, /* type */ pkt->type, /* data */ pkt->data);
+		ret = ticalcs_event_send(handle, &event);
+	}
 
 	if (!ret)
 	{
@@ -115,9 +118,12 @@ int TICALL dusb_send(CalcHandle* handle, DUSBRawPacket* pkt)
 		}
 	}
 
-	ticalcs_event_fill_header(handle, &event, /* type */ CALC_EVENT_TYPE_AFTER_SEND_DUSB_RPKT, /* retval */ ret, /* operation */ CALC_FNCT_LAST);
-	ticalcs_event_fill_dusb_rpkt(&event, /* size */ pkt->size, /* type */ pkt->type, /* data */ pkt->data);
-	ret = ticalcs_event_send(handle, &event);
+	if (ticalcs_event_wanted(handle, CALC_EVENT_TYPE_AFTER_SEND_DUSB_RPKT))
+	{
+		ticalcs_event_fill_header(handle, &event, /* type */ CALC_EVENT_TYPE_AFTER_SEND_DUSB_RPKT, /* retval */ ret, /* operation */ CALC_FNCT_LAST);
+		ticalcs_event_fill_dusb_rpkt(&event, /* size */ pkt->size, /* type */ pkt->type, /* data */ pkt->data);
+		ret = ticalcs_event_send(handle, &event);
+	}
 
 	CLEAR_HANDLE_BUSY_IF_NECESSARY(handle);
 
@@ -127,7 +133,7 @@ int TICALL dusb_send(CalcHandle* handle, DUSBRawPacket* pkt)
 int TICALL dusb_recv(CalcHandle* handle, DUSBRawPacket* pkt)
 {
 	uint8_t buf[5];
-	int ret;
+	int ret = 0;
 	CalcEventData event;
 
 	VALIDATE_HANDLE(handle);
@@ -135,9 +141,12 @@ int TICALL dusb_recv(CalcHandle* handle, DUSBRawPacket* pkt)
 
 	SET_HANDLE_BUSY_IF_NECESSARY(handle);
 
-	ticalcs_event_fill_header(handle, &event, /* type */ CALC_EVENT_TYPE_BEFORE_RECV_DUSB_RPKT, /* retval */ 0, /* operation */ CALC_FNCT_LAST);
-	ticalcs_event_fill_dusb_rpkt(&event, /* size */ 0, /* type */ 0, /* data */ pkt->data);
-	ret = ticalcs_event_send(handle, &event);
+	if (ticalcs_event_wanted(handle, CALC_EVENT_TYPE_BEFORE_RECV_DUSB_RPKT))
+	{
+		ticalcs_event_fill_header(handle, &event, /* type */ CALC_EVENT_TYPE_BEFORE_RECV_DUSB_RPKT, /* retval */ 0, /* operation */ CALC_FNCT_LAST);
+		ticalcs_event_fill_dusb_rpkt(&event, /* size */ 0, /* type */ 0, /* data */ pkt->data);
+		ret = ticalcs_event_send(handle, &event);
+	}
 
 	if (!ret)
 	{
@@ -192,9 +201,12 @@ int TICALL dusb_recv(CalcHandle* handle, DUSBRawPacket* pkt)
 		}
 	}
 
-	ticalcs_event_fill_header(handle, &event, /* type */ CALC_EVENT_TYPE_AFTER_RECV_DUSB_RPKT, /* retval */ ret, /* operation */ CALC_FNCT_LAST);
-	ticalcs_event_fill_dusb_rpkt(&event, /* size */ pkt->size, /* type */ pkt->type, /* data */ pkt->data);
-	ret = ticalcs_event_send(handle, &event);
+	if (ticalcs_event_wanted(handle, CALC_EVENT_TYPE_AFTER_RECV_DUSB_RPKT))
+	{
+		ticalcs_event_fill_header(handle, &event, /* type */ CALC_EVENT_TYPE_AFTER_RECV_DUSB_RPKT, /* retval */ ret, /* operation */ CALC_FNCT_LAST);
+		ticalcs_event_fill_dusb_rpkt(&event, /* size */ pkt->size, /* type */ pkt->type, /* data */ pkt->data);
+		ret = ticalcs_event_send(handle, &event);
+	}
 
 	CLEAR_HANDLE_BUSY_IF_NECESSARY(handle);
 
@@ -535,9 +535,14 @@ int TICALL dusb_send_data(CalcHandle *handle, DUSBVirtualPacket *vtl)
 
 	SET_HANDLE_BUSY_IF_NECESSARY(handle);
 
-	ticalcs_event_fill_header(handle, &event, /* type */ CALC_EVENT_TYPE_BEFORE_SEND_DUSB_VPKT, /* retval */ 0, /* operation */ CALC_FNCT_LAST);
-	ticalcs_event_fill_dusb_vpkt(&event, /* size */ vtl->size, /* type */ vtl->type, /* data */ vtl->data);
-	ret = ticalcs_event_send(handle, &event);
+	int64_t start = ticalcs_metrics_clock(handle);
+
+	if (ticalcs_event_wanted(handle, CALC_EVENT_TYPE_BEFORE_SEND_DUSB_VPKT))
+	{
+		ticalcs_event_fill_header(handle, &event, /* type */ CALC_EVENT_TYPE_BEFORE_SEND_DUSB_VPKT, /* retval */ 0, /* operation */ CALC_FNCT_LAST);
+		ticalcs_event_fill_dusb_vpkt(&event, /* size */ vtl->size, /* type */ vtl->type, /* data */ vtl->data);
+		ret = ticalcs_event_send(handle, &event);
+	}
 
 	if (!ret)
 	{
@@ -669,9 +674,14 @@ int TICALL dusb_send_data(CalcHandle *handle, DUSBVirtualPacket *vtl)
 	}
 end:
 
-	ticalcs_event_fill_header(handle, &event, /* type */ CALC_EVENT_TYPE_AFTER_SEND_DUSB_VPKT, /* retval */ ret, /* operation */ CALC_FNCT_LAST);
-	ticalcs_event_fill_dusb_vpkt(&event, /* size */ vtl->size, /* type */ vtl->type, /* data */ vtl->data);
-	ret = ticalcs_event_send(handle, &event);
+	ticalcs_metrics_record(handle, CALC_METRICS_PROTOCOL_DUSB, /* recv */ 0, vtl->type, start, ret);
+
+	if (ticalcs_event_wanted(handle, CALC_EVENT_TYPE_AFTER_SEND_DUSB_VPKT))
+	{
+		ticalcs_event_fill_header(handle, &event, /* type */ CALC_EVENT_TYPE_AFTER_SEND_DUSB_VPKT, /* retval */ ret, /* operation */ CALC_FNCT_LAST);
+		ticalcs_event_fill_dusb_vpkt(&event, /* size */ vtl->size, /* type */ vtl->type, /* data */ vtl->data);
+		ret = ticalcs_event_send(handle, &event);
+	}
 
 	CLEAR_HANDLE_BUSY_IF_NECESSARY(handle);
 
@@ -729,9 +739,14 @@ int TICALL dusb_recv_data_varsize(CalcHandle* handle, DUSBVirtualPacket* vtl, ui
 
 	SET_HANDLE_BUSY_IF_NECESSARY(handle);
 
-	ticalcs_event_fill_header(handle, &event, /* type */ CALC_EVENT_TYPE_BEFORE_RECV_DUSB_VPKT, /* retval */ 0, /* operation */ CALC_FNCT_LAST);
-	ticalcs_event_fill_dusb_vpkt(&event, /* size */ 0, /* type */ 0, /* data */ NULL);
-	ret = ticalcs_event_send(handle, &event);
+	int64_t start = ticalcs_metrics_clock(handle);
+
+	if (ticalcs_event_wanted(handle, CALC_EVENT_TYPE_BEFORE_RECV_DUSB_VPKT))
+	{
+		ticalcs_event_fill_header(handle, &event, /* type */ CALC_EVENT_TYPE_BEFORE_RECV_DUSB_VPKT, /* retval */ 0, /* operation */ CALC_FNCT_LAST);
+		ticalcs_event_fill_dusb_vpkt(&event, /* size */ 0, /* type */ 0, /* data */ NULL);
+		ret = ticalcs_event_send(handle, &event);
+	}
 
 	if (!ret)
 	{
@@ -846,9 +861,14 @@ int TICALL dusb_recv_data_varsize(CalcHandle* handle, DUSBVirtualPacket* vtl, ui
 		} while (raw.type != DUSB_RPKT_VIRT_DATA_LAST);
 	}
 
-	ticalcs_event_fill_header(handle, &event, /* type */ CALC_EVENT_TYPE_AFTER_RECV_DUSB_VPKT, /* retval */ ret, /* operation */ CALC_FNCT_LAST);
-	ticalcs_event_fill_dusb_vpkt(&event, /* size */ vtl->size, /* type */ vtl->type, /* data */ vtl->data);
-	ret = ticalcs_event_send(handle, &event);
+	ticalcs_metrics_record(handle, CALC_METRICS_PROTOCOL_DUSB, /* recv */ 1, vtl->type, start, ret);
+
+	if (ticalcs_event_wanted(handle, CALC_EVENT_TYPE_AFTER_RECV_DUSB_VPKT))
+	{
+		ticalcs_event_fill_header(handle, &event, /* type */ CALC_EVENT_TYPE_AFTER_RECV_DUSB_VPKT, /* retval */ ret, /* operation */ CALC_FNCT_LAST);
+		ticalcs_event_fill_dusb_vpkt(&event, /* size */ vtl->size, /* type */ vtl->type, /* data */ vtl->data);
+		ret = ticalcs_event_send(handle, &event);
+	}
 
 	CLEAR_HANDLE_BUSY_IF_NECESSARY(handle);
 
@@ -333,7 +333,7 @@ static inline void ticalcs_event_fill_nsp_rpkt(CalcEventData * event, uint16_t s
 	event->data.nsp_rpkt.dst_addr = dst_addr;
 	event->data.nsp_rpkt.dst_port = dst_port;
 	event->data.nsp_rpkt.data_sum = data_sum;
-	event->data.nsp_rpkt.data_size = data_sum;
+	event->data.nsp_rpkt.data_size = data_size;
 	event->data.nsp_rpkt.ack = ack;
 	event->data.nsp_rpkt.seq = seq;
 	event->data.nsp_rpkt.hdr_sum = hdr_sum;
@@ -358,11 +358,54 @@ static inline void ticalcs_event_fill_romdump_pkt(CalcEventData * event, uint16_
 	event->data.romdump_pkt.data = data;
 }
 
+static inline uint32_t ticalcs_event_type_to_mask(CalcEventType type)
+{
+	if (type >= CALC_EVENT_TYPE_USER)
+	{
+		return CALC_EVENT_MASK_USER;
+	}
+	if (type >= CALC_EVENT_TYPE_BEFORE_GENERIC_OPERATION)
+	{
+		return CALC_EVENT_MASK_GENERIC;
+	}
+	if (type >= CALC_EVENT_TYPE_BEFORE_SEND_ROMDUMP_PKT)
+	{
+		return CALC_EVENT_MASK_ROMDUMP_PKT;
+	}
+	if (type >= CALC_EVENT_TYPE_BEFORE_SEND_NSP_VPKT)
+	{
+		return CALC_EVENT_MASK_NSP_VPKT;
+	}
+	if (type >= CALC_EVENT_TYPE_BEFORE_SEND_NSP_RPKT)
+	{
+		return CALC_EVENT_MASK_NSP_RPKT;
+	}
+	if (type >= CALC_EVENT_TYPE_BEFORE_SEND_DUSB_VPKT)
+	{
+		return CALC_EVENT_MASK_DUSB_VPKT;
+	}
+	if (type >= CALC_EVENT_TYPE_BEFORE_SEND_DUSB_RPKT)
+	{
+		return CALC_EVENT_MASK_DUSB_RPKT;
+	}
+	if (type >= CALC_EVENT_TYPE_BEFORE_SEND_DBUS_PKT)
+	{
+		return CALC_EVENT_MASK_DBUS_PKT;
+	}
+	return CALC_EVENT_MASK_CABLE;
+}
+
+// Cheap test done before building an event, so that unsubscribed events cost nothing.
+static inline int ticalcs_event_wanted(CalcHandle * handle, CalcEventType type)
+{
+	return (handle->event_hook != NULL) && (handle->event_mask & ticalcs_event_type_to_mask(type));
+}
+
 static inline int ticalcs_event_send_simple_generic(CalcHandle * handle, CalcEventType type, int retval, CalcFnctsIdx operation)
 {
 	int ret = retval;
 
-	if (handle->event_hook)
+	if (ticalcs_event_wanted(handle, type))
 	{
 		CalcEventData event;
 		ticalcs_event_fill_header(handle, &event, type, retval, operation);
@@ -383,7 +426,7 @@ static inline int ticalcs_event_send(CalcHandle * handle, CalcEventData * event)
 {
 	int ret = event->retval;
 
-	if (handle->event_hook)
+	if (ticalcs_event_wanted(handle, event->type))
 	{
 		handle->event_count++;
 		ret = handle->event_hook(handle, handle->event_count, event, handle->user_pointer);
@@ -457,4 +500,13 @@ int dusb_dissect_cmd_data(CalcModel model, FILE *f, const uint8_t * data, uint32
 		return ERR_INVALID_PARAMETER; \
 	}
 
+// metrics.c
+void ticalcs_metrics_record(CalcHandle * handle, CalcMetricsProtocol protocol, int recv, uint16_t type, int64_t start, int retval);
+
+// Start time of a measured packet, 0 when metrics are disabled.
+static inline int64_t ticalcs_metrics_clock(CalcHandle * handle)
+{
+	return handle->metrics != NULL ? g_get_monotonic_time() : 0;
+}
+
 #endif // __TICALCS_INTERNAL__
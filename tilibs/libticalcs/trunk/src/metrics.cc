@@ -0,0 +1,309 @@
+/* Hey EMACS -*- linux-c -*- */
+
+/*  libticalcs - Ti Calculator library, a part of the TiLP project
+ *  Copyright (C) 1999-2005  Romain Liévin
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software Foundation,
+ *  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+	Per packet type latency histograms and retry / error counters.
+	Histograms are the libticables ones (see ticables_histogram_record).
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ticalcs.h"
+#include "internal.h"
+#include "dbus_pkt.h"
+#include "logging.h"
+#include "error.h"
+
+typedef struct
+{
+	uint8_t protocol;
+	uint8_t recv;
+	uint16_t type;
+	CableHistogram histogram;
+} CalcPacketHistogram;
+
+typedef struct
+{
+	GMutex lock;
+	uint32_t count;
+	CalcPacketHistogram packets[CALC_METRICS_MAX_PACKETS];
+	uint32_t retries;
+	uint32_t checksum_errors;
+	uint32_t timeouts;
+	uint32_t errors;
+	uint32_t overflow;
+} CalcMetricsPriv;
+
+static CableHistogram * find_histogram(CalcMetricsPriv *metrics, CalcMetricsProtocol protocol, int recv, uint16_t type)
+{
+	uint32_t i;
+	CalcPacketHistogram *entry;
+
+	for (i = 0; i < metrics->count; i++)
+	{
+		entry = &metrics->packets[i];
+		if (entry->protocol == protocol && entry->recv == !!recv && entry->type == type)
+		{
+			return &entry->histogram;
+		}
+	}
+
+	if (metrics->count >= CALC_METRICS_MAX_PACKETS)
+	{
+		// Can only happen with garbage packet types.
+		if (!metrics->overflow++)
+		{
+			ticalcs_warning("metrics: too many packet types, ignoring the others");
+		}
+		return NULL;
+	}
+
+	entry = &metrics->packets[metrics->count++];
+	entry->protocol = (uint8_t)protocol;
+	entry->recv = !!recv;
+	entry->type = type;
+
+	return &entry->histogram;
+}
+
+// Called by the packet layers after each packet sent or received.
+void ticalcs_metrics_record(CalcHandle * handle, CalcMetricsProtocol protocol, int recv, uint16_t type, int64_t start, int retval)
+{
+	CalcMetricsPriv *metrics = (CalcMetricsPriv *)handle->metrics;
+	int64_t elapsed;
+
+	if (metrics == NULL || start == 0)
+	{
+		return;
+	}
+
+	elapsed = MAX(g_get_monotonic_time() - start, 0);
+
+	g_mutex_lock(&metrics->lock);
+	if (!retval)
+	{
+		ticables_histogram_record(find_histogram(metrics, protocol, recv, type), (uint32_t)MIN(elapsed, (int64_t)UINT32_MAX));
+	}
+	else if (retval == ERR_CHECKSUM && protocol == CALC_METRICS_PROTOCOL_DBUS && (type == DBUS_CMD_ERR || type == DBUS_CMD_ERR2))
+	{
+		metrics->retries++;
+	}
+	else if (retval == ERR_CHECKSUM)
+	{
+		metrics->checksum_errors++;
+	}
+	else if (retval == ERROR_READ_TIMEOUT || retval == ERROR_WRITE_TIMEOUT)
+	{
+		metrics->timeouts++;
+	}
+	else
+	{
+		metrics->errors++;
+	}
+	g_mutex_unlock(&metrics->lock);
+}
+
+/**
+ * ticalcs_calc_metrics_start:
+ * @handle: a previously allocated handle
+ *
+ * Start collecting latency histograms per DBUS command and DUSB virtual
+ * packet type, plus retry, checksum, timeout and error counters.
+ *
+ * Return value: 0 if successful, an error code otherwise.
+ **/
+int TICALL ticalcs_calc_metrics_start(CalcHandle *handle)
+{
+	CalcMetricsPriv *metrics;
+
+	VALIDATE_HANDLE(handle);
+	RETURN_IF_HANDLE_BUSY(handle);
+
+	if (handle->metrics != NULL)
+	{
+		return ERR_INVALID_PARAMETER;
+	}
+
+	metrics = (CalcMetricsPriv *)g_malloc0(sizeof(CalcMetricsPriv));
+	g_mutex_init(&metrics->lock);
+	handle->metrics = metrics;
+
+	return 0;
+}
+
+/**
+ * ticalcs_calc_metrics_reset:
+ * @handle: a previously allocated handle
+ *
+ * Clear the collected metrics. May be called while transfers are running.
+ *
+ * Return value: 0 if successful, an error code otherwise.
+ **/
+int TICALL ticalcs_calc_metrics_reset(CalcHandle *handle)
+{
+	CalcMetricsPriv *metrics;
+
+	VALIDATE_HANDLE(handle);
+
+	metrics = (CalcMetricsPriv *)handle->metrics;
+	if (metrics == NULL)
+	{
+		return ERR_INVALID_PARAMETER;
+	}
+
+	g_mutex_lock(&metrics->lock);
+	metrics->count = 0;
+	memset(metrics->packets, 0, sizeof(metrics->packets));
+	metrics->retries = 0;
+	metrics->checksum_errors = 0;
+	metrics->timeouts = 0;
+	metrics->errors = 0;
+	metrics->overflow = 0;
+	g_mutex_unlock(&metrics->lock);
+
+	return 0;
+}
+
+/**
+ * ticalcs_calc_metrics_get:
+ * @handle: a previously allocated handle
+ * @metrics: where to store the snapshot
+ *
+ * Take a consistent snapshot of the collected metrics. May be called from
+ * another thread while transfers are running.
+ *
+ * Return value: 0 if successful, an error code otherwise.
+ **/
+int TICALL ticalcs_calc_metrics_get(CalcHandle *handle, CalcMetrics *metrics)
+{
+	CalcMetricsPriv *priv;
+	uint32_t i;
+
+	VALIDATE_HANDLE(handle);
+	VALIDATE_NONNULL(metrics);
+
+	priv = (CalcMetricsPriv *)handle->metrics;
+	if (priv == NULL)
+	{
+		return ERR_INVALID_PARAMETER;
+	}
+
+	memset(metrics, 0, sizeof(*metrics));
+
+	g_mutex_lock(&priv->lock);
+	metrics->packet_count = priv->count;
+	for (i = 0; i < priv->count; i++)
+	{
+		metrics->packets[i].protocol = priv->packets[i].protocol;
+		metrics->packets[i].recv = priv->packets[i].recv;
+		metrics->packets[i].type = priv->packets[i].type;
+		ticables_histogram_stats(&priv->packets[i].histogram, &metrics->packets[i].latency);
+	}
+	metrics->retries = priv->retries;
+	metrics->checksum_errors = priv->checksum_errors;
+	metrics->timeouts = priv->timeouts;
+	metrics->errors = priv->errors;
+	g_mutex_unlock(&priv->lock);
+
+	return 0;
+}
+
+/**
+ * ticalcs_calc_metrics_json:
+ * @handle: a previously allocated handle
+ * @buffer: where to store the JSON text (may be NULL if @size is 0)
+ * @size: size of @buffer
+ *
+ * Format a snapshot of the metrics as a JSON object.
+ *
+ * Return value: length of the JSON text like snprintf (the output was
+ * truncated if it is >= @size), or a negative error code.
+ **/
+int TICALL ticalcs_calc_metrics_json(CalcHandle *handle, char *buffer, uint32_t size)
+{
+	CalcMetrics *metrics;
+	int ret;
+	uint32_t i;
+	size_t len = 0;
+
+	metrics = (CalcMetrics *)g_malloc(sizeof(CalcMetrics));
+	ret = ticalcs_calc_metrics_get(handle, metrics);
+	if (ret)
+	{
+		g_free(metrics);
+		return -ret;
+	}
+
+#define JSON_APPEND(...) \
+	do { \
+		int n_ = snprintf(buffer ? buffer + MIN(len, (size_t)size) : NULL, size > len ? size - len : 0, __VA_ARGS__); \
+		if (n_ > 0) len += (size_t)n_; \
+	} while (0)
+
+	JSON_APPEND("{\"packets\":[");
+	for (i = 0; i < metrics->packet_count; i++)
+	{
+		const CalcPacketMetrics *p = &metrics->packets[i];
+
+		JSON_APPEND("%s{\"protocol\":\"%s\",\"dir\":\"%s\",\"type\":%u,\"count\":%llu,\"total_us\":%llu,\"min_us\":%u,\"max_us\":%u,\"p50_us\":%u,\"p90_us\":%u,\"p99_us\":%u}",
+		            i ? "," : "", p->protocol == CALC_METRICS_PROTOCOL_DBUS ? "dbus" : "dusb", p->recv ? "recv" : "send", p->type,
+		            (unsigned long long)p->latency.count, (unsigned long long)p->latency.total_us,
+		            p->latency.min_us, p->latency.max_us, p->latency.p50_us, p->latency.p90_us, p->latency.p99_us);
+	}
+	JSON_APPEND("],\"retries\":%u,\"checksum_errors\":%u,\"timeouts\":%u,\"errors\":%u}",
+	            metrics->retries, metrics->checksum_errors, metrics->timeouts, metrics->errors);
+
+#undef JSON_APPEND
+
+	g_free(metrics);
+
+	return (int)len;
+}
+
+/**
+ * ticalcs_calc_metrics_stop:
+ * @handle: a previously allocated handle
+ *
+ * Stop collecting metrics and release them.
+ *
+ * Return value: 0 if successful, an error code otherwise.
+ **/
+int TICALL ticalcs_calc_metrics_stop(CalcHandle *handle)
+{
+	CalcMetricsPriv *metrics;
+
+	VALIDATE_HANDLE(handle);
+	RETURN_IF_HANDLE_BUSY(handle);
+
+	metrics = (CalcMetricsPriv *)handle->metrics;
+	if (metrics != NULL)
+	{
+		handle->metrics = NULL;
+		g_mutex_clear(&metrics->lock);
+		g_free(metrics);
+	}
+
+	return 0;
+}
@@ -194,6 +194,10 @@ static const uint32_t supported_calcs =
 // not static, must be shared between instances
 int ticalcs_instance = 0;	// counts # of instances
 
+// TICALCS_EVENT_DEBUG / TICALCS_PKT_DEBUG, read once by ticalcs_library_init()
+static int event_debug = 0;
+static int pkt_debug = 0;
+
 /**
  * ticalcs_library_init:
  *
@@ -238,6 +242,9 @@ int TICALL ticalcs_library_init(void)
 	ticalcs_info(_("ticalcs library version %s"), LIBCALCS_VERSION);
 	errno = 0;
 
+	event_debug = (getenv("TICALCS_EVENT_DEBUG") != NULL);
+	pkt_debug = (getenv("TICALCS_PKT_DEBUG") != NULL);
+
 #if defined(ENABLE_NLS)
 	ticalcs_info("setlocale: %s", setlocale(LC_ALL, ""));
 	ticalcs_info("bindtextdomain: %s", bindtextdomain(PACKAGE, locale_dir));
@@ -297,8 +304,7 @@ static int default_event_hook(CalcHandle * handle, uint32_t event_count, const C
 	CableHandle * cable = ticalcs_cable_get(handle);
 	const char * cablestr = ticables_model_to_string(ticables_get_model(cable));
 	const char * portstr = ticables_port_to_string(ticables_get_port(cable));
-	int pkt_debug = (getenv("TICALCS_PKT_DEBUG") != NULL);
-	if (getenv("TICALCS_EVENT_DEBUG") != NULL)
+	if (event_debug)
 	{
 		ticalcs_info("Event #%u %d for calc %s connected through cable %s port %s", event_count, event->type, calcstr, cablestr, portstr);
 	}
@@ -473,6 +479,16 @@ CalcHandle* TICALL ticalcs_handle_new(CalcModel model)
 			handle->event_hook = default_event_hook;
 			//handle->event_count = 0;
 
+			// The default hook only reports cable attach/detach unless debugging is on.
+			if (event_debug || pkt_debug)
+			{
+				handle->event_mask = CALC_EVENT_MASK_ALL;
+			}
+			else
+			{
+				handle->event_mask = CALC_EVENT_MASK_CABLE | CALC_EVENT_MASK_USER;
+			}
+
 			handle->buffer = (uint8_t *)g_malloc(65536 + 6);
 			if (handle->buffer == NULL)
 			{
@@ -511,6 +527,8 @@ int TICALL ticalcs_handle_del(CalcHandle* handle)
 		ticalcs_cable_detach(handle);
 	}
 
+	ticalcs_calc_metrics_stop(handle);
+
 	if (handle->buffer2)
 	{
 		g_free(handle->buffer2);
@@ -789,6 +807,8 @@ ticalcs_event_hook_type TICALL ticalcs_calc_set_event_hook(CalcHandle *handle, t
 
 	old_hook = handle->event_hook;
 	handle->event_hook = hook;
+	// A custom hook gets every event unless it narrows the mask afterwards.
+	handle->event_mask = CALC_EVENT_MASK_ALL;
 
 	return old_hook;
 }
@@ -870,7 +890,7 @@ int TICALL ticalcs_calc_fire_user_event(CalcHandle *handle, CalcEventType type,
 
 	VALIDATE_HANDLE(handle);
 
-	if (handle->event_hook && type >= CALC_EVENT_TYPE_USER)
+	if (type >= CALC_EVENT_TYPE_USER && ticalcs_event_wanted(handle, type))
 	{
 		CalcEventData event;
 		ticalcs_event_fill_header(handle, &event, /* type */ type, /* retval */ retval, /* operation */ CALC_FNCT_LAST);
@@ -882,3 +902,49 @@ int TICALL ticalcs_calc_fire_user_event(CalcHandle *handle, CalcEventType type,
 
 	return ret;
 }
+
+/**
+ * ticalcs_calc_get_event_mask:
+ * @handle: a previously allocated handle.
+ *
+ * Get the classes of events (CalcEventMask) dispatched by this handle.
+ *
+ * Return value: a binary OR of CALC_EVENT_MASK_* values.
+ */
+uint32_t TICALL ticalcs_calc_get_event_mask(CalcHandle *handle)
+{
+	if (!ticalcs_validate_handle(handle))
+	{
+		ticalcs_critical("%s: handle is NULL", __FUNCTION__);
+		return 0;
+	}
+
+	return handle->event_mask;
+}
+
+/**
+ * ticalcs_calc_set_event_mask:
+ * @handle: a previously allocated handle.
+ * @mask: binary OR of CALC_EVENT_MASK_* values.
+ *
+ * Select the classes of events dispatched to the event hook; events outside
+ * the mask are neither built nor counted.
+ * Note that ticalcs_calc_set_event_hook() resets the mask to CALC_EVENT_MASK_ALL.
+ *
+ * Return value: the previous mask.
+ */
+uint32_t TICALL ticalcs_calc_set_event_mask(CalcHandle *handle, uint32_t mask)
+{
+	uint32_t old_mask;
+
+	if (!ticalcs_validate_handle(handle))
+	{
+		ticalcs_critical("%s: handle is NULL", __FUNCTION__);
+		return 0;
+	}
+
+	old_mask = handle->event_mask;
+	handle->event_mask = mask & CALC_EVENT_MASK_ALL;
+
+	return old_mask;
+}
@@ -786,6 +786,78 @@ typedef enum
 	CALC_EVENT_TYPE_USER = 49152
 } CalcEventType;
 
+/**
+ * CalcEventMask:
+ *
+ * Event classes a handle dispatches to its event hook.
+ * Events whose class is not in the handle's mask are not built at all.
+ */
+typedef enum
+{
+	CALC_EVENT_MASK_NONE        = 0,
+	CALC_EVENT_MASK_CABLE       = 1 << 0,   /* cable attach / detach */
+	CALC_EVENT_MASK_DBUS_PKT    = 1 << 1,
+	CALC_EVENT_MASK_DUSB_RPKT   = 1 << 2,
+	CALC_EVENT_MASK_DUSB_VPKT   = 1 << 3,
+	CALC_EVENT_MASK_NSP_RPKT    = 1 << 4,
+	CALC_EVENT_MASK_NSP_VPKT    = 1 << 5,
+	CALC_EVENT_MASK_ROMDUMP_PKT = 1 << 6,
+	CALC_EVENT_MASK_GENERIC     = 1 << 7,   /* BEFORE/AFTER_GENERIC_OPERATION */
+	CALC_EVENT_MASK_USER        = 1 << 8,
+	CALC_EVENT_MASK_ALL         = (1 << 9) - 1
+} CalcEventMask;
+
+#define CALC_METRICS_MAX_PACKETS	64
+
+/**
+ * CalcMetricsProtocol:
+ *
+ * Protocol of a #CalcPacketMetrics entry.
+ **/
+typedef enum
+{
+	CALC_METRICS_PROTOCOL_DBUS = 1,
+	CALC_METRICS_PROTOCOL_DUSB
+} CalcMetricsProtocol;
+
+/**
+ * CalcPacketMetrics:
+ * @protocol: a #CalcMetricsProtocol.
+ * @recv: 0 for packets sent to the calculator, 1 for packets received from it.
+ * @type: DBUS command or DUSB virtual packet type.
+ * @latency: time spent sending or receiving packets of this type.
+ *
+ * Latency statistics for one packet type.
+ **/
+typedef struct
+{
+	uint8_t protocol;
+	uint8_t recv;
+	uint16_t type;
+	CableLatencyStats latency;
+} CalcPacketMetrics;
+
+/**
+ * CalcMetrics:
+ * @packet_count: number of valid entries in @packets.
+ * @packets: per packet type statistics, in order of first appearance.
+ * @retries: retransmissions requested by the calculator (DBUS ERR).
+ * @checksum_errors: received packets with a bad checksum.
+ * @timeouts: packets which failed with a read or write timeout.
+ * @errors: packets which failed otherwise.
+ *
+ * Snapshot of the metrics collected on a calc handle.
+ **/
+typedef struct
+{
+	uint32_t packet_count;
+	CalcPacketMetrics packets[CALC_METRICS_MAX_PACKETS];
+	uint32_t retries;
+	uint32_t checksum_errors;
+	uint32_t timeouts;
+	uint32_t errors;
+} CalcMetrics;
+
 /**
  * CalcEventData:
  * @version: event protocol version.
@@ -862,6 +934,8 @@ typedef int (*ticalcs_event_hook_type)(CalcHandle * handle, uint32_t event_count
  * @event_hook: callback fired upon various events (replaces and expands on the deprecated callbacks).
  * @user_pointer: user-set pointer passed to the event callbacks.
  * @event_count: number of events sent since this handle was created.
+ * @event_mask: classes of events (CalcEventMask) which are dispatched.
+ * @metrics: packet latency histograms and counters, if enabled.
  *
  * A structure used to store information as a handle.
  * !!! This structure is for private use !!!
@@ -885,6 +959,8 @@ struct _CalcHandle
 	ticalcs_event_hook_type event_hook;
 	void * user_pointer;
 	uint32_t event_count;
+	uint32_t event_mask;
+	void * metrics;
 
 	struct {
 		uint32_t dusb_rpkt_maxlen; // max length of data in raw packet
@@ -962,6 +1038,15 @@ typedef struct
 	TIEXPORT3 void * ticalcs_calc_set_event_user_pointer(CalcHandle *handle, void * user_pointer);
 	TIEXPORT3 uint32_t TICALL ticalcs_calc_get_event_count(CalcHandle *handle);
 	TIEXPORT3 int TICALL ticalcs_calc_fire_user_event(CalcHandle *handle, CalcEventType type, int retval, void * user_data, uint32_t user_len);
+	TIEXPORT3 uint32_t TICALL ticalcs_calc_get_event_mask(CalcHandle *handle);
+	TIEXPORT3 uint32_t TICALL ticalcs_calc_set_event_mask(CalcHandle *handle, uint32_t mask);
+
+	// metrics.c
+	TIEXPORT3 int TICALL ticalcs_calc_metrics_start(CalcHandle *handle);
+	TIEXPORT3 int TICALL ticalcs_calc_metrics_reset(CalcHandle *handle);
+	TIEXPORT3 int TICALL ticalcs_calc_metrics_get(CalcHandle *handle, CalcMetrics *metrics);
+	TIEXPORT3 int TICALL ticalcs_calc_metrics_json(CalcHandle *handle, char *buffer, uint32_t size);
+	TIEXPORT3 int TICALL ticalcs_calc_metrics_stop(CalcHandle *handle);
 
 	// error.c
 	TIEXPORT3 int         TICALL ticalcs_error_get (int number, char **message);
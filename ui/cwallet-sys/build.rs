@@ -59,8 +59,17 @@ fn main() {
     // Re-run if any C source changes
     println!("cargo:rerun-if-changed=../../CMakeLists.txt");
     println!("cargo:rerun-if-changed=../../calc_session.c");
+    println!("cargo:rerun-if-changed=../../calc_pool.c");
+    println!("cargo:rerun-if-changed=../../calc_discovery.c");
     println!("cargo:rerun-if-changed=../../calc_string_store.c");
+    println!("cargo:rerun-if-changed=../../calc_vault.c");
     println!("cargo:rerun-if-changed=../../wallet_crypto.c");
+    println!("cargo:rerun-if-changed=../../wallet_argon2.c");
+    println!("cargo:rerun-if-changed=../../wallet_random.c");
+    println!("cargo:rerun-if-changed=../../wallet_aead.c");
+    println!("cargo:rerun-if-changed=../../wallet_agent.c");
+    println!("cargo:rerun-if-changed=../../wallet_verify.c");
+    println!("cargo:rerun-if-changed=../../wallet_hd.c");
     println!("cargo:rerun-if-changed=../../solana/");
     println!("cargo:rerun-if-changed=../../keypair/");
 }
@@ -6,7 +6,7 @@
 
 #![allow(non_camel_case_types)]
 
-use std::os::raw::{c_char, c_int, c_long, c_uchar, c_void};
+use std::os::raw::{c_char, c_int, c_long, c_uchar, c_uint, c_void};
 
 // ---------------------------------------------------------------------------
 // Constants
@@ -22,6 +22,11 @@ pub const APP_ERR_IO: c_int = 5;
 pub const APP_ERR_THREAD: c_int = 6;
 pub const APP_ERR_CRYPTO: c_int = 7;
 
+// Readiness monitor states (CalcSessionState in calc_session.h)
+pub const CALC_SESSION_STATE_UNKNOWN: c_int = 0;
+pub const CALC_SESSION_STATE_READY: c_int = 1;
+pub const CALC_SESSION_STATE_NOT_READY: c_int = 2;
+
 // Solana error codes (solana_client.h)
 pub const SOLANA_OK: c_int = 0;
 pub const SOLANA_ERROR_INVALID_ARGUMENT: c_int = -1;
@@ -30,23 +35,132 @@ pub const SOLANA_ERROR_CURL: c_int = -3;
 pub const SOLANA_ERROR_HTTP_STATUS: c_int = -4;
 
 // Wallet crypto sizes (wallet_crypto.h)
-pub const WALLET_BLOB_VERSION: u32 = 1;
+pub const WALLET_BLOB_VERSION: u32 = 2;
+pub const WALLET_BLOB_VERSION_V1: u32 = 1;
 pub const WALLET_SALT_LEN: usize = 16;
 pub const WALLET_NONCE_LEN: usize = 12;
 pub const WALLET_MAC_LEN: usize = 32;
 pub const WALLET_PUBLIC_KEY_LEN: usize = 32;
 pub const WALLET_PRIVATE_KEY_LEN: usize = 64;
 pub const WALLET_SEED_LEN: usize = 32;
-pub const WALLET_BLOB_LEN: usize = 1 + WALLET_SALT_LEN + WALLET_NONCE_LEN + WALLET_PRIVATE_KEY_LEN + WALLET_MAC_LEN;
+pub const WALLET_KDF_PARAMS_LEN: usize = 8;
+pub const WALLET_BLOB_V1_LEN: usize = 1 + WALLET_SALT_LEN + WALLET_NONCE_LEN + WALLET_PRIVATE_KEY_LEN + WALLET_MAC_LEN;
+pub const WALLET_BLOB_LEN: usize = WALLET_BLOB_V1_LEN + WALLET_KDF_PARAMS_LEN;
 
-/// 32-byte public key + 125-byte encrypted blob
+/// 32-byte public key + 133-byte encrypted blob (125 bytes for v1 blobs)
 pub const STORED_KEY_PAYLOAD_LEN: usize = WALLET_PUBLIC_KEY_LEN + WALLET_BLOB_LEN;
 
+// KDF ids and calibration target (wallet_crypto.h)
+pub const WALLET_KDF_PBKDF2_SHA512: c_int = 1;
+pub const WALLET_KDF_ARGON2ID: c_int = 2;
+pub const WALLET_KDF_TARGET_MS: c_uint = 1000;
+
+// v3 vaults (wallet_crypto.h)
+pub const WALLET_VAULT_VERSION: u32 = 3;
+pub const WALLET_VAULT_NONCE_PREFIX_LEN: usize = 7;
+pub const WALLET_VAULT_TAG_LEN: usize = 16;
+pub const WALLET_VAULT_HEADER_LEN: usize =
+    1 + WALLET_KDF_PARAMS_LEN + WALLET_SALT_LEN + WALLET_VAULT_NONCE_PREFIX_LEN + 4;
+pub const WALLET_VAULT_CHUNK_LEN: u32 = 64 * 1024;
+pub const WALLET_VAULT_MAX_CHUNK_LEN: u32 = 16 * 1024 * 1024;
+
+/// Mirrors `WalletKdfParams` from wallet_crypto.h.
+#[repr(C)]
+#[derive(Clone, Copy, Debug, Default)]
+pub struct WalletKdfParams {
+    pub id: c_int, // WalletKdfId (enum → int)
+    pub cost: u32,
+    pub passes: u32,
+    pub lanes: u32,
+}
+
+/// Mirrors `WalletVaultStream` from wallet_crypto.h. Holds the vault key:
+/// pass it to `wallet_vault_stream_wipe` before dropping.
+#[repr(C)]
+#[derive(Clone, Copy, Debug)]
+pub struct WalletVaultStream {
+    pub key: [u8; 32],
+    pub header: [u8; WALLET_VAULT_HEADER_LEN],
+    pub chunk_len: u32,
+    pub next_chunk: u32,
+    pub finished: c_int,
+}
+
+/// Mirrors `ed25519_segment` from keypair/ed25519.h.
+#[repr(C)]
+#[derive(Clone, Copy, Debug)]
+pub struct Ed25519Segment {
+    pub data: *const c_uchar,
+    pub len: usize,
+}
+
+/// Mirrors `sha512_context` from keypair/sha512.h.
+#[repr(C)]
+#[derive(Clone, Copy, Debug)]
+pub struct Sha512Context {
+    pub length: u64,
+    pub state: [u64; 8],
+    pub curlen: usize,
+    pub buf: [u8; 128],
+}
+
+/// Mirrors `ed25519_signer` from keypair/ed25519.h.
+#[repr(C)]
+#[derive(Clone, Copy, Debug)]
+pub struct Ed25519Signer {
+    pub expanded_private: [u8; 64],
+    pub public_key: [u8; 32],
+    pub nonce_prefix: Sha512Context,
+}
+
+// SLIP-0010 derivation (wallet_hd.h)
+pub const WALLET_HD_HARDENED: u32 = 0x8000_0000;
+pub const WALLET_HD_MAX_DEPTH: usize = 8;
+pub const WALLET_HD_CACHE_ENTRIES: usize = 32;
+pub const WALLET_HD_SOLANA_DEPTH: usize = 4;
+
+/// Mirrors `WalletHdNode` from wallet_hd.h.
+#[repr(C)]
+#[derive(Clone, Copy, Debug, Default)]
+pub struct WalletHdNode {
+    pub last_used: u64,
+    pub depth: usize,
+    pub path: [u32; WALLET_HD_MAX_DEPTH],
+    pub key: [u8; WALLET_SEED_LEN],
+    pub chain_code: [u8; WALLET_SEED_LEN],
+}
+
+/// Mirrors `WalletHdContext` from wallet_hd.h. Holds key material: pass it
+/// to `wallet_hd_clear` before dropping.
+#[repr(C)]
+#[derive(Clone, Copy, Debug, Default)]
+pub struct WalletHdContext {
+    pub master: WalletHdNode,
+    pub clock: u64,
+    pub cache: [WalletHdNode; WALLET_HD_CACHE_ENTRIES],
+}
+
 // ---------------------------------------------------------------------------
 // CalcSession — laid out identically to the C struct so we can stack-allocate
 // and pass `&mut` to C functions.
 // ---------------------------------------------------------------------------
 
+/// Mirrors `CalcSessionStatus` from calc_session.h.
+#[repr(C)]
+#[derive(Clone, Copy, Debug, Default)]
+pub struct CalcSessionStatus {
+    pub state: c_int, // CalcSessionState (enum → int)
+    pub last_error: c_int,
+    pub latency_us: u32,
+    pub interval_ms: c_int,
+    pub probe_count: u32,
+    pub reattach_count: u32,
+}
+
+/// `calc_session_status_fn`; called on the session I/O thread.
+pub type calc_session_status_fn =
+    Option<unsafe extern "C" fn(status: *const CalcSessionStatus, user_data: *mut c_void)>;
+
 /// Mirrors `CalcSession` from calc_session.h.
 ///
 /// Fields use opaque pointers for TI library handles.  The struct is
@@ -62,6 +176,59 @@ pub struct CalcSession {
     pub poll_active: c_int,       // volatile int
     pub poll_thread_started: c_int,
     pub poll_thread: u64,         // pthread_t (opaque, 8 bytes on 64-bit)
+    pub link_generation: u32,     // calc_discovery generation at last attach
+    pub link: *mut c_void,        // struct CalcSessionLink* (I/O thread state)
+    pub status_callback: calc_session_status_fn,
+    pub status_user_data: *mut c_void,
+    pub string_cache: *mut c_void, // struct CalcStringCache* (host variable cache)
+}
+
+/// Mirrors `CalcBinaryString` from calc_string_store.h.
+#[repr(C)]
+pub struct CalcBinaryString {
+    pub var_name: *const c_char,
+    pub payload: *const u8,
+    pub payload_len: usize,
+}
+
+/// Mirrors `CalcBinaryStringFetch` from calc_string_store.h.
+#[repr(C)]
+pub struct CalcBinaryStringFetch {
+    pub var_name: *const c_char,
+    pub out_data: *mut u8,
+    pub out_size: usize,
+    pub out_len: usize,
+    pub status: c_int,
+}
+
+// Wallet vault (calc_vault.h)
+pub const CALC_VAULT_MAX_ENTRIES: usize = 64;
+pub const CALC_VAULT_LABEL_LEN: usize = 8;
+pub const CALC_VAULT_KEYPAIR: c_int = 1;
+pub const CALC_VAULT_CONTACT: c_int = 2;
+pub const CALC_VAULT_NONCE_ACCOUNT: c_int = 3;
+
+/// Mirrors `CalcVaultEntry` from calc_vault.h.
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct CalcVaultEntry {
+    pub kind: u8,
+    pub flags: u8,
+    pub label: [c_char; CALC_VAULT_LABEL_LEN + 1],
+    pub public_key: [u8; WALLET_PUBLIC_KEY_LEN],
+    pub offset: u16,
+    pub length: u16,
+    pub capacity: u16,
+}
+
+/// Mirrors `CalcVault` from calc_vault.h.
+#[repr(C)]
+pub struct CalcVault {
+    pub entry_count: c_uint,
+    pub entries: [CalcVaultEntry; CALC_VAULT_MAX_ENTRIES],
+    pub data: *mut u8,
+    pub data_len: usize,
+    pub data_capacity: usize,
 }
 
 // ---------------------------------------------------------------------------
@@ -90,6 +257,20 @@ extern "C" {
     pub fn calc_session_cleanup(session: *mut CalcSession);
     pub fn calc_session_start_polling(session: *mut CalcSession, interval_ms: c_int) -> c_int;
     pub fn calc_session_stop_polling(session: *mut CalcSession);
+    pub fn calc_session_isready(session: *mut CalcSession) -> c_int;
+    pub fn calc_session_set_status_callback(
+        session: *mut CalcSession,
+        callback: calc_session_status_fn,
+        user_data: *mut c_void,
+    );
+    pub fn calc_session_get_status(session: *mut CalcSession, out_status: *mut CalcSessionStatus) -> c_int;
+    pub fn calc_session_status_fd(session: *mut CalcSession) -> c_int;
+    pub fn calc_session_reattach(session: *mut CalcSession) -> c_int;
+    pub fn calc_session_ensure_link(session: *mut CalcSession) -> c_int;
+
+    // -- USB hotplug discovery ----------------------------------------------
+    pub fn calc_discovery_start() -> c_int;
+    pub fn calc_discovery_stop();
 
     // -- Calculator string storage ------------------------------------------
     pub fn calc_store_persistent_string(
@@ -119,10 +300,40 @@ extern "C" {
         out_len: *mut usize,
     ) -> c_int;
 
+    pub fn calc_store_binary_strings(
+        session: *mut CalcSession,
+        items: *const CalcBinaryString,
+        count: usize,
+    ) -> c_int;
+
+    pub fn calc_fetch_binary_strings(
+        session: *mut CalcSession,
+        items: *mut CalcBinaryStringFetch,
+        count: usize,
+    ) -> c_int;
+
+    pub fn calc_string_cache_invalidate(session: *mut CalcSession);
+
+    // -- Wallet vault -------------------------------------------------------
+    pub fn calc_vault_init(vault: *mut CalcVault);
+    pub fn calc_vault_free(vault: *mut CalcVault);
+    pub fn calc_vault_load(session: *mut CalcSession, vault: *mut CalcVault) -> c_int;
+    pub fn calc_vault_save(session: *mut CalcSession, vault: *const CalcVault) -> c_int;
+    pub fn calc_vault_find(vault: *const CalcVault, label: *const c_char) -> c_int;
+    pub fn calc_vault_get(
+        vault: *const CalcVault,
+        index: c_int,
+        out_data: *mut u8,
+        out_size: usize,
+        out_len: *mut usize,
+    ) -> c_int;
+
     // -- Wallet crypto ------------------------------------------------------
     pub fn wallet_random_bytes(buffer: *mut u8, length: usize) -> c_int;
     pub fn wallet_secure_zero(ptr: *mut c_void, length: usize);
 
+    pub fn wallet_constant_time_compare(a: *const u8, b: *const u8, len: usize) -> c_int;
+
     pub fn wallet_encrypt_private_key(
         password: *const c_char,
         private_key: *const u8,
@@ -139,6 +350,90 @@ extern "C" {
         private_key_len: usize,
     ) -> c_int;
 
+    pub fn wallet_encrypt_private_key_kdf(
+        password: *const c_char,
+        params: *const WalletKdfParams,
+        private_key: *const u8,
+        private_key_len: usize,
+        out_blob: *mut u8,
+        out_blob_len: usize,
+    ) -> c_int;
+
+    pub fn wallet_kdf_calibrate(id: c_int, target_ms: c_uint, out_params: *mut WalletKdfParams) -> c_int;
+    pub fn wallet_kdf_default_params(out_params: *mut WalletKdfParams);
+    pub fn wallet_blob_length(blob: *const u8, available: usize) -> usize;
+
+    pub fn wallet_vault_sealed_length(plaintext_len: usize, chunk_len: u32) -> usize;
+    pub fn wallet_vault_seal(
+        password: *const c_char,
+        params: *const WalletKdfParams,
+        plaintext: *const u8,
+        plaintext_len: usize,
+        out_vault: *mut u8,
+        out_vault_len: usize,
+        out_written: *mut usize,
+    ) -> c_int;
+    pub fn wallet_vault_open(
+        password: *const c_char,
+        vault: *const u8,
+        vault_len: usize,
+        out_plaintext: *mut u8,
+        out_plaintext_len: usize,
+        out_read: *mut usize,
+    ) -> c_int;
+    pub fn wallet_vault_seal_init(
+        stream: *mut WalletVaultStream,
+        password: *const c_char,
+        params: *const WalletKdfParams,
+        chunk_len: u32,
+        out_header: *mut u8,
+    ) -> c_int;
+    pub fn wallet_vault_seal_chunk(
+        stream: *mut WalletVaultStream,
+        chunk: *const u8,
+        length: usize,
+        last: c_int,
+        out_sealed: *mut u8,
+    ) -> c_int;
+    pub fn wallet_vault_open_init(
+        stream: *mut WalletVaultStream,
+        password: *const c_char,
+        header: *const u8,
+        header_len: usize,
+    ) -> c_int;
+    pub fn wallet_vault_open_chunk(
+        stream: *mut WalletVaultStream,
+        sealed: *const u8,
+        sealed_len: usize,
+        last: c_int,
+        out_chunk: *mut u8,
+    ) -> c_int;
+    pub fn wallet_vault_stream_wipe(stream: *mut WalletVaultStream);
+
+    // -- SLIP-0010 derivation -----------------------------------------------
+    pub fn wallet_hd_init(ctx: *mut WalletHdContext, seed: *const u8, seed_len: usize) -> c_int;
+    pub fn wallet_hd_clear(ctx: *mut WalletHdContext);
+    pub fn wallet_hd_derive(
+        ctx: *mut WalletHdContext,
+        path: *const u32,
+        depth: usize,
+        out_seed: *mut u8,
+    ) -> c_int;
+    pub fn wallet_hd_derive_keypair(
+        ctx: *mut WalletHdContext,
+        path: *const u32,
+        depth: usize,
+        out_public_key: *mut u8,
+        out_private_key: *mut u8,
+    ) -> c_int;
+    pub fn wallet_hd_solana_path(account: u32, out_path: *mut u32) -> usize;
+    pub fn wallet_hd_parse_path(
+        text: *const c_char,
+        out_path: *mut u32,
+        max_depth: usize,
+        out_depth: *mut usize,
+    ) -> c_int;
+
     // -- Ed25519 ------------------------------------------------------------
     pub fn ed25519_create_seed(seed: *mut c_uchar) -> c_int;
 
@@ -161,6 +456,21 @@ extern "C" {
         private_key: *const c_uchar,
     );
 
+    pub fn ed25519_signer_init(
+        signer: *mut Ed25519Signer,
+        public_key: *const c_uchar,
+        private_key: *const c_uchar,
+    );
+
+    pub fn ed25519_signer_sign(
+        signer: *const Ed25519Signer,
+        signature: *mut c_uchar,
+        segments: *const Ed25519Segment,
+        count: usize,
+    );
+
+    pub fn ed25519_signer_wipe(signer: *mut Ed25519Signer);
+
     pub fn ed25519_verify(
         signature: *const c_uchar,
         message: *const c_uchar,
@@ -168,6 +478,15 @@ extern "C" {
         public_key: *const c_uchar,
     ) -> c_int;
 
+    pub fn wallet_verify(
+        signature: *const u8,
+        message: *const u8,
+        message_len: usize,
+        public_key: *const u8,
+    ) -> c_int;
+
+    pub fn wallet_verify_cache_clear();
+
     // -- Solana client ------------------------------------------------------
     pub fn solana_client_init(
         client: *mut solana_client_t,
@@ -1,3 +1,6 @@
+use std::time::Duration;
+
+use cwallet_sys as sys;
 use dioxus::prelude::*;
 
 use crate::ffi::Calculator;
@@ -14,10 +17,15 @@ pub fn ConnectionStatusIndicator() -> Element {
         ConnectionStatus::Disconnected => ("dot disconnected", "Disconnected"),
         ConnectionStatus::Connecting => ("dot connecting", "Connecting"),
         ConnectionStatus::Connected => ("dot connected", "Connected"),
+        ConnectionStatus::NotResponding => ("dot connecting", "Not responding"),
         ConnectionStatus::Error(_) => ("dot error", "Error"),
     };
 
-    let is_connected = matches!(status, ConnectionStatus::Connected);
+    let is_connected = matches!(status, ConnectionStatus::Connected | ConnectionStatus::NotResponding);
+    let latency_title = match wallet.read().link_latency_us {
+        Some(us) => format!("Link round trip: {:.1} ms", f64::from(us) / 1000.0),
+        None => String::new(),
+    };
 
     let calc_for_disconnect = calc.clone();
     let connect = move |_| {
@@ -37,6 +45,7 @@ pub fn ConnectionStatusIndicator() -> Element {
                 Ok(calculator) => {
                     *calc.lock().unwrap() = Some(calculator);
                     wallet.write().connection_status = ConnectionStatus::Connected;
+                    watch_link_status(calc, wallet).await;
                 }
                 Err(e) => {
                     let msg = e.to_string();
@@ -50,6 +59,7 @@ pub fn ConnectionStatusIndicator() -> Element {
     let disconnect = move |_| {
         *calc_for_disconnect.lock().unwrap() = None;
         wallet.write().connection_status = ConnectionStatus::Disconnected;
+        wallet.write().link_latency_us = None;
         wallet.write().loaded_keypair = None;
         wallet.write().balance_lamports = None;
     };
@@ -57,7 +67,7 @@ pub fn ConnectionStatusIndicator() -> Element {
     rsx! {
         div { class: "conn-indicator",
             span { class: dot_class }
-            span { class: "conn-label", "{label}" }
+            span { class: "conn-label", title: "{latency_title}", "{label}" }
             if is_connected {
                 button { class: "conn-btn conn-btn-disconnect", onclick: disconnect, "Disconnect" }
             } else {
@@ -71,3 +81,36 @@ pub fn ConnectionStatusIndicator() -> Element {
         }
     }
 }
+
+/// Mirror the session monitor into the UI until the calculator is dropped.
+/// Only reads the cached status, so it adds no link traffic; skips a tick
+/// when a transfer holds the calculator lock.
+async fn watch_link_status(calc: SharedCalculator, mut wallet: Signal<WalletState>) {
+    loop {
+        tokio::time::sleep(Duration::from_millis(250)).await;
+
+        let status = match calc.try_lock() {
+            Ok(mut guard) => match guard.as_mut() {
+                Some(calculator) => calculator.link_status(),
+                None => return,
+            },
+            Err(_) => continue,
+        };
+
+        let Some(status) = status else { continue };
+        let next = match status.state {
+            sys::CALC_SESSION_STATE_READY => ConnectionStatus::Connected,
+            sys::CALC_SESSION_STATE_NOT_READY => ConnectionStatus::NotResponding,
+            _ => continue,
+        };
+
+        if wallet.read().connection_status != next {
+            wallet.write().connection_status = next;
+        }
+        if status.state == sys::CALC_SESSION_STATE_READY
+            && wallet.read().link_latency_us != Some(status.latency_us)
+        {
+            wallet.write().link_latency_us = Some(status.latency_us);
+        }
+    }
+}
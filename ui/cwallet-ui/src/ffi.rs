@@ -77,6 +77,8 @@ pub fn init_ti_libraries() {
         sys::ticables_library_init();
         sys::tifiles_library_init();
         sys::ticalcs_library_init();
+        // Best effort: without it, sessions just don't reattach on their own.
+        sys::calc_discovery_start();
     }
 }
 
@@ -84,9 +86,14 @@ pub fn init_ti_libraries() {
 // Calculator
 // ---------------------------------------------------------------------------
 
+/// Base readiness probe interval for the UI session, in milliseconds.
+const LINK_MONITOR_INTERVAL_MS: i32 = 500;
+
 /// Owns a `CalcSession`, cleaning up on drop.
+///
+/// The session is boxed because its I/O thread keeps a pointer to it.
 pub struct Calculator {
-    session: sys::CalcSession,
+    session: Box<sys::CalcSession>,
 }
 
 // All access goes through Arc<Mutex<>>, so this is safe.
@@ -95,22 +102,33 @@ unsafe impl Send for Calculator {}
 impl Calculator {
     /// Open a connection to the calculator.
     pub fn open() -> Result<Self, WalletError> {
-        let mut session = unsafe { std::mem::zeroed::<sys::CalcSession>() };
+        let mut session = Box::new(unsafe { std::mem::zeroed::<sys::CalcSession>() });
         // Default to port 1 (same as CLI)
         session.port_number = 1;
-        app_result(unsafe { sys::calc_session_open(&mut session) })?;
-        Ok(Self { session })
+        app_result(unsafe { sys::calc_session_open(&mut *session) })?;
+        let mut calculator = Self { session };
+        // The monitor backs off from here while the calculator stays ready.
+        calculator.start_polling(LINK_MONITOR_INTERVAL_MS)?;
+        Ok(calculator)
+    }
+
+    /// Last readiness state seen by the session monitor. Reads a cached
+    /// snapshot: no link traffic.
+    pub fn link_status(&mut self) -> Option<sys::CalcSessionStatus> {
+        let mut status = sys::CalcSessionStatus::default();
+        let code = unsafe { sys::calc_session_get_status(&mut *self.session, &mut status) };
+        (code == sys::APP_OK).then_some(status)
     }
 
     pub fn start_polling(&mut self, interval_ms: i32) -> Result<(), WalletError> {
-        app_result(unsafe { sys::calc_session_start_polling(&mut self.session, interval_ms) })
+        app_result(unsafe { sys::calc_session_start_polling(&mut *self.session, interval_ms) })
     }
 
     pub fn stop_polling(&mut self) {
-        unsafe { sys::calc_session_stop_polling(&mut self.session) };
+        unsafe { sys::calc_session_stop_polling(&mut *self.session) };
     }
 
-    /// Store a keypair payload (32-byte pubkey + 125-byte blob) in a Str slot.
+    /// Store a keypair payload (32-byte pubkey + encrypted blob) in a Str slot.
     pub fn store_keypair(
         &mut self,
         slot: &str,
@@ -118,21 +136,27 @@ impl Calculator {
         blob: &[u8; sys::WALLET_BLOB_LEN],
     ) -> Result<(), WalletError> {
         let var_name = CString::new(slot).map_err(|_| WalletError::Io("invalid slot".into()))?;
+        // A v1 blob fetched earlier only fills the front of the array.
+        let blob_len = unsafe { sys::wallet_blob_length(blob.as_ptr(), blob.len()) };
+        if blob_len == 0 {
+            return Err(WalletError::Crypto);
+        }
         let mut payload = [0u8; sys::STORED_KEY_PAYLOAD_LEN];
         payload[..32].copy_from_slice(public_key);
-        payload[32..].copy_from_slice(blob);
+        payload[32..32 + blob_len].copy_from_slice(&blob[..blob_len]);
+        app_result(unsafe { sys::calc_session_ensure_link(&mut *self.session) })?;
         app_result(unsafe {
             sys::calc_store_binary_string(
-                &mut self.session,
+                &mut *self.session,
                 var_name.as_ptr(),
                 payload.as_ptr(),
-                payload.len(),
+                32 + blob_len,
             )
         })
     }
 
     /// Fetch a keypair from a calculator Str slot.
-    /// Returns (public_key, encrypted_blob).
+    /// Returns (public_key, encrypted_blob); v1 blobs come back zero-padded.
     pub fn fetch_keypair(
         &mut self,
         slot: &str,
@@ -141,9 +165,12 @@ impl Calculator {
         let mut buf = [0u8; 256];
         let mut out_len: usize = 0;
 
+        app_result(unsafe { sys::calc_session_ensure_link(&mut *self.session) })?;
+        // The slot may have been edited on the calculator since the last call.
+        unsafe { sys::calc_string_cache_invalidate(&mut *self.session) };
         app_result(unsafe {
             sys::calc_fetch_binary_string(
-                &mut self.session,
+                &mut *self.session,
                 var_name.as_ptr(),
                 buf.as_mut_ptr(),
                 buf.len(),
@@ -151,9 +178,16 @@ impl Calculator {
             )
         })?;
 
-        if out_len != sys::STORED_KEY_PAYLOAD_LEN {
+        let blob_len = if out_len > 32 {
+            unsafe { sys::wallet_blob_length(buf[32..].as_ptr(), out_len - 32) }
+        } else {
+            0
+        };
+        if blob_len == 0 || out_len != 32 + blob_len {
+            secure_zero(&mut buf);
             return Err(WalletError::Io(format!(
-                "unexpected payload length: {out_len} (expected {})",
+                "unexpected payload length: {out_len} (expected {} or {})",
+                sys::WALLET_PUBLIC_KEY_LEN + sys::WALLET_BLOB_V1_LEN,
                 sys::STORED_KEY_PAYLOAD_LEN
             )));
         }
@@ -161,18 +195,42 @@ impl Calculator {
         let mut public_key = [0u8; 32];
         let mut blob = [0u8; sys::WALLET_BLOB_LEN];
         public_key.copy_from_slice(&buf[..32]);
-        blob.copy_from_slice(&buf[32..sys::STORED_KEY_PAYLOAD_LEN]);
+        blob[..blob_len].copy_from_slice(&buf[32..out_len]);
 
         // Secure-zero the temporary buffer
         secure_zero(&mut buf);
 
         Ok((public_key, blob))
     }
+
+    /// List the labels and public keys held in the wallet vault AppVar.
+    /// The whole index arrives in a single transfer; payloads stay untouched.
+    pub fn list_vault(&mut self) -> Result<Vec<(String, [u8; 32])>, WalletError> {
+        let mut vault: Box<sys::CalcVault> = Box::new(unsafe { std::mem::zeroed() });
+
+        app_result(unsafe { sys::calc_session_ensure_link(&mut *self.session) })?;
+        let status = unsafe { sys::calc_vault_load(&mut *self.session, &mut *vault) };
+
+        let entries = vault.entries[..vault.entry_count as usize]
+            .iter()
+            .map(|entry| {
+                let label = unsafe { CStr::from_ptr(entry.label.as_ptr()) }
+                    .to_string_lossy()
+                    .into_owned();
+                (label, entry.public_key)
+            })
+            .collect();
+
+        unsafe { sys::calc_vault_free(&mut *vault) };
+        app_result(status)?;
+
+        Ok(entries)
+    }
 }
 
 impl Drop for Calculator {
     fn drop(&mut self) {
-        unsafe { sys::calc_session_cleanup(&mut self.session) };
+        unsafe { sys::calc_session_cleanup(&mut *self.session) };
     }
 }
 
@@ -281,8 +339,8 @@ pub fn create_keypair() -> Result<([u8; 32], [u8; 64]), WalletError> {
     let mut public_key = [0u8; 32];
     let mut private_key = [0u8; 64];
 
-    let rc = unsafe { sys::ed25519_create_seed(seed.as_mut_ptr()) };
-    if rc != 0 {
+    let rc = unsafe { sys::wallet_random_bytes(seed.as_mut_ptr(), seed.len()) };
+    if rc != sys::APP_OK {
         return Err(WalletError::Crypto);
     }
 
@@ -303,10 +361,18 @@ pub fn encrypt_private_key(
     private_key: &[u8; 64],
 ) -> Result<[u8; sys::WALLET_BLOB_LEN], WalletError> {
     let pw = CString::new(password).map_err(|_| WalletError::Crypto)?;
+    let mut params = sys::WalletKdfParams::default();
+    let calibrated = unsafe {
+        sys::wallet_kdf_calibrate(sys::WALLET_KDF_ARGON2ID, sys::WALLET_KDF_TARGET_MS, &mut params)
+    };
+    if calibrated != sys::APP_OK {
+        unsafe { sys::wallet_kdf_default_params(&mut params) };
+    }
     let mut blob = [0u8; sys::WALLET_BLOB_LEN];
     app_result(unsafe {
-        sys::wallet_encrypt_private_key(
+        sys::wallet_encrypt_private_key_kdf(
             pw.as_ptr(),
+            &params,
             private_key.as_ptr(),
             private_key.len(),
             blob.as_mut_ptr(),
@@ -10,6 +10,8 @@ pub enum ConnectionStatus {
     Disconnected,
     Connecting,
     Connected,
+    /// Session open but the calculator stopped answering readiness probes.
+    NotResponding,
     Error(String),
 }
 
@@ -31,6 +33,8 @@ pub struct WalletState {
     pub rpc_url: String,
     pub last_error: Option<String>,
     pub pending_operation: Option<String>,
+    /// Round trip of the last readiness probe, from the session monitor.
+    pub link_latency_us: Option<u32>,
 }
 
 impl Default for WalletState {
@@ -42,6 +46,7 @@ impl Default for WalletState {
             rpc_url: "https://api.devnet.solana.com".to_string(),
             last_error: None,
             pending_operation: None,
+            link_latency_us: None,
         }
     }
 }
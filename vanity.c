@@ -0,0 +1,509 @@
+/* sysconf, clock_gettime, nanosleep and termios with CMAKE_C_EXTENSIONS off */
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ed25519.h"
+#include "solana_encoding.h"
+#include "wallet_crypto.h"
+
+#define VANITY_MAX_PREFIX 12u
+#define VANITY_MAX_THREADS 256u
+#define VANITY_KEY_LEN 32u
+/* Range bounds get one byte of headroom: 58^44 does not fit in 256 bits. */
+#define VANITY_BOUND_LEN (VANITY_KEY_LEN + 1u)
+#define VANITY_PASSWORD_LEN 256u
+#define VANITY_ADDRESS_LEN 64u
+
+static const char vanity_alphabet[] = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+
+/*
+ * Keys whose base58 form is exactly `digits` long and starts with the
+ * prefix are the integers in [low, high); big-endian like the encoding.
+ */
+typedef struct
+{
+    uint8_t low[VANITY_BOUND_LEN];
+    uint8_t high[VANITY_BOUND_LEN];
+} VanityRange;
+
+typedef struct
+{
+    VanityRange ranges[2];
+    atomic_ullong attempts;
+    atomic_int found;
+    int failed;
+    pthread_mutex_t lock;
+    uint8_t seed[WALLET_SEED_LEN];
+    uint8_t public_key[WALLET_PUBLIC_KEY_LEN];
+} VanitySearch;
+
+static void usage(const char *program);
+static int build_range(const char *prefix, size_t digits, VanityRange *range);
+static int range_feasible(const VanityRange *range);
+static double range_share(const VanityRange *range);
+static int key_matches(const VanitySearch *search, const uint8_t *public_key);
+static void bound_mul_add(uint8_t *value, unsigned int factor, unsigned int addend);
+static double bound_to_double(const uint8_t *value);
+static void *vanity_worker(void *arg);
+static double monotonic_seconds(void);
+static int read_password(const char *prompt, char *buffer, size_t size);
+static int seal_result(const VanitySearch *search, const char *output_path);
+
+int main(int argc, char **argv)
+{
+    VanitySearch search;
+    pthread_t threads[VANITY_MAX_THREADS];
+    const char *prefix = NULL;
+    const char *output_path = NULL;
+    unsigned long thread_count = 0ul;
+    unsigned long started = 0ul;
+    size_t prefix_len = 0u;
+    double start_time = 0.0;
+    double expected = 0.0;
+    char address[VANITY_ADDRESS_LEN];
+    int status = EXIT_SUCCESS;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "t:o:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 't':
+                thread_count = strtoul(optarg, NULL, 10);
+                break;
+            case 'o':
+                output_path = optarg;
+                break;
+            default:
+                usage(argv[0]);
+                return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    if (optind != (argc - 1))
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    prefix = argv[optind];
+    prefix_len = strlen(prefix);
+    if ((prefix_len == 0u) || (prefix_len > VANITY_MAX_PREFIX))
+    {
+        fprintf(stderr, "Prefix must be 1 to %u characters.\n", VANITY_MAX_PREFIX);
+        return EXIT_FAILURE;
+    }
+
+    if (prefix[0] == '1')
+    {
+        fprintf(stderr, "A leading '1' encodes a zero byte; Ed25519 public keys almost never have one.\n");
+        return EXIT_FAILURE;
+    }
+
+    memset(&search, 0, sizeof(search));
+    if ((build_range(prefix, 43u, &search.ranges[0]) != 0) || (build_range(prefix, 44u, &search.ranges[1]) != 0))
+    {
+        fprintf(stderr, "Prefix contains characters outside the base58 alphabet (no 0, O, I or l).\n");
+        return EXIT_FAILURE;
+    }
+
+    if ((range_feasible(&search.ranges[0]) == 0) && (range_feasible(&search.ranges[1]) == 0))
+    {
+        fprintf(stderr, "No 32-byte key encodes to an address starting with \"%s\".\n", prefix);
+        return EXIT_FAILURE;
+    }
+
+    if (thread_count == 0ul)
+    {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = (online > 0) ? (unsigned long)online : 1ul;
+    }
+    if (thread_count > VANITY_MAX_THREADS)
+    {
+        thread_count = VANITY_MAX_THREADS;
+    }
+
+    expected = range_share(&search.ranges[0]) + range_share(&search.ranges[1]);
+    fprintf(stderr, "Searching for \"%s\" on %lu threads, about %.0f keys expected.\n",
+            prefix, thread_count, (expected > 0.0) ? (1.0 / expected) : 0.0);
+
+    atomic_init(&search.attempts, 0ull);
+    atomic_init(&search.found, 0);
+    (void)pthread_mutex_init(&search.lock, NULL);
+
+    start_time = monotonic_seconds();
+    for (started = 0ul; started < thread_count; started++)
+    {
+        if (pthread_create(&threads[started], NULL, vanity_worker, &search) != 0)
+        {
+            break;
+        }
+    }
+
+    if (started == 0ul)
+    {
+        fprintf(stderr, "Failed to start search threads.\n");
+        status = EXIT_FAILURE;
+    }
+    else
+    {
+        const struct timespec interval = {0, 100000000L};
+        double next_report = start_time + 1.0;
+
+        while (atomic_load(&search.found) == 0)
+        {
+            double now;
+
+            (void)nanosleep(&interval, NULL);
+            now = monotonic_seconds();
+            if (now >= next_report)
+            {
+                unsigned long long attempts = atomic_load(&search.attempts);
+
+                fprintf(stderr, "\r%llu keys, %.0f keys/s   ", attempts, (double)attempts / (now - start_time));
+                next_report = now + 1.0;
+            }
+        }
+    }
+
+    for (unsigned long index = 0ul; index < started; index++)
+    {
+        (void)pthread_join(threads[index], NULL);
+    }
+    (void)pthread_mutex_destroy(&search.lock);
+
+    if ((status == EXIT_SUCCESS) && (search.failed != 0))
+    {
+        fprintf(stderr, "\nRandom number generator failed.\n");
+        status = EXIT_FAILURE;
+    }
+
+    if (status == EXIT_SUCCESS)
+    {
+        double elapsed = monotonic_seconds() - start_time;
+        unsigned long long attempts = atomic_load(&search.attempts);
+
+        fprintf(stderr, "\nFound after %llu keys in %.1f s (%.0f keys/s).\n",
+                attempts, elapsed, (elapsed > 0.0) ? ((double)attempts / elapsed) : 0.0);
+
+        if ((solana_base58_encode(search.public_key, sizeof(search.public_key), address, sizeof(address)) <= 0) ||
+            (strncmp(address, prefix, prefix_len) != 0))
+        {
+            fprintf(stderr, "Internal error: match does not encode with the prefix.\n");
+            status = EXIT_FAILURE;
+        }
+        else
+        {
+            printf("Address: %s\n", address);
+            if (seal_result(&search, output_path) != APP_OK)
+            {
+                status = EXIT_FAILURE;
+            }
+        }
+    }
+
+    wallet_secure_zero(search.seed, sizeof(search.seed));
+
+    return status;
+}
+
+static void usage(const char *program)
+{
+    fprintf(stderr,
+            "Usage: %s [-t threads] [-o payload_file] PREFIX\n"
+            "Searches for a Solana address starting with PREFIX and encrypts its seed\n"
+            "into the wallet blob format. The payload (public key + blob) is written to\n"
+            "payload_file, or printed as hex.\n",
+            program);
+}
+
+static int build_range(const char *prefix, size_t digits, VanityRange *range)
+{
+    size_t prefix_len = strlen(prefix);
+
+    memset(range, 0, sizeof(*range));
+    for (size_t index = 0u; index < prefix_len; index++)
+    {
+        const char *position = strchr(vanity_alphabet, prefix[index]);
+        unsigned int digit;
+
+        if (position == NULL)
+        {
+            return -1;
+        }
+
+        digit = (unsigned int)(position - vanity_alphabet);
+        bound_mul_add(range->low, 58u, digit);
+        bound_mul_add(range->high, 58u, digit + ((index + 1u == prefix_len) ? 1u : 0u));
+    }
+
+    for (size_t index = prefix_len; index < digits; index++)
+    {
+        bound_mul_add(range->low, 58u, 0u);
+        bound_mul_add(range->high, 58u, 0u);
+    }
+
+    return 0;
+}
+
+/* The range has to meet [2^248, 2^256): a zero first byte would encode as a leading '1'. */
+static int range_feasible(const VanityRange *range)
+{
+    static const uint8_t floor_bound[VANITY_BOUND_LEN] = {0x00, 0x01};
+    static const uint8_t ceiling_bound[VANITY_BOUND_LEN] = {0x01};
+
+    return (memcmp(range->high, floor_bound, VANITY_BOUND_LEN) > 0) &&
+           (memcmp(range->low, ceiling_bound, VANITY_BOUND_LEN) < 0);
+}
+
+/* Fraction of uniformly random keys that land in the range. */
+static double range_share(const VanityRange *range)
+{
+    double key_space = bound_to_double((const uint8_t[VANITY_BOUND_LEN]){0x01});
+    double low = bound_to_double(range->low);
+    double high = bound_to_double(range->high);
+    double floor_value = key_space / 256.0;
+
+    if (range_feasible(range) == 0)
+    {
+        return 0.0;
+    }
+    if (low < floor_value)
+    {
+        low = floor_value;
+    }
+    if (high > key_space)
+    {
+        high = key_space;
+    }
+
+    return (high - low) / key_space;
+}
+
+/* Two big-endian compares per range instead of a base58 encode per candidate. */
+static int key_matches(const VanitySearch *search, const uint8_t *public_key)
+{
+    uint8_t value[VANITY_BOUND_LEN];
+
+    if (public_key[0] == 0u)
+    {
+        return 0;
+    }
+
+    value[0] = 0u;
+    memcpy(value + 1u, public_key, VANITY_KEY_LEN);
+
+    for (size_t index = 0u; index < 2u; index++)
+    {
+        if ((memcmp(value, search->ranges[index].low, VANITY_BOUND_LEN) >= 0) &&
+            (memcmp(value, search->ranges[index].high, VANITY_BOUND_LEN) < 0))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static void bound_mul_add(uint8_t *value, unsigned int factor, unsigned int addend)
+{
+    unsigned int carry = addend;
+
+    for (size_t index = VANITY_BOUND_LEN; index > 0u; index--)
+    {
+        unsigned int product = ((unsigned int)value[index - 1u] * factor) + carry;
+        value[index - 1u] = (uint8_t)(product & 0xffu);
+        carry = product >> 8;
+    }
+}
+
+static double bound_to_double(const uint8_t *value)
+{
+    double result = 0.0;
+
+    for (size_t index = 0u; index < VANITY_BOUND_LEN; index++)
+    {
+        result = (result * 256.0) + (double)value[index];
+    }
+
+    return result;
+}
+
+/*
+ * Each worker draws its own random seeds, so threads never overlap and need
+ * no coordination beyond the attempt counter. Keys are generated in batches
+ * sharing one field inversion.
+ */
+static void *vanity_worker(void *arg)
+{
+    VanitySearch *search = (VanitySearch *)arg;
+    uint8_t seeds[ED25519_KEYPAIR_BATCH * WALLET_SEED_LEN];
+    uint8_t public_keys[ED25519_KEYPAIR_BATCH * WALLET_PUBLIC_KEY_LEN];
+
+    while (atomic_load_explicit(&search->found, memory_order_relaxed) == 0)
+    {
+        if (wallet_random_bytes(seeds, sizeof(seeds)) != APP_OK)
+        {
+            pthread_mutex_lock(&search->lock);
+            search->failed = 1;
+            atomic_store(&search->found, 1);
+            pthread_mutex_unlock(&search->lock);
+            break;
+        }
+
+        ed25519_create_keypairs_batch(public_keys, NULL, seeds, ED25519_KEYPAIR_BATCH);
+
+        for (size_t index = 0u; index < ED25519_KEYPAIR_BATCH; index++)
+        {
+            if (key_matches(search, public_keys + (index * WALLET_PUBLIC_KEY_LEN)) != 0)
+            {
+                pthread_mutex_lock(&search->lock);
+                if (atomic_load(&search->found) == 0)
+                {
+                    memcpy(search->seed, seeds + (index * WALLET_SEED_LEN), WALLET_SEED_LEN);
+                    memcpy(search->public_key, public_keys + (index * WALLET_PUBLIC_KEY_LEN), WALLET_PUBLIC_KEY_LEN);
+                    atomic_store(&search->found, 1);
+                }
+                pthread_mutex_unlock(&search->lock);
+                break;
+            }
+        }
+
+        atomic_fetch_add_explicit(&search->attempts, ED25519_KEYPAIR_BATCH, memory_order_relaxed);
+    }
+
+    wallet_secure_zero(seeds, sizeof(seeds));
+
+    return NULL;
+}
+
+static double monotonic_seconds(void)
+{
+    struct timespec now;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + ((double)now.tv_nsec / 1e9);
+}
+
+/* Echo is switched off when stdin is a terminal. */
+static int read_password(const char *prompt, char *buffer, size_t size)
+{
+    struct termios old_settings;
+    int restore = 0;
+    size_t length = 0u;
+
+    fprintf(stderr, "%s", prompt);
+    fflush(stderr);
+
+    if ((isatty(STDIN_FILENO) != 0) && (tcgetattr(STDIN_FILENO, &old_settings) == 0))
+    {
+        struct termios new_settings = old_settings;
+        new_settings.c_lflag &= ~(tcflag_t)ECHO;
+        restore = (tcsetattr(STDIN_FILENO, TCSANOW, &new_settings) == 0);
+    }
+
+    if (fgets(buffer, (int)size, stdin) == NULL)
+    {
+        buffer[0] = '\0';
+    }
+
+    if (restore != 0)
+    {
+        (void)tcsetattr(STDIN_FILENO, TCSANOW, &old_settings);
+        fputc('\n', stderr);
+    }
+
+    length = strlen(buffer);
+    if ((length > 0u) && (buffer[length - 1u] == '\n'))
+    {
+        buffer[--length] = '\0';
+    }
+
+    return (length > 0u);
+}
+
+static int seal_result(const VanitySearch *search, const char *output_path)
+{
+    char password[VANITY_PASSWORD_LEN];
+    char password_confirm[VANITY_PASSWORD_LEN];
+    uint8_t private_key[WALLET_PRIVATE_KEY_LEN];
+    uint8_t payload[WALLET_PUBLIC_KEY_LEN + WALLET_BLOB_LEN];
+    WalletKdfParams kdf_params;
+    int status = APP_ERR_IO;
+
+    memset(private_key, 0, sizeof(private_key));
+    memset(payload, 0, sizeof(payload));
+
+    if ((read_password("Password: ", password, sizeof(password)) != 0) &&
+        (read_password("Confirm password: ", password_confirm, sizeof(password_confirm)) != 0))
+    {
+        if (strcmp(password, password_confirm) != 0)
+        {
+            fprintf(stderr, "Passwords do not match.\n");
+        }
+        else
+        {
+            if (wallet_kdf_calibrate(WALLET_KDF_ARGON2ID, WALLET_KDF_TARGET_MS, &kdf_params) != APP_OK)
+            {
+                wallet_kdf_default_params(&kdf_params);
+            }
+
+            memcpy(private_key, search->seed, WALLET_SEED_LEN);
+            memcpy(payload, search->public_key, WALLET_PUBLIC_KEY_LEN);
+            status = wallet_encrypt_private_key_kdf(password, &kdf_params, private_key, sizeof(private_key),
+                                                    payload + WALLET_PUBLIC_KEY_LEN, WALLET_BLOB_LEN);
+            if (status != APP_OK)
+            {
+                fprintf(stderr, "Failed to encrypt the seed (error %d).\n", status);
+            }
+        }
+    }
+    else
+    {
+        fprintf(stderr, "Password cannot be empty.\n");
+    }
+
+    if ((status == APP_OK) && (output_path != NULL))
+    {
+        FILE *file = fopen(output_path, "wb");
+
+        if ((file == NULL) || (fwrite(payload, 1u, sizeof(payload), file) != sizeof(payload)))
+        {
+            fprintf(stderr, "Failed to write %s.\n", output_path);
+            status = APP_ERR_IO;
+        }
+        if ((file != NULL) && (fclose(file) != 0))
+        {
+            status = APP_ERR_IO;
+        }
+        if (status == APP_OK)
+        {
+            printf("Encrypted payload written to %s.\n", output_path);
+        }
+    }
+    else if (status == APP_OK)
+    {
+        printf("Encrypted payload: ");
+        for (size_t index = 0u; index < sizeof(payload); index++)
+        {
+            printf("%02x", payload[index]);
+        }
+        printf("\n");
+    }
+
+    wallet_secure_zero(password, sizeof(password));
+    wallet_secure_zero(password_confirm, sizeof(password_confirm));
+    wallet_secure_zero(private_key, sizeof(private_key));
+    wallet_secure_zero(payload, sizeof(payload));
+
+    return status;
+}
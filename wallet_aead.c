@@ -0,0 +1,697 @@
+#include "wallet_aead.h"
+
+#include <string.h>
+
+#include "wallet_crypto.h"
+
+/* Define WALLET_AEAD_SCALAR to build the portable kernels on any compiler. */
+#if defined(__GNUC__) && !defined(WALLET_AEAD_SCALAR)
+#define CHACHA20_LANES 4u
+typedef uint32_t chacha20_vec __attribute__((vector_size(16)));
+#else
+#define CHACHA20_LANES 1u
+#endif
+#define CHACHA20_BLOCK_LEN 64u
+
+#if defined(__SIZEOF_INT128__) && !defined(WALLET_AEAD_SCALAR)
+#define POLY1305_LIMB64 1
+__extension__ typedef unsigned __int128 poly1305_u128;
+#endif
+
+#define POLY1305_BLOCK_LEN 16u
+
+/* Accumulator and clamped r in 44-bit limbs when 128-bit products exist, 26-bit limbs otherwise. */
+typedef struct
+{
+#ifdef POLY1305_LIMB64
+    uint64_t r[3];
+    uint64_t h[3];
+    uint64_t pad[2];
+#else
+    uint32_t r[5];
+    uint32_t h[5];
+    uint32_t pad[4];
+#endif
+    uint8_t buffer[POLY1305_BLOCK_LEN];
+    size_t leftover;
+} Poly1305State;
+
+static uint32_t load32_le(const uint8_t *in);
+static void store32_le(uint8_t *out, uint32_t value);
+static void chacha20_setup(uint32_t *input, const uint8_t *key, const uint8_t *nonce, uint32_t counter);
+static void chacha20_blocks(uint32_t *input, uint8_t *out);
+static void poly1305_init(Poly1305State *state, const uint8_t *key);
+static void poly1305_blocks(Poly1305State *state, const uint8_t *message, size_t length, int final);
+static void poly1305_update(Poly1305State *state, const uint8_t *message, size_t length);
+static void poly1305_finish(Poly1305State *state, uint8_t *out_tag);
+static void aead_tag(const uint8_t *key,
+                     const uint8_t *nonce,
+                     const uint8_t *ad,
+                     size_t ad_len,
+                     const uint8_t *ciphertext,
+                     size_t length,
+                     uint8_t *out_tag);
+
+void wallet_chacha20_xor(const uint8_t *key,
+                         const uint8_t *nonce,
+                         uint32_t counter,
+                         const uint8_t *in,
+                         uint8_t *out,
+                         size_t length)
+{
+    uint32_t input[16];
+    uint8_t block[CHACHA20_LANES * CHACHA20_BLOCK_LEN];
+
+    if ((key == NULL) || (nonce == NULL) || ((length > 0u) && ((in == NULL) || (out == NULL))))
+    {
+        return;
+    }
+
+    chacha20_setup(input, key, nonce, counter);
+    while (length > 0u)
+    {
+        size_t take = (length < sizeof(block)) ? length : sizeof(block);
+
+        chacha20_blocks(input, block);
+        for (size_t index = 0u; index < take; index++)
+        {
+            out[index] = in[index] ^ block[index];
+        }
+
+        in += take;
+        out += take;
+        length -= take;
+    }
+
+    wallet_secure_zero(input, sizeof(input));
+    wallet_secure_zero(block, sizeof(block));
+}
+
+void wallet_chacha20_stream(const uint8_t *key,
+                            const uint8_t *nonce,
+                            uint32_t counter,
+                            uint8_t *out,
+                            size_t length)
+{
+    if (out == NULL)
+    {
+        return;
+    }
+
+    memset(out, 0, length);
+    wallet_chacha20_xor(key, nonce, counter, out, out, length);
+}
+
+int wallet_aead_encrypt(const uint8_t *key,
+                        const uint8_t *nonce,
+                        const uint8_t *ad,
+                        size_t ad_len,
+                        const uint8_t *plaintext,
+                        size_t length,
+                        uint8_t *out_ciphertext,
+                        uint8_t *out_tag)
+{
+    if ((key == NULL) || (nonce == NULL) || (out_tag == NULL) || ((ad == NULL) && (ad_len > 0u)) ||
+        ((length > 0u) && ((plaintext == NULL) || (out_ciphertext == NULL))))
+    {
+        return APP_ERR_IO;
+    }
+
+    /* Block 0 keys Poly1305; the message starts at block 1. */
+    wallet_chacha20_xor(key, nonce, 1u, plaintext, out_ciphertext, length);
+    aead_tag(key, nonce, ad, ad_len, out_ciphertext, length, out_tag);
+
+    return APP_OK;
+}
+
+int wallet_aead_decrypt(const uint8_t *key,
+                        const uint8_t *nonce,
+                        const uint8_t *ad,
+                        size_t ad_len,
+                        const uint8_t *ciphertext,
+                        size_t length,
+                        const uint8_t *tag,
+                        uint8_t *out_plaintext)
+{
+    uint8_t expected[WALLET_AEAD_TAG_LEN];
+    uint8_t diff = 0u;
+
+    if ((key == NULL) || (nonce == NULL) || (tag == NULL) || ((ad == NULL) && (ad_len > 0u)) ||
+        ((length > 0u) && ((ciphertext == NULL) || (out_plaintext == NULL))))
+    {
+        return APP_ERR_IO;
+    }
+
+    aead_tag(key, nonce, ad, ad_len, ciphertext, length, expected);
+    for (size_t index = 0u; index < WALLET_AEAD_TAG_LEN; index++)
+    {
+        diff |= (uint8_t)(expected[index] ^ tag[index]);
+    }
+    wallet_secure_zero(expected, sizeof(expected));
+
+    if (diff != 0u)
+    {
+        if (length > 0u)
+        {
+            wallet_secure_zero(out_plaintext, length);
+        }
+        return APP_ERR_CRYPTO;
+    }
+
+    wallet_chacha20_xor(key, nonce, 1u, ciphertext, out_plaintext, length);
+
+    return APP_OK;
+}
+
+static uint32_t load32_le(const uint8_t *in)
+{
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+static void store32_le(uint8_t *out, uint32_t value)
+{
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    out[2] = (uint8_t)(value >> 16);
+    out[3] = (uint8_t)(value >> 24);
+}
+
+static void chacha20_setup(uint32_t *input, const uint8_t *key, const uint8_t *nonce, uint32_t counter)
+{
+    input[0] = 0x61707865u;
+    input[1] = 0x3320646eu;
+    input[2] = 0x79622d32u;
+    input[3] = 0x6b206574u;
+    for (size_t index = 0u; index < 8u; index++)
+    {
+        input[4u + index] = load32_le(key + (4u * index));
+    }
+    input[12] = counter;
+    input[13] = load32_le(nonce);
+    input[14] = load32_le(nonce + 4u);
+    input[15] = load32_le(nonce + 8u);
+}
+
+#define CHACHA20_ROTL(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+#define CHACHA20_QUARTER(a, b, c, d) \
+    do \
+    { \
+        a += b; d ^= a; d = CHACHA20_ROTL(d, 16); \
+        c += d; b ^= c; b = CHACHA20_ROTL(b, 12); \
+        a += b; d ^= a; d = CHACHA20_ROTL(d, 8); \
+        c += d; b ^= c; b = CHACHA20_ROTL(b, 7); \
+    } while (0)
+#define CHACHA20_DOUBLE_ROUND(x) \
+    do \
+    { \
+        CHACHA20_QUARTER(x[0], x[4], x[8], x[12]); \
+        CHACHA20_QUARTER(x[1], x[5], x[9], x[13]); \
+        CHACHA20_QUARTER(x[2], x[6], x[10], x[14]); \
+        CHACHA20_QUARTER(x[3], x[7], x[11], x[15]); \
+        CHACHA20_QUARTER(x[0], x[5], x[10], x[15]); \
+        CHACHA20_QUARTER(x[1], x[6], x[11], x[12]); \
+        CHACHA20_QUARTER(x[2], x[7], x[8], x[13]); \
+        CHACHA20_QUARTER(x[3], x[4], x[9], x[14]); \
+    } while (0)
+
+/*
+ * CHACHA20_LANES consecutive blocks starting at counter input[12], which is
+ * advanced past them. The vector kernel keeps word i of all four blocks in
+ * one register, so every quarter round runs on four blocks at once. The
+ * working state is not wiped here; wiping it per batch costs more than the
+ * rounds do, so wallet_chacha20_xor wipes the counter block and keystream
+ * once at the end.
+ */
+static void chacha20_blocks(uint32_t *input, uint8_t *out)
+{
+#if CHACHA20_LANES == 4u
+    chacha20_vec start[16];
+    chacha20_vec x[16];
+
+    for (size_t index = 0u; index < 16u; index++)
+    {
+        uint32_t word = input[index];
+
+        start[index] = (chacha20_vec){ word, word, word, word };
+    }
+    start[12] += (chacha20_vec){ 0u, 1u, 2u, 3u };
+    memcpy(x, start, sizeof(x));
+
+    for (int round = 0; round < 10; round++)
+    {
+        CHACHA20_DOUBLE_ROUND(x);
+    }
+
+    for (size_t index = 0u; index < 16u; index++)
+    {
+        x[index] += start[index];
+    }
+
+    for (size_t lane = 0u; lane < 4u; lane++)
+    {
+        for (size_t index = 0u; index < 16u; index++)
+        {
+            store32_le(out + (lane * CHACHA20_BLOCK_LEN) + (4u * index), x[index][lane]);
+        }
+    }
+
+#else
+    uint32_t x[16];
+
+    memcpy(x, input, sizeof(x));
+    for (int round = 0; round < 10; round++)
+    {
+        CHACHA20_DOUBLE_ROUND(x);
+    }
+
+    for (size_t index = 0u; index < 16u; index++)
+    {
+        store32_le(out + (4u * index), x[index] + input[index]);
+    }
+
+#endif
+
+    input[12] += CHACHA20_LANES;
+}
+
+#ifdef POLY1305_LIMB64
+
+static uint64_t load64_le(const uint8_t *in)
+{
+    return (uint64_t)load32_le(in) | ((uint64_t)load32_le(in + 4u) << 32);
+}
+
+static void poly1305_init(Poly1305State *state, const uint8_t *key)
+{
+    uint64_t t0 = load64_le(key);
+    uint64_t t1 = load64_le(key + 8u);
+
+    /* r &= 0x0ffffffc0ffffffc0ffffffc0fffffff */
+    state->r[0] = t0 & 0xffc0fffffffull;
+    state->r[1] = ((t0 >> 44) | (t1 << 20)) & 0xfffffc0ffffull;
+    state->r[2] = (t1 >> 24) & 0x00ffffffc0full;
+    state->h[0] = 0u;
+    state->h[1] = 0u;
+    state->h[2] = 0u;
+    state->pad[0] = load64_le(key + 16u);
+    state->pad[1] = load64_le(key + 24u);
+    state->leftover = 0u;
+}
+
+/* h = (h + m + 2^128) * r mod 2^130 - 5 per block; the final padded block has no 2^128 bit. */
+static void poly1305_blocks(Poly1305State *state, const uint8_t *message, size_t length, int final)
+{
+    const uint64_t hibit = final ? 0u : (1ull << 40);
+    const uint64_t r0 = state->r[0];
+    const uint64_t r1 = state->r[1];
+    const uint64_t r2 = state->r[2];
+    const uint64_t s1 = r1 * (5u << 2);
+    const uint64_t s2 = r2 * (5u << 2);
+    uint64_t h0 = state->h[0];
+    uint64_t h1 = state->h[1];
+    uint64_t h2 = state->h[2];
+
+    while (length >= POLY1305_BLOCK_LEN)
+    {
+        uint64_t t0 = load64_le(message);
+        uint64_t t1 = load64_le(message + 8u);
+        poly1305_u128 d0;
+        poly1305_u128 d1;
+        poly1305_u128 d2;
+        uint64_t carry;
+
+        h0 += t0 & 0xfffffffffffull;
+        h1 += ((t0 >> 44) | (t1 << 20)) & 0xfffffffffffull;
+        h2 += ((t1 >> 24) & 0x3ffffffffffull) | hibit;
+
+        d0 = ((poly1305_u128)h0 * r0) + ((poly1305_u128)h1 * s2) + ((poly1305_u128)h2 * s1);
+        d1 = ((poly1305_u128)h0 * r1) + ((poly1305_u128)h1 * r0) + ((poly1305_u128)h2 * s2);
+        d2 = ((poly1305_u128)h0 * r2) + ((poly1305_u128)h1 * r1) + ((poly1305_u128)h2 * r0);
+
+        carry = (uint64_t)(d0 >> 44);
+        h0 = (uint64_t)d0 & 0xfffffffffffull;
+        d1 += carry;
+        carry = (uint64_t)(d1 >> 44);
+        h1 = (uint64_t)d1 & 0xfffffffffffull;
+        d2 += carry;
+        carry = (uint64_t)(d2 >> 42);
+        h2 = (uint64_t)d2 & 0x3ffffffffffull;
+        h0 += carry * 5u;
+        carry = h0 >> 44;
+        h0 &= 0xfffffffffffull;
+        h1 += carry;
+
+        message += POLY1305_BLOCK_LEN;
+        length -= POLY1305_BLOCK_LEN;
+    }
+
+    state->h[0] = h0;
+    state->h[1] = h1;
+    state->h[2] = h2;
+}
+
+static void poly1305_finish(Poly1305State *state, uint8_t *out_tag)
+{
+    uint64_t h0;
+    uint64_t h1;
+    uint64_t h2;
+    uint64_t g0;
+    uint64_t g1;
+    uint64_t g2;
+    uint64_t carry;
+    uint64_t mask;
+
+    if (state->leftover > 0u)
+    {
+        state->buffer[state->leftover] = 1u;
+        memset(state->buffer + state->leftover + 1u, 0, POLY1305_BLOCK_LEN - state->leftover - 1u);
+        poly1305_blocks(state, state->buffer, POLY1305_BLOCK_LEN, 1);
+    }
+
+    h0 = state->h[0];
+    h1 = state->h[1];
+    h2 = state->h[2];
+
+    /* Fully carry h. */
+    carry = h1 >> 44;
+    h1 &= 0xfffffffffffull;
+    h2 += carry;
+    carry = h2 >> 42;
+    h2 &= 0x3ffffffffffull;
+    h0 += carry * 5u;
+    carry = h0 >> 44;
+    h0 &= 0xfffffffffffull;
+    h1 += carry;
+    carry = h1 >> 44;
+    h1 &= 0xfffffffffffull;
+    h2 += carry;
+    carry = h2 >> 42;
+    h2 &= 0x3ffffffffffull;
+    h0 += carry * 5u;
+    carry = h0 >> 44;
+    h0 &= 0xfffffffffffull;
+    h1 += carry;
+
+    /* g = h - p; keep g when it did not borrow. */
+    g0 = h0 + 5u;
+    carry = g0 >> 44;
+    g0 &= 0xfffffffffffull;
+    g1 = h1 + carry;
+    carry = g1 >> 44;
+    g1 &= 0xfffffffffffull;
+    g2 = h2 + carry - (1ull << 42);
+
+    mask = (g2 >> 63) - 1u;
+    g0 &= mask;
+    g1 &= mask;
+    g2 &= mask;
+    mask = ~mask;
+    h0 = (h0 & mask) | g0;
+    h1 = (h1 & mask) | g1;
+    h2 = (h2 & mask) | g2;
+
+    /* tag = (h + pad) mod 2^128 */
+    h0 += state->pad[0] & 0xfffffffffffull;
+    carry = h0 >> 44;
+    h0 &= 0xfffffffffffull;
+    h1 += (((state->pad[0] >> 44) | (state->pad[1] << 20)) & 0xfffffffffffull) + carry;
+    carry = h1 >> 44;
+    h1 &= 0xfffffffffffull;
+    h2 += ((state->pad[1] >> 24) & 0x3ffffffffffull) + carry;
+    h2 &= 0x3ffffffffffull;
+
+    h0 = h0 | (h1 << 44);
+    h1 = (h1 >> 20) | (h2 << 24);
+
+    store32_le(out_tag, (uint32_t)h0);
+    store32_le(out_tag + 4u, (uint32_t)(h0 >> 32));
+    store32_le(out_tag + 8u, (uint32_t)h1);
+    store32_le(out_tag + 12u, (uint32_t)(h1 >> 32));
+
+    wallet_secure_zero(state, sizeof(*state));
+}
+
+#else
+
+static void poly1305_init(Poly1305State *state, const uint8_t *key)
+{
+    /* r &= 0x0ffffffc0ffffffc0ffffffc0fffffff */
+    state->r[0] = load32_le(key) & 0x3ffffffu;
+    state->r[1] = (load32_le(key + 3u) >> 2) & 0x3ffff03u;
+    state->r[2] = (load32_le(key + 6u) >> 4) & 0x3ffc0ffu;
+    state->r[3] = (load32_le(key + 9u) >> 6) & 0x3f03fffu;
+    state->r[4] = (load32_le(key + 12u) >> 8) & 0x00fffffu;
+    memset(state->h, 0, sizeof(state->h));
+    for (size_t index = 0u; index < 4u; index++)
+    {
+        state->pad[index] = load32_le(key + 16u + (4u * index));
+    }
+    state->leftover = 0u;
+}
+
+/* h = (h + m + 2^128) * r mod 2^130 - 5 per block; the final padded block has no 2^128 bit. */
+static void poly1305_blocks(Poly1305State *state, const uint8_t *message, size_t length, int final)
+{
+    const uint32_t hibit = final ? 0u : (1u << 24);
+    const uint32_t r0 = state->r[0];
+    const uint32_t r1 = state->r[1];
+    const uint32_t r2 = state->r[2];
+    const uint32_t r3 = state->r[3];
+    const uint32_t r4 = state->r[4];
+    const uint32_t s1 = r1 * 5u;
+    const uint32_t s2 = r2 * 5u;
+    const uint32_t s3 = r3 * 5u;
+    const uint32_t s4 = r4 * 5u;
+    uint32_t h0 = state->h[0];
+    uint32_t h1 = state->h[1];
+    uint32_t h2 = state->h[2];
+    uint32_t h3 = state->h[3];
+    uint32_t h4 = state->h[4];
+
+    while (length >= POLY1305_BLOCK_LEN)
+    {
+        uint64_t d0;
+        uint64_t d1;
+        uint64_t d2;
+        uint64_t d3;
+        uint64_t d4;
+        uint32_t carry;
+
+        h0 += load32_le(message) & 0x3ffffffu;
+        h1 += (load32_le(message + 3u) >> 2) & 0x3ffffffu;
+        h2 += (load32_le(message + 6u) >> 4) & 0x3ffffffu;
+        h3 += (load32_le(message + 9u) >> 6) & 0x3ffffffu;
+        h4 += (load32_le(message + 12u) >> 8) | hibit;
+
+        d0 = ((uint64_t)h0 * r0) + ((uint64_t)h1 * s4) + ((uint64_t)h2 * s3) + ((uint64_t)h3 * s2) + ((uint64_t)h4 * s1);
+        d1 = ((uint64_t)h0 * r1) + ((uint64_t)h1 * r0) + ((uint64_t)h2 * s4) + ((uint64_t)h3 * s3) + ((uint64_t)h4 * s2);
+        d2 = ((uint64_t)h0 * r2) + ((uint64_t)h1 * r1) + ((uint64_t)h2 * r0) + ((uint64_t)h3 * s4) + ((uint64_t)h4 * s3);
+        d3 = ((uint64_t)h0 * r3) + ((uint64_t)h1 * r2) + ((uint64_t)h2 * r1) + ((uint64_t)h3 * r0) + ((uint64_t)h4 * s4);
+        d4 = ((uint64_t)h0 * r4) + ((uint64_t)h1 * r3) + ((uint64_t)h2 * r2) + ((uint64_t)h3 * r1) + ((uint64_t)h4 * r0);
+
+        carry = (uint32_t)(d0 >> 26);
+        h0 = (uint32_t)d0 & 0x3ffffffu;
+        d1 += carry;
+        carry = (uint32_t)(d1 >> 26);
+        h1 = (uint32_t)d1 & 0x3ffffffu;
+        d2 += carry;
+        carry = (uint32_t)(d2 >> 26);
+        h2 = (uint32_t)d2 & 0x3ffffffu;
+        d3 += carry;
+        carry = (uint32_t)(d3 >> 26);
+        h3 = (uint32_t)d3 & 0x3ffffffu;
+        d4 += carry;
+        carry = (uint32_t)(d4 >> 26);
+        h4 = (uint32_t)d4 & 0x3ffffffu;
+        h0 += carry * 5u;
+        carry = h0 >> 26;
+        h0 &= 0x3ffffffu;
+        h1 += carry;
+
+        message += POLY1305_BLOCK_LEN;
+        length -= POLY1305_BLOCK_LEN;
+    }
+
+    state->h[0] = h0;
+    state->h[1] = h1;
+    state->h[2] = h2;
+    state->h[3] = h3;
+    state->h[4] = h4;
+}
+
+static void poly1305_finish(Poly1305State *state, uint8_t *out_tag)
+{
+    uint32_t h0;
+    uint32_t h1;
+    uint32_t h2;
+    uint32_t h3;
+    uint32_t h4;
+    uint32_t g0;
+    uint32_t g1;
+    uint32_t g2;
+    uint32_t g3;
+    uint32_t g4;
+    uint32_t carry;
+    uint32_t mask;
+    uint64_t f;
+
+    if (state->leftover > 0u)
+    {
+        state->buffer[state->leftover] = 1u;
+        memset(state->buffer + state->leftover + 1u, 0, POLY1305_BLOCK_LEN - state->leftover - 1u);
+        poly1305_blocks(state, state->buffer, POLY1305_BLOCK_LEN, 1);
+    }
+
+    h0 = state->h[0];
+    h1 = state->h[1];
+    h2 = state->h[2];
+    h3 = state->h[3];
+    h4 = state->h[4];
+
+    /* Fully carry h. */
+    carry = h1 >> 26;
+    h1 &= 0x3ffffffu;
+    h2 += carry;
+    carry = h2 >> 26;
+    h2 &= 0x3ffffffu;
+    h3 += carry;
+    carry = h3 >> 26;
+    h3 &= 0x3ffffffu;
+    h4 += carry;
+    carry = h4 >> 26;
+    h4 &= 0x3ffffffu;
+    h0 += carry * 5u;
+    carry = h0 >> 26;
+    h0 &= 0x3ffffffu;
+    h1 += carry;
+
+    /* g = h - p; keep g when it did not borrow. */
+    g0 = h0 + 5u;
+    carry = g0 >> 26;
+    g0 &= 0x3ffffffu;
+    g1 = h1 + carry;
+    carry = g1 >> 26;
+    g1 &= 0x3ffffffu;
+    g2 = h2 + carry;
+    carry = g2 >> 26;
+    g2 &= 0x3ffffffu;
+    g3 = h3 + carry;
+    carry = g3 >> 26;
+    g3 &= 0x3ffffffu;
+    g4 = h4 + carry - (1u << 26);
+
+    mask = (g4 >> 31) - 1u;
+    g0 &= mask;
+    g1 &= mask;
+    g2 &= mask;
+    g3 &= mask;
+    g4 &= mask;
+    mask = ~mask;
+    h0 = (h0 & mask) | g0;
+    h1 = (h1 & mask) | g1;
+    h2 = (h2 & mask) | g2;
+    h3 = (h3 & mask) | g3;
+    h4 = (h4 & mask) | g4;
+
+    /* tag = (h + pad) mod 2^128 */
+    h0 = h0 | (h1 << 26);
+    h1 = (h1 >> 6) | (h2 << 20);
+    h2 = (h2 >> 12) | (h3 << 14);
+    h3 = (h3 >> 18) | (h4 << 8);
+
+    f = (uint64_t)h0 + state->pad[0];
+    store32_le(out_tag, (uint32_t)f);
+    f = (uint64_t)h1 + state->pad[1] + (f >> 32);
+    store32_le(out_tag + 4u, (uint32_t)f);
+    f = (uint64_t)h2 + state->pad[2] + (f >> 32);
+    store32_le(out_tag + 8u, (uint32_t)f);
+    f = (uint64_t)h3 + state->pad[3] + (f >> 32);
+    store32_le(out_tag + 12u, (uint32_t)f);
+
+    wallet_secure_zero(state, sizeof(*state));
+}
+
+#endif
+
+static void poly1305_update(Poly1305State *state, const uint8_t *message, size_t length)
+{
+    if (state->leftover > 0u)
+    {
+        size_t want = POLY1305_BLOCK_LEN - state->leftover;
+
+        if (want > length)
+        {
+            want = length;
+        }
+        memcpy(state->buffer + state->leftover, message, want);
+        state->leftover += want;
+        message += want;
+        length -= want;
+        if (state->leftover < POLY1305_BLOCK_LEN)
+        {
+            return;
+        }
+        poly1305_blocks(state, state->buffer, POLY1305_BLOCK_LEN, 0);
+        state->leftover = 0u;
+    }
+
+    if (length >= POLY1305_BLOCK_LEN)
+    {
+        size_t whole = length & ~(size_t)(POLY1305_BLOCK_LEN - 1u);
+
+        poly1305_blocks(state, message, whole, 0);
+        message += whole;
+        length -= whole;
+    }
+
+    if (length > 0u)
+    {
+        memcpy(state->buffer, message, length);
+        state->leftover = length;
+    }
+}
+
+/* Poly1305 over ad, ciphertext (each zero-padded to 16 bytes) and both lengths, keyed from block 0. */
+static void aead_tag(const uint8_t *key,
+                     const uint8_t *nonce,
+                     const uint8_t *ad,
+                     size_t ad_len,
+                     const uint8_t *ciphertext,
+                     size_t length,
+                     uint8_t *out_tag)
+{
+    static const uint8_t zeros[POLY1305_BLOCK_LEN] = { 0 };
+    uint8_t poly_key[32];
+    uint8_t lengths[16];
+    Poly1305State state;
+
+    wallet_chacha20_stream(key, nonce, 0u, poly_key, sizeof(poly_key));
+    poly1305_init(&state, poly_key);
+
+    if (ad_len > 0u)
+    {
+        poly1305_update(&state, ad, ad_len);
+        if ((ad_len % POLY1305_BLOCK_LEN) != 0u)
+        {
+            poly1305_update(&state, zeros, POLY1305_BLOCK_LEN - (ad_len % POLY1305_BLOCK_LEN));
+        }
+    }
+
+    if (length > 0u)
+    {
+        poly1305_update(&state, ciphertext, length);
+        if ((length % POLY1305_BLOCK_LEN) != 0u)
+        {
+            poly1305_update(&state, zeros, POLY1305_BLOCK_LEN - (length % POLY1305_BLOCK_LEN));
+        }
+    }
+
+    store32_le(lengths, (uint32_t)ad_len);
+    store32_le(lengths + 4u, (uint32_t)((uint64_t)ad_len >> 32));
+    store32_le(lengths + 8u, (uint32_t)length);
+    store32_le(lengths + 12u, (uint32_t)((uint64_t)length >> 32));
+    poly1305_update(&state, lengths, sizeof(lengths));
+    poly1305_finish(&state, out_tag);
+
+    wallet_secure_zero(poly_key, sizeof(poly_key));
+}
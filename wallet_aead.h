@@ -0,0 +1,61 @@
+#ifndef WALLET_AEAD_H
+#define WALLET_AEAD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WALLET_AEAD_KEY_LEN 32u
+#define WALLET_AEAD_NONCE_LEN 12u
+#define WALLET_AEAD_TAG_LEN 16u
+
+/*
+ * RFC 8439 ChaCha20 (96-bit nonce, 32-bit block counter) XORed over in;
+ * in may equal out. With GCC or Clang four blocks are computed at once in
+ * vector registers; other compilers get the one-block scalar loop.
+ */
+void wallet_chacha20_xor(const uint8_t *key,
+                         const uint8_t *nonce,
+                         uint32_t counter,
+                         const uint8_t *in,
+                         uint8_t *out,
+                         size_t length);
+
+/* Raw keystream, the same as XORing over zeros. */
+void wallet_chacha20_stream(const uint8_t *key,
+                            const uint8_t *nonce,
+                            uint32_t counter,
+                            uint8_t *out,
+                            size_t length);
+
+/* RFC 8439 ChaCha20-Poly1305. ciphertext may equal plaintext. */
+int wallet_aead_encrypt(const uint8_t *key,
+                        const uint8_t *nonce,
+                        const uint8_t *ad,
+                        size_t ad_len,
+                        const uint8_t *plaintext,
+                        size_t length,
+                        uint8_t *out_ciphertext,
+                        uint8_t *out_tag);
+
+/*
+ * Checks the tag before decrypting anything. Returns APP_ERR_CRYPTO on a
+ * mismatch, with out_plaintext zeroed.
+ */
+int wallet_aead_decrypt(const uint8_t *key,
+                        const uint8_t *nonce,
+                        const uint8_t *ad,
+                        size_t ad_len,
+                        const uint8_t *ciphertext,
+                        size_t length,
+                        const uint8_t *tag,
+                        uint8_t *out_plaintext);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,797 @@
+/* mmap/madvise flags, SO_PEERCRED, struct ucred and getpeereid with CMAKE_C_EXTENSIONS off */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wallet_agent.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+#include "ed25519.h"
+
+#define WALLET_AGENT_IO_TIMEOUT_MS 2000
+#define WALLET_AGENT_FRAME_MAX (1u + WALLET_PUBLIC_KEY_LEN + WALLET_AGENT_MAX_MESSAGE)
+
+/* Key material, kept on its own locked page: the expanded signing key, never the seed. */
+typedef struct
+{
+    ed25519_signer signer;
+} WalletAgentKey;
+
+static int wallet_agent_serve(int listen_fd, WalletAgentKey *key, unsigned int idle_timeout_s);
+static int wallet_agent_handle(int fd, const WalletAgentKey *key, int *lock_requested);
+static int wallet_agent_listen(const char *socket_path);
+static int wallet_agent_connect(const char *socket_path);
+static int wallet_agent_peer_allowed(int fd);
+static int wallet_agent_check_path(const char *socket_path, int need_socket);
+static void wallet_agent_scrub_child(int keep_a, int keep_b, long max_fd);
+static int wallet_agent_request(const char *socket_path, const uint8_t *request, size_t request_len,
+                                uint8_t *response, size_t response_size, size_t *response_len);
+static int wallet_agent_write_frame(int fd, const uint8_t *data, size_t len);
+static int wallet_agent_read_frame(int fd, uint8_t *data, size_t size, size_t *len);
+static int wallet_agent_read_full(int fd, uint8_t *data, size_t len);
+static int wallet_agent_write_full(int fd, const uint8_t *data, size_t len);
+static long wallet_agent_now_s(void);
+
+int wallet_agent_default_path(char *out_path, size_t size)
+{
+    const char *runtime_dir = getenv("XDG_RUNTIME_DIR");
+    int written;
+
+    if ((out_path == NULL) || (size == 0u))
+    {
+        return APP_ERR_IO;
+    }
+
+    if ((runtime_dir != NULL) && (runtime_dir[0] != '\0'))
+    {
+        written = snprintf(out_path, size, "%s/%s", runtime_dir, WALLET_AGENT_SOCKET_NAME);
+    }
+    else
+    {
+        char directory[WALLET_AGENT_PATH_MAX];
+
+        /* /tmp itself is shared; the socket goes in a directory only we can enter. */
+        (void)snprintf(directory, sizeof(directory), "/tmp/cwallet-%lu", (unsigned long)getuid());
+        if ((mkdir(directory, 0700) != 0) && (errno != EEXIST))
+        {
+            return APP_ERR_IO;
+        }
+        written = snprintf(out_path, size, "%s/%s", directory, WALLET_AGENT_SOCKET_NAME);
+    }
+
+    if ((written < 0) || ((size_t)written >= size) || ((size_t)written >= WALLET_AGENT_PATH_MAX))
+    {
+        return APP_ERR_IO;
+    }
+
+    return APP_OK;
+}
+
+int wallet_agent_start(const char *socket_path,
+                       const uint8_t *public_key,
+                       uint8_t *private_key,
+                       unsigned int idle_timeout_s)
+{
+    int ready_fds[2];
+    int listen_fd = -1;
+    int status = APP_OK;
+    long max_fd = sysconf(_SC_OPEN_MAX);
+    pid_t pid;
+
+    if ((socket_path == NULL) || (public_key == NULL) || (private_key == NULL))
+    {
+        if (private_key != NULL)
+        {
+            wallet_secure_zero(private_key, WALLET_PRIVATE_KEY_LEN);
+        }
+        return APP_ERR_IO;
+    }
+
+    listen_fd = wallet_agent_listen(socket_path);
+    if (listen_fd < 0)
+    {
+        wallet_secure_zero(private_key, WALLET_PRIVATE_KEY_LEN);
+        return (listen_fd == -2) ? APP_ERR_NOT_READY : APP_ERR_IO;
+    }
+
+    if (pipe(ready_fds) != 0)
+    {
+        close(listen_fd);
+        unlink(socket_path);
+        wallet_secure_zero(private_key, WALLET_PRIVATE_KEY_LEN);
+        return APP_ERR_THREAD;
+    }
+
+    /*
+     * Only the forking thread exists in the child, so it must stay away from
+     * anything the session and discovery threads may have been holding
+     * (stdio, malloc, the link mutexes) and use raw system calls only. It
+     * keeps nothing of the parent but the listening socket and ready_fds[1].
+     * Its fate is reported through ready_fds.
+     */
+    pid = fork();
+    if (pid == 0)
+    {
+        WalletAgentKey *key = NULL;
+        unsigned char ready = (unsigned char)APP_OK;
+        int result;
+
+        wallet_agent_scrub_child(listen_fd, ready_fds[1], max_fd);
+        (void)setsid();
+        /* Double fork so the agent is reparented instead of lingering as our zombie. */
+        if (fork() != 0)
+        {
+            wallet_secure_zero(private_key, WALLET_PRIVATE_KEY_LEN);
+            _exit(0);
+        }
+        signal(SIGPIPE, SIG_IGN);
+
+        /* Locks are not inherited across fork: map and lock the page here. */
+        key = (WalletAgentKey *)mmap(NULL, sizeof(*key), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (key == MAP_FAILED)
+        {
+            key = NULL;
+            ready = (unsigned char)APP_ERR_ALLOC;
+        }
+        else if (mlock(key, sizeof(*key)) != 0)
+        {
+            ready = (unsigned char)APP_ERR_ALLOC;
+        }
+        else
+        {
+#ifdef MADV_DONTDUMP
+            (void)madvise(key, sizeof(*key), MADV_DONTDUMP);
+#endif
+            ed25519_signer_init(&key->signer, public_key, private_key);
+        }
+        wallet_secure_zero(private_key, WALLET_PRIVATE_KEY_LEN);
+
+        result = wallet_agent_write_full(ready_fds[1], &ready, 1u);
+        close(ready_fds[1]);
+
+        if ((ready == (unsigned char)APP_OK) && (result == APP_OK))
+        {
+            (void)wallet_agent_serve(listen_fd, key, idle_timeout_s);
+        }
+
+        close(listen_fd);
+        unlink(socket_path);
+        if (key != NULL)
+        {
+            ed25519_signer_wipe(&key->signer);
+            wallet_secure_zero(key, sizeof(*key));
+            munlock(key, sizeof(*key));
+            munmap(key, sizeof(*key));
+        }
+        _exit(0);
+    }
+
+    wallet_secure_zero(private_key, WALLET_PRIVATE_KEY_LEN);
+    close(ready_fds[1]);
+    close(listen_fd);
+
+    if (pid < 0)
+    {
+        unlink(socket_path);
+        status = APP_ERR_THREAD;
+    }
+    else
+    {
+        unsigned char ready = (unsigned char)APP_ERR_THREAD;
+
+        (void)waitpid(pid, NULL, 0);
+        if (wallet_agent_read_full(ready_fds[0], &ready, 1u) != APP_OK)
+        {
+            ready = (unsigned char)APP_ERR_THREAD;
+        }
+        status = (int)ready;
+    }
+    close(ready_fds[0]);
+
+    return status;
+}
+
+int wallet_agent_public_key(const char *socket_path, uint8_t *out_public_key)
+{
+    uint8_t request = WALLET_AGENT_MSG_PUBLIC_KEY;
+    uint8_t response[1u + WALLET_PUBLIC_KEY_LEN];
+    size_t response_len = 0u;
+    int status;
+
+    if (out_public_key == NULL)
+    {
+        return APP_ERR_IO;
+    }
+
+    status = wallet_agent_request(socket_path, &request, 1u, response, sizeof(response), &response_len);
+    if ((status == APP_OK) && (response_len != sizeof(response)))
+    {
+        status = APP_ERR_IO;
+    }
+
+    if (status == APP_OK)
+    {
+        memcpy(out_public_key, response + 1u, WALLET_PUBLIC_KEY_LEN);
+    }
+
+    return status;
+}
+
+int wallet_agent_sign(const char *socket_path,
+                      const uint8_t *public_key,
+                      const uint8_t *message,
+                      size_t message_len,
+                      uint8_t *out_signature)
+{
+    uint8_t request[WALLET_AGENT_FRAME_MAX];
+    uint8_t response[1u + WALLET_AGENT_SIGNATURE_LEN];
+    size_t response_len = 0u;
+    int status;
+
+    if ((public_key == NULL) || (message == NULL) || (out_signature == NULL) ||
+        (message_len > WALLET_AGENT_MAX_MESSAGE))
+    {
+        return APP_ERR_IO;
+    }
+
+    request[0] = WALLET_AGENT_MSG_SIGN;
+    memcpy(request + 1u, public_key, WALLET_PUBLIC_KEY_LEN);
+    memcpy(request + 1u + WALLET_PUBLIC_KEY_LEN, message, message_len);
+
+    status = wallet_agent_request(socket_path, request, 1u + WALLET_PUBLIC_KEY_LEN + message_len,
+                                  response, sizeof(response), &response_len);
+    if ((status == APP_OK) && (response_len != sizeof(response)))
+    {
+        status = APP_ERR_IO;
+    }
+
+    if (status == APP_OK)
+    {
+        memcpy(out_signature, response + 1u, WALLET_AGENT_SIGNATURE_LEN);
+    }
+
+    return status;
+}
+
+int wallet_agent_lock(const char *socket_path)
+{
+    uint8_t request = WALLET_AGENT_MSG_LOCK;
+    uint8_t response[1];
+    size_t response_len = 0u;
+
+    return wallet_agent_request(socket_path, &request, 1u, response, sizeof(response), &response_len);
+}
+
+static int wallet_agent_serve(int listen_fd, WalletAgentKey *key, unsigned int idle_timeout_s)
+{
+    long deadline = wallet_agent_now_s() + (long)idle_timeout_s;
+    int lock_requested = 0;
+
+    while (lock_requested == 0)
+    {
+        struct pollfd pfd;
+        long remaining = deadline - wallet_agent_now_s();
+        int ready;
+
+        if (remaining <= 0)
+        {
+            break;
+        }
+
+        pfd.fd = listen_fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        ready = poll(&pfd, 1, (int)((remaining > 60) ? 60000 : (remaining * 1000)));
+        if ((ready < 0) && (errno != EINTR))
+        {
+            return APP_ERR_IO;
+        }
+
+        if ((ready > 0) && ((pfd.revents & POLLIN) != 0))
+        {
+            int client_fd = accept(listen_fd, NULL, NULL);
+            if (client_fd >= 0)
+            {
+                if (wallet_agent_peer_allowed(client_fd) != 0)
+                {
+                    /* Requests answered one at a time; a client may send several. */
+                    while (wallet_agent_handle(client_fd, key, &lock_requested) == APP_OK)
+                    {
+                        deadline = wallet_agent_now_s() + (long)idle_timeout_s;
+                        if (lock_requested != 0)
+                        {
+                            break;
+                        }
+                    }
+                }
+                close(client_fd);
+            }
+        }
+    }
+
+    return APP_OK;
+}
+
+static int wallet_agent_handle(int fd, const WalletAgentKey *key, int *lock_requested)
+{
+    uint8_t request[WALLET_AGENT_FRAME_MAX];
+    uint8_t response[1u + WALLET_AGENT_SIGNATURE_LEN];
+    size_t request_len = 0u;
+    size_t response_len = 1u;
+    int status;
+
+    status = wallet_agent_read_frame(fd, request, sizeof(request), &request_len);
+    if ((status != APP_OK) || (request_len == 0u))
+    {
+        return APP_ERR_IO;
+    }
+
+    response[0] = WALLET_AGENT_MSG_FAILURE;
+    switch (request[0])
+    {
+        case WALLET_AGENT_MSG_PUBLIC_KEY:
+        {
+            response[0] = WALLET_AGENT_MSG_SUCCESS;
+            memcpy(response + 1u, key->signer.public_key, WALLET_PUBLIC_KEY_LEN);
+            response_len = 1u + WALLET_PUBLIC_KEY_LEN;
+            break;
+        }
+        case WALLET_AGENT_MSG_SIGN:
+        {
+            if ((request_len >= (1u + WALLET_PUBLIC_KEY_LEN)) &&
+                (memcmp(request + 1u, key->signer.public_key, WALLET_PUBLIC_KEY_LEN) == 0))
+            {
+                ed25519_segment message;
+
+                message.data = request + 1u + WALLET_PUBLIC_KEY_LEN;
+                message.len = request_len - 1u - WALLET_PUBLIC_KEY_LEN;
+                ed25519_signer_sign(&key->signer, response + 1u, &message, 1u);
+                response[0] = WALLET_AGENT_MSG_SUCCESS;
+                response_len = 1u + WALLET_AGENT_SIGNATURE_LEN;
+            }
+            break;
+        }
+        case WALLET_AGENT_MSG_LOCK:
+        {
+            response[0] = WALLET_AGENT_MSG_SUCCESS;
+            *lock_requested = 1;
+            break;
+        }
+        default:
+        {
+            break;
+        }
+    }
+
+    status = wallet_agent_write_frame(fd, response, response_len);
+    wallet_secure_zero(request, sizeof(request));
+
+    return status;
+}
+
+/* Returns the bound socket, -2 if another agent already answers on the path, -1 on error. */
+static int wallet_agent_listen(const char *socket_path)
+{
+    struct sockaddr_un address;
+    mode_t old_mask;
+    int fd;
+    int probe_fd;
+
+    if ((strlen(socket_path) >= sizeof(address.sun_path)) || (wallet_agent_check_path(socket_path, 0) != APP_OK))
+    {
+        return -1;
+    }
+
+    probe_fd = wallet_agent_connect(socket_path);
+    if (probe_fd >= 0)
+    {
+        close(probe_fd);
+        return -2;
+    }
+    /* Nobody listening: whatever is left at the path is a stale socket. */
+    unlink(socket_path);
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, socket_path, strlen(socket_path));
+
+    old_mask = umask(0177);
+    if ((bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0) || (listen(fd, 4) != 0))
+    {
+        close(fd);
+        fd = -1;
+    }
+    umask(old_mask);
+
+    return fd;
+}
+
+static int wallet_agent_connect(const char *socket_path)
+{
+    struct sockaddr_un address;
+    int fd;
+
+    if ((socket_path == NULL) || (strlen(socket_path) >= sizeof(address.sun_path)))
+    {
+        return -1;
+    }
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, socket_path, strlen(socket_path));
+
+    if (connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+
+    return fd;
+}
+
+/* 1 when the process at the other end of fd runs as our user; both the agent and its clients check. */
+static int wallet_agent_peer_allowed(int fd)
+{
+#ifdef SO_PEERCRED
+    struct ucred credentials;
+    socklen_t length = sizeof(credentials);
+
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) != 0)
+    {
+        return 0;
+    }
+
+    return credentials.uid == getuid();
+#else
+    uid_t uid;
+    gid_t gid;
+
+    if (getpeereid(fd, &uid, &gid) != 0)
+    {
+        return 0;
+    }
+
+    return uid == getuid();
+#endif
+}
+
+/*
+ * The directory holding the socket must be ours and writable by nobody
+ * else, or another user could have planted the socket; with need_socket the
+ * socket must also exist, be ours and be closed to group and other.
+ * APP_ERR_NOT_READY when the socket is simply missing, APP_ERR_IO when
+ * anything is owned or opened up wrongly.
+ */
+static int wallet_agent_check_path(const char *socket_path, int need_socket)
+{
+    char directory[WALLET_AGENT_PATH_MAX];
+    const char *slash = strrchr(socket_path, '/');
+    struct stat info;
+    size_t directory_len;
+
+    if ((slash == NULL) || (slash == socket_path))
+    {
+        return APP_ERR_IO;
+    }
+
+    directory_len = (size_t)(slash - socket_path);
+    if (directory_len >= sizeof(directory))
+    {
+        return APP_ERR_IO;
+    }
+    memcpy(directory, socket_path, directory_len);
+    directory[directory_len] = '\0';
+
+    if ((lstat(directory, &info) != 0) || !S_ISDIR(info.st_mode) || (info.st_uid != getuid()) ||
+        ((info.st_mode & (S_IWGRP | S_IWOTH)) != 0))
+    {
+        return APP_ERR_IO;
+    }
+
+    if (need_socket != 0)
+    {
+        if (lstat(socket_path, &info) != 0)
+        {
+            return (errno == ENOENT) ? APP_ERR_NOT_READY : APP_ERR_IO;
+        }
+        if (!S_ISSOCK(info.st_mode) || (info.st_uid != getuid()) || ((info.st_mode & (S_IRWXG | S_IRWXO)) != 0))
+        {
+            return APP_ERR_IO;
+        }
+    }
+
+    return APP_OK;
+}
+
+/*
+ * First thing in the forked agent: close every descriptor inherited from the
+ * parent (calculator links, hotplug and status pipes, sockets) except the
+ * two it needs, point stdio at /dev/null, clear the signal mask the parent's
+ * threads left behind and, on Linux, make the process non-dumpable so no
+ * same-user process can ptrace or core it. Raw system calls only.
+ */
+static void wallet_agent_scrub_child(int keep_a, int keep_b, long max_fd)
+{
+    const int keep[2] = { (keep_a < keep_b) ? keep_a : keep_b, (keep_a < keep_b) ? keep_b : keep_a };
+    sigset_t none;
+    int null_fd;
+    int fd;
+
+#ifdef SYS_close_range
+    {
+        unsigned int start = 3u;
+        int closed = 1;
+
+        for (fd = 0; fd < 2; fd++)
+        {
+            if ((keep[fd] >= (int)start) && (closed != 0))
+            {
+                closed = ((unsigned int)keep[fd] == start) ||
+                         (syscall(SYS_close_range, start, (unsigned int)keep[fd] - 1u, 0u) == 0);
+                start = (unsigned int)keep[fd] + 1u;
+            }
+        }
+        if ((closed != 0) && (syscall(SYS_close_range, start, ~0u, 0u) == 0))
+        {
+            max_fd = 0;
+        }
+    }
+#endif
+    /* Fallback where close_range is missing or the kernel predates it. */
+    for (fd = 3; fd < max_fd; fd++)
+    {
+        if ((fd != keep[0]) && (fd != keep[1]))
+        {
+            (void)close(fd);
+        }
+    }
+
+    null_fd = open("/dev/null", O_RDWR);
+    if (null_fd >= 0)
+    {
+        for (fd = STDIN_FILENO; fd <= STDERR_FILENO; fd++)
+        {
+            if ((fd != null_fd) && (fd != keep[0]) && (fd != keep[1]))
+            {
+                (void)dup2(null_fd, fd);
+            }
+        }
+        if (null_fd > STDERR_FILENO)
+        {
+            (void)close(null_fd);
+        }
+    }
+
+    sigemptyset(&none);
+    (void)sigprocmask(SIG_SETMASK, &none, NULL);
+#ifdef __linux__
+    (void)prctl(PR_SET_DUMPABLE, 0, 0, 0, 0);
+#endif
+}
+
+static int wallet_agent_request(const char *socket_path, const uint8_t *request, size_t request_len,
+                                uint8_t *response, size_t response_size, size_t *response_len)
+{
+    int status = (socket_path != NULL) ? wallet_agent_check_path(socket_path, 1) : APP_ERR_IO;
+    int fd = -1;
+
+    /* Nothing is sent, the message to sign included, until both the socket and its owner check out. */
+    if (status != APP_OK)
+    {
+        return status;
+    }
+
+    fd = wallet_agent_connect(socket_path);
+    if (fd < 0)
+    {
+        return APP_ERR_NOT_READY;
+    }
+
+    if (wallet_agent_peer_allowed(fd) == 0)
+    {
+        close(fd);
+        return APP_ERR_IO;
+    }
+
+    status = wallet_agent_write_frame(fd, request, request_len);
+    if (status == APP_OK)
+    {
+        status = wallet_agent_read_frame(fd, response, response_size, response_len);
+    }
+
+    if ((status == APP_OK) && ((*response_len == 0u) || (response[0] != WALLET_AGENT_MSG_SUCCESS)))
+    {
+        status = APP_ERR_CRYPTO;
+    }
+
+    close(fd);
+
+    return status;
+}
+
+static int wallet_agent_write_frame(int fd, const uint8_t *data, size_t len)
+{
+    uint8_t header[4];
+
+    header[0] = (uint8_t)((len >> 24) & 0xFFu);
+    header[1] = (uint8_t)((len >> 16) & 0xFFu);
+    header[2] = (uint8_t)((len >> 8) & 0xFFu);
+    header[3] = (uint8_t)(len & 0xFFu);
+
+    if (wallet_agent_write_full(fd, header, sizeof(header)) != APP_OK)
+    {
+        return APP_ERR_IO;
+    }
+
+    return wallet_agent_write_full(fd, data, len);
+}
+
+static int wallet_agent_read_frame(int fd, uint8_t *data, size_t size, size_t *len)
+{
+    uint8_t header[4];
+    size_t frame_len;
+
+    if (wallet_agent_read_full(fd, header, sizeof(header)) != APP_OK)
+    {
+        return APP_ERR_IO;
+    }
+
+    frame_len = ((size_t)header[0] << 24) | ((size_t)header[1] << 16) | ((size_t)header[2] << 8) | (size_t)header[3];
+    if (frame_len > size)
+    {
+        return APP_ERR_IO;
+    }
+
+    *len = frame_len;
+
+    return wallet_agent_read_full(fd, data, frame_len);
+}
+
+static int wallet_agent_read_full(int fd, uint8_t *data, size_t len)
+{
+    size_t offset = 0u;
+
+    while (offset < len)
+    {
+        struct pollfd pfd;
+        ssize_t received;
+
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, WALLET_AGENT_IO_TIMEOUT_MS) <= 0)
+        {
+            return APP_ERR_IO;
+        }
+
+        received = read(fd, data + offset, len - offset);
+        if (received <= 0)
+        {
+            if ((received < 0) && (errno == EINTR))
+            {
+                continue;
+            }
+            return APP_ERR_IO;
+        }
+        offset += (size_t)received;
+    }
+
+    return APP_OK;
+}
+
+static int wallet_agent_write_full(int fd, const uint8_t *data, size_t len)
+{
+    size_t offset = 0u;
+
+    while (offset < len)
+    {
+        ssize_t sent = send(fd, data + offset, len - offset, MSG_NOSIGNAL);
+        if ((sent < 0) && (errno == ENOTSOCK))
+        {
+            sent = write(fd, data + offset, len - offset);
+        }
+        if (sent <= 0)
+        {
+            if ((sent < 0) && (errno == EINTR))
+            {
+                continue;
+            }
+            return APP_ERR_IO;
+        }
+        offset += (size_t)sent;
+    }
+
+    return APP_OK;
+}
+
+static long wallet_agent_now_s(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (long)now.tv_sec;
+}
+
+#else
+
+int wallet_agent_default_path(char *out_path, size_t size)
+{
+    (void)out_path;
+    (void)size;
+    return APP_ERR_NOT_READY;
+}
+
+int wallet_agent_start(const char *socket_path,
+                       const uint8_t *public_key,
+                       uint8_t *private_key,
+                       unsigned int idle_timeout_s)
+{
+    (void)socket_path;
+    (void)public_key;
+    (void)idle_timeout_s;
+    if (private_key != NULL)
+    {
+        wallet_secure_zero(private_key, WALLET_PRIVATE_KEY_LEN);
+    }
+    return APP_ERR_NOT_READY;
+}
+
+int wallet_agent_public_key(const char *socket_path, uint8_t *out_public_key)
+{
+    (void)socket_path;
+    (void)out_public_key;
+    return APP_ERR_NOT_READY;
+}
+
+int wallet_agent_sign(const char *socket_path,
+                      const uint8_t *public_key,
+                      const uint8_t *message,
+                      size_t message_len,
+                      uint8_t *out_signature)
+{
+    (void)socket_path;
+    (void)public_key;
+    (void)message;
+    (void)message_len;
+    (void)out_signature;
+    return APP_ERR_NOT_READY;
+}
+
+int wallet_agent_lock(const char *socket_path)
+{
+    (void)socket_path;
+    return APP_ERR_NOT_READY;
+}
+
+#endif
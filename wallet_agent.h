@@ -0,0 +1,68 @@
+#ifndef WALLET_AGENT_H
+#define WALLET_AGENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "wallet_crypto.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WALLET_AGENT_SOCKET_NAME "cwallet-agent.sock"
+#define WALLET_AGENT_PATH_MAX 108u
+#define WALLET_AGENT_IDLE_TIMEOUT_S 600u
+#define WALLET_AGENT_MAX_MESSAGE 1232u
+#define WALLET_AGENT_SIGNATURE_LEN 64u
+
+/*
+ * Frames on the agent socket: u32 big-endian length, then that many bytes
+ * starting with a message type.
+ *
+ *   PUBLIC_KEY  -> SUCCESS public_key[32]
+ *   SIGN public_key[32] message -> SUCCESS signature[64]
+ *   LOCK        -> SUCCESS, then the agent wipes the key and exits
+ *
+ * Anything else, or a public key other than the one held, gets FAILURE.
+ */
+#define WALLET_AGENT_MSG_PUBLIC_KEY 1u
+#define WALLET_AGENT_MSG_SIGN 2u
+#define WALLET_AGENT_MSG_LOCK 3u
+#define WALLET_AGENT_MSG_SUCCESS 0x80u
+#define WALLET_AGENT_MSG_FAILURE 0x81u
+
+/*
+ * $XDG_RUNTIME_DIR/cwallet-agent.sock, or the same name in a private
+ * /tmp/cwallet-<uid> directory (created 0700 if missing). Clients refuse to
+ * talk to a socket whose directory or file is not ours and closed to others,
+ * or whose listening process runs as another user.
+ */
+int wallet_agent_default_path(char *out_path, size_t size);
+
+/*
+ * Forks a background agent holding the expanded signing key (an
+ * ed25519_signer, not the seed) in locked, non-dumpable memory. The agent
+ * closes every descriptor it inherited except its socket. The caller's copy
+ * of private_key is wiped before returning, whatever the outcome.
+ * The agent exits and wipes the key after idle_timeout_s without requests.
+ */
+int wallet_agent_start(const char *socket_path,
+                       const uint8_t *public_key,
+                       uint8_t *private_key,
+                       unsigned int idle_timeout_s);
+
+/* APP_ERR_NOT_READY when no agent is listening on socket_path. */
+int wallet_agent_public_key(const char *socket_path, uint8_t *out_public_key);
+int wallet_agent_sign(const char *socket_path,
+                      const uint8_t *public_key,
+                      const uint8_t *message,
+                      size_t message_len,
+                      uint8_t *out_signature);
+int wallet_agent_lock(const char *socket_path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,627 @@
+#include "wallet_argon2.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "wallet_crypto.h"
+
+#define ARGON2_VERSION 0x13u
+#define ARGON2_TYPE_ID 2u
+#define ARGON2_SYNC_POINTS 4u
+#define ARGON2_QWORDS_IN_BLOCK (WALLET_ARGON2_BLOCK_SIZE / 8u)
+#define ARGON2_PREHASH_LEN 64u
+#define ARGON2_PREHASH_SEED_LEN (ARGON2_PREHASH_LEN + 8u)
+
+#define BLAKE2B_BLOCK_LEN 128u
+#define BLAKE2B_OUT_LEN 64u
+
+typedef struct
+{
+    uint64_t h[8];
+    uint64_t t[2];
+    uint8_t buffer[BLAKE2B_BLOCK_LEN];
+    size_t buffer_len;
+    size_t out_len;
+} Blake2bState;
+
+typedef struct
+{
+    uint64_t v[ARGON2_QWORDS_IN_BLOCK];
+} Argon2Block;
+
+typedef struct
+{
+    Argon2Block *memory;
+    uint32_t passes;
+    uint32_t lanes;
+    uint32_t lane_length;
+    uint32_t segment_length;
+    uint32_t memory_blocks;
+} Argon2Instance;
+
+static const uint64_t blake2b_iv[8] = {
+    0x6a09e667f3bcc908ull, 0xbb67ae8584caa73bull, 0x3c6ef372fe94f82bull, 0xa54ff53a5f1d36f1ull,
+    0x510e527fade682d1ull, 0x9b05688c2b3e6c1full, 0x1f83d9abfb41bd6bull, 0x5be0cd19137e2179ull,
+};
+
+static const uint8_t blake2b_sigma[12][16] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+    {11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4},
+    {7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8},
+    {9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13},
+    {2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9},
+    {12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11},
+    {13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10},
+    {6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5},
+    {10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0},
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+};
+
+static int argon2id_hash(const uint8_t *password,
+                         size_t password_len,
+                         const uint8_t *salt,
+                         size_t salt_len,
+                         const uint8_t *secret,
+                         size_t secret_len,
+                         const uint8_t *associated,
+                         size_t associated_len,
+                         uint32_t passes,
+                         uint32_t memory_kib,
+                         uint32_t lanes,
+                         uint8_t *out,
+                         size_t out_len);
+static void argon2_fill_segment(const Argon2Instance *instance, uint32_t pass, uint32_t lane, uint32_t slice);
+static uint32_t argon2_index_alpha(const Argon2Instance *instance,
+                                   uint32_t pass,
+                                   uint32_t slice,
+                                   uint32_t index,
+                                   uint32_t pseudo_rand,
+                                   int same_lane);
+static void argon2_fill_block(const Argon2Block *prev, const Argon2Block *ref, Argon2Block *next, int with_xor);
+static void argon2_next_addresses(Argon2Block *address_block, Argon2Block *input_block);
+static void argon2_hash_long(uint8_t *out, size_t out_len, const uint8_t *in, size_t in_len);
+static void argon2_store32(uint8_t *out, uint32_t value);
+static void blake2b_init(Blake2bState *state, size_t out_len);
+static void blake2b_update(Blake2bState *state, const uint8_t *in, size_t in_len);
+static void blake2b_final(Blake2bState *state, uint8_t *out);
+static void blake2b_update32(Blake2bState *state, uint32_t value);
+static void blake2b_compress(Blake2bState *state, const uint8_t *block, int last);
+static uint64_t load64(const uint8_t *in);
+static void store64(uint8_t *out, uint64_t value);
+
+int wallet_argon2id(const uint8_t *password,
+                    size_t password_len,
+                    const uint8_t *salt,
+                    size_t salt_len,
+                    uint32_t passes,
+                    uint32_t memory_kib,
+                    uint32_t lanes,
+                    uint8_t *out,
+                    size_t out_len)
+{
+    return argon2id_hash(password, password_len, salt, salt_len, NULL, 0u, NULL, 0u,
+                         passes, memory_kib, lanes, out, out_len);
+}
+
+static int argon2id_hash(const uint8_t *password,
+                         size_t password_len,
+                         const uint8_t *salt,
+                         size_t salt_len,
+                         const uint8_t *secret,
+                         size_t secret_len,
+                         const uint8_t *associated,
+                         size_t associated_len,
+                         uint32_t passes,
+                         uint32_t memory_kib,
+                         uint32_t lanes,
+                         uint8_t *out,
+                         size_t out_len)
+{
+    Argon2Instance instance;
+    Blake2bState state;
+    Argon2Block final_block;
+    uint8_t prehash[ARGON2_PREHASH_SEED_LEN];
+    uint8_t block_bytes[WALLET_ARGON2_BLOCK_SIZE];
+    uint32_t pass;
+    uint32_t slice;
+    uint32_t lane;
+    uint32_t i;
+
+    if ((password == NULL) || (salt == NULL) || (out == NULL) || (out_len < 4u) ||
+        (passes == 0u) || (passes > WALLET_ARGON2_MAX_PASSES) ||
+        (lanes == 0u) || (lanes > WALLET_ARGON2_MAX_LANES) ||
+        (memory_kib < (2u * ARGON2_SYNC_POINTS * lanes)) || (memory_kib > WALLET_ARGON2_MAX_MEMORY_KIB))
+    {
+        return APP_ERR_CRYPTO;
+    }
+
+    memset(&instance, 0, sizeof(instance));
+    instance.passes = passes;
+    instance.lanes = lanes;
+    instance.memory_blocks = (memory_kib / (ARGON2_SYNC_POINTS * lanes)) * (ARGON2_SYNC_POINTS * lanes);
+    instance.lane_length = instance.memory_blocks / lanes;
+    instance.segment_length = instance.lane_length / ARGON2_SYNC_POINTS;
+    instance.memory = (Argon2Block *)calloc(instance.memory_blocks, sizeof(Argon2Block));
+    if (instance.memory == NULL)
+    {
+        return APP_ERR_ALLOC;
+    }
+
+    /* H0 over every parameter and input, each prefixed with its length. */
+    blake2b_init(&state, ARGON2_PREHASH_LEN);
+    blake2b_update32(&state, lanes);
+    blake2b_update32(&state, (uint32_t)out_len);
+    blake2b_update32(&state, memory_kib);
+    blake2b_update32(&state, passes);
+    blake2b_update32(&state, ARGON2_VERSION);
+    blake2b_update32(&state, ARGON2_TYPE_ID);
+    blake2b_update32(&state, (uint32_t)password_len);
+    blake2b_update(&state, password, password_len);
+    blake2b_update32(&state, (uint32_t)salt_len);
+    blake2b_update(&state, salt, salt_len);
+    blake2b_update32(&state, (uint32_t)secret_len);
+    blake2b_update(&state, secret, secret_len);
+    blake2b_update32(&state, (uint32_t)associated_len);
+    blake2b_update(&state, associated, associated_len);
+    blake2b_final(&state, prehash);
+
+    for (lane = 0u; lane < lanes; lane++)
+    {
+        for (i = 0u; i < 2u; i++)
+        {
+            Argon2Block *block = &instance.memory[(lane * instance.lane_length) + i];
+            uint32_t word;
+
+            argon2_store32(prehash + ARGON2_PREHASH_LEN, i);
+            argon2_store32(prehash + ARGON2_PREHASH_LEN + 4u, lane);
+            argon2_hash_long(block_bytes, sizeof(block_bytes), prehash, sizeof(prehash));
+            for (word = 0u; word < ARGON2_QWORDS_IN_BLOCK; word++)
+            {
+                block->v[word] = load64(block_bytes + (8u * word));
+            }
+        }
+    }
+
+    for (pass = 0u; pass < passes; pass++)
+    {
+        for (slice = 0u; slice < ARGON2_SYNC_POINTS; slice++)
+        {
+            for (lane = 0u; lane < lanes; lane++)
+            {
+                argon2_fill_segment(&instance, pass, lane, slice);
+            }
+        }
+    }
+
+    /* XOR of the last block of every lane, stretched to the tag length. */
+    final_block = instance.memory[instance.lane_length - 1u];
+    for (lane = 1u; lane < lanes; lane++)
+    {
+        const Argon2Block *last = &instance.memory[(lane * instance.lane_length) + instance.lane_length - 1u];
+        for (i = 0u; i < ARGON2_QWORDS_IN_BLOCK; i++)
+        {
+            final_block.v[i] ^= last->v[i];
+        }
+    }
+    for (i = 0u; i < ARGON2_QWORDS_IN_BLOCK; i++)
+    {
+        store64(block_bytes + (8u * i), final_block.v[i]);
+    }
+    argon2_hash_long(out, out_len, block_bytes, sizeof(block_bytes));
+
+    wallet_secure_zero(instance.memory, (size_t)instance.memory_blocks * sizeof(Argon2Block));
+    free(instance.memory);
+    wallet_secure_zero(&final_block, sizeof(final_block));
+    wallet_secure_zero(block_bytes, sizeof(block_bytes));
+    wallet_secure_zero(prehash, sizeof(prehash));
+    wallet_secure_zero(&state, sizeof(state));
+
+    return APP_OK;
+}
+
+/*
+ * The first half of the first pass picks reference blocks from a counter
+ * (Argon2i), everything after that from the previous block (Argon2d).
+ */
+static void argon2_fill_segment(const Argon2Instance *instance, uint32_t pass, uint32_t lane, uint32_t slice)
+{
+    Argon2Block address_block;
+    Argon2Block input_block;
+    int data_independent = (pass == 0u) && (slice < (ARGON2_SYNC_POINTS / 2u));
+    uint32_t start_index = 0u;
+    uint32_t index;
+    uint32_t curr_offset;
+    uint32_t prev_offset;
+
+    memset(&address_block, 0, sizeof(address_block));
+    memset(&input_block, 0, sizeof(input_block));
+
+    if (data_independent)
+    {
+        input_block.v[0] = pass;
+        input_block.v[1] = lane;
+        input_block.v[2] = slice;
+        input_block.v[3] = instance->memory_blocks;
+        input_block.v[4] = instance->passes;
+        input_block.v[5] = ARGON2_TYPE_ID;
+    }
+
+    if ((pass == 0u) && (slice == 0u))
+    {
+        /* Blocks 0 and 1 come straight from H0. */
+        start_index = 2u;
+        if (data_independent)
+        {
+            argon2_next_addresses(&address_block, &input_block);
+        }
+    }
+
+    curr_offset = (lane * instance->lane_length) + (slice * instance->segment_length) + start_index;
+    if ((curr_offset % instance->lane_length) == 0u)
+    {
+        prev_offset = curr_offset + instance->lane_length - 1u;
+    }
+    else
+    {
+        prev_offset = curr_offset - 1u;
+    }
+
+    for (index = start_index; index < instance->segment_length; index++, curr_offset++, prev_offset++)
+    {
+        uint64_t pseudo_rand;
+        uint32_t ref_lane;
+        uint32_t ref_index;
+
+        if ((curr_offset % instance->lane_length) == 1u)
+        {
+            prev_offset = curr_offset - 1u;
+        }
+
+        if (data_independent)
+        {
+            if ((index % ARGON2_QWORDS_IN_BLOCK) == 0u)
+            {
+                argon2_next_addresses(&address_block, &input_block);
+            }
+            pseudo_rand = address_block.v[index % ARGON2_QWORDS_IN_BLOCK];
+        }
+        else
+        {
+            pseudo_rand = instance->memory[prev_offset].v[0];
+        }
+
+        ref_lane = (uint32_t)((pseudo_rand >> 32) % instance->lanes);
+        if ((pass == 0u) && (slice == 0u))
+        {
+            ref_lane = lane;
+        }
+
+        ref_index = argon2_index_alpha(instance, pass, slice, index, (uint32_t)pseudo_rand, ref_lane == lane);
+        argon2_fill_block(&instance->memory[prev_offset],
+                          &instance->memory[(instance->lane_length * ref_lane) + ref_index],
+                          &instance->memory[curr_offset],
+                          pass != 0u);
+    }
+
+    wallet_secure_zero(&address_block, sizeof(address_block));
+    wallet_secure_zero(&input_block, sizeof(input_block));
+}
+
+static uint32_t argon2_index_alpha(const Argon2Instance *instance,
+                                   uint32_t pass,
+                                   uint32_t slice,
+                                   uint32_t index,
+                                   uint32_t pseudo_rand,
+                                   int same_lane)
+{
+    uint32_t reference_area;
+    uint32_t start_position = 0u;
+    uint64_t relative_position;
+
+    if (pass == 0u)
+    {
+        if (slice == 0u)
+        {
+            reference_area = index - 1u;
+        }
+        else if (same_lane)
+        {
+            reference_area = (slice * instance->segment_length) + index - 1u;
+        }
+        else
+        {
+            reference_area = (slice * instance->segment_length) - ((index == 0u) ? 1u : 0u);
+        }
+    }
+    else
+    {
+        if (same_lane)
+        {
+            reference_area = instance->lane_length - instance->segment_length + index - 1u;
+        }
+        else
+        {
+            reference_area = instance->lane_length - instance->segment_length - ((index == 0u) ? 1u : 0u);
+        }
+
+        if (slice != (ARGON2_SYNC_POINTS - 1u))
+        {
+            start_position = (slice + 1u) * instance->segment_length;
+        }
+    }
+
+    relative_position = pseudo_rand;
+    relative_position = (relative_position * relative_position) >> 32;
+    relative_position = reference_area - 1u - ((reference_area * relative_position) >> 32);
+
+    return (uint32_t)((start_position + relative_position) % instance->lane_length);
+}
+
+#define ARGON2_ROTR64(w, c) (((w) >> (c)) | ((w) << (64 - (c))))
+#define ARGON2_FBLAMKA(x, y) ((x) + (y) + (2u * ((x) & 0xffffffffull) * ((y) & 0xffffffffull)))
+#define ARGON2_G(a, b, c, d) \
+    do \
+    { \
+        a = ARGON2_FBLAMKA(a, b); d = ARGON2_ROTR64(d ^ a, 32); \
+        c = ARGON2_FBLAMKA(c, d); b = ARGON2_ROTR64(b ^ c, 24); \
+        a = ARGON2_FBLAMKA(a, b); d = ARGON2_ROTR64(d ^ a, 16); \
+        c = ARGON2_FBLAMKA(c, d); b = ARGON2_ROTR64(b ^ c, 63); \
+    } while (0)
+#define ARGON2_ROUND(v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10, v11, v12, v13, v14, v15) \
+    do \
+    { \
+        ARGON2_G(v0, v4, v8, v12); \
+        ARGON2_G(v1, v5, v9, v13); \
+        ARGON2_G(v2, v6, v10, v14); \
+        ARGON2_G(v3, v7, v11, v15); \
+        ARGON2_G(v0, v5, v10, v15); \
+        ARGON2_G(v1, v6, v11, v12); \
+        ARGON2_G(v2, v7, v8, v13); \
+        ARGON2_G(v3, v4, v9, v14); \
+    } while (0)
+
+/* next = P(prev ^ ref) ^ prev ^ ref, XORed into next on later passes (v1.3). */
+static void argon2_fill_block(const Argon2Block *prev, const Argon2Block *ref, Argon2Block *next, int with_xor)
+{
+    Argon2Block r;
+    Argon2Block tmp;
+    uint64_t *v = r.v;
+    uint32_t i;
+
+    for (i = 0u; i < ARGON2_QWORDS_IN_BLOCK; i++)
+    {
+        r.v[i] = prev->v[i] ^ ref->v[i];
+        tmp.v[i] = r.v[i];
+        if (with_xor)
+        {
+            tmp.v[i] ^= next->v[i];
+        }
+    }
+
+    for (i = 0u; i < 8u; i++)
+    {
+        uint32_t o = 16u * i;
+        ARGON2_ROUND(v[o], v[o + 1u], v[o + 2u], v[o + 3u], v[o + 4u], v[o + 5u], v[o + 6u], v[o + 7u],
+                     v[o + 8u], v[o + 9u], v[o + 10u], v[o + 11u], v[o + 12u], v[o + 13u], v[o + 14u], v[o + 15u]);
+    }
+
+    for (i = 0u; i < 8u; i++)
+    {
+        uint32_t o = 2u * i;
+        ARGON2_ROUND(v[o], v[o + 1u], v[o + 16u], v[o + 17u], v[o + 32u], v[o + 33u], v[o + 48u], v[o + 49u],
+                     v[o + 64u], v[o + 65u], v[o + 80u], v[o + 81u], v[o + 96u], v[o + 97u], v[o + 112u], v[o + 113u]);
+    }
+
+    for (i = 0u; i < ARGON2_QWORDS_IN_BLOCK; i++)
+    {
+        next->v[i] = tmp.v[i] ^ r.v[i];
+    }
+}
+
+static void argon2_next_addresses(Argon2Block *address_block, Argon2Block *input_block)
+{
+    Argon2Block zero_block;
+
+    memset(&zero_block, 0, sizeof(zero_block));
+    input_block->v[6]++;
+    argon2_fill_block(&zero_block, input_block, address_block, 0);
+    argon2_fill_block(&zero_block, address_block, address_block, 0);
+}
+
+/* H' from RFC 9106 section 3.3: BLAKE2b chained in 32-byte steps past 64 bytes. */
+static void argon2_hash_long(uint8_t *out, size_t out_len, const uint8_t *in, size_t in_len)
+{
+    Blake2bState state;
+    uint8_t chain[BLAKE2B_OUT_LEN];
+
+    if (out_len <= BLAKE2B_OUT_LEN)
+    {
+        blake2b_init(&state, out_len);
+        blake2b_update32(&state, (uint32_t)out_len);
+        blake2b_update(&state, in, in_len);
+        blake2b_final(&state, out);
+    }
+    else
+    {
+        size_t remaining = out_len;
+
+        blake2b_init(&state, BLAKE2B_OUT_LEN);
+        blake2b_update32(&state, (uint32_t)out_len);
+        blake2b_update(&state, in, in_len);
+        blake2b_final(&state, chain);
+        memcpy(out, chain, BLAKE2B_OUT_LEN / 2u);
+        out += BLAKE2B_OUT_LEN / 2u;
+        remaining -= BLAKE2B_OUT_LEN / 2u;
+
+        while (remaining > BLAKE2B_OUT_LEN)
+        {
+            blake2b_init(&state, BLAKE2B_OUT_LEN);
+            blake2b_update(&state, chain, sizeof(chain));
+            blake2b_final(&state, chain);
+            memcpy(out, chain, BLAKE2B_OUT_LEN / 2u);
+            out += BLAKE2B_OUT_LEN / 2u;
+            remaining -= BLAKE2B_OUT_LEN / 2u;
+        }
+
+        blake2b_init(&state, remaining);
+        blake2b_update(&state, chain, sizeof(chain));
+        blake2b_final(&state, out);
+    }
+
+    wallet_secure_zero(chain, sizeof(chain));
+    wallet_secure_zero(&state, sizeof(state));
+}
+
+static void argon2_store32(uint8_t *out, uint32_t value)
+{
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    out[2] = (uint8_t)(value >> 16);
+    out[3] = (uint8_t)(value >> 24);
+}
+
+static void blake2b_init(Blake2bState *state, size_t out_len)
+{
+    memset(state, 0, sizeof(*state));
+    memcpy(state->h, blake2b_iv, sizeof(state->h));
+    /* Parameter block: digest length, no key, fanout 1, depth 1. */
+    state->h[0] ^= 0x01010000ull ^ (uint64_t)out_len;
+    state->out_len = out_len;
+}
+
+static void blake2b_update(Blake2bState *state, const uint8_t *in, size_t in_len)
+{
+    while (in_len > 0u)
+    {
+        size_t take;
+
+        /* Keep the last block buffered: it has to be compressed with the final flag. */
+        if (state->buffer_len == BLAKE2B_BLOCK_LEN)
+        {
+            state->t[0] += BLAKE2B_BLOCK_LEN;
+            if (state->t[0] < BLAKE2B_BLOCK_LEN)
+            {
+                state->t[1]++;
+            }
+            blake2b_compress(state, state->buffer, 0);
+            state->buffer_len = 0u;
+        }
+
+        take = BLAKE2B_BLOCK_LEN - state->buffer_len;
+        if (take > in_len)
+        {
+            take = in_len;
+        }
+        memcpy(state->buffer + state->buffer_len, in, take);
+        state->buffer_len += take;
+        in += take;
+        in_len -= take;
+    }
+}
+
+static void blake2b_update32(Blake2bState *state, uint32_t value)
+{
+    uint8_t bytes[4];
+
+    argon2_store32(bytes, value);
+    blake2b_update(state, bytes, sizeof(bytes));
+}
+
+static void blake2b_final(Blake2bState *state, uint8_t *out)
+{
+    uint8_t digest[BLAKE2B_OUT_LEN];
+    uint32_t i;
+
+    state->t[0] += state->buffer_len;
+    if (state->t[0] < state->buffer_len)
+    {
+        state->t[1]++;
+    }
+    memset(state->buffer + state->buffer_len, 0, BLAKE2B_BLOCK_LEN - state->buffer_len);
+    blake2b_compress(state, state->buffer, 1);
+
+    for (i = 0u; i < 8u; i++)
+    {
+        store64(digest + (8u * i), state->h[i]);
+    }
+    memcpy(out, digest, state->out_len);
+    wallet_secure_zero(digest, sizeof(digest));
+}
+
+#define BLAKE2B_G(r, i, a, b, c, d) \
+    do \
+    { \
+        a = a + b + m[blake2b_sigma[r][2 * (i)]]; d = ARGON2_ROTR64(d ^ a, 32); \
+        c = c + d; b = ARGON2_ROTR64(b ^ c, 24); \
+        a = a + b + m[blake2b_sigma[r][2 * (i) + 1]]; d = ARGON2_ROTR64(d ^ a, 16); \
+        c = c + d; b = ARGON2_ROTR64(b ^ c, 63); \
+    } while (0)
+
+static void blake2b_compress(Blake2bState *state, const uint8_t *block, int last)
+{
+    uint64_t m[16];
+    uint64_t v[16];
+    int round;
+    int i;
+
+    for (i = 0; i < 16; i++)
+    {
+        m[i] = load64(block + (8 * i));
+    }
+    for (i = 0; i < 8; i++)
+    {
+        v[i] = state->h[i];
+        v[i + 8] = blake2b_iv[i];
+    }
+    v[12] ^= state->t[0];
+    v[13] ^= state->t[1];
+    if (last)
+    {
+        v[14] = ~v[14];
+    }
+
+    for (round = 0; round < 12; round++)
+    {
+        BLAKE2B_G(round, 0, v[0], v[4], v[8], v[12]);
+        BLAKE2B_G(round, 1, v[1], v[5], v[9], v[13]);
+        BLAKE2B_G(round, 2, v[2], v[6], v[10], v[14]);
+        BLAKE2B_G(round, 3, v[3], v[7], v[11], v[15]);
+        BLAKE2B_G(round, 4, v[0], v[5], v[10], v[15]);
+        BLAKE2B_G(round, 5, v[1], v[6], v[11], v[12]);
+        BLAKE2B_G(round, 6, v[2], v[7], v[8], v[13]);
+        BLAKE2B_G(round, 7, v[3], v[4], v[9], v[14]);
+    }
+
+    for (i = 0; i < 8; i++)
+    {
+        state->h[i] ^= v[i] ^ v[i + 8];
+    }
+
+    wallet_secure_zero(m, sizeof(m));
+    wallet_secure_zero(v, sizeof(v));
+}
+
+static uint64_t load64(const uint8_t *in)
+{
+    uint64_t value = 0u;
+    int i;
+
+    for (i = 7; i >= 0; i--)
+    {
+        value = (value << 8) | in[i];
+    }
+
+    return value;
+}
+
+static void store64(uint8_t *out, uint64_t value)
+{
+    int i;
+
+    for (i = 0; i < 8; i++)
+    {
+        out[i] = (uint8_t)(value >> (8 * i));
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef WALLET_ARGON2_H
+#define WALLET_ARGON2_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WALLET_ARGON2_BLOCK_SIZE 1024u
+#define WALLET_ARGON2_MAX_LANES 16u
+#define WALLET_ARGON2_MAX_PASSES 64u
+/* 1 GiB; anything larger in a blob header is treated as hostile. */
+#define WALLET_ARGON2_MAX_MEMORY_KIB (1024u * 1024u)
+
+/*
+ * Argon2id (RFC 9106, version 0x13) without secret or associated data.
+ * memory_kib must be at least 8 * lanes; lanes are filled one after another
+ * on the calling thread, so they change the output but not the wall time.
+ * Returns APP_OK, APP_ERR_ALLOC when the memory cannot be reserved, or
+ * APP_ERR_CRYPTO for out-of-range parameters. The working memory is wiped
+ * before it is released.
+ */
+int wallet_argon2id(const uint8_t *password,
+                    size_t password_len,
+                    const uint8_t *salt,
+                    size_t salt_len,
+                    uint32_t passes,
+                    uint32_t memory_kib,
+                    uint32_t lanes,
+                    uint8_t *out,
+                    size_t out_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -3,85 +3,261 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#ifndef _WIN32
+#include <pthread.h>
+#endif
 
 #include "ed25519.h"
 #include "sha512.h"
+#include "wallet_aead.h"
+#include "wallet_argon2.h"
+#include "wallet_random.h"
 
 #define SHA512_BLOCK_SIZE 128u
 #define SHA512_DIGEST_LENGTH 64u
-#define PBKDF2_ITERATIONS 200000u
+/* Calibration probes run at least this long before their time is trusted. */
+#define KDF_CALIBRATE_PROBE_S 0.05
+/* Threads used for outputs longer than one SHA-512 block; more blocks are shared round-robin. */
+#define PBKDF2_MAX_LANES 8u
+
+typedef struct
+{
+    sha512_context inner;
+    sha512_context outer;
+} Pbkdf2Key;
+
+typedef struct
+{
+    const Pbkdf2Key *key;
+    const uint8_t *salt;
+    size_t salt_len;
+    uint32_t iterations;
+    uint8_t *output;
+    size_t output_len;
+    uint32_t first_block;
+    uint32_t stride;
+} Pbkdf2Lane;
 
 static void hmac_sha512(const uint8_t *key,
                         size_t key_len,
                         const uint8_t *data,
                         size_t data_len,
                         uint8_t *out_digest);
-static int pbkdf2_hmac_sha512(const uint8_t *password,
-                              size_t password_len,
-                              const uint8_t *salt,
-                              size_t salt_len,
-                              uint32_t iterations,
-                              uint8_t *output,
-                              size_t output_len);
+static void pbkdf2_key_init(Pbkdf2Key *key, const uint8_t *password, size_t password_len);
+static void pbkdf2_hmac(const Pbkdf2Key *key, const uint8_t *data, size_t data_len, uint8_t *out_digest);
+static void pbkdf2_lane_run(const Pbkdf2Lane *lane);
+#ifndef _WIN32
+static void *pbkdf2_lane_thread(void *arg);
+#endif
 static void derive_stream_key(const uint8_t *master_key,
                               const uint8_t *nonce,
                               size_t nonce_len,
                               const char *label,
                               uint8_t *derived,
                               size_t derived_len);
-static int constant_time_compare(const uint8_t *a, const uint8_t *b, size_t len);
+static int kdf_params_valid(const WalletKdfParams *params);
+static void encode_kdf_params(const WalletKdfParams *params, uint8_t *out);
+static int decode_kdf_params(const uint8_t *in, WalletKdfParams *out_params);
+static int derive_master_key(const uint8_t *password,
+                             size_t password_len,
+                             const WalletKdfParams *params,
+                             const uint8_t *salt,
+                             uint8_t *master_key);
+static void compute_blob_mac(const uint8_t *master_key,
+                             const uint8_t *header,
+                             size_t header_len,
+                             const uint8_t *nonce,
+                             const uint8_t *ciphertext,
+                             uint8_t *out_mac);
+static int time_kdf(const WalletKdfParams *params, double *out_seconds);
+static int vault_derive_key(WalletVaultStream *stream,
+                            const char *password,
+                            size_t password_len,
+                            const WalletKdfParams *params);
+static void vault_chunk_nonce(const WalletVaultStream *stream, int last, uint8_t *out_nonce);
 
 int wallet_random_bytes(uint8_t *buffer, size_t length)
 {
-    int status = APP_ERR_IO;
+    if (buffer == NULL)
+    {
+        return APP_ERR_IO;
+    }
 
-    if (buffer != NULL)
+    return wallet_random_fill(buffer, length);
+}
+
+void wallet_secure_zero(void *ptr, size_t length)
+{
+    if (ptr == NULL)
     {
-        size_t offset = 0u;
+        return;
+    }
 
-        while (offset < length)
-        {
-            uint8_t seed[WALLET_SEED_LEN];
-            size_t copy_len = length - offset;
+    volatile uint8_t *volatile bytes = (volatile uint8_t *volatile)ptr;
+    for (size_t i = 0; i < length; i++)
+    {
+        bytes[i] = 0u;
+    }
+}
+
+void wallet_hmac_sha512(const uint8_t *key,
+                        size_t key_len,
+                        const uint8_t *data,
+                        size_t data_len,
+                        uint8_t *out_digest)
+{
+    hmac_sha512(key, key_len, data, data_len, out_digest);
+}
+
+void wallet_kdf_default_params(WalletKdfParams *out_params)
+{
+    if (out_params == NULL)
+    {
+        return;
+    }
 
-            if (ed25519_create_seed(seed) != 0)
+    out_params->id = WALLET_KDF_PBKDF2_SHA512;
+    out_params->cost = WALLET_KDF_PBKDF2_DEFAULT_ITERATIONS;
+    out_params->passes = 0u;
+    out_params->lanes = 0u;
+}
+
+int wallet_kdf_calibrate(WalletKdfId id, unsigned int target_ms, WalletKdfParams *out_params)
+{
+    int status = APP_OK;
+    double elapsed = 0.0;
+    double target = (double)target_ms / 1000.0;
+    uint32_t probe = 0u;
+
+    if ((out_params == NULL) || (target_ms == 0u))
+    {
+        return APP_ERR_IO;
+    }
+
+    memset(out_params, 0, sizeof(*out_params));
+    out_params->id = id;
+
+    if (id == WALLET_KDF_PBKDF2_SHA512)
+    {
+        /* Double the probe until it runs long enough for clock() to be meaningful. */
+        probe = 1000u;
+        while (status == APP_OK)
+        {
+            out_params->cost = probe;
+            status = time_kdf(out_params, &elapsed);
+            if ((elapsed >= KDF_CALIBRATE_PROBE_S) || (probe >= WALLET_KDF_PBKDF2_MIN_ITERATIONS))
             {
-                wallet_secure_zero(seed, sizeof(seed));
-                status = APP_ERR_IO;
                 break;
             }
+            probe *= 2u;
+        }
+
+        if (status == APP_OK)
+        {
+            double iterations = (double)probe * target / ((elapsed > 0.0) ? elapsed : 1e-6);
 
-            if (copy_len > sizeof(seed))
+            if (iterations < (double)WALLET_KDF_PBKDF2_MIN_ITERATIONS)
             {
-                copy_len = sizeof(seed);
+                iterations = (double)WALLET_KDF_PBKDF2_MIN_ITERATIONS;
             }
-
-            memcpy(buffer + offset, seed, copy_len);
-            wallet_secure_zero(seed, sizeof(seed));
-            offset += copy_len;
+            if (iterations > (double)WALLET_KDF_PBKDF2_MAX_ITERATIONS)
+            {
+                iterations = (double)WALLET_KDF_PBKDF2_MAX_ITERATIONS;
+            }
+            out_params->cost = ((uint32_t)iterations / 1000u) * 1000u;
+        }
+    }
+    else if (id == WALLET_KDF_ARGON2ID)
+    {
+        out_params->passes = 1u;
+        out_params->lanes = 1u;
+        probe = 4096u;
+        while (status == APP_OK)
+        {
+            out_params->cost = probe;
+            status = time_kdf(out_params, &elapsed);
+            if ((elapsed >= KDF_CALIBRATE_PROBE_S) || (probe >= WALLET_KDF_ARGON2_MIN_MEMORY_KIB))
+            {
+                break;
+            }
+            probe *= 2u;
         }
 
-        if (offset >= length)
+        if (status == APP_OK)
         {
-            status = APP_OK;
+            /* Argon2id time is close to linear in memory * passes. */
+            double budget = (double)probe * target / ((elapsed > 0.0) ? elapsed : 1e-6);
+            double memory = budget / (double)WALLET_KDF_ARGON2_PASSES;
+            double passes = (double)WALLET_KDF_ARGON2_PASSES;
+
+            if (memory > (double)WALLET_KDF_ARGON2_MAX_MEMORY_KIB)
+            {
+                memory = (double)WALLET_KDF_ARGON2_MAX_MEMORY_KIB;
+                passes = budget / memory;
+                if (passes > (double)WALLET_KDF_ARGON2_MAX_PASSES)
+                {
+                    passes = (double)WALLET_KDF_ARGON2_MAX_PASSES;
+                }
+            }
+            if (memory < (double)WALLET_KDF_ARGON2_MIN_MEMORY_KIB)
+            {
+                memory = (double)WALLET_KDF_ARGON2_MIN_MEMORY_KIB;
+            }
+
+            out_params->cost = ((uint32_t)memory / 1024u) * 1024u;
+            if (out_params->cost < WALLET_KDF_ARGON2_MIN_MEMORY_KIB)
+            {
+                out_params->cost = WALLET_KDF_ARGON2_MIN_MEMORY_KIB;
+            }
+            out_params->passes = (uint32_t)passes;
         }
     }
+    else
+    {
+        status = APP_ERR_CRYPTO;
+    }
 
     return status;
 }
 
-void wallet_secure_zero(void *ptr, size_t length)
+size_t wallet_blob_length(const uint8_t *blob, size_t available)
 {
-    if (ptr == NULL)
+    size_t length = 0u;
+
+    if ((blob == NULL) || (available == 0u))
     {
-        return;
+        return 0u;
     }
 
-    volatile uint8_t *volatile bytes = (volatile uint8_t *volatile)ptr;
-    for (size_t i = 0; i < length; i++)
+    if (blob[0] == WALLET_BLOB_VERSION_V1)
     {
-        bytes[i] = 0u;
+        length = WALLET_BLOB_V1_LEN;
+    }
+    else if (blob[0] == WALLET_BLOB_VERSION)
+    {
+        length = WALLET_BLOB_LEN;
+    }
+
+    return (length <= available) ? length : 0u;
+}
+
+int wallet_blob_kdf_params(const uint8_t *blob, size_t blob_len, WalletKdfParams *out_params)
+{
+    size_t length = wallet_blob_length(blob, blob_len);
+
+    if ((length == 0u) || (out_params == NULL))
+    {
+        return APP_ERR_CRYPTO;
     }
+
+    if (blob[0] == WALLET_BLOB_VERSION_V1)
+    {
+        wallet_kdf_default_params(out_params);
+        return APP_OK;
+    }
+
+    return decode_kdf_params(blob + 1u, out_params);
 }
 
 int wallet_encrypt_private_key(const char *password,
@@ -89,68 +265,67 @@ int wallet_encrypt_private_key(const char *password,
                                size_t private_key_len,
                                uint8_t *out_blob,
                                size_t out_blob_len)
+{
+    WalletKdfParams params;
+
+    wallet_kdf_default_params(&params);
+    return wallet_encrypt_private_key_kdf(password, &params, private_key, private_key_len, out_blob, out_blob_len);
+}
+
+int wallet_encrypt_private_key_kdf(const char *password,
+                                   const WalletKdfParams *params,
+                                   const uint8_t *private_key,
+                                   size_t private_key_len,
+                                   uint8_t *out_blob,
+                                   size_t out_blob_len)
 {
     int status = APP_ERR_IO;
     size_t password_len = 0u;
+    uint8_t header[1u + WALLET_KDF_PARAMS_LEN];
     uint8_t salt[WALLET_SALT_LEN];
     uint8_t nonce[WALLET_NONCE_LEN];
     uint8_t master_key[SHA512_DIGEST_LENGTH];
     uint8_t keystream[WALLET_PRIVATE_KEY_LEN];
-    uint8_t mac_key[SHA512_DIGEST_LENGTH];
     uint8_t ciphertext[WALLET_PRIVATE_KEY_LEN];
-    uint8_t auth_input[WALLET_NONCE_LEN + WALLET_PRIVATE_KEY_LEN];
-    uint8_t mac_full[SHA512_DIGEST_LENGTH];
-    uint8_t mac_truncated[WALLET_MAC_LEN];
+    uint8_t mac[WALLET_MAC_LEN];
 
+    memset(header, 0, sizeof(header));
     memset(master_key, 0, sizeof(master_key));
     memset(keystream, 0, sizeof(keystream));
-    memset(mac_key, 0, sizeof(mac_key));
     memset(ciphertext, 0, sizeof(ciphertext));
-    memset(auth_input, 0, sizeof(auth_input));
-    memset(mac_full, 0, sizeof(mac_full));
-    memset(mac_truncated, 0, sizeof(mac_truncated));
+    memset(mac, 0, sizeof(mac));
 
-    if ((password != NULL) && (private_key != NULL) && (out_blob != NULL))
+    if ((password != NULL) && (params != NULL) && (private_key != NULL) && (out_blob != NULL))
     {
         if ((private_key_len == WALLET_PRIVATE_KEY_LEN) && (out_blob_len >= WALLET_BLOB_LEN))
         {
             password_len = strlen(password);
-            if (password_len > 0u)
+            if ((password_len > 0u) && (kdf_params_valid(params) != 0))
             {
                 int salt_status = wallet_random_bytes(salt, sizeof(salt));
                 int nonce_status = wallet_random_bytes(nonce, sizeof(nonce));
                 if ((salt_status == APP_OK) && (nonce_status == APP_OK))
                 {
-                    status = pbkdf2_hmac_sha512((const uint8_t *)password,
-                                                password_len,
-                                                salt,
-                                                sizeof(salt),
-                                                PBKDF2_ITERATIONS,
-                                                master_key,
-                                                sizeof(master_key));
+                    header[0] = WALLET_BLOB_VERSION;
+                    encode_kdf_params(params, header + 1u);
+
+                    status = derive_master_key((const uint8_t *)password, password_len, params, salt, master_key);
                     if (status == APP_OK)
                     {
                         derive_stream_key(master_key, nonce, sizeof(nonce), "ENC", keystream, sizeof(keystream));
-                        derive_stream_key(master_key, nonce, sizeof(nonce), "MAC", mac_key, sizeof(mac_key));
 
                         for (size_t index = 0u; index < WALLET_PRIVATE_KEY_LEN; index++)
                         {
                             ciphertext[index] = private_key[index] ^ keystream[index];
                         }
 
-                        memcpy(auth_input, nonce, sizeof(nonce));
-                        memcpy(auth_input + sizeof(nonce), ciphertext, sizeof(ciphertext));
-
-                        hmac_sha512(mac_key, sizeof(mac_key), auth_input, sizeof(auth_input), mac_full);
-                        memcpy(mac_truncated, mac_full, sizeof(mac_truncated));
+                        compute_blob_mac(master_key, header, sizeof(header), nonce, ciphertext, mac);
 
-                        out_blob[0] = WALLET_BLOB_VERSION;
-                        memcpy(out_blob + 1u, salt, sizeof(salt));
-                        memcpy(out_blob + 1u + sizeof(salt), nonce, sizeof(nonce));
-                        memcpy(out_blob + 1u + sizeof(salt) + sizeof(nonce), ciphertext, sizeof(ciphertext));
-                        memcpy(out_blob + 1u + sizeof(salt) + sizeof(nonce) + sizeof(ciphertext), mac_truncated, sizeof(mac_truncated));
-
-                        status = APP_OK;
+                        memcpy(out_blob, header, sizeof(header));
+                        memcpy(out_blob + sizeof(header), salt, sizeof(salt));
+                        memcpy(out_blob + sizeof(header) + sizeof(salt), nonce, sizeof(nonce));
+                        memcpy(out_blob + sizeof(header) + sizeof(salt) + sizeof(nonce), ciphertext, sizeof(ciphertext));
+                        memcpy(out_blob + sizeof(header) + sizeof(salt) + sizeof(nonce) + sizeof(ciphertext), mac, sizeof(mac));
                     }
                     else
                     {
@@ -163,11 +338,8 @@ int wallet_encrypt_private_key(const char *password,
 
     wallet_secure_zero(master_key, sizeof(master_key));
     wallet_secure_zero(keystream, sizeof(keystream));
-    wallet_secure_zero(mac_key, sizeof(mac_key));
-    wallet_secure_zero(mac_full, sizeof(mac_full));
-    wallet_secure_zero(mac_truncated, sizeof(mac_truncated));
+    wallet_secure_zero(mac, sizeof(mac));
     wallet_secure_zero(ciphertext, sizeof(ciphertext));
-    wallet_secure_zero(auth_input, sizeof(auth_input));
     wallet_secure_zero(salt, sizeof(salt));
     wallet_secure_zero(nonce, sizeof(nonce));
 
@@ -182,54 +354,48 @@ int wallet_decrypt_private_key(const char *password,
 {
     int status = APP_ERR_IO;
     size_t password_len = 0u;
+    size_t header_len = 0u;
+    WalletKdfParams params;
     const uint8_t *salt = NULL;
     const uint8_t *nonce = NULL;
     const uint8_t *ciphertext = NULL;
     const uint8_t *mac = NULL;
     uint8_t master_key[SHA512_DIGEST_LENGTH];
-    uint8_t mac_key[SHA512_DIGEST_LENGTH];
     uint8_t keystream[WALLET_PRIVATE_KEY_LEN];
-    uint8_t auth_input[WALLET_NONCE_LEN + WALLET_PRIVATE_KEY_LEN];
-    uint8_t mac_full[SHA512_DIGEST_LENGTH];
+    uint8_t expected_mac[WALLET_MAC_LEN];
 
     memset(master_key, 0, sizeof(master_key));
-    memset(mac_key, 0, sizeof(mac_key));
     memset(keystream, 0, sizeof(keystream));
-    memset(auth_input, 0, sizeof(auth_input));
-    memset(mac_full, 0, sizeof(mac_full));
+    memset(expected_mac, 0, sizeof(expected_mac));
 
     if ((password != NULL) && (blob != NULL) && (out_private_key != NULL))
     {
-        if ((blob_len >= WALLET_BLOB_LEN) && (private_key_len == WALLET_PRIVATE_KEY_LEN))
+        if ((blob_len > 0u) && (private_key_len == WALLET_PRIVATE_KEY_LEN))
         {
             password_len = strlen(password);
             if (password_len > 0u)
             {
-                if (blob[0] == WALLET_BLOB_VERSION)
+                status = APP_ERR_CRYPTO;
+                if (wallet_blob_length(blob, blob_len) != 0u)
                 {
-                    salt = blob + 1u;
+                    /* v1 authenticates nonce and ciphertext only; v2 also binds the header. */
+                    header_len = (blob[0] == WALLET_BLOB_VERSION_V1) ? 0u : (1u + WALLET_KDF_PARAMS_LEN);
+                    status = wallet_blob_kdf_params(blob, blob_len, &params);
+                }
+
+                if ((status == APP_OK) && (kdf_params_valid(&params) != 0))
+                {
+                    salt = blob + ((header_len == 0u) ? 1u : header_len);
                     nonce = salt + WALLET_SALT_LEN;
                     ciphertext = nonce + WALLET_NONCE_LEN;
                     mac = ciphertext + WALLET_PRIVATE_KEY_LEN;
 
-                    status = pbkdf2_hmac_sha512((const uint8_t *)password,
-                                                password_len,
-                                                salt,
-                                                WALLET_SALT_LEN,
-                                                PBKDF2_ITERATIONS,
-                                                master_key,
-                                                sizeof(master_key));
+                    status = derive_master_key((const uint8_t *)password, password_len, &params, salt, master_key);
                     if (status == APP_OK)
                     {
-                        int mac_mismatch = 0;
-
-                        derive_stream_key(master_key, nonce, WALLET_NONCE_LEN, "MAC", mac_key, sizeof(mac_key));
-                        memcpy(auth_input, nonce, WALLET_NONCE_LEN);
-                        memcpy(auth_input + WALLET_NONCE_LEN, ciphertext, WALLET_PRIVATE_KEY_LEN);
-                        hmac_sha512(mac_key, sizeof(mac_key), auth_input, sizeof(auth_input), mac_full);
-                        mac_mismatch = constant_time_compare(mac, mac_full, WALLET_MAC_LEN);
+                        compute_blob_mac(master_key, blob, header_len, nonce, ciphertext, expected_mac);
 
-                        if (mac_mismatch == 0)
+                        if (wallet_constant_time_compare(mac, expected_mac, WALLET_MAC_LEN) == 0)
                         {
                             derive_stream_key(master_key, nonce, WALLET_NONCE_LEN, "ENC", keystream, sizeof(keystream));
 
@@ -237,8 +403,6 @@ int wallet_decrypt_private_key(const char *password,
                             {
                                 out_private_key[index] = ciphertext[index] ^ keystream[index];
                             }
-
-                            status = APP_OK;
                         }
                         else
                         {
@@ -264,14 +428,492 @@ int wallet_decrypt_private_key(const char *password,
     }
 
     wallet_secure_zero(master_key, sizeof(master_key));
+    wallet_secure_zero(expected_mac, sizeof(expected_mac));
+    wallet_secure_zero(keystream, sizeof(keystream));
+    wallet_secure_zero(&params, sizeof(params));
+
+    return status;
+}
+
+size_t wallet_vault_sealed_length(size_t plaintext_len, uint32_t chunk_len)
+{
+    size_t chunks = 1u;
+
+    if (chunk_len == 0u)
+    {
+        chunk_len = WALLET_VAULT_CHUNK_LEN;
+    }
+
+    if (plaintext_len > (SIZE_MAX / 2u))
+    {
+        return 0u;
+    }
+
+    if (plaintext_len > 0u)
+    {
+        chunks = (plaintext_len + chunk_len - 1u) / chunk_len;
+    }
+
+    return WALLET_VAULT_HEADER_LEN + plaintext_len + (chunks * WALLET_VAULT_TAG_LEN);
+}
+
+int wallet_vault_seal(const char *password,
+                      const WalletKdfParams *params,
+                      const uint8_t *plaintext,
+                      size_t plaintext_len,
+                      uint8_t *out_vault,
+                      size_t out_vault_len,
+                      size_t *out_written)
+{
+    WalletVaultStream stream;
+    size_t total = wallet_vault_sealed_length(plaintext_len, WALLET_VAULT_CHUNK_LEN);
+    size_t offset = 0u;
+    size_t written = WALLET_VAULT_HEADER_LEN;
+    int status = APP_ERR_IO;
+
+    if ((out_vault == NULL) || (out_written == NULL) || ((plaintext == NULL) && (plaintext_len > 0u)))
+    {
+        return APP_ERR_IO;
+    }
+
+    *out_written = 0u;
+    if ((total == 0u) || (out_vault_len < total))
+    {
+        return APP_ERR_IO;
+    }
+
+    status = wallet_vault_seal_init(&stream, password, params, WALLET_VAULT_CHUNK_LEN, out_vault);
+    while (status == APP_OK)
+    {
+        size_t length = plaintext_len - offset;
+        int last = (length <= WALLET_VAULT_CHUNK_LEN);
+
+        if (last == 0)
+        {
+            length = WALLET_VAULT_CHUNK_LEN;
+        }
+
+        status = wallet_vault_seal_chunk(&stream, (plaintext != NULL) ? (plaintext + offset) : NULL, length, last,
+                                         out_vault + written);
+        offset += length;
+        written += length + WALLET_VAULT_TAG_LEN;
+
+        if (last != 0)
+        {
+            break;
+        }
+    }
+
+    wallet_vault_stream_wipe(&stream);
+
+    if (status == APP_OK)
+    {
+        *out_written = written;
+    }
+    else
+    {
+        memset(out_vault, 0, total);
+    }
+
+    return status;
+}
+
+int wallet_vault_open(const char *password,
+                      const uint8_t *vault,
+                      size_t vault_len,
+                      uint8_t *out_plaintext,
+                      size_t out_plaintext_len,
+                      size_t *out_read)
+{
+    WalletVaultStream stream;
+    size_t offset = WALLET_VAULT_HEADER_LEN;
+    size_t produced = 0u;
+    int status = APP_ERR_IO;
+
+    if ((vault == NULL) || (out_read == NULL) || ((out_plaintext == NULL) && (out_plaintext_len > 0u)))
+    {
+        return APP_ERR_IO;
+    }
+
+    *out_read = 0u;
+    status = wallet_vault_open_init(&stream, password, vault, vault_len);
+    while (status == APP_OK)
+    {
+        size_t sealed_chunk = (size_t)stream.chunk_len + WALLET_VAULT_TAG_LEN;
+        size_t remaining = vault_len - offset;
+        int last = (remaining <= sealed_chunk);
+        size_t take = (last != 0) ? remaining : sealed_chunk;
+
+        if (take < WALLET_VAULT_TAG_LEN)
+        {
+            status = APP_ERR_CRYPTO;
+            break;
+        }
+
+        if ((take - WALLET_VAULT_TAG_LEN) > (out_plaintext_len - produced))
+        {
+            status = APP_ERR_IO;
+            break;
+        }
+
+        status = wallet_vault_open_chunk(&stream, vault + offset, take, last,
+                                         (out_plaintext != NULL) ? (out_plaintext + produced) : NULL);
+        offset += take;
+        produced += take - WALLET_VAULT_TAG_LEN;
+
+        if (last != 0)
+        {
+            break;
+        }
+    }
+
+    wallet_vault_stream_wipe(&stream);
+
+    if (status == APP_OK)
+    {
+        *out_read = produced;
+    }
+    else if (out_plaintext != NULL)
+    {
+        wallet_secure_zero(out_plaintext, out_plaintext_len);
+    }
+
+    return status;
+}
+
+int wallet_vault_seal_init(WalletVaultStream *stream,
+                           const char *password,
+                           const WalletKdfParams *params,
+                           uint32_t chunk_len,
+                           uint8_t *out_header)
+{
+    int status = APP_ERR_IO;
+    size_t password_len = 0u;
+    uint8_t *header = NULL;
+
+    if ((stream == NULL) || (password == NULL) || (params == NULL) || (out_header == NULL))
+    {
+        return APP_ERR_IO;
+    }
+
+    memset(stream, 0, sizeof(*stream));
+    if (chunk_len == 0u)
+    {
+        chunk_len = WALLET_VAULT_CHUNK_LEN;
+    }
+
+    password_len = strlen(password);
+    if ((password_len == 0u) || (chunk_len > WALLET_VAULT_MAX_CHUNK_LEN) || (kdf_params_valid(params) == 0))
+    {
+        return APP_ERR_IO;
+    }
+
+    header = stream->header;
+    header[0] = WALLET_VAULT_VERSION;
+    encode_kdf_params(params, header + 1u);
+    status = wallet_random_bytes(header + 1u + WALLET_KDF_PARAMS_LEN, WALLET_SALT_LEN + WALLET_VAULT_NONCE_PREFIX_LEN);
+    if (status == APP_OK)
+    {
+        header[WALLET_VAULT_HEADER_LEN - 4u] = (uint8_t)((chunk_len >> 24u) & 0xffu);
+        header[WALLET_VAULT_HEADER_LEN - 3u] = (uint8_t)((chunk_len >> 16u) & 0xffu);
+        header[WALLET_VAULT_HEADER_LEN - 2u] = (uint8_t)((chunk_len >> 8u) & 0xffu);
+        header[WALLET_VAULT_HEADER_LEN - 1u] = (uint8_t)(chunk_len & 0xffu);
+        stream->chunk_len = chunk_len;
+
+        status = vault_derive_key(stream, password, password_len, params);
+    }
+
+    if (status == APP_OK)
+    {
+        memcpy(out_header, header, WALLET_VAULT_HEADER_LEN);
+    }
+    else
+    {
+        wallet_vault_stream_wipe(stream);
+    }
+
+    return status;
+}
+
+int wallet_vault_seal_chunk(WalletVaultStream *stream,
+                            const uint8_t *chunk,
+                            size_t length,
+                            int last,
+                            uint8_t *out_sealed)
+{
+    uint8_t nonce[WALLET_AEAD_NONCE_LEN];
+    int status = APP_ERR_IO;
+
+    if ((stream == NULL) || (out_sealed == NULL) || ((chunk == NULL) && (length > 0u)))
+    {
+        return APP_ERR_IO;
+    }
+
+    if ((stream->chunk_len == 0u) || (stream->finished != 0) || (stream->next_chunk == UINT32_MAX))
+    {
+        return APP_ERR_IO;
+    }
+
+    if ((length > stream->chunk_len) || ((last == 0) && (length != stream->chunk_len)))
+    {
+        return APP_ERR_IO;
+    }
+
+    vault_chunk_nonce(stream, last, nonce);
+    status = wallet_aead_encrypt(stream->key, nonce, stream->header, WALLET_VAULT_HEADER_LEN,
+                                 chunk, length, out_sealed, out_sealed + length);
+    if (status == APP_OK)
+    {
+        stream->next_chunk++;
+        stream->finished = (last != 0);
+    }
+
+    return status;
+}
+
+int wallet_vault_open_init(WalletVaultStream *stream,
+                           const char *password,
+                           const uint8_t *header,
+                           size_t header_len)
+{
+    int status = APP_ERR_IO;
+    size_t password_len = 0u;
+    uint32_t chunk_len = 0u;
+    WalletKdfParams params;
+
+    if ((stream == NULL) || (password == NULL) || (header == NULL))
+    {
+        return APP_ERR_IO;
+    }
+
+    memset(stream, 0, sizeof(*stream));
+    password_len = strlen(password);
+    if (password_len == 0u)
+    {
+        return APP_ERR_IO;
+    }
+
+    if ((header_len < WALLET_VAULT_HEADER_LEN) || (header[0] != WALLET_VAULT_VERSION) ||
+        (decode_kdf_params(header + 1u, &params) != APP_OK) || (kdf_params_valid(&params) == 0))
+    {
+        return APP_ERR_CRYPTO;
+    }
+
+    chunk_len = ((uint32_t)header[WALLET_VAULT_HEADER_LEN - 4u] << 24u) |
+                ((uint32_t)header[WALLET_VAULT_HEADER_LEN - 3u] << 16u) |
+                ((uint32_t)header[WALLET_VAULT_HEADER_LEN - 2u] << 8u) |
+                (uint32_t)header[WALLET_VAULT_HEADER_LEN - 1u];
+    if ((chunk_len == 0u) || (chunk_len > WALLET_VAULT_MAX_CHUNK_LEN))
+    {
+        return APP_ERR_CRYPTO;
+    }
+
+    memcpy(stream->header, header, WALLET_VAULT_HEADER_LEN);
+    stream->chunk_len = chunk_len;
+    status = vault_derive_key(stream, password, password_len, &params);
+    if (status != APP_OK)
+    {
+        wallet_vault_stream_wipe(stream);
+    }
+
+    wallet_secure_zero(&params, sizeof(params));
+
+    return status;
+}
+
+int wallet_vault_open_chunk(WalletVaultStream *stream,
+                            const uint8_t *sealed,
+                            size_t sealed_len,
+                            int last,
+                            uint8_t *out_chunk)
+{
+    uint8_t nonce[WALLET_AEAD_NONCE_LEN];
+    size_t length = 0u;
+    int status = APP_ERR_IO;
+
+    if ((stream == NULL) || (sealed == NULL))
+    {
+        return APP_ERR_IO;
+    }
+
+    if ((stream->chunk_len == 0u) || (stream->finished != 0) || (stream->next_chunk == UINT32_MAX))
+    {
+        return APP_ERR_IO;
+    }
+
+    if (sealed_len < WALLET_VAULT_TAG_LEN)
+    {
+        return APP_ERR_CRYPTO;
+    }
+
+    length = sealed_len - WALLET_VAULT_TAG_LEN;
+    if ((length > stream->chunk_len) || ((last == 0) && (length != stream->chunk_len)))
+    {
+        return APP_ERR_CRYPTO;
+    }
+
+    vault_chunk_nonce(stream, last, nonce);
+    status = wallet_aead_decrypt(stream->key, nonce, stream->header, WALLET_VAULT_HEADER_LEN,
+                                 sealed, length, sealed + length, out_chunk);
+    if (status == APP_OK)
+    {
+        stream->next_chunk++;
+        stream->finished = (last != 0);
+    }
+
+    return status;
+}
+
+void wallet_vault_stream_wipe(WalletVaultStream *stream)
+{
+    if (stream != NULL)
+    {
+        wallet_secure_zero(stream, sizeof(*stream));
+    }
+}
+
+/* Headers are attacker-controlled: the cost ceilings are checked here, before any KDF work. */
+static int kdf_params_valid(const WalletKdfParams *params)
+{
+    if (params->id == WALLET_KDF_PBKDF2_SHA512)
+    {
+        return (params->cost > 0u) && (params->cost <= WALLET_KDF_PBKDF2_MAX_ITERATIONS);
+    }
+
+    if (params->id == WALLET_KDF_ARGON2ID)
+    {
+        return (params->passes > 0u) && (params->passes <= WALLET_KDF_ARGON2_MAX_PASSES) &&
+               (params->lanes > 0u) && (params->lanes <= WALLET_ARGON2_MAX_LANES) &&
+               (params->cost >= (8u * params->lanes)) && (params->cost <= WALLET_KDF_ARGON2_MAX_MEMORY_KIB);
+    }
+
+    return 0;
+}
+
+static void encode_kdf_params(const WalletKdfParams *params, uint8_t *out)
+{
+    out[0] = (uint8_t)params->id;
+    out[1] = (uint8_t)((params->cost >> 24u) & 0xffu);
+    out[2] = (uint8_t)((params->cost >> 16u) & 0xffu);
+    out[3] = (uint8_t)((params->cost >> 8u) & 0xffu);
+    out[4] = (uint8_t)(params->cost & 0xffu);
+    out[5] = (uint8_t)((params->passes >> 8u) & 0xffu);
+    out[6] = (uint8_t)(params->passes & 0xffu);
+    out[7] = (uint8_t)(params->lanes & 0xffu);
+}
+
+static int decode_kdf_params(const uint8_t *in, WalletKdfParams *out_params)
+{
+    if ((in[0] != (uint8_t)WALLET_KDF_PBKDF2_SHA512) && (in[0] != (uint8_t)WALLET_KDF_ARGON2ID))
+    {
+        return APP_ERR_CRYPTO;
+    }
+
+    out_params->id = (WalletKdfId)in[0];
+    out_params->cost = ((uint32_t)in[1] << 24u) | ((uint32_t)in[2] << 16u) | ((uint32_t)in[3] << 8u) | (uint32_t)in[4];
+    out_params->passes = ((uint32_t)in[5] << 8u) | (uint32_t)in[6];
+    out_params->lanes = in[7];
+
+    return APP_OK;
+}
+
+static int derive_master_key(const uint8_t *password,
+                             size_t password_len,
+                             const WalletKdfParams *params,
+                             const uint8_t *salt,
+                             uint8_t *master_key)
+{
+    if (params->id == WALLET_KDF_ARGON2ID)
+    {
+        return wallet_argon2id(password, password_len, salt, WALLET_SALT_LEN,
+                               params->passes, params->cost, params->lanes,
+                               master_key, SHA512_DIGEST_LENGTH);
+    }
+
+    return wallet_pbkdf2_hmac_sha512(password, password_len, salt, WALLET_SALT_LEN, params->cost,
+                                     master_key, SHA512_DIGEST_LENGTH, PBKDF2_MAX_LANES);
+}
+
+static void compute_blob_mac(const uint8_t *master_key,
+                             const uint8_t *header,
+                             size_t header_len,
+                             const uint8_t *nonce,
+                             const uint8_t *ciphertext,
+                             uint8_t *out_mac)
+{
+    uint8_t mac_key[SHA512_DIGEST_LENGTH];
+    uint8_t auth_input[1u + WALLET_KDF_PARAMS_LEN + WALLET_NONCE_LEN + WALLET_PRIVATE_KEY_LEN];
+    uint8_t mac_full[SHA512_DIGEST_LENGTH];
+
+    derive_stream_key(master_key, nonce, WALLET_NONCE_LEN, "MAC", mac_key, sizeof(mac_key));
+    memcpy(auth_input, header, header_len);
+    memcpy(auth_input + header_len, nonce, WALLET_NONCE_LEN);
+    memcpy(auth_input + header_len + WALLET_NONCE_LEN, ciphertext, WALLET_PRIVATE_KEY_LEN);
+    hmac_sha512(mac_key, sizeof(mac_key), auth_input, header_len + WALLET_NONCE_LEN + WALLET_PRIVATE_KEY_LEN, mac_full);
+    memcpy(out_mac, mac_full, WALLET_MAC_LEN);
+
     wallet_secure_zero(mac_key, sizeof(mac_key));
     wallet_secure_zero(mac_full, sizeof(mac_full));
     wallet_secure_zero(auth_input, sizeof(auth_input));
-    wallet_secure_zero(keystream, sizeof(keystream));
+}
+
+/* One KDF run on a throwaway password, in CPU seconds. */
+static int time_kdf(const WalletKdfParams *params, double *out_seconds)
+{
+    static const uint8_t probe_password[] = "calibrate";
+    uint8_t salt[WALLET_SALT_LEN];
+    uint8_t output[SHA512_DIGEST_LENGTH];
+    clock_t start;
+    int status;
+
+    memset(salt, 0x5a, sizeof(salt));
+    start = clock();
+    status = derive_master_key(probe_password, sizeof(probe_password) - 1u, params, salt, output);
+    *out_seconds = (double)(clock() - start) / (double)CLOCKS_PER_SEC;
+    wallet_secure_zero(output, sizeof(output));
+
+    return status;
+}
+
+/* The salt and nonce prefix must already be in stream->header. */
+static int vault_derive_key(WalletVaultStream *stream,
+                            const char *password,
+                            size_t password_len,
+                            const WalletKdfParams *params)
+{
+    const uint8_t *salt = stream->header + 1u + WALLET_KDF_PARAMS_LEN;
+    uint8_t master_key[SHA512_DIGEST_LENGTH];
+    int status;
+
+    status = derive_master_key((const uint8_t *)password, password_len, params, salt, master_key);
+    if (status == APP_OK)
+    {
+        derive_stream_key(master_key, salt + WALLET_SALT_LEN, WALLET_VAULT_NONCE_PREFIX_LEN, "VAULT",
+                          stream->key, sizeof(stream->key));
+    }
+    else
+    {
+        status = APP_ERR_CRYPTO;
+    }
+
+    wallet_secure_zero(master_key, sizeof(master_key));
 
     return status;
 }
 
+/* prefix || chunk index (u32 big-endian) || last flag */
+static void vault_chunk_nonce(const WalletVaultStream *stream, int last, uint8_t *out_nonce)
+{
+    const uint8_t *prefix = stream->header + 1u + WALLET_KDF_PARAMS_LEN + WALLET_SALT_LEN;
+
+    memcpy(out_nonce, prefix, WALLET_VAULT_NONCE_PREFIX_LEN);
+    out_nonce[7] = (uint8_t)((stream->next_chunk >> 24u) & 0xffu);
+    out_nonce[8] = (uint8_t)((stream->next_chunk >> 16u) & 0xffu);
+    out_nonce[9] = (uint8_t)((stream->next_chunk >> 8u) & 0xffu);
+    out_nonce[10] = (uint8_t)(stream->next_chunk & 0xffu);
+    out_nonce[11] = (last != 0) ? 1u : 0u;
+}
+
 static void hmac_sha512(const uint8_t *key,
                         size_t key_len,
                         const uint8_t *data,
@@ -318,19 +960,24 @@ static void hmac_sha512(const uint8_t *key,
     wallet_secure_zero(temp_key, sizeof(temp_key));
 }
 
-static int pbkdf2_hmac_sha512(const uint8_t *password,
+int wallet_pbkdf2_hmac_sha512(const uint8_t *password,
                               size_t password_len,
                               const uint8_t *salt,
                               size_t salt_len,
                               uint32_t iterations,
                               uint8_t *output,
-                              size_t output_len)
+                              size_t output_len,
+                              unsigned int max_lanes)
 {
-    int status = APP_ERR_IO;
-    uint32_t block_index = 0u;
-    uint8_t u[SHA512_DIGEST_LENGTH];
-    uint8_t t[SHA512_DIGEST_LENGTH];
-    uint8_t first_input[WALLET_SALT_LEN + 4u];
+    Pbkdf2Key key;
+    Pbkdf2Lane lanes[PBKDF2_MAX_LANES];
+#ifndef _WIN32
+    pthread_t threads[PBKDF2_MAX_LANES];
+    int started[PBKDF2_MAX_LANES];
+#endif
+    size_t block_count = 0u;
+    uint32_t lane_count = 0u;
+    uint32_t lane = 0u;
 
     if ((password == NULL) || (salt == NULL) || (output == NULL) || (iterations == 0u))
     {
@@ -342,32 +989,137 @@ static int pbkdf2_hmac_sha512(const uint8_t *password,
         return APP_ERR_IO;
     }
 
-    memset(u, 0, sizeof(u));
-    memset(t, 0, sizeof(t));
-    memset(first_input, 0, sizeof(first_input));
+    block_count = (output_len + SHA512_DIGEST_LENGTH - 1u) / SHA512_DIGEST_LENGTH;
+    if ((max_lanes == 0u) || (max_lanes > PBKDF2_MAX_LANES))
+    {
+        max_lanes = PBKDF2_MAX_LANES;
+    }
+    lane_count = (block_count < max_lanes) ? (uint32_t)block_count : max_lanes;
+    pbkdf2_key_init(&key, password, password_len);
+
+    for (lane = 0u; lane < lane_count; lane++)
+    {
+        lanes[lane].key = &key;
+        lanes[lane].salt = salt;
+        lanes[lane].salt_len = salt_len;
+        lanes[lane].iterations = iterations;
+        lanes[lane].output = output;
+        lanes[lane].output_len = output_len;
+        lanes[lane].first_block = lane + 1u;
+        lanes[lane].stride = lane_count;
+    }
 
-    for (block_index = 1u; block_index <= (uint32_t)((output_len + SHA512_DIGEST_LENGTH - 1u) / SHA512_DIGEST_LENGTH); block_index++)
+    /* Output blocks are independent chains; each lane takes every lane_count-th one. */
+#ifndef _WIN32
+    for (lane = 1u; lane < lane_count; lane++)
     {
-        uint32_t iteration_index = 0u;
-        size_t offset = (size_t)(block_index - 1u) * SHA512_DIGEST_LENGTH;
-        size_t copy_len = output_len - offset;
-        size_t xor_index = 0u;
+        started[lane] = (pthread_create(&threads[lane], NULL, pbkdf2_lane_thread, &lanes[lane]) == 0);
+    }
+#endif
 
-        memset(first_input, 0, sizeof(first_input));
+    if (lane_count > 0u)
+    {
+        pbkdf2_lane_run(&lanes[0]);
+    }
 
-        memcpy(first_input, salt, salt_len);
-        first_input[salt_len + 0u] = (uint8_t)((block_index >> 24u) & 0xffu);
-        first_input[salt_len + 1u] = (uint8_t)((block_index >> 16u) & 0xffu);
-        first_input[salt_len + 2u] = (uint8_t)((block_index >> 8u) & 0xffu);
-        first_input[salt_len + 3u] = (uint8_t)(block_index & 0xffu);
+    for (lane = 1u; lane < lane_count; lane++)
+    {
+#ifndef _WIN32
+        if (started[lane] != 0)
+        {
+            (void)pthread_join(threads[lane], NULL);
+            continue;
+        }
+#endif
+        pbkdf2_lane_run(&lanes[lane]);
+    }
+
+    wallet_secure_zero(&key, sizeof(key));
 
-        hmac_sha512(password, password_len, first_input, salt_len + 4u, u);
+    return APP_OK;
+}
+
+/* HMAC-SHA512 with the padded key already absorbed: two compressions per call instead of four. */
+static void pbkdf2_key_init(Pbkdf2Key *key, const uint8_t *password, size_t password_len)
+{
+    uint8_t kopad[SHA512_BLOCK_SIZE];
+    uint8_t kipad[SHA512_BLOCK_SIZE];
+    uint8_t temp_key[SHA512_DIGEST_LENGTH];
+
+    if (password_len > SHA512_BLOCK_SIZE)
+    {
+        sha512(password, password_len, temp_key);
+        password = temp_key;
+        password_len = SHA512_DIGEST_LENGTH;
+    }
+
+    memset(kopad, 0, sizeof(kopad));
+    memset(kipad, 0, sizeof(kipad));
+    if (password_len > 0u)
+    {
+        memcpy(kopad, password, password_len);
+        memcpy(kipad, password, password_len);
+    }
+
+    for (size_t i = 0; i < SHA512_BLOCK_SIZE; i++)
+    {
+        kopad[i] ^= 0x5c;
+        kipad[i] ^= 0x36;
+    }
+
+    sha512_init(&key->inner);
+    sha512_update(&key->inner, kipad, SHA512_BLOCK_SIZE);
+    sha512_init(&key->outer);
+    sha512_update(&key->outer, kopad, SHA512_BLOCK_SIZE);
+
+    wallet_secure_zero(kopad, sizeof(kopad));
+    wallet_secure_zero(kipad, sizeof(kipad));
+    wallet_secure_zero(temp_key, sizeof(temp_key));
+}
+
+static void pbkdf2_hmac(const Pbkdf2Key *key, const uint8_t *data, size_t data_len, uint8_t *out_digest)
+{
+    sha512_context ctx;
+    uint8_t inner_digest[SHA512_DIGEST_LENGTH];
+
+    ctx = key->inner;
+    sha512_update(&ctx, data, data_len);
+    sha512_final(&ctx, inner_digest);
+
+    ctx = key->outer;
+    sha512_update(&ctx, inner_digest, SHA512_DIGEST_LENGTH);
+    sha512_final(&ctx, out_digest);
+
+    wallet_secure_zero(&ctx, sizeof(ctx));
+    wallet_secure_zero(inner_digest, sizeof(inner_digest));
+}
+
+/* T_i = U_1 ^ ... ^ U_c with U_1 = HMAC(P, S || INT(i)), for the lane's share of the blocks. */
+static void pbkdf2_lane_run(const Pbkdf2Lane *lane)
+{
+    size_t block_count = (lane->output_len + SHA512_DIGEST_LENGTH - 1u) / SHA512_DIGEST_LENGTH;
+    uint8_t u[SHA512_DIGEST_LENGTH];
+    uint8_t t[SHA512_DIGEST_LENGTH];
+    uint8_t first_input[WALLET_SALT_LEN + 4u];
+
+    for (uint32_t block_index = lane->first_block; block_index <= block_count; block_index += lane->stride)
+    {
+        size_t offset = (size_t)(block_index - 1u) * SHA512_DIGEST_LENGTH;
+        size_t copy_len = lane->output_len - offset;
+
+        memcpy(first_input, lane->salt, lane->salt_len);
+        first_input[lane->salt_len + 0u] = (uint8_t)((block_index >> 24u) & 0xffu);
+        first_input[lane->salt_len + 1u] = (uint8_t)((block_index >> 16u) & 0xffu);
+        first_input[lane->salt_len + 2u] = (uint8_t)((block_index >> 8u) & 0xffu);
+        first_input[lane->salt_len + 3u] = (uint8_t)(block_index & 0xffu);
+
+        pbkdf2_hmac(lane->key, first_input, lane->salt_len + 4u, u);
         memcpy(t, u, sizeof(t));
 
-        for (iteration_index = 1u; iteration_index < iterations; iteration_index++)
+        for (uint32_t iteration_index = 1u; iteration_index < lane->iterations; iteration_index++)
         {
-            hmac_sha512(password, password_len, u, sizeof(u), u);
-            for (xor_index = 0u; xor_index < sizeof(t); xor_index++)
+            pbkdf2_hmac(lane->key, u, sizeof(u), u);
+            for (size_t xor_index = 0u; xor_index < sizeof(t); xor_index++)
             {
                 t[xor_index] ^= u[xor_index];
             }
@@ -378,16 +1130,21 @@ static int pbkdf2_hmac_sha512(const uint8_t *password,
             copy_len = SHA512_DIGEST_LENGTH;
         }
 
-        memcpy(output + offset, t, copy_len);
+        memcpy(lane->output + offset, t, copy_len);
     }
 
     wallet_secure_zero(u, sizeof(u));
     wallet_secure_zero(t, sizeof(t));
     wallet_secure_zero(first_input, sizeof(first_input));
+}
 
-    status = APP_OK;
-    return status;
+#ifndef _WIN32
+static void *pbkdf2_lane_thread(void *arg)
+{
+    pbkdf2_lane_run((const Pbkdf2Lane *)arg);
+    return NULL;
 }
+#endif
 
 static void derive_stream_key(const uint8_t *master_key,
                               const uint8_t *nonce,
@@ -436,7 +1193,7 @@ static void derive_stream_key(const uint8_t *master_key,
     wallet_secure_zero(info, sizeof(info));
 }
 
-static int constant_time_compare(const uint8_t *a, const uint8_t *b, size_t len)
+int wallet_constant_time_compare(const uint8_t *a, const uint8_t *b, size_t len)
 {
     uint8_t diff = 0u;
     size_t index = 0u;
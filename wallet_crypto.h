@@ -10,28 +10,185 @@
 extern "C" {
 #endif
 
-#define WALLET_BLOB_VERSION 1u
+#define WALLET_BLOB_VERSION 2u
+#define WALLET_BLOB_VERSION_V1 1u
 #define WALLET_SALT_LEN 16u
 #define WALLET_NONCE_LEN 12u
 #define WALLET_MAC_LEN 32u
 #define WALLET_PUBLIC_KEY_LEN 32u
 #define WALLET_PRIVATE_KEY_LEN 64u
 #define WALLET_SEED_LEN 32u
-#define WALLET_BLOB_LEN (1u + WALLET_SALT_LEN + WALLET_NONCE_LEN + WALLET_PRIVATE_KEY_LEN + WALLET_MAC_LEN)
+#define WALLET_KDF_PARAMS_LEN 8u
+/* v1: version, salt, nonce, ciphertext, mac; always PBKDF2 with 200000 iterations. */
+#define WALLET_BLOB_V1_LEN (1u + WALLET_SALT_LEN + WALLET_NONCE_LEN + WALLET_PRIVATE_KEY_LEN + WALLET_MAC_LEN)
+/* v2 adds the KDF parameters after the version byte; the MAC covers them too. */
+#define WALLET_BLOB_LEN (WALLET_BLOB_V1_LEN + WALLET_KDF_PARAMS_LEN)
+
+/*
+ * v3 vaults hold any length: version, KDF parameters, salt, a 7-byte nonce
+ * prefix and the chunk length (u32 big-endian), then ChaCha20-Poly1305
+ * chunks of chunk_len bytes plus a tag, the last one possibly shorter.
+ * Chunk n uses nonce prefix || n (u32 big-endian) || last flag and the
+ * header as associated data, so chunks cannot be reordered, dropped or
+ * cut off without failing the tag check.
+ */
+#define WALLET_VAULT_VERSION 3u
+#define WALLET_VAULT_NONCE_PREFIX_LEN 7u
+#define WALLET_VAULT_TAG_LEN 16u
+#define WALLET_VAULT_HEADER_LEN (1u + WALLET_KDF_PARAMS_LEN + WALLET_SALT_LEN + WALLET_VAULT_NONCE_PREFIX_LEN + 4u)
+#define WALLET_VAULT_CHUNK_LEN (64u * 1024u)
+#define WALLET_VAULT_MAX_CHUNK_LEN (16u * 1024u * 1024u)
+
+/*
+ * The MAX values cap what calibration picks and what a blob or vault header
+ * may ask for: anything above them is refused before the KDF runs, so a
+ * crafted header cannot pin the CPU or memory for minutes.
+ */
+#define WALLET_KDF_PBKDF2_DEFAULT_ITERATIONS 200000u
+#define WALLET_KDF_PBKDF2_MIN_ITERATIONS 100000u
+#define WALLET_KDF_PBKDF2_MAX_ITERATIONS 5000000u
+#define WALLET_KDF_ARGON2_PASSES 3u
+#define WALLET_KDF_ARGON2_MAX_PASSES 16u
+#define WALLET_KDF_ARGON2_MIN_MEMORY_KIB 19456u
+#define WALLET_KDF_ARGON2_MAX_MEMORY_KIB (256u * 1024u)
+#define WALLET_KDF_TARGET_MS 1000u
+
+typedef enum
+{
+    WALLET_KDF_PBKDF2_SHA512 = 1,
+    WALLET_KDF_ARGON2ID = 2
+} WalletKdfId;
+
+/*
+ * On disk: id u8, cost u32 big-endian, passes u16 big-endian, lanes u8.
+ * cost is the PBKDF2 iteration count or the Argon2id memory in KiB;
+ * passes and lanes are zero for PBKDF2.
+ */
+typedef struct
+{
+    WalletKdfId id;
+    uint32_t cost;
+    uint32_t passes;
+    uint32_t lanes;
+} WalletKdfParams;
+
+/* One KDF run per stream; every chunk after that is symmetric crypto only. */
+typedef struct
+{
+    uint8_t key[32];
+    uint8_t header[WALLET_VAULT_HEADER_LEN];
+    uint32_t chunk_len;
+    uint32_t next_chunk;
+    int finished;
+} WalletVaultStream;
 
 int wallet_random_bytes(uint8_t *buffer, size_t length);
 void wallet_secure_zero(void *ptr, size_t length);
+/* 0 when the buffers match; the time taken depends only on len. Used for the blob MAC check. */
+int wallet_constant_time_compare(const uint8_t *a, const uint8_t *b, size_t len);
+/* out_digest receives 64 bytes. */
+void wallet_hmac_sha512(const uint8_t *key,
+                        size_t key_len,
+                        const uint8_t *data,
+                        size_t data_len,
+                        uint8_t *out_digest);
+
+/*
+ * PBKDF2-HMAC-SHA512 with any output length and a salt of at most
+ * WALLET_SALT_LEN bytes. Outputs longer than one 64-byte block compute their
+ * block chains on up to max_lanes threads (0 for the default of eight, 1 for
+ * none); the result does not depend on max_lanes.
+ */
+int wallet_pbkdf2_hmac_sha512(const uint8_t *password,
+                              size_t password_len,
+                              const uint8_t *salt,
+                              size_t salt_len,
+                              uint32_t iterations,
+                              uint8_t *output,
+                              size_t output_len,
+                              unsigned int max_lanes);
+
+/* PBKDF2-HMAC-SHA512 at the iteration count v1 blobs were written with. */
+void wallet_kdf_default_params(WalletKdfParams *out_params);
+
+/*
+ * Times the KDF on this host and picks parameters that take roughly
+ * target_ms to unlock, never going below the MIN floors above. Argon2id
+ * grows memory first, up to WALLET_KDF_ARGON2_MAX_MEMORY_KIB, then passes.
+ */
+int wallet_kdf_calibrate(WalletKdfId id, unsigned int target_ms, WalletKdfParams *out_params);
+
+/* Length of the blob starting at blob (by its version byte), or 0 if unknown or truncated. */
+size_t wallet_blob_length(const uint8_t *blob, size_t available);
+
+/* KDF parameters a blob was sealed with; v1 blobs report the defaults. */
+int wallet_blob_kdf_params(const uint8_t *blob, size_t blob_len, WalletKdfParams *out_params);
+
+/* Writes a v2 blob with the default PBKDF2 parameters. */
 int wallet_encrypt_private_key(const char *password,
                                const uint8_t *private_key,
                                size_t private_key_len,
                                uint8_t *out_blob,
                                size_t out_blob_len);
+int wallet_encrypt_private_key_kdf(const char *password,
+                                   const WalletKdfParams *params,
+                                   const uint8_t *private_key,
+                                   size_t private_key_len,
+                                   uint8_t *out_blob,
+                                   size_t out_blob_len);
+/* Accepts v1 and v2 blobs; blob_len may exceed the blob's own length. */
 int wallet_decrypt_private_key(const char *password,
                                const uint8_t *blob,
                                size_t blob_len,
                                uint8_t *out_private_key,
                                size_t private_key_len);
 
+/* chunk_len 0 picks WALLET_VAULT_CHUNK_LEN. */
+size_t wallet_vault_sealed_length(size_t plaintext_len, uint32_t chunk_len);
+
+/* One-shot v3 vault with WALLET_VAULT_CHUNK_LEN chunks; *out_written gets the sealed length. */
+int wallet_vault_seal(const char *password,
+                      const WalletKdfParams *params,
+                      const uint8_t *plaintext,
+                      size_t plaintext_len,
+                      uint8_t *out_vault,
+                      size_t out_vault_len,
+                      size_t *out_written);
+/* vault_len must be the exact sealed length. On failure out_plaintext is zeroed. */
+int wallet_vault_open(const char *password,
+                      const uint8_t *vault,
+                      size_t vault_len,
+                      uint8_t *out_plaintext,
+                      size_t out_plaintext_len,
+                      size_t *out_read);
+
+/*
+ * Streaming form. Seal: init writes the header, then every chunk but the
+ * last must be exactly chunk_len bytes; each call writes length +
+ * WALLET_VAULT_TAG_LEN bytes. Open: init reads the header, then feed the
+ * sealed chunks back with the same last flags. Wipe the stream when done.
+ */
+int wallet_vault_seal_init(WalletVaultStream *stream,
+                           const char *password,
+                           const WalletKdfParams *params,
+                           uint32_t chunk_len,
+                           uint8_t *out_header);
+int wallet_vault_seal_chunk(WalletVaultStream *stream,
+                            const uint8_t *chunk,
+                            size_t length,
+                            int last,
+                            uint8_t *out_sealed);
+int wallet_vault_open_init(WalletVaultStream *stream,
+                           const char *password,
+                           const uint8_t *header,
+                           size_t header_len);
+int wallet_vault_open_chunk(WalletVaultStream *stream,
+                            const uint8_t *sealed,
+                            size_t sealed_len,
+                            int last,
+                            uint8_t *out_chunk);
+void wallet_vault_stream_wipe(WalletVaultStream *stream);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,240 @@
+#include "wallet_hd.h"
+
+#include <string.h>
+
+#include "ed25519.h"
+
+#define WALLET_HD_DIGEST_LEN 64u
+
+static const char hd_master_key[] = "ed25519 seed";
+
+static void hd_child(WalletHdNode *node, uint32_t index);
+static const WalletHdNode *hd_cache_find(WalletHdContext *ctx, const uint32_t *path, size_t depth);
+static void hd_cache_insert(WalletHdContext *ctx, const WalletHdNode *node);
+
+int wallet_hd_init(WalletHdContext *ctx, const uint8_t *seed, size_t seed_len)
+{
+    uint8_t digest[WALLET_HD_DIGEST_LEN];
+
+    if ((ctx == NULL) || (seed == NULL) || (seed_len < 16u) || (seed_len > 64u))
+    {
+        return APP_ERR_IO;
+    }
+
+    memset(ctx, 0, sizeof(*ctx));
+    wallet_hmac_sha512((const uint8_t *)hd_master_key, sizeof(hd_master_key) - 1u, seed, seed_len, digest);
+    memcpy(ctx->master.key, digest, WALLET_SEED_LEN);
+    memcpy(ctx->master.chain_code, digest + WALLET_SEED_LEN, WALLET_SEED_LEN);
+    wallet_secure_zero(digest, sizeof(digest));
+
+    return APP_OK;
+}
+
+void wallet_hd_clear(WalletHdContext *ctx)
+{
+    wallet_secure_zero(ctx, ctx != NULL ? sizeof(*ctx) : 0u);
+}
+
+int wallet_hd_derive(WalletHdContext *ctx, const uint32_t *path, size_t depth, uint8_t *out_seed)
+{
+    WalletHdNode node;
+    const WalletHdNode *start;
+    size_t level;
+
+    if ((ctx == NULL) || (out_seed == NULL) || (path == NULL && depth != 0u) || (depth > WALLET_HD_MAX_DEPTH))
+    {
+        return APP_ERR_IO;
+    }
+
+    for (level = 0; level < depth; ++level)
+    {
+        if ((path[level] & WALLET_HD_HARDENED) == 0u)
+        {
+            return APP_ERR_CRYPTO;
+        }
+    }
+
+    start = hd_cache_find(ctx, path, depth);
+    node = *start;
+
+    for (level = node.depth; level < depth; ++level)
+    {
+        hd_child(&node, path[level]);
+        node.path[level] = path[level];
+        node.depth = level + 1u;
+
+        if (node.depth < depth)
+        {
+            hd_cache_insert(ctx, &node);
+        }
+    }
+
+    memcpy(out_seed, node.key, WALLET_SEED_LEN);
+    wallet_secure_zero(&node, sizeof(node));
+
+    return APP_OK;
+}
+
+int wallet_hd_derive_keypair(WalletHdContext *ctx,
+                             const uint32_t *path,
+                             size_t depth,
+                             uint8_t *out_public_key,
+                             uint8_t *out_private_key)
+{
+    uint8_t seed[WALLET_SEED_LEN];
+    int status;
+
+    if ((out_public_key == NULL) || (out_private_key == NULL))
+    {
+        return APP_ERR_IO;
+    }
+
+    status = wallet_hd_derive(ctx, path, depth, seed);
+    if (status == APP_OK)
+    {
+        ed25519_create_keypair(out_public_key, out_private_key, seed);
+    }
+    wallet_secure_zero(seed, sizeof(seed));
+
+    return status;
+}
+
+size_t wallet_hd_solana_path(uint32_t account, uint32_t *out_path)
+{
+    out_path[0] = 44u | WALLET_HD_HARDENED;
+    out_path[1] = 501u | WALLET_HD_HARDENED;
+    out_path[2] = account | WALLET_HD_HARDENED;
+    out_path[3] = 0u | WALLET_HD_HARDENED;
+
+    return WALLET_HD_SOLANA_DEPTH;
+}
+
+int wallet_hd_parse_path(const char *text, uint32_t *out_path, size_t max_depth, size_t *out_depth)
+{
+    size_t depth = 0;
+
+    if ((text == NULL) || (out_path == NULL) || (out_depth == NULL) || (text[0] != 'm'))
+    {
+        return APP_ERR_IO;
+    }
+
+    text++;
+    while (*text != '\0')
+    {
+        uint32_t index = 0;
+        int digits = 0;
+
+        if ((*text != '/') || (depth >= max_depth))
+        {
+            return APP_ERR_IO;
+        }
+        text++;
+
+        while ((*text >= '0') && (*text <= '9'))
+        {
+            index = index * 10u + (uint32_t)(*text - '0');
+            if (index >= WALLET_HD_HARDENED)
+            {
+                return APP_ERR_IO;
+            }
+            digits++;
+            text++;
+        }
+
+        if (digits == 0)
+        {
+            return APP_ERR_IO;
+        }
+
+        if ((*text == '\'') || (*text == 'h') || (*text == 'H'))
+        {
+            index |= WALLET_HD_HARDENED;
+            text++;
+        }
+
+        out_path[depth++] = index;
+    }
+
+    *out_depth = depth;
+
+    return APP_OK;
+}
+
+/* I = HMAC-SHA512(chain_code, 0x00 || key || index big-endian); key = I[0..32], chain_code = I[32..64]. */
+static void hd_child(WalletHdNode *node, uint32_t index)
+{
+    uint8_t data[1u + WALLET_SEED_LEN + 4u];
+    uint8_t digest[WALLET_HD_DIGEST_LEN];
+
+    data[0] = 0u;
+    memcpy(data + 1u, node->key, WALLET_SEED_LEN);
+    data[1u + WALLET_SEED_LEN] = (uint8_t)(index >> 24u);
+    data[2u + WALLET_SEED_LEN] = (uint8_t)(index >> 16u);
+    data[3u + WALLET_SEED_LEN] = (uint8_t)(index >> 8u);
+    data[4u + WALLET_SEED_LEN] = (uint8_t)index;
+
+    wallet_hmac_sha512(node->chain_code, WALLET_SEED_LEN, data, sizeof(data), digest);
+    memcpy(node->key, digest, WALLET_SEED_LEN);
+    memcpy(node->chain_code, digest + WALLET_SEED_LEN, WALLET_SEED_LEN);
+
+    wallet_secure_zero(data, sizeof(data));
+    wallet_secure_zero(digest, sizeof(digest));
+}
+
+/* Deepest cached proper prefix of path, or the master node. */
+static const WalletHdNode *hd_cache_find(WalletHdContext *ctx, const uint32_t *path, size_t depth)
+{
+    WalletHdNode *best = NULL;
+    size_t i;
+
+    for (i = 0; i < WALLET_HD_CACHE_ENTRIES; ++i)
+    {
+        WalletHdNode *entry = &ctx->cache[i];
+
+        if ((entry->last_used == 0u) || (entry->depth >= depth))
+        {
+            continue;
+        }
+        if ((best != NULL) && (entry->depth <= best->depth))
+        {
+            continue;
+        }
+        if (memcmp(entry->path, path, entry->depth * sizeof(path[0])) == 0)
+        {
+            best = entry;
+        }
+    }
+
+    if (best == NULL)
+    {
+        return &ctx->master;
+    }
+
+    best->last_used = ++ctx->clock;
+    return best;
+}
+
+static void hd_cache_insert(WalletHdContext *ctx, const WalletHdNode *node)
+{
+    WalletHdNode *victim = NULL;
+    size_t i;
+
+    for (i = 0; i < WALLET_HD_CACHE_ENTRIES; ++i)
+    {
+        WalletHdNode *entry = &ctx->cache[i];
+
+        if ((entry->last_used != 0u) && (entry->depth == node->depth) &&
+            (memcmp(entry->path, node->path, node->depth * sizeof(node->path[0])) == 0))
+        {
+            victim = entry;
+            break;
+        }
+        if ((victim == NULL) || (entry->last_used < victim->last_used))
+        {
+            victim = entry;
+        }
+    }
+
+    *victim = *node;
+    victim->last_used = ++ctx->clock;
+}
@@ -0,0 +1,69 @@
+#ifndef WALLET_HD_H
+#define WALLET_HD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "wallet_crypto.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WALLET_HD_HARDENED 0x80000000u
+#define WALLET_HD_MAX_DEPTH 8u
+#define WALLET_HD_CACHE_ENTRIES 32u
+#define WALLET_HD_SOLANA_DEPTH 4u
+
+typedef struct
+{
+    uint64_t last_used;
+    size_t depth;
+    uint32_t path[WALLET_HD_MAX_DEPTH];
+    uint8_t key[WALLET_SEED_LEN];
+    uint8_t chain_code[WALLET_SEED_LEN];
+} WalletHdNode;
+
+/*
+ * SLIP-0010 ed25519 derivation from one master seed. Every intermediate
+ * node reached on the way to a requested path is kept in an LRU of
+ * WALLET_HD_CACHE_ENTRIES entries, so deriving m/44'/501'/n'/0' after
+ * m/44'/501'/(n-1)'/0' resumes from the cached m/44'/501' and costs two
+ * HMACs instead of four; a sibling of a cached parent costs one. Leaves
+ * are not cached. Not thread-safe: use one context per thread.
+ *
+ * The context holds key material; release it with wallet_hd_clear.
+ */
+typedef struct
+{
+    WalletHdNode master;
+    uint64_t clock;
+    WalletHdNode cache[WALLET_HD_CACHE_ENTRIES];
+} WalletHdContext;
+
+/* seed is 16 to 64 bytes, e.g. the seed half of a stored private key. */
+int wallet_hd_init(WalletHdContext *ctx, const uint8_t *seed, size_t seed_len);
+void wallet_hd_clear(WalletHdContext *ctx);
+
+/*
+ * Writes the 32-byte ed25519 seed for path. ed25519 only supports hardened
+ * children, so every index must have WALLET_HD_HARDENED set.
+ */
+int wallet_hd_derive(WalletHdContext *ctx, const uint32_t *path, size_t depth, uint8_t *out_seed);
+int wallet_hd_derive_keypair(WalletHdContext *ctx,
+                             const uint32_t *path,
+                             size_t depth,
+                             uint8_t *out_public_key,
+                             uint8_t *out_private_key);
+
+/* m/44'/501'/account'/0', the layout Solana wallets use. Returns WALLET_HD_SOLANA_DEPTH. */
+size_t wallet_hd_solana_path(uint32_t account, uint32_t *out_path);
+
+/* Parses "m/44'/501'/0'/0'" ('h' and 'H' also mark hardened indexes). */
+int wallet_hd_parse_path(const char *text, uint32_t *out_path, size_t max_depth, size_t *out_depth);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,299 @@
+/* getrandom, pthread_atfork and O_CLOEXEC with CMAKE_C_EXTENSIONS off */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wallet_random.h"
+#include "wallet_aead.h"
+#include "wallet_crypto.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <wincrypt.h>
+#else
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/random.h>
+#endif
+#endif
+
+#define WALLET_RANDOM_KEY_LEN 32u
+#define WALLET_RANDOM_BLOCKS 16u
+#define WALLET_RANDOM_BUFFER_LEN (WALLET_RANDOM_BLOCKS * 64u)
+
+typedef struct
+{
+    uint8_t key[WALLET_RANDOM_KEY_LEN];
+    uint8_t buffer[WALLET_RANDOM_BUFFER_LEN];
+    size_t available;
+    size_t served;
+    unsigned int fork_generation;
+    int seeded;
+} WalletRandomState;
+
+static volatile int random_buffered = 1;
+
+#ifndef _WIN32
+static pthread_once_t random_once = PTHREAD_ONCE_INIT;
+static pthread_key_t random_key;
+static int random_key_ready = 0;
+static volatile unsigned int random_fork_generation = 0u;
+/* Each key encrypts exactly one batch, so the nonce can stay fixed. */
+static const uint8_t random_zero_nonce[WALLET_AEAD_NONCE_LEN] = { 0 };
+
+static void wallet_random_init_once(void);
+static void wallet_random_after_fork(void);
+static void wallet_random_free_state(void *state);
+static WalletRandomState *wallet_random_state(void);
+static int wallet_random_refill(WalletRandomState *state);
+#endif
+
+int wallet_random_fill(uint8_t *buffer, size_t length)
+{
+    int status = APP_OK;
+
+    if ((buffer == NULL) && (length > 0u))
+    {
+        return APP_ERR_IO;
+    }
+
+#ifndef _WIN32
+    if (random_buffered != 0)
+    {
+        WalletRandomState *state = wallet_random_state();
+        size_t offset = 0u;
+
+        if (state == NULL)
+        {
+            return wallet_random_system(buffer, length);
+        }
+
+        while ((offset < length) && (status == APP_OK))
+        {
+            size_t copy_len = length - offset;
+
+            if ((state->available == 0u) || (state->seeded == 0) ||
+                (state->fork_generation != random_fork_generation) ||
+                (state->served >= WALLET_RANDOM_RESEED_BYTES))
+            {
+                status = wallet_random_refill(state);
+                continue;
+            }
+
+            if (copy_len > state->available)
+            {
+                copy_len = state->available;
+            }
+
+            /* Serve from the end and wipe what was handed out. */
+            memcpy(buffer + offset, state->buffer + state->available - copy_len, copy_len);
+            wallet_secure_zero(state->buffer + state->available - copy_len, copy_len);
+            state->available -= copy_len;
+            state->served += copy_len;
+            offset += copy_len;
+        }
+
+        if (status != APP_OK)
+        {
+            wallet_secure_zero(buffer, length);
+        }
+
+        return status;
+    }
+#endif
+
+    return wallet_random_system(buffer, length);
+}
+
+int wallet_random_system(uint8_t *buffer, size_t length)
+{
+    int status = APP_OK;
+
+    if ((buffer == NULL) && (length > 0u))
+    {
+        return APP_ERR_IO;
+    }
+
+#ifdef _WIN32
+    {
+        HCRYPTPROV provider;
+
+        if (!CryptAcquireContext(&provider, NULL, NULL, PROV_RSA_FULL, CRYPT_VERIFYCONTEXT))
+        {
+            status = APP_ERR_IO;
+        }
+        else
+        {
+            if ((length > 0u) && !CryptGenRandom(provider, (DWORD)length, buffer))
+            {
+                status = APP_ERR_IO;
+            }
+            CryptReleaseContext(provider, 0);
+        }
+    }
+#else
+    {
+        size_t offset = 0u;
+        int fd = -1;
+
+        while ((offset < length) && (status == APP_OK))
+        {
+            ssize_t received = -1;
+
+#if defined(__linux__)
+            if (fd < 0)
+            {
+                received = getrandom(buffer + offset, length - offset, 0);
+                if ((received < 0) && (errno == ENOSYS))
+                {
+                    fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+                    if (fd < 0)
+                    {
+                        status = APP_ERR_IO;
+                    }
+                    continue;
+                }
+            }
+            else
+#endif
+            {
+                if (fd < 0)
+                {
+                    fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+                    if (fd < 0)
+                    {
+                        status = APP_ERR_IO;
+                        continue;
+                    }
+                }
+                received = read(fd, buffer + offset, length - offset);
+            }
+
+            if (received > 0)
+            {
+                offset += (size_t)received;
+            }
+            else if ((received == 0) || (errno != EINTR))
+            {
+                status = APP_ERR_IO;
+            }
+        }
+
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+#endif
+
+    if ((status != APP_OK) && (buffer != NULL))
+    {
+        wallet_secure_zero(buffer, length);
+    }
+
+    return status;
+}
+
+void wallet_random_set_buffered(int enabled)
+{
+    random_buffered = (enabled != 0);
+}
+
+void wallet_random_wipe(void)
+{
+#ifndef _WIN32
+    if ((pthread_once(&random_once, wallet_random_init_once) == 0) && (random_key_ready != 0))
+    {
+        WalletRandomState *state = (WalletRandomState *)pthread_getspecific(random_key);
+        if (state != NULL)
+        {
+            wallet_secure_zero(state, sizeof(*state));
+        }
+    }
+#endif
+}
+
+#ifndef _WIN32
+
+static void wallet_random_init_once(void)
+{
+    if (pthread_key_create(&random_key, wallet_random_free_state) == 0)
+    {
+        random_key_ready = 1;
+        (void)pthread_atfork(NULL, NULL, wallet_random_after_fork);
+    }
+}
+
+/* Parent and child would otherwise hand out the same bytes. */
+static void wallet_random_after_fork(void)
+{
+    random_fork_generation++;
+}
+
+static void wallet_random_free_state(void *state)
+{
+    if (state != NULL)
+    {
+        wallet_secure_zero(state, sizeof(WalletRandomState));
+        free(state);
+    }
+}
+
+static WalletRandomState *wallet_random_state(void)
+{
+    WalletRandomState *state = NULL;
+
+    if ((pthread_once(&random_once, wallet_random_init_once) != 0) || (random_key_ready == 0))
+    {
+        return NULL;
+    }
+
+    state = (WalletRandomState *)pthread_getspecific(random_key);
+    if (state == NULL)
+    {
+        state = (WalletRandomState *)calloc(1u, sizeof(*state));
+        if ((state != NULL) && (pthread_setspecific(random_key, state) != 0))
+        {
+            free(state);
+            state = NULL;
+        }
+    }
+
+    return state;
+}
+
+/*
+ * Refill the output buffer. The first 32 bytes of each batch replace the key
+ * right away, so a later compromise of the state says nothing about bytes
+ * already handed out.
+ */
+static int wallet_random_refill(WalletRandomState *state)
+{
+    uint8_t block[(WALLET_RANDOM_BLOCKS + 1u) * 64u];
+
+    if ((state->seeded == 0) || (state->fork_generation != random_fork_generation) ||
+        (state->served >= WALLET_RANDOM_RESEED_BYTES))
+    {
+        wallet_secure_zero(state, sizeof(*state));
+        if (wallet_random_system(state->key, sizeof(state->key)) != APP_OK)
+        {
+            return APP_ERR_IO;
+        }
+        state->fork_generation = random_fork_generation;
+        state->seeded = 1;
+    }
+
+    wallet_chacha20_stream(state->key, random_zero_nonce, 0u, block, sizeof(block));
+    memcpy(state->key, block, WALLET_RANDOM_KEY_LEN);
+    memcpy(state->buffer, block + WALLET_RANDOM_KEY_LEN, WALLET_RANDOM_BUFFER_LEN);
+    state->available = WALLET_RANDOM_BUFFER_LEN;
+    wallet_secure_zero(block, sizeof(block));
+
+    return APP_OK;
+}
+
+#endif
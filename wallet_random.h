@@ -0,0 +1,37 @@
+#ifndef WALLET_RANDOM_H
+#define WALLET_RANDOM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bytes served from one thread's ChaCha20 generator before it goes back to the kernel. */
+#define WALLET_RANDOM_RESEED_BYTES (1024u * 1024u)
+
+/*
+ * Random bytes for keys, salts and nonces. Returns APP_OK or APP_ERR_IO;
+ * on failure the buffer is zeroed, never left partially filled.
+ *
+ * By default each thread draws from its own ChaCha20 generator keyed from
+ * getrandom(2) (fast key erasure: every refill rekeys from its own output),
+ * reseeded after WALLET_RANDOM_RESEED_BYTES and in a forked child.
+ */
+int wallet_random_fill(uint8_t *buffer, size_t length);
+
+/* Straight from the OS: getrandom(2), /dev/urandom or CryptGenRandom. */
+int wallet_random_system(uint8_t *buffer, size_t length);
+
+/* 0 sends every request to wallet_random_system. */
+void wallet_random_set_buffered(int enabled);
+
+/* Wipes the calling thread's generator state; the next request reseeds. */
+void wallet_random_wipe(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
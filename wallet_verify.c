@@ -0,0 +1,145 @@
+#include <string.h>
+#include <pthread.h>
+
+#include "wallet_verify.h"
+#include "wallet_crypto.h"
+#include "ge.h"
+#include "sc.h"
+#include "sha512.h"
+
+typedef struct
+{
+    uint64_t last_used;
+    uint8_t public_key[WALLET_PUBLIC_KEY_LEN];
+    ge_cached multiples[8];
+} WalletVerifyEntry;
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    uint64_t clock;
+    WalletVerifyEntry entries[WALLET_VERIFY_CACHE_ENTRIES];
+} WalletVerifyCache;
+
+/* last_used == 0 marks a free slot; the clock starts handing out 1. */
+static WalletVerifyCache verify_cache = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static int verify_cache_lookup(const uint8_t *public_key, ge_cached *out_multiples);
+static void verify_cache_insert(const uint8_t *public_key, const ge_cached *multiples);
+
+int wallet_verify(const uint8_t *signature,
+                  const uint8_t *message,
+                  size_t message_len,
+                  const uint8_t *public_key)
+{
+    ge_cached multiples[8];
+    uint8_t h[64];
+    uint8_t checker[32];
+    uint8_t diff = 0;
+    sha512_context hash;
+    ge_p2 R;
+    size_t i;
+
+    if (signature == NULL || public_key == NULL || (message == NULL && message_len != 0))
+    {
+        return 0;
+    }
+
+    if (signature[63] & 224)
+    {
+        return 0;
+    }
+
+    if (verify_cache_lookup(public_key, multiples) == 0)
+    {
+        ge_p3 A;
+
+        /* Stores -A, as ed25519_verify does, so the result is R = hA' + sB. */
+        if (ge_frombytes_negate_vartime(&A, public_key) != 0)
+        {
+            return 0;
+        }
+        ge_p3_to_cached_multiples(multiples, &A);
+        verify_cache_insert(public_key, multiples);
+    }
+
+    sha512_init(&hash);
+    sha512_update(&hash, signature, 32);
+    sha512_update(&hash, public_key, 32);
+    sha512_update(&hash, message, message_len);
+    sha512_final(&hash, h);
+
+    sc_reduce(h);
+    ge_double_scalarmult_vartime_cached(&R, h, multiples, signature + 32);
+    ge_tobytes(checker, &R);
+
+    for (i = 0; i < sizeof(checker); ++i)
+    {
+        diff |= (uint8_t)(checker[i] ^ signature[i]);
+    }
+
+    return diff == 0;
+}
+
+void wallet_verify_cache_clear(void)
+{
+    pthread_mutex_lock(&verify_cache.lock);
+    memset(verify_cache.entries, 0, sizeof(verify_cache.entries));
+    verify_cache.clock = 0;
+    pthread_mutex_unlock(&verify_cache.lock);
+}
+
+/* Copies the table out so it stays valid if another thread evicts the entry. */
+static int verify_cache_lookup(const uint8_t *public_key, ge_cached *out_multiples)
+{
+    int found = 0;
+    size_t i;
+
+    pthread_mutex_lock(&verify_cache.lock);
+    for (i = 0; i < WALLET_VERIFY_CACHE_ENTRIES; ++i)
+    {
+        WalletVerifyEntry *entry = &verify_cache.entries[i];
+
+        if (entry->last_used != 0 && memcmp(entry->public_key, public_key, WALLET_PUBLIC_KEY_LEN) == 0)
+        {
+            entry->last_used = ++verify_cache.clock;
+            memcpy(out_multiples, entry->multiples, sizeof(entry->multiples));
+            found = 1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&verify_cache.lock);
+
+    return found;
+}
+
+/*
+ * The table is built outside the lock, so two threads missing on the same
+ * key may both get here; the second one only refreshes the entry.
+ */
+static void verify_cache_insert(const uint8_t *public_key, const ge_cached *multiples)
+{
+    WalletVerifyEntry *victim = NULL;
+    size_t i;
+
+    pthread_mutex_lock(&verify_cache.lock);
+    for (i = 0; i < WALLET_VERIFY_CACHE_ENTRIES; ++i)
+    {
+        WalletVerifyEntry *entry = &verify_cache.entries[i];
+
+        if (entry->last_used != 0 && memcmp(entry->public_key, public_key, WALLET_PUBLIC_KEY_LEN) == 0)
+        {
+            victim = entry;
+            break;
+        }
+        if (victim == NULL || entry->last_used < victim->last_used)
+        {
+            victim = entry;
+        }
+    }
+
+    victim->last_used = ++verify_cache.clock;
+    memcpy(victim->public_key, public_key, WALLET_PUBLIC_KEY_LEN);
+    memcpy(victim->multiples, multiples, sizeof(victim->multiples));
+    pthread_mutex_unlock(&verify_cache.lock);
+}
@@ -0,0 +1,32 @@
+#ifndef WALLET_VERIFY_H
+#define WALLET_VERIFY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WALLET_VERIFY_CACHE_ENTRIES 16u
+
+/*
+ * Same answer as ed25519_verify (1 valid, 0 invalid), but the decompressed
+ * public key and its odd-multiples table (A, 3A, ..., 15A) are kept in a
+ * process-wide LRU of WALLET_VERIFY_CACHE_ENTRIES keys, so repeat checks
+ * against a known key skip both. Public keys that do not decode are never
+ * cached. Safe to call from several threads.
+ */
+int wallet_verify(const uint8_t *signature,
+                  const uint8_t *message,
+                  size_t message_len,
+                  const uint8_t *public_key);
+
+/* Drops every cached key. */
+void wallet_verify_cache_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif